@@ -99,6 +99,11 @@
 #endif
 #endif
 
+/* PME replaces the k-space sum of EWALD */
+#if defined(PME) && !defined(EWALD)
+#undef PME
+#endif
+
 /* default short-range potential for DIPOLE is MORSE */
 #if ((defined(DIPOLE) || defined(KERMODE)) && !defined(BUCK))
 #define MORSE
@@ -123,6 +128,9 @@
    so that the forces go continuously to zero */
 #define POT_TAIL 0.05
 
+/* maximal length of potential tables chosen with pot_table_ferr */
+#define POT_TABLE_MAXLEN 1048576
+
 /* with VEC or MPI or NBL we always use buffer cells */
 #if defined(MPI) || defined(VEC) || defined(NBL)
 #define BUFCELLS
@@ -138,6 +146,20 @@
 #define NBLIST
 #endif
 
+/* cell pair caches for the two EAM2 force loops of the cell versions */
+#if defined(EAM2) && !defined(NBLIST) && !defined(ASYMPOT) && \
+   !defined(TWOD) && !defined(COVALENT)
+#define EAM2_CACHE
+#endif
+
+/* precomputed atom lists for the buffer cell updates between 
+   neighbor list rebuilds */
+#if defined(NBL) && !defined(VEC) && !defined(CBE) && !defined(KIM) && \
+   !defined(SR) && !defined(LOADBALANCE) && !defined(TWOD) && \
+   !defined(UNIAX) && !defined(VARCHG) && !defined(SM)
+#define COMM_LISTS
+#endif
+
 #ifdef BUFCELLS
 
 /* AR is the default. We could make the default machine dependent */
@@ -241,6 +263,10 @@
 #define MPI2
 #endif
 
+#if defined(MPI) && (MPI_VERSION>=3)
+#define MPI3
+#endif
+
 /******************************************************************************
 *
 * Constants
@@ -265,6 +291,15 @@
 #define NEIGH_LEN_INC  2
 #endif
 
+#ifdef EAM2_CACHE
+#define EAM2_CACHE_INC 64
+#ifdef EEAM
+#define EAM2_CACHE_LEN 4
+#else
+#define EAM2_CACHE_LEN 2
+#endif
+#endif
+
 #ifdef CNA
 #define MAX_NEIGH 12
 #define MAX_BONDS 24
@@ -69,6 +69,7 @@
 #define INBUF_TAG  400
 #define AT_BUF_TAG 500
 #define ANNOUNCE_TAG 600
+#define SHM_TAG    700
 
 /* Definition of the value that should be minimized */
 #define CGE  0 /* completely based on energy, no use of gradient information */
@@ -80,6 +81,8 @@
 #define LB_EMPTY_CELL 3
 #define LB_NON_PBC_BUFFER_CELL 4
 #define LB_CELL_SUBLEVELS 11 /*each cell is divided into sublevels for finer approximations of cpu domains*/
+#define LB_MIN_CELLS 2 /*minimum width of a domain in cells, in recursive bisection*/
+#define LB_COST_UNITS 16 /*integer load units per atom on average, used by orthogonal balancing*/
 
 #define LB_SEND_FORCE   1
 #define LB_SEND_CELL    2
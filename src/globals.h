@@ -148,6 +148,7 @@ EXTERN int lb_largest_cell INIT(0);
 EXTERN int lb_balancingType INIT(0);		   /* 0: communication limited to 26 neighbors */
 											   /* 1: communication with any neighbor */
 											   /* 2: only axis parallel movements */
+											   /* 3: hierarchical recursive bisection */
 EXTERN ivektor lb_cell_offset;                 /* offset of cell array (per cpu), required for local to global mapping*/
 
 EXTERN real lb_contractionRate INIT(-1);		/*Parameters that control load balancing*/
@@ -175,6 +176,15 @@ EXTERN real lb_loadVariance INIT(0.);
 EXTERN real lb_maxLoadTolerance INIT(1.1);
 EXTERN int lb_maxLoadOnCPU INIT(0);
 EXTERN int lb_preRuns INIT(0);
+EXTERN int lb_loadMeasure INIT(0);		/* 0: number of atoms */
+											/* 1: measured time of the force computation */
+											/* 2: cost model, atom pairs in neighboring cells */
+EXTERN real lb_costRate INIT(1.);		/* measured time per unit of the cost model on this CPU */
+EXTERN double lb_lastForceTime INIT(0.);	/* force and comm time at the last balancing step */
+EXTERN double lb_lastCommTime INIT(0.);
+EXTERN real lb_predictedMaxLoad INIT(0.);	/* max load expected after the last balancing step */
+EXTERN real lb_achievedMaxLoad INIT(0.);	/* max load measured since the last balancing step */
+EXTERN FILE *lbcost_file INIT(NULL);     /* pointer to .lbcost file */
 
 EXTERN lb_domainInfo lb_domain;
 /* Storing the local communication partners
@@ -189,7 +199,8 @@ EXTERN int lb_randomNumberGeneratorState INIT(42);
 
 EXTERN int *x_bounds;	/* Spacings for CPU in orthogonal */
 EXTERN int *y_bounds;	/* load-balancings */
-EXTERN int *z_bounds;
+EXTERN int *z_bounds;	/* in bisection, one set per slab (y) and per column (z) */
+EXTERN long lb_migratedAtoms INIT(0);	/* atoms sent to other CPUs in the current balancing step */
 
 #endif /*LOADBALANCE*/
 #ifdef VISCOUS
@@ -363,6 +374,18 @@ EXTERN vektor min_height INIT(nullvektor);
 EXTERN char *outbuf INIT(NULL);         /* output buffer */
 EXTERN int outbuf_size INIT(OUTPUT_BUF_SIZE * 1048576);
 EXTERN int inbuf_size  INIT(INPUT_BUF_SIZE  * 1048576);
+#ifdef ASYNC_CKPT
+EXTERN int async_checkpoint INIT(1);    /* write checkpoints in background */
+EXTERN int ckpt_pending INIT(0);        /* checkpoint in progress */
+EXTERN pthread_t ckpt_thread;           /* checkpoint writer thread */
+EXTERN cell ckpt_cell;                  /* snapshot of the local atoms */
+EXTERN char *ckpt_buf INIT(NULL);       /* output buffer of the writer */
+EXTERN int ckpt_buf_size INIT(0);
+EXTERN int ckpt_fzhlr INIT(0);          /* number of that checkpoint */
+#ifdef NYETENSOR
+EXTERN nyeTensorInfo *ckpt_nye INIT(NULL); /* snapshot of the Nye tensors */
+#endif
+#endif
 EXTERN str255 infilename INIT("\0");    /* Input File */
 EXTERN str255 itrfilename INIT("\0");   /* initial itr-file */
 EXTERN str255 outfilename INIT("\0");   /* Output File */
@@ -417,7 +440,13 @@ EXTERN long seed INIT(0);            /* seed for random number generator */
 EXTERN int  box_from_header INIT(0); /* read box from config file */
 #ifdef NBLIST
 EXTERN real nbl_margin INIT(0.4);    /* neighbor list margin */
+EXTERN int  nbl_adapt  INIT(0);      /* adapt margin to minimize time per step */
+EXTERN real nbl_skin   INIT(0.0);    /* margin actually used, <= nbl_margin */
 EXTERN real nbl_size   INIT(1.1);    /* neighbor list size */
+EXTERN int  nbl_full   INIT(0);      /* full neighbor lists, no actio=reactio */
+EXTERN int  nbl_sort   INIT(0);      /* sort atoms in cells every nbl_sort updates */
+EXTERN int  nbl_cluster INIT(0);     /* size of atom clusters in cluster pair lists */
+EXTERN int  nbl_comm_lists INIT(0);  /* buffer cell updates with atom lists */
 EXTERN int  nbl_count  INIT(0);      /* counting neighbor list rebuild */
 EXTERN int  have_valid_nbl INIT(0);
 EXTERN int  last_nbl_len   INIT(0);
@@ -478,6 +507,18 @@ EXTERN int n_out_grps   INIT(1);    /* number of output groups */
 EXTERN MPI_Comm cpugrid;                  /* Cartesian MPI communicator */
 
 EXTERN int outputgrpsize INIT(1); /* group size to be read in param */
+EXTERN int comm_overlap  INIT(0); /* overlap buffer cell exchange with forces */
+EXTERN int comm_mode     INIT(0); /* buffer exchange: 0 point-to-point, 
+                                     1 neighborhood collectives,
+                                     2 shared memory within a node */
+#ifdef MPI3
+EXTERN MPI_Comm cpugrid_axis[3];  /* neighborhoods along the CPU grid axes */
+EXTERN MPI_Comm cpugrid_node;     /* CPUs on the same node (comm_mode 2) */
+EXTERN int   nb_node_rank[3][2];  /* lower/upper neighbors in cpugrid_node */
+EXTERN MPI_Win shm_win;           /* receive buffers in shared memory */
+EXTERN real *shm_my_base;         /* start of our receive buffers */
+EXTERN real *shm_nb_base[3][2];   /* those of the neighbors, if on the node */
+#endif
 
 
 /* Send and Receive buffers */
@@ -516,6 +557,9 @@ EXTERN imd_timer time_fft_plan;
 EXTERN imd_timer time_input;
 EXTERN imd_timer time_integrate;
 EXTERN imd_timer time_forces;
+#ifdef MPI
+EXTERN imd_timer time_comm;
+#endif
 
 /* Parameters for the various ensembles */
 
@@ -1023,6 +1067,9 @@ EXTERN real r_cut [10][10];
 EXTERN real r2_cut[10][10];
 EXTERN real r_begin[55] INIT(zero55);
 EXTERN real pot_res[55] INIT(zero55);
+EXTERN real pot_table_ferr INIT(0.0);   /* max. force error, sets pot_res */
+EXTERN real pot_table_emax INIT(0.0);   /* no check where potential larger */
+EXTERN str255 pot_table_file INIT("\0"); /* write created table to file */
 EXTERN int  have_pre_pot INIT(0);
 /* Lennard-Jones */
 EXTERN real lj_epsilon_lin[55] INIT(zero55);
@@ -1082,6 +1129,11 @@ EXTERN pot_table_t embed_pot;                     /* embedding energy table  */
 EXTERN pot_table_t rho_h_tab;                     /* electron transfer table */
 EXTERN str255 eam2_emb_E_filename INIT("\0");     /* embedding energy file   */
 EXTERN str255 eam2_at_rho_filename INIT("\0");    /* electron transfer file  */
+#ifdef EAM2_CACHE
+EXTERN int eam2_cache INIT(0);            /* cache rho_h between force loops */
+EXTERN eam2_cache_t *eam2_pcache[27];     /* caches, parallel to pairs[]     */
+EXTERN int  neam2_pcache[27];             /* allocated caches per list       */
+#endif
 #ifdef EEAM
 EXTERN pot_table_t emod_pot;                      /* energy mod. term table  */
 EXTERN str255 eeam_mod_E_filename INIT("\0");     /* energy mod. term file   */
@@ -1340,6 +1392,7 @@ EXTERN int      ew_dx;
 EXTERN int      ew_dy;
 EXTERN int      ew_dz;
 EXTERN int      ew_test INIT(0);
+EXTERN int      respa_steps INIT(1);     /* k-space part every n steps */
 EXTERN vektor   *ew_kvek;
 EXTERN ivektor  *ew_ivek;
 EXTERN real     *ew_expk;
@@ -1351,8 +1404,18 @@ EXTERN real     *coskz;
 EXTERN real     *sinkz;
 EXTERN real     *coskr;
 EXTERN real     *sinkr;
+EXTERN int      ew_nloc;                 /* local atoms in exp(ikr) tables */
+EXTERN int      ew_nloc_max INIT(0);     /* room in exp(ikr) tables */
+EXTERN real     *ew_sum_cos;             /* structure factors */
+EXTERN real     *ew_sum_sin;
+EXTERN real     *ew_sum_buf;
 EXTERN real     ew_vorf;
 EXTERN real     twopi;
+#ifdef PME
+EXTERN int      ew_pme INIT(1);          /* use PME for the k-space part */
+EXTERN int      ew_pme_order INIT(4);    /* order of the B-splines */
+EXTERN ivektor  ew_pme_grid INIT(nullivektor); /* PME mesh, 0: from ew_kcut */
+#endif
 EXTERN pot_table_t coul_table; /* one table to hold all coul. and dipole fn */
 EXTERN real     coul_res   INIT(0); /* function table resolution */
 EXTERN real     coul_begin INIT(0.2); /* start of function table */
@@ -66,6 +66,9 @@ int main(int argc, char **argv)
   imd_init_timer( &time_input,      1, "input",     "orange");
   imd_init_timer( &time_integrate,  1, "integrate", "green" );
   imd_init_timer( &time_forces,     1, "forces",    "yellow");
+#ifdef MPI
+  imd_init_timer( &time_comm,       1, "comm",      "red"   );
+#endif
 #if defined(CBE)
   tick0 = ticks();
 #endif
@@ -258,6 +261,8 @@ int main(int argc, char **argv)
 	  	printf("LOAD BALANCING: After initial runs variance %f\n", lb_loadVariance);
 	  }
   }
+  lb_predictedMaxLoad = lb_maxLoad;
+  lb_migratedAtoms = 0;
 #endif
 
   imd_stop_timer(&time_setup);
@@ -282,6 +287,11 @@ int main(int argc, char **argv)
   }
 
 
+#ifdef ASYNC_CKPT
+  /* the last checkpoint must be on disk before we quit */
+  wait_config_async();
+#endif
+
 #if defined(CBE)
   tick1=ticks();
 #endif
@@ -298,6 +308,7 @@ int main(int argc, char **argv)
 #endif
 #ifdef LOADBALANCE
     if (NULL!= lblog_file) fclose(lblog_file);
+    if (NULL!= lbcost_file) fclose(lbcost_file);
 #endif
 #ifdef RELAX
     if (NULL!= ssdef_file) fclose( ssdef_file);
@@ -320,6 +331,9 @@ int main(int argc, char **argv)
 #ifdef NBLIST
     printf("Neighbor list update every %d steps on average\n\n",
            steps_max / MAX(nbl_count,1));
+    if (nbl_adapt)
+      printf("Adaptive neighbor list margin %f (at most %f)\n\n",
+             nbl_skin, nbl_margin);
 #endif
 
 #ifdef EPITAX
@@ -370,6 +384,10 @@ int main(int argc, char **argv)
            time_input.total,100*time_input.total/time_main.total);
     printf("Force  time:   %e seconds or %.1f %% of main loop\n",
            time_forces.total,100*time_forces.total/time_main.total);
+#ifdef MPI
+    printf("Comm   time:   %e seconds or %.1f %% of main loop\n",
+           time_comm.total,100*time_comm.total/time_main.total);
+#endif
 #endif
 
      fflush(stdout);
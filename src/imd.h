@@ -56,9 +56,12 @@
 #ifdef OMP
 #include <omp.h>
 #endif
+#ifdef ASYNC_CKPT
+#include <pthread.h>
+#endif
 
-/* FFT for diffraction patterns */
-#ifdef DIFFPAT
+/* FFT for diffraction patterns and particle mesh Ewald */
+#if defined(DIFFPAT) || defined(PME)
 #include <fftw3.h>
 #endif
 
@@ -422,6 +422,57 @@ void increase_neightab(neightab *neigh, int count)
 }
 #endif
 
+#ifdef EAM2_CACHE
+
+/******************************************************************************
+*
+*  increase the EAM2 cache of a pair of cells
+*
+******************************************************************************/
+
+void increase_eam2_cache(eam2_cache_t *ec, int count)
+{
+  ec->ij   = (integer *) realloc( ec->ij,   count * 2 * sizeof(integer) );
+  ec->drho = (real    *) realloc( ec->drho, 
+                                  count * EAM2_CACHE_LEN * sizeof(real) );
+  if ((ec->ij==NULL) || (ec->drho==NULL)) {
+    error("EAM2: cannot extend memory for pair cache");
+  }
+  ec->n_max = count;
+}
+
+/******************************************************************************
+*
+*  make sure there is an EAM2 cache for each pair of cells
+*
+******************************************************************************/
+
+void alloc_eam2_cache(void)
+{
+  int n, k, np;
+
+  for (n=0; n<nlists; ++n) {
+#ifdef BUFCELLS
+    np = npairs2[n];
+#else
+    np = npairs[n];
+#endif
+    if (neam2_pcache[n] >= np) continue;
+    eam2_pcache[n] = (eam2_cache_t *) realloc( eam2_pcache[n],
+                                      np * sizeof(eam2_cache_t) );
+    if (NULL==eam2_pcache[n]) error("EAM2: cannot allocate pair caches");
+    for (k=neam2_pcache[n]; k<np; ++k) {
+      eam2_pcache[n][k].n     = 0;
+      eam2_pcache[n][k].n_max = 0;
+      eam2_pcache[n][k].ij    = NULL;
+      eam2_pcache[n][k].drho  = NULL;
+    }
+    neam2_pcache[n] = np;
+  }
+}
+
+#endif
+
 
 
 /******************************************************************************
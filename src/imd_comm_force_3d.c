@@ -26,6 +26,15 @@
 /* send_cells is located in imd_loadBalance_direct.c*/
 #else
 
+/* in AR mode, the west buffer cells are needed only for full neighbor lists */
+#if !defined(AR) || defined(COVALENT)
+#define WEST_BUFCELLS 1
+#elif defined(NBLIST)
+#define WEST_BUFCELLS nbl_full
+#else
+#define WEST_BUFCELLS 0
+#endif
+
 #ifdef SR
 
 /******************************************************************************
@@ -35,7 +44,8 @@
 *  We use Steve Plimptons communication scheme: we send only along
 *  the main axis of the system, so that edge cells travel twice,
 *  and corner cells three times. In AR mode, one cell wall (including
-*  adjacent edge and corner cells) is not needed in the buffer cells.
+*  adjacent edge and corner cells) is not needed in the buffer cells,
+*  unless full neighbor lists are used.
 *
 ******************************************************************************/
 
@@ -166,9 +176,8 @@ void send_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
     for (i=0; i < cell_dim.y; ++i)
       for (j=0; j < cell_dim.z; ++j) {
         (*copy_func)( 1, i, j, cell_dim.x-1, i, j, evec );
-#if !defined(AR) || defined(COVALENT)
-        (*copy_func)( cell_dim.x-2, i, j, 0, i, j, wvec );
-#endif
+        if (WEST_BUFCELLS)
+          (*copy_func)( cell_dim.x-2, i, j, 0, i, j, wvec );
       }
   }
 #ifdef MPI
@@ -187,21 +196,21 @@ void send_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
       for (j=0; j < cell_dim.z; ++j)
         (*unpack_func)( &recv_buf_west, cell_dim.x-1, i, j );
 
-#if !defined(AR) || defined(COVALENT)
-    /* copy west atoms into send buffer */
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_west, cell_dim.x-2, i, j, wvec );
+    if (WEST_BUFCELLS) {
+      /* copy west atoms into send buffer */
+      for (i=0; i < cell_dim.y; ++i)
+        for (j=0; j < cell_dim.z; ++j)
+          (*pack_func)( &send_buf_west, cell_dim.x-2, i, j, wvec );
 
-    /* send west, receive east */
-    sendrecv_buf(&send_buf_west, nbwest, &recv_buf_east, nbeast, &stat);
+      /* send west, receive east */
+      sendrecv_buf(&send_buf_west, nbwest, &recv_buf_east, nbeast, &stat);
 
-    /* unpack atoms from east */
-    recv_buf_east.n = 0;
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*unpack_func)( &recv_buf_east, 0, i, j );
-#endif
+      /* unpack atoms from east */
+      recv_buf_east.n = 0;
+      for (i=0; i < cell_dim.y; ++i)
+        for (j=0; j < cell_dim.z; ++j)
+          (*unpack_func)( &recv_buf_east, 0, i, j );
+    }
   }
 #endif
 }
@@ -215,186 +224,761 @@ void send_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
 *  We use Steve Plimptons communication scheme: we send only along
 *  the main axis of the system, so that edge cells travel twice,
 *  and corner cells three times. In AR mode, one cell wall (including
-*  adjacent edge and corner cells) is not needed in the buffer cells.
+*  adjacent edge and corner cells) is not needed in the buffer cells,
+*  unless full neighbor lists are used.
+*
+*  The exchange can also be done in the background: send_cells_begin
+*  starts the up/down exchange, send_cells_test completes the exchange
+*  along one axis after the other as far as the messages have arrived,
+*  and send_cells_end waits for the rest. In between, the caller may
+*  work on the inner cells, which are only read by the pack functions.
 *
 ******************************************************************************/
 
-void send_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
-                void (*pack_func)  (msgbuf*, int, int, int, vektor),
-                void (*unpack_func)(msgbuf*, int, int, int))
+#ifdef MPI
+
+/******************************************************************************
+*
+*  exchange_start starts the exchange of message buffers with the two
+*  neighbors along an axis of the CPU grid (0: east/west, 1: north/south,
+*  2: up/down). send_lo goes to the neighbor at the lower coordinate 
+*  (east, north, up) and recv_hi comes from the other one, and vice
+*  versa for send_hi and recv_lo. NULL buffers mean that there is no 
+*  exchange in that direction. The exchange is completed with 
+*  exchange_wait or exchange_test. With comm_mode 1, the exchange is a
+*  neighborhood collective on the communicator of the axis, preceded 
+*  by an exchange of the message sizes.
+*
+*  With comm_mode 2, the receive buffers are in shared memory (see
+*  alloc_shm_buffers), and a neighbor on the same node copies its send
+*  buffer directly into our receive buffer. We tell it when our receive
+*  buffer is ready, and it tells us when the data is there, with short
+*  messages. Neighbors on other nodes get ordinary messages.
+*
+******************************************************************************/
+
+#ifdef MPI3
+/* comm_mode 2 exchange in progress, for direction 0 (send_lo/recv_hi)
+   and 1 (send_hi/recv_lo) */
+static msgbuf      *shm_src[2];    /* send buffer still to be copied */
+static real        *shm_dst[2];    /* where it goes */
+static int          shm_nb[2];     /* receiving neighbor */
+static int          shm_cnt[2], shm_dummy;
+static MPI_Request  shm_req[6];    /* 0,1: ready from / done to receiver,
+                                      2,3: ready to sender, 4,5: done from
+                                      sender */
+#endif
+
+static void exchange_start(int axis, msgbuf *send_lo, msgbuf *recv_hi,
+                           msgbuf *send_hi, msgbuf *recv_lo, MPI_Request *req)
+{
+  int lo, hi;
+
+#ifdef MPI3
+  if (comm_mode==1) {
+    /* these must remain valid until the exchange is complete */
+    static int          scnt[2], rcnt[2];
+    static MPI_Aint     sdsp[2], rdsp[2];
+    static MPI_Datatype typ[2];
+    msgbuf *sbuf[2], *rbuf[2];
+    int k;
+
+    /* we send to the lower, then the upper neighbor, and receive from
+       the upper, then the lower one (see setup_mpi_topology) */
+    sbuf[0] = send_lo; rbuf[0] = recv_hi;
+    sbuf[1] = send_hi; rbuf[1] = recv_lo;
+    for (k=0; k<2; ++k) {
+      scnt[k] = sbuf[k] ? sbuf[k]->n : 0;
+      sdsp[k] = 0;
+      rdsp[k] = 0;
+      if (sbuf[k]) MPI_Get_address( sbuf[k]->data, &sdsp[k] );
+      if (rbuf[k]) MPI_Get_address( rbuf[k]->data, &rdsp[k] );
+      typ[k] = REAL;
+    }
+    MPI_Neighbor_alltoall( scnt, 1, MPI_INT, rcnt, 1, MPI_INT, 
+                           cpugrid_axis[axis] );
+    MPI_Ineighbor_alltoallw( MPI_BOTTOM, scnt, sdsp, typ, 
+                             MPI_BOTTOM, rcnt, rdsp, typ, 
+                             cpugrid_axis[axis], &req[0] );
+    req[1] = MPI_REQUEST_NULL;
+    req[2] = MPI_REQUEST_NULL;
+    req[3] = MPI_REQUEST_NULL;
+    return;
+  }
+#endif
+
+  lo = (axis==0) ? nbeast : ((axis==1) ? nbnorth : nbup  );
+  hi = (axis==0) ? nbwest : ((axis==1) ? nbsouth : nbdown);
+  req[0] = req[1] = req[2] = req[3] = MPI_REQUEST_NULL;
+
+#ifdef MPI3
+  if (comm_mode==2) {
+    msgbuf *sbuf[2], *rbuf[2];
+    int    nb[2], d, k;
+
+    sbuf[0] = send_lo; rbuf[0] = recv_hi; nb[0] = lo;
+    sbuf[1] = send_hi; rbuf[1] = recv_lo; nb[1] = hi;
+    for (k=0; k<6; ++k) shm_req[k] = MPI_REQUEST_NULL;
+    for (d=0; d<2; ++d) {
+      shm_src[d] = NULL;
+      if (NULL==sbuf[d]) continue;
+      /* receive from the neighbor on the other side */
+      if (shm_nb_base[axis][1-d]) {
+        MPI_Isend( &shm_dummy, 0, MPI_INT, nb[1-d], SHM_TAG + d, 
+                   cpugrid, &shm_req[2+d] );
+        MPI_Irecv( &shm_cnt[d], 1, MPI_INT, nb[1-d], SHM_TAG + 2 + d, 
+                   cpugrid, &shm_req[4+d] );
+      }
+      else irecv_buf( rbuf[d], nb[1-d], &req[2*d+1] );
+      /* send to the neighbor on this side */
+      if (shm_nb_base[axis][d]) {
+        if (sbuf[d]->n > rbuf[d]->n_max)
+          error("Buffer overflow in exchange_start - increase msgbuf_size");
+        shm_src[d] = sbuf[d];
+        shm_dst[d] = shm_nb_base[axis][d] + (rbuf[d]->data - shm_my_base);
+        shm_nb [d] = nb[d];
+        MPI_Irecv( &shm_dummy, 0, MPI_INT, nb[d], SHM_TAG + d, 
+                   cpugrid, &shm_req[d] );
+      }
+      else isend_buf( sbuf[d], nb[d], &req[2*d] );
+    }
+    return;
+  }
+#endif
+
+  if (send_lo) {
+    irecv_buf( recv_hi, hi, &req[1] );
+    isend_buf( send_lo, lo, &req[0] );
+  }
+  if (send_hi) {
+    irecv_buf( recv_lo, lo, &req[3] );
+    isend_buf( send_hi, hi, &req[2] );
+  }
+}
+
+#ifdef MPI3
+
+/* progress of a comm_mode 2 exchange, returns 1 when complete */
+static int shm_progress(int wait)
+{
+  MPI_Status stat[6];
+  int d, flag;
+
+  /* copy our data as soon as the receiver is ready */
+  for (d=0; d<2; ++d) {
+    if (NULL==shm_src[d]) continue;
+    if (wait) {
+      MPI_Wait( &shm_req[d], stat );
+      flag = 1;
+    }
+    else MPI_Test( &shm_req[d], &flag, stat );
+    if (flag) {
+      memcpy( shm_dst[d], shm_src[d]->data, shm_src[d]->n * sizeof(real) );
+      MPI_Win_sync( shm_win );
+      MPI_Isend( &shm_src[d]->n, 1, MPI_INT, shm_nb[d], SHM_TAG + 2 + d, 
+                 cpugrid, &shm_req[d] );
+      shm_src[d] = NULL;
+    }
+  }
+  if (shm_src[0] || shm_src[1]) return 0;
+
+  /* wait for the data of the senders */
+  if (wait) {
+    MPI_Waitall( 6, shm_req, stat );
+    flag = 1;
+  }
+  else MPI_Testall( 6, shm_req, &flag, stat );
+  if (flag) MPI_Win_sync( shm_win );
+  return flag;
+}
+
+#endif
+
+/* complete an exchange */
+static void exchange_wait(MPI_Request *req)
+{
+  MPI_Status stat[4];
+
+#ifdef MPI3
+  if (comm_mode==2) shm_progress(1);
+#endif
+  MPI_Waitall(4, req, stat);
+}
+
+/* returns 1 if the exchange is complete */
+static int exchange_test(MPI_Request *req)
+{
+  MPI_Status stat[4];
+  int flag;
+
+#ifdef MPI3
+  if ((comm_mode==2) && (0==shm_progress(0))) return 0;
+#endif
+  MPI_Testall(4, req, &flag, stat);
+  return flag;
+}
+
+#endif
+
+/* state of the exchange in progress */
+static void (*sc_copy)  (int, int, int, int, int, int, vektor);
+static void (*sc_pack)  (msgbuf*, int, int, int, vektor);
+static void (*sc_unpack)(msgbuf*, int, int, int);
+static vektor sc_uvec, sc_dvec, sc_nvec, sc_svec, sc_evec, sc_wvec;
+static int    sc_axis = 3;  /* axis in flight: 0 up/down, 1 north/south, 
+                               2 east/west, 3 none */
+#ifdef MPI
+static MPI_Request sc_req[4];
+#endif
+
+/* start the exchange along an axis, or do it right away on a single CPU */
+static void send_cells_start(int axis)
 {
   int i,j;
 
-  vektor uvec={0,0,0}, dvec={0,0,0};
-  vektor nvec={0,0,0}, svec={0,0,0};
-  vektor evec={0,0,0}, wvec={0,0,0};
+  sc_axis = axis;
 
+  /* exchange up/down */
+  if (axis==0) {
+    if (cpu_dim.z==1) {
+      /* simply copy up/down atoms to buffer cells*/
+      for (i=1; i < cell_dim.x-1; ++i)
+        for (j=1; j < cell_dim.y-1; ++j) {
+          (*sc_copy)( i, j, 1, i, j, cell_dim.z-1, sc_uvec );
+          (*sc_copy)( i, j, cell_dim.z-2, i, j, 0, sc_dvec );
+        }
+      send_cells_start(1);
+    }
 #ifdef MPI
-  MPI_Status  stateast[2],  statwest[2];
-  MPI_Status statnorth[2], statsouth[2];
-  MPI_Status    statup[2],  statdown[2];
+    else {
+      /* copy up and down atoms into send buffers, send up and down */
+      for (i=1; i < cell_dim.x-1; ++i)
+        for (j=1; j < cell_dim.y-1; ++j) {
+          (*sc_pack)( &send_buf_up,   i, j, 1,            sc_uvec );
+          (*sc_pack)( &send_buf_down, i, j, cell_dim.z-2, sc_dvec );
+        }
+      exchange_start( 2, &send_buf_up,   &recv_buf_down, 
+                         &send_buf_down, &recv_buf_up, sc_req );
+    }
+#endif
+  }
 
-  MPI_Request  reqeast[2],   reqwest[2];
-  MPI_Request reqnorth[2],  reqsouth[2];
-  MPI_Request    requp[2],   reqdown[2];
+  /* exchange north/south */
+  else if (axis==1) {
+    if (cpu_dim.y==1) {
+      /* simply copy north/south atoms to buffer cells */
+      for (i=1; i < cell_dim.x-1; ++i)
+        for (j=0; j < cell_dim.z; ++j) {
+          (*sc_copy)( i, 1, j, i, cell_dim.y-1, j, sc_nvec );
+          (*sc_copy)( i, cell_dim.y-2, j, i, 0, j, sc_svec );
+        }
+      send_cells_start(2);
+    }
+#ifdef MPI
+    else {
+      /* copy north and south atoms into send buffers, send north/south */
+      for (i=1; i < cell_dim.x-1; ++i)
+        for (j=0; j < cell_dim.z; ++j) {
+          (*sc_pack)( &send_buf_north, i, 1,            j, sc_nvec );
+          (*sc_pack)( &send_buf_south, i, cell_dim.y-2, j, sc_svec );
+        }
+      exchange_start( 1, &send_buf_north, &recv_buf_south, 
+                         &send_buf_south, &recv_buf_north, sc_req );
+    }
+#endif
+  }
 
-  empty_mpi_buffers();
+  /* exchange east/west*/
+  else if (axis==2) {
+    if (cpu_dim.x==1) {
+      /* simply copy east/west atoms to buffer cells*/
+      for (i=0; i < cell_dim.y; ++i)
+        for (j=0; j < cell_dim.z; ++j) {
+          (*sc_copy)( 1, i, j, cell_dim.x-1, i, j, sc_evec );
+          if (WEST_BUFCELLS)
+            (*sc_copy)( cell_dim.x-2, i, j, 0, i, j, sc_wvec );
+        }
+      sc_axis = 3;
+    }
+#ifdef MPI
+    else {
+      /* copy east (and west) atoms into send buffers, send east/west */
+      for (i=0; i < cell_dim.y; ++i)
+        for (j=0; j < cell_dim.z; ++j) {
+          (*sc_pack)( &send_buf_east, 1, i, j, sc_evec );
+          if (WEST_BUFCELLS)
+            (*sc_pack)( &send_buf_west, cell_dim.x-2, i, j, sc_wvec );
+        }
+      if (WEST_BUFCELLS)
+        exchange_start( 0, &send_buf_east, &recv_buf_west,
+                           &send_buf_west, &recv_buf_east, sc_req );
+      else
+        exchange_start( 0, &send_buf_east, &recv_buf_west, NULL, NULL, sc_req );
+    }
 #endif
+  }
+}
+
+#ifdef MPI
+
+/* move the received atoms of the axis in flight to the buffer cells */
+static void send_cells_finish(void)
+{
+  int i,j;
+
+  if (sc_axis==0) {
+    /* unpack atoms from down */
+    recv_buf_down.n = 0;
+    for (i=1; i < cell_dim.x-1; ++i)
+      for (j=1; j < cell_dim.y-1; ++j)
+        (*sc_unpack)( &recv_buf_down, i, j, cell_dim.z-1 );
+    /* unpack atoms from up */
+    recv_buf_up.n = 0;
+    for (i=1; i < cell_dim.x-1; ++i)
+      for (j=1; j < cell_dim.y-1; ++j)
+        (*sc_unpack)( &recv_buf_up, i, j, 0 );
+    send_cells_start(1);
+  }
+  else if (sc_axis==1) {
+    /* unpack atoms from south */
+    recv_buf_south.n = 0;
+    for (i=1; i < cell_dim.x-1; ++i)
+      for (j=0; j < cell_dim.z; ++j)
+        (*sc_unpack)( &recv_buf_south, i, cell_dim.y-1, j );
+    /* unpack atoms from north */
+    recv_buf_north.n = 0;
+    for (i=1; i < cell_dim.x-1; ++i)
+      for (j=0; j < cell_dim.z; ++j)
+        (*sc_unpack)( &recv_buf_north, i, 0, j );
+    send_cells_start(2);
+  }
+  else if (sc_axis==2) {
+    /* unpack atoms from west */
+    recv_buf_west.n = 0;
+    for (i=0; i < cell_dim.y; ++i)
+      for (j=0; j < cell_dim.z; ++j)
+        (*sc_unpack)( &recv_buf_west, cell_dim.x-1, i, j );
+    if (WEST_BUFCELLS) {
+      /* unpack atoms from east */
+      recv_buf_east.n = 0;
+      for (i=0; i < cell_dim.y; ++i)
+        for (j=0; j < cell_dim.z; ++j)
+          (*sc_unpack)( &recv_buf_east, 0, i, j );
+    }
+    sc_axis = 3;
+  }
+}
 
-#ifdef VEC
-  atoms.n_buf = atoms.n;
 #endif
+
+/* periodic images are shifted when sent, with neighbor lists only */
+static void set_shift_vectors(void)
+{
+  vektor null={0,0,0};
+
+  sc_uvec = sc_dvec = sc_nvec = sc_svec = sc_evec = sc_wvec = null;
 #ifdef NBLIST
   if (pbc_dirs.x==1) {
-    if (my_coord.x==0) evec = box_x;
+    if (my_coord.x==0) sc_evec = box_x;
     if (my_coord.x==cpu_dim.x-1) {
-      wvec.x = -box_x.x; wvec.y = -box_x.y; wvec.z = -box_x.z;
+      sc_wvec.x = -box_x.x; sc_wvec.y = -box_x.y; sc_wvec.z = -box_x.z;
     }
   }
   if (pbc_dirs.y==1) {
-    if (my_coord.y==0) nvec = box_y;
+    if (my_coord.y==0) sc_nvec = box_y;
     if (my_coord.y==cpu_dim.y-1) {
-      svec.x = -box_y.x; svec.y = -box_y.y; svec.z = -box_y.z;
+      sc_svec.x = -box_y.x; sc_svec.y = -box_y.y; sc_svec.z = -box_y.z;
     }
   }
   if (pbc_dirs.z==1) {
-    if (my_coord.z==0) uvec = box_z;
+    if (my_coord.z==0) sc_uvec = box_z;
     if (my_coord.z==cpu_dim.z-1) {
-      dvec.x = -box_z.x; dvec.y = -box_z.y; dvec.z = -box_z.z;
+      sc_dvec.x = -box_z.x; sc_dvec.y = -box_z.y; sc_dvec.z = -box_z.z;
     }
   }
 #endif
+}
 
-  /* exchange up/down */
-  if (cpu_dim.z==1) {
-    /* simply copy up/down atoms to buffer cells*/
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j) {
-        (*copy_func)( i, j, 1, i, j, cell_dim.z-1, uvec );
-        (*copy_func)( i, j, cell_dim.z-2, i, j, 0, dvec );
-      }
-  }
+void send_cells_begin(void (*copy_func)  (int, int, int, int, int, int, vektor),
+                      void (*pack_func)  (msgbuf*, int, int, int, vektor),
+                      void (*unpack_func)(msgbuf*, int, int, int))
+{
 #ifdef MPI
-  else {
-    /* copy up atoms into send buffer, send up */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
-        (*pack_func)( &send_buf_up, i, j, 1, uvec );
-    irecv_buf( &recv_buf_down , nbdown, &reqdown[1]);
-    isend_buf( &send_buf_up   , nbup  , &reqdown[0]);
+  imd_start_timer(&time_comm);
+  empty_mpi_buffers();
+#endif
+#ifdef VEC
+  atoms.n_buf = atoms.n;
+#endif
 
-    /* copy down atoms into send buffer, send down */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
-        (*pack_func)( &send_buf_down, i, j, cell_dim.z-2, dvec );
-    irecv_buf( &recv_buf_up  , nbup  , &requp[1] );
-    isend_buf( &send_buf_down, nbdown, &requp[0] );
+  sc_copy   = copy_func;
+  sc_pack   = pack_func;
+  sc_unpack = unpack_func;
+  set_shift_vectors();
+  send_cells_start(0);
+#ifdef MPI
+  imd_stop_timer(&time_comm);
+#endif
+}
 
-    /* wait for atoms from down, move them to buffer cells */
-    MPI_Waitall(2, reqdown, statdown);
-    recv_buf_down.n = 0;
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
-        (*unpack_func)( &recv_buf_down, i, j, cell_dim.z-1 );
+/* returns 1 if the exchange is complete */
+int send_cells_test(void)
+{
+#ifdef MPI
+  int flag = 1;
 
-    /* wait for atoms from up, move them to buffer cells*/
-    MPI_Waitall(2, requp, statup);
-    recv_buf_up.n = 0;
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
-        (*unpack_func)( &recv_buf_up, i, j, 0 );
+  imd_start_timer(&time_comm);
+  while ((sc_axis < 3) && flag) {
+    flag = exchange_test(sc_req);
+    if (flag) send_cells_finish();
   }
+  imd_stop_timer(&time_comm);
 #endif
+  return (sc_axis == 3);
+}
 
-  /* exchange north/south */
-  if (cpu_dim.y==1) {
-    /* simply copy north/south atoms to buffer cells */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j) {
-        (*copy_func)( i, 1, j, i, cell_dim.y-1, j, nvec );
-        (*copy_func)( i, cell_dim.y-2, j, i, 0, j, svec );
-      }
+void send_cells_end(void)
+{
+#ifdef MPI
+  imd_start_timer(&time_comm);
+  while (sc_axis < 3) {
+    exchange_wait(sc_req);
+    send_cells_finish();
   }
+  imd_stop_timer(&time_comm);
+#endif
+}
+
+void send_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
+                void (*pack_func)  (msgbuf*, int, int, int, vektor),
+                void (*unpack_func)(msgbuf*, int, int, int))
+{
+  send_cells_begin(copy_func, pack_func, unpack_func);
+  send_cells_end();
+}
+
+#ifdef COMM_LISTS
+
+/******************************************************************************
+*
+*  Between neighbor list rebuilds, the buffer cells contain the same atoms
+*  in the same order, and only their positions change. make_comm_lists 
+*  records, after a complete send_cells, which atoms are sent in each of
+*  the six directions (0: up, 1: down, 2: north, 3: south, 4: east, 
+*  5: west), and which buffer cell atoms they end up in. send_cells_lists
+*  then updates the positions, and send_forces_lists returns the forces, 
+*  by a gather and a scatter along these lists, without walking the cells
+*  and without sending cell counts and other constant atom data.
+*
+******************************************************************************/
+
+static comm_list_t cl_send[6], cl_recv[6];
+static int cl_nbl_count = -1;  /* neighbor list the lists belong to */
+
+/* directions with buffer cells, and with forces to send back */
+#define CL_USED(d) (((d) < 5) || WEST_BUFCELLS)
+#ifdef COVALENT
+#define CL_FORCES(d) CL_USED(d)
+#else
+#define CL_FORCES(d) ((d) < 5)
+#endif
+
+/* append the atoms of cell (k,l,m) to a list */
+static void add_comm_list(comm_list_t *cl, int k, int l, int m)
+{
+  minicell *p = PTR_3D_V(cell_array, k, l, m, cell_dim);
+  int i;
+
+  if (cl->n + p->n > cl->n_max) {
+    cl->n_max = cl->n + p->n + 256;
+    cl->cell  = (minicell **) realloc(cl->cell, cl->n_max * sizeof(minicell*));
+    cl->ind   = (int *) realloc(cl->ind, cl->n_max * sizeof(int));
+    if ((NULL==cl->cell) || (NULL==cl->ind))
+      error("cannot allocate communication lists");
+  }
+  for (i=0; i<p->n; ++i) {
+    cl->cell[cl->n] = p;
+    cl->ind [cl->n] = i;
+    cl->n++;
+  }
+}
+
+void make_comm_lists(void)
+{
+  int i, j, d;
+
+  for (d=0; d<6; ++d) cl_send[d].n = cl_recv[d].n = 0;
+
+  /* the cells are traversed as in send_cells */
+  for (i=1; i < cell_dim.x-1; ++i)
+    for (j=1; j < cell_dim.y-1; ++j) {
+      add_comm_list( cl_send + 0, i, j, 1 );
+      add_comm_list( cl_recv + 0, i, j, cell_dim.z-1 );
+      add_comm_list( cl_send + 1, i, j, cell_dim.z-2 );
+      add_comm_list( cl_recv + 1, i, j, 0 );
+    }
+  for (i=1; i < cell_dim.x-1; ++i)
+    for (j=0; j < cell_dim.z; ++j) {
+      add_comm_list( cl_send + 2, i, 1, j );
+      add_comm_list( cl_recv + 2, i, cell_dim.y-1, j );
+      add_comm_list( cl_send + 3, i, cell_dim.y-2, j );
+      add_comm_list( cl_recv + 3, i, 0, j );
+    }
+  for (i=0; i < cell_dim.y; ++i)
+    for (j=0; j < cell_dim.z; ++j) {
+      add_comm_list( cl_send + 4, 1, i, j );
+      add_comm_list( cl_recv + 4, cell_dim.x-1, i, j );
+      if (WEST_BUFCELLS) {
+        add_comm_list( cl_send + 5, cell_dim.x-2, i, j );
+        add_comm_list( cl_recv + 5, 0, i, j );
+      }
+    }
+  cl_nbl_count = nbl_count;
+}
+
 #ifdef MPI
-  else {
-    /* copy north atoms into send buffer, send north */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_north, i, 1, j, nvec );
-    irecv_buf( &recv_buf_south, nbsouth, &reqsouth[1] );
-    isend_buf( &send_buf_north, nbnorth, &reqsouth[0] );
 
-    /* copy south atoms into send buffer, send south*/
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_south, i, cell_dim.y-2, j, svec );
-    irecv_buf( &recv_buf_north, nbnorth, &reqnorth[1] );
-    isend_buf( &send_buf_south, nbsouth, &reqnorth[0] );
+/* gather positions of a list into a send buffer */
+static void pack_pos_list( msgbuf *b, comm_list_t *cl, vektor v )
+{
+  int n, j = 0;
 
-    /* wait for atoms from south, move them to buffer cells */
-    MPI_Waitall(2, reqsouth, statsouth);
-    recv_buf_south.n = 0;
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*unpack_func)( &recv_buf_south, i, cell_dim.y-1, j );
+  if (SDIM * cl->n > b->n_max)
+    error("Buffer overflow in pack_pos_list - increase msgbuf_size");
+  for (n=0; n<cl->n; ++n) {
+    minicell *p = cl->cell[n];
+    int       i = cl->ind [n];
+    b->data[ j++ ] = ORT(p,i,X) + v.x;
+    b->data[ j++ ] = ORT(p,i,Y) + v.y;
+    b->data[ j++ ] = ORT(p,i,Z) + v.z;
+  }
+  b->n = j;
+}
 
-    /* wait for atoms from north, move them to buffer cells*/
-    MPI_Waitall(2, reqnorth, statnorth);
-    recv_buf_north.n = 0;
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*unpack_func)( &recv_buf_north, i, 0, j );
+/* scatter positions from a receive buffer */
+static void unpack_pos_list( msgbuf *b, comm_list_t *cl )
+{
+  int n, j = 0;
+
+  if (SDIM * cl->n > b->n_max)
+    error("Buffer overflow in unpack_pos_list - increase msgbuf_size");
+  for (n=0; n<cl->n; ++n) {
+    minicell *p = cl->cell[n];
+    int       i = cl->ind [n];
+    ORT(p,i,X) = b->data[ j++ ];
+    ORT(p,i,Y) = b->data[ j++ ];
+    ORT(p,i,Z) = b->data[ j++ ];
   }
+  b->n = j;
+}
+
+/* gather forces of a list into a send buffer */
+static void pack_forces_list( msgbuf *b, comm_list_t *cl )
+{
+  int n, j = 0;
+
+  for (n=0; n<cl->n; ++n) {
+    minicell *p = cl->cell[n];
+    int       i = cl->ind [n];
+    b->data[ j++ ] = KRAFT(p,i,X);
+    b->data[ j++ ] = KRAFT(p,i,Y);
+    b->data[ j++ ] = KRAFT(p,i,Z);
+#ifndef MONOLJ
+    b->data[ j++ ] = POTENG(p,i);
+#endif
+#ifdef STRESS_TENS
+    b->data[ j++ ] = PRESSTENS(p,i,xx);
+    b->data[ j++ ] = PRESSTENS(p,i,yy);
+    b->data[ j++ ] = PRESSTENS(p,i,zz);
+    b->data[ j++ ] = PRESSTENS(p,i,yz);
+    b->data[ j++ ] = PRESSTENS(p,i,zx);
+    b->data[ j++ ] = PRESSTENS(p,i,xy);
 #endif
+#ifdef NNBR
+    b->data[ j++ ] = (real) NBANZ(p,i);
+#endif
+  }
+  b->n = j;
+  if (b->n_max < b->n)
+    error("Buffer overflow in pack_forces_list - increase msgbuf_size");
+}
 
-  /* exchange east/west*/
-  if (cpu_dim.x==1) {
-  /* simply copy east/west atoms to buffer cells*/
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j) {
-        (*copy_func)( 1, i, j, cell_dim.x-1, i, j, evec );
-#if !defined(AR) || defined(COVALENT)
-        (*copy_func)( cell_dim.x-2, i, j, 0, i, j, wvec );
+/* add forces from a receive buffer to the atoms of a list */
+static void unpack_forces_list( msgbuf *b, comm_list_t *cl )
+{
+  int n, j = 0;
+
+  for (n=0; n<cl->n; ++n) {
+    minicell *p = cl->cell[n];
+    int       i = cl->ind [n];
+    KRAFT(p,i,X) += b->data[ j++ ];
+    KRAFT(p,i,Y) += b->data[ j++ ];
+    KRAFT(p,i,Z) += b->data[ j++ ];
+#ifndef MONOLJ
+    POTENG(p,i)  += b->data[ j++ ];
 #endif
-      }
+#ifdef STRESS_TENS
+    PRESSTENS(p,i,xx) += b->data[ j++ ];
+    PRESSTENS(p,i,yy) += b->data[ j++ ];
+    PRESSTENS(p,i,zz) += b->data[ j++ ];
+    PRESSTENS(p,i,yz) += b->data[ j++ ];
+    PRESSTENS(p,i,zx) += b->data[ j++ ];
+    PRESSTENS(p,i,xy) += b->data[ j++ ];
+#endif
+#ifdef NNBR
+    NBANZ(p,i) += (shortint) b->data[ j++ ];
+#endif
+  }
+  b->n = j;
+  if (b->n_max < b->n)
+    error("Buffer overflow in unpack_forces_list - increase msgbuf_size");
+}
+
+#endif /* MPI */
+
+/* copy positions from one list to another on the same CPU */
+static void copy_pos_list( comm_list_t *from, comm_list_t *to, vektor v )
+{
+  int n;
+
+  for (n=0; n<to->n; ++n) {
+    minicell *p = from->cell[n], *q = to->cell[n];
+    int       i = from->ind [n],  k = to->ind [n];
+    ORT(q,k,X) = ORT(p,i,X) + v.x;
+    ORT(q,k,Y) = ORT(p,i,Y) + v.y;
+    ORT(q,k,Z) = ORT(p,i,Z) + v.z;
   }
+}
+
+/* add forces from one list to another on the same CPU */
+static void add_forces_list( comm_list_t *from, comm_list_t *to )
+{
+  int n;
+
+  for (n=0; n<to->n; ++n) {
+    minicell *p = from->cell[n], *q = to->cell[n];
+    int       i = from->ind [n],  k = to->ind [n];
+    KRAFT(q,k,X) += KRAFT(p,i,X);
+    KRAFT(q,k,Y) += KRAFT(p,i,Y);
+    KRAFT(q,k,Z) += KRAFT(p,i,Z);
+#ifndef MONOLJ
+    POTENG(q,k)  += POTENG(p,i);
+#endif
+#ifdef STRESS_TENS
+    PRESSTENS(q,k,xx) += PRESSTENS(p,i,xx);
+    PRESSTENS(q,k,yy) += PRESSTENS(p,i,yy);
+    PRESSTENS(q,k,zz) += PRESSTENS(p,i,zz);
+    PRESSTENS(q,k,yz) += PRESSTENS(p,i,yz);
+    PRESSTENS(q,k,zx) += PRESSTENS(p,i,zx);
+    PRESSTENS(q,k,xy) += PRESSTENS(p,i,xy);
+#endif
+#ifdef NNBR
+    NBANZ(q,k) += NBANZ(p,i);
+#endif
+  }
+}
+
+/* update the positions in the buffer cells */
+void send_cells_lists(void)
+{
+  vektor v[6];
+  int    a, d, dim[3];
 #ifdef MPI
-  else {
-  /* copy east atoms into send buffer, send east*/
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_east, 1, i, j, evec );
-    irecv_buf( &recv_buf_west, nbwest, &reqwest[1] );
-    isend_buf( &send_buf_east, nbeast, &reqwest[0] );
+  msgbuf *sbuf[6], *rbuf[6];
+  MPI_Request req[4];
+
+  sbuf[0] = &send_buf_up;    rbuf[0] = &recv_buf_down;
+  sbuf[1] = &send_buf_down;  rbuf[1] = &recv_buf_up;
+  sbuf[2] = &send_buf_north; rbuf[2] = &recv_buf_south;
+  sbuf[3] = &send_buf_south; rbuf[3] = &recv_buf_north;
+  sbuf[4] = &send_buf_east;  rbuf[4] = &recv_buf_west;
+  sbuf[5] = &send_buf_west;  rbuf[5] = &recv_buf_east;
+  imd_start_timer(&time_comm);
+  empty_mpi_buffers();
+#endif
 
-#if !defined(AR) || defined(COVALENT)
-    /* copy west atoms into send buffer, send west*/
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_west, cell_dim.x-2, i, j, wvec );
-    irecv_buf( &recv_buf_east, nbeast, &reqeast[1] );
-    isend_buf( &send_buf_west, nbwest, &reqeast[0] );
+  if (cl_nbl_count != nbl_count)
+    error("communication lists do not match the neighbor lists");
+
+  set_shift_vectors();
+  v[0] = sc_uvec; v[1] = sc_dvec; 
+  v[2] = sc_nvec; v[3] = sc_svec;
+  v[4] = sc_evec; v[5] = sc_wvec;
+  dim[0] = cpu_dim.z; dim[1] = cpu_dim.y; dim[2] = cpu_dim.x;
+
+  /* up/down, north/south, east/west */
+  for (a=0; a<3; ++a) {
+    if (dim[a]==1) {
+      for (d=2*a; d<2*a+2; ++d)
+        if (CL_USED(d)) copy_pos_list( cl_send + d, cl_recv + d, v[d] );
+    }
+#ifdef MPI
+    else {
+      for (d=2*a; d<2*a+2; ++d)
+        if (CL_USED(d)) pack_pos_list( sbuf[d], cl_send + d, v[d] );
+      exchange_start( 2-a, sbuf[2*a], rbuf[2*a], 
+                      CL_USED(2*a+1) ? sbuf[2*a+1] : NULL, rbuf[2*a+1], req );
+      exchange_wait(req);
+      for (d=2*a; d<2*a+2; ++d)
+        if (CL_USED(d)) unpack_pos_list( rbuf[d], cl_recv + d );
+    }
+#endif
+  }
+#ifdef MPI
+  imd_stop_timer(&time_comm);
 #endif
+}
 
-    /* wait for atoms from west, move them to buffer cells*/
-    MPI_Waitall(2, reqwest, statwest);
-    recv_buf_west.n = 0;
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*unpack_func)( &recv_buf_west, cell_dim.x-1, i, j );
+/* add the forces in the buffer cells back to the original atoms */
+void send_forces_lists(void)
+{
+  int a, d, dim[3];
+#ifdef MPI
+  msgbuf *sbuf[6], *rbuf[6];
+  MPI_Request req[4];
+
+  /* forces go the opposite way as the positions */
+  sbuf[0] = &send_buf_down;  rbuf[0] = &recv_buf_up;
+  sbuf[1] = &send_buf_up;    rbuf[1] = &recv_buf_down;
+  sbuf[2] = &send_buf_south; rbuf[2] = &recv_buf_north;
+  sbuf[3] = &send_buf_north; rbuf[3] = &recv_buf_south;
+  sbuf[4] = &send_buf_west;  rbuf[4] = &recv_buf_east;
+  sbuf[5] = &send_buf_east;  rbuf[5] = &recv_buf_west;
+  imd_start_timer(&time_comm);
+  empty_mpi_buffers();
+#endif
 
-#if !defined(AR) || defined(COVALENT)
-    /* wait for atoms from east, move them to buffer cells*/
-    MPI_Waitall(2, reqeast, stateast);
-    recv_buf_east.n = 0;
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*unpack_func)( &recv_buf_east, 0, i, j );
+  if (cl_nbl_count != nbl_count)
+    error("communication lists do not match the neighbor lists");
+
+  dim[0] = cpu_dim.z; dim[1] = cpu_dim.y; dim[2] = cpu_dim.x;
+
+  /* east/west, north/south, up/down, in the order of send_forces */
+  for (a=2; a>=0; --a) {
+    if (dim[a]==1) {
+      for (d=2*a+1; d>=2*a; --d)
+        if (CL_FORCES(d)) add_forces_list( cl_recv + d, cl_send + d );
+    }
+#ifdef MPI
+    else {
+      for (d=2*a+1; d>=2*a; --d)
+        if (CL_FORCES(d)) pack_forces_list( sbuf[d], cl_recv + d );
+      exchange_start( 2-a, CL_FORCES(2*a+1) ? sbuf[2*a+1] : NULL, rbuf[2*a+1],
+                           CL_FORCES(2*a)   ? sbuf[2*a]   : NULL, rbuf[2*a],
+                      req );
+      exchange_wait(req);
+      for (d=2*a+1; d>=2*a; --d)
+        if (CL_FORCES(d)) unpack_forces_list( rbuf[d], cl_send + d );
+    }
 #endif
   }
+#ifdef MPI
+  imd_stop_timer(&time_comm);
 #endif
 }
 
+#endif /* COMM_LISTS */
+
 #endif /* not SR */
 #endif /*not LOADBALANCE*/
 
@@ -573,14 +1157,9 @@ void send_forces(void (*add_func)   (int, int, int, int, int, int),
   int i,j;
 
 #ifdef MPI
-  MPI_Status  stateast[2],  statwest[2];
-  MPI_Status statnorth[2], statsouth[2];
-  MPI_Status    statup[2],  statdown[2];
-
-  MPI_Request  reqeast[2],   reqwest[2];
-  MPI_Request reqnorth[2],  reqsouth[2];
-  MPI_Request    requp[2],   reqdown[2];
+  MPI_Request req[4];
 
+  imd_start_timer(&time_comm);
   empty_mpi_buffers();
 #endif
 
@@ -597,33 +1176,31 @@ void send_forces(void (*add_func)   (int, int, int, int, int, int),
   }
 #ifdef MPI
   else {
-#if defined(COVALENT) || defined KIM
-    /* copy east forces into send buffer, send east */
+    /* copy east (and west) forces into send buffers, send east/west */
     for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
+      for (j=0; j < cell_dim.z; ++j) {
+#if defined(COVALENT) || defined KIM
         (*pack_func)( &send_buf_east, 0, i, j );
-    irecv_buf( &recv_buf_west, nbwest, &reqwest[1] );
-    isend_buf( &send_buf_east, nbeast, &reqwest[0] );
 #endif
-
-    /* copy west forces into send buffer, send west */
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
         (*pack_func)( &send_buf_west, cell_dim.x-1, i, j );
-    irecv_buf( &recv_buf_east, nbeast, &reqeast[1] );
-    isend_buf( &send_buf_west, nbwest, &reqeast[0] );
+      }
+#if defined(COVALENT) || defined KIM
+    exchange_start( 0, &send_buf_east, &recv_buf_west, 
+                       &send_buf_west, &recv_buf_east, req );
+#else
+    exchange_start( 0, NULL, NULL, &send_buf_west, &recv_buf_east, req );
+#endif
+    exchange_wait(req);
 
 #if defined(COVALENT) || defined KIM
-    /* wait for forces from west, add them to original cells */
-    MPI_Waitall(2, reqwest, statwest);
+    /* add forces from west to original cells */
     recv_buf_west.n = 0;
     for (i=0; i < cell_dim.y; ++i)
       for (j=0; j < cell_dim.z; ++j)
         (*unpack_func)( &recv_buf_west, cell_dim.x-2, i, j );
 #endif
 
-    /* wait for forces from east, add them to original cells */
-    MPI_Waitall(2, reqeast, stateast);
+    /* add forces from east to original cells */
     recv_buf_east.n = 0;
     for (i=0; i < cell_dim.y; ++i)
       for (j=0; j < cell_dim.z; ++j)
@@ -642,29 +1219,23 @@ void send_forces(void (*add_func)   (int, int, int, int, int, int),
   }
 #ifdef MPI
   else {
-    /* copy north forces into send buffer, send north */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_north, i, 0, j );
-    irecv_buf( &recv_buf_south, nbsouth, &reqsouth[1] );
-    isend_buf( &send_buf_north, nbnorth, &reqsouth[0] );
-
-    /* copy south forces into send buffer, send south */
+    /* copy north and south forces into send buffers, send north/south */
     for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
+      for (j=0; j < cell_dim.z; ++j) {
+        (*pack_func)( &send_buf_north, i, 0,            j );
         (*pack_func)( &send_buf_south, i, cell_dim.y-1, j );
-    irecv_buf( &recv_buf_north, nbnorth, &reqnorth[1] );
-    isend_buf( &send_buf_south, nbsouth, &reqnorth[0] );
+      }
+    exchange_start( 1, &send_buf_north, &recv_buf_south, 
+                       &send_buf_south, &recv_buf_north, req );
+    exchange_wait(req);
 
-    /* wait for forces from south, add them to original cells */
-    MPI_Waitall(2, reqsouth, statsouth);
+    /* add forces from south to original cells */
     recv_buf_south.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=0; j < cell_dim.z; ++j)
         (*unpack_func)( &recv_buf_south, i, cell_dim.y-2, j );
 
-    /* wait for forces from north, add them to original cells */
-    MPI_Waitall(2, reqnorth, statnorth);
+    /* add forces from north to original cells */
     recv_buf_north.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=0; j < cell_dim.z; ++j)
@@ -683,34 +1254,29 @@ void send_forces(void (*add_func)   (int, int, int, int, int, int),
   }
 #ifdef MPI
   else {
-    /* copy up forces into send buffer, send up */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
-        (*pack_func)( &send_buf_up, i, j, 0 );
-    irecv_buf( &recv_buf_down , nbdown, &reqdown[1]);
-    isend_buf( &send_buf_up   , nbup  , &reqdown[0]);
-
-    /* copy down forces into send buffer, send down */
+    /* copy up and down forces into send buffers, send up/down */
     for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
+      for (j=1; j < cell_dim.y-1; ++j) {
+        (*pack_func)( &send_buf_up,   i, j, 0            );
         (*pack_func)( &send_buf_down, i, j, cell_dim.z-1 );
-    irecv_buf( &recv_buf_up  , nbup  , &requp[1] );
-    isend_buf( &send_buf_down, nbdown, &requp[0] );
+      }
+    exchange_start( 2, &send_buf_up,   &recv_buf_down, 
+                       &send_buf_down, &recv_buf_up, req );
+    exchange_wait(req);
 
-    /* wait for forces from down, add them to original cells */
-    MPI_Waitall(2, reqdown, statdown);
+    /* add forces from down to original cells */
     recv_buf_down.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=1; j < cell_dim.y-1; ++j)
         (*unpack_func)( &recv_buf_down, i, j, cell_dim.z-2 );
 
-    /* wait for forces from up, add them to original cells */
-    MPI_Waitall(2, requp, statup);
+    /* add forces from up to original cells */
     recv_buf_up.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=1; j < cell_dim.y-1; ++j)
         (*unpack_func)( &recv_buf_up, i, j, 1 );
   }
+  imd_stop_timer(&time_comm);
 #endif
 }
 
@@ -2051,14 +2617,9 @@ void sync_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
   vektor evec={0,0,0}, wvec={0,0,0};
 
 #ifdef MPI
-  MPI_Status  stateast[2],  statwest[2];
-  MPI_Status statnorth[2], statsouth[2];
-  MPI_Status    statup[2],  statdown[2];
-
-  MPI_Request  reqeast[2],   reqwest[2];
-  MPI_Request reqnorth[2],  reqsouth[2];
-  MPI_Request    requp[2],   reqdown[2];
+  MPI_Request req[4];
 
+  imd_start_timer(&time_comm);
   empty_mpi_buffers();
 #endif
 
@@ -2097,29 +2658,23 @@ void sync_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
   }
 #ifdef MPI
   else {
-    /* copy up atoms into send buffer, send up */
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
-        (*pack_func)( &send_buf_up, i, j, 1, uvec );
-    irecv_buf( &recv_buf_down , nbdown, &reqdown[1]);
-    isend_buf( &send_buf_up   , nbup  , &reqdown[0]);
-
-    /* copy down atoms into send buffer, send down */
+    /* copy up and down atoms into send buffers, send up/down */
     for (i=1; i < cell_dim.x-1; ++i)
-      for (j=1; j < cell_dim.y-1; ++j)
+      for (j=1; j < cell_dim.y-1; ++j) {
+        (*pack_func)( &send_buf_up,   i, j, 1,            uvec );
         (*pack_func)( &send_buf_down, i, j, cell_dim.z-2, dvec );
-    irecv_buf( &recv_buf_up  , nbup  , &requp[1] );
-    isend_buf( &send_buf_down, nbdown, &requp[0] );
+      }
+    exchange_start( 2, &send_buf_up,   &recv_buf_down, 
+                       &send_buf_down, &recv_buf_up, req );
+    exchange_wait(req);
 
-    /* wait for atoms from down, move them to buffer cells */
-    MPI_Waitall(2, reqdown, statdown);
+    /* move atoms from down to buffer cells */
     recv_buf_down.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=1; j < cell_dim.y-1; ++j)
         (*unpack_func)( &recv_buf_down, i, j, cell_dim.z-1 );
 
-    /* wait for atoms from up, move them to buffer cells*/
-    MPI_Waitall(2, requp, statup);
+    /* move atoms from up to buffer cells */
     recv_buf_up.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=1; j < cell_dim.y-1; ++j)
@@ -2138,29 +2693,23 @@ void sync_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
   }
 #ifdef MPI
   else {
-    /* copy north atoms into send buffer, send north */
+    /* copy north and south atoms into send buffers, send north/south */
     for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_north, i, 1, j, nvec );
-    irecv_buf( &recv_buf_south, nbsouth, &reqsouth[1] );
-    isend_buf( &send_buf_north, nbnorth, &reqsouth[0] );
-
-    /* copy south atoms into send buffer, send south*/
-    for (i=1; i < cell_dim.x-1; ++i)
-      for (j=0; j < cell_dim.z; ++j)
+      for (j=0; j < cell_dim.z; ++j) {
+        (*pack_func)( &send_buf_north, i, 1,            j, nvec );
         (*pack_func)( &send_buf_south, i, cell_dim.y-2, j, svec );
-    irecv_buf( &recv_buf_north, nbnorth, &reqnorth[1] );
-    isend_buf( &send_buf_south, nbsouth, &reqnorth[0] );
+      }
+    exchange_start( 1, &send_buf_north, &recv_buf_south, 
+                       &send_buf_south, &recv_buf_north, req );
+    exchange_wait(req);
 
-    /* wait for atoms from south, move them to buffer cells */
-    MPI_Waitall(2, reqsouth, statsouth);
+    /* move atoms from south to buffer cells */
     recv_buf_south.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=0; j < cell_dim.z; ++j)
         (*unpack_func)( &recv_buf_south, i, cell_dim.y-1, j );
 
-    /* wait for atoms from north, move them to buffer cells*/
-    MPI_Waitall(2, reqnorth, statnorth);
+    /* move atoms from north to buffer cells */
     recv_buf_north.n = 0;
     for (i=1; i < cell_dim.x-1; ++i)
       for (j=0; j < cell_dim.z; ++j)
@@ -2179,34 +2728,29 @@ void sync_cells(void (*copy_func)  (int, int, int, int, int, int, vektor),
   }
 #ifdef MPI
   else {
-  /* copy east atoms into send buffer, send east*/
+    /* copy east and west atoms into send buffers, send east/west */
     for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
-        (*pack_func)( &send_buf_east, 1, i, j, evec );
-    irecv_buf( &recv_buf_west, nbwest, &reqwest[1] );
-    isend_buf( &send_buf_east, nbeast, &reqwest[0] );
-
-    /* copy west atoms into send buffer, send west*/
-    for (i=0; i < cell_dim.y; ++i)
-      for (j=0; j < cell_dim.z; ++j)
+      for (j=0; j < cell_dim.z; ++j) {
+        (*pack_func)( &send_buf_east, 1,            i, j, evec );
         (*pack_func)( &send_buf_west, cell_dim.x-2, i, j, wvec );
-    irecv_buf( &recv_buf_east, nbeast, &reqeast[1] );
-    isend_buf( &send_buf_west, nbwest, &reqeast[0] );
+      }
+    exchange_start( 0, &send_buf_east, &recv_buf_west, 
+                       &send_buf_west, &recv_buf_east, req );
+    exchange_wait(req);
 
-    /* wait for atoms from west, move them to buffer cells*/
-    MPI_Waitall(2, reqwest, statwest);
+    /* move atoms from west to buffer cells */
     recv_buf_west.n = 0;
     for (i=0; i < cell_dim.y; ++i)
       for (j=0; j < cell_dim.z; ++j)
         (*unpack_func)( &recv_buf_west, cell_dim.x-1, i, j );
 
-    /* wait for atoms from east, move them to buffer cells*/
-    MPI_Waitall(2, reqeast, stateast);
+    /* move atoms from east to buffer cells */
     recv_buf_east.n = 0;
     for (i=0; i < cell_dim.y; ++i)
       for (j=0; j < cell_dim.z; ++j)
         (*unpack_func)( &recv_buf_east, 0, i, j );
   }
+  imd_stop_timer(&time_comm);
 #endif
 }
 #endif
@@ -28,11 +28,22 @@
 *
 *  computes the forces between atoms in two given cells
 *
+*  With EAM2_CACHE, do_forces_cache also stores the pairs of atoms within
+*  the rho_h cutoff, with the rho_h derivatives, in the cache ec (if not
+*  NULL), for use by do_forces_eam2_cache in the second force loop.
+*
 ******************************************************************************/
 
+#ifdef EAM2_CACHE
+void do_forces_cache(cell *p, cell *q, vektor pbc, eam2_cache_t *ec,
+                     real *Epot, real *Virial, 
+                     real *Vir_xx, real *Vir_yy, real *Vir_zz,
+                     real *Vir_yz, real *Vir_zx, real *Vir_xy)
+#else
 void do_forces(cell *p, cell *q, vektor pbc, real *Epot, real *Virial, 
                real *Vir_xx, real *Vir_yy, real *Vir_zz,
                real *Vir_yz, real *Vir_zx, real *Vir_xy)
+#endif
 {
   int i,j,k;
   vektor d;
@@ -49,6 +60,9 @@ void do_forces(cell *p, cell *q, vektor pbc, real *Epot, real *Virial,
   real *qptr, *pfptr, *qfptr, *qpdptr, *ppdptr, *qpoptr, *ppoptr;
   
   tmp_virial     = 0.0;
+#ifdef EAM2_CACHE
+  if (ec) ec->n = 0;
+#endif
 #ifdef P_AXIAL
   tmp_vir_vect.x = 0.0;
   tmp_vir_vect.y = 0.0;
@@ -185,6 +199,47 @@ void do_forces(cell *p, cell *q, vektor pbc, real *Epot, real *Virial,
 #endif /* PAIR || KEATING */
 
 #ifdef EAM2
+#ifdef EAM2_CACHE
+      if (ec) {
+        /* host electron density and its derivative, for both atoms */
+        if ((r2 < rho_h_tab.end[col]) || (r2 < rho_h_tab.end[col2])) {
+          real rho_p, rho_q, drho_p, drho_q, *dptr;
+          PAIR_INT(rho_p, drho_p, rho_h_tab, col, inc, r2, is_short);
+          if (col==col2) {
+            rho_q  = rho_p;
+            drho_q = drho_p;
+          }
+          else {
+            PAIR_INT(rho_q, drho_q, rho_h_tab, col2, inc, r2, is_short);
+          }
+          if (r2 < rho_h_tab.end[col]) {
+            EAM_RHO(p,i) += rho_p; 
+#ifdef EEAM
+            EAM_P(p,i) += rho_p*rho_p; 
+#endif
+          }
+          if (r2 < rho_h_tab.end[col2]) {
+            EAM_RHO(q,j) += rho_q; 
+#ifdef EEAM
+            EAM_P(q,j) += rho_q*rho_q; 
+#endif
+          }
+          /* store the pair, with the derivatives as do_forces_eam2 needs them */
+          if (ec->n_max <= ec->n) 
+            increase_eam2_cache( ec, ec->n_max + EAM2_CACHE_INC );
+          ec->ij[2*ec->n  ] = i;
+          ec->ij[2*ec->n+1] = j;
+          dptr = ec->drho + EAM2_CACHE_LEN * ec->n;
+          dptr[0] = drho_q;
+          dptr[1] = drho_p;
+#ifdef EEAM
+          dptr[2] = rho_q;
+          dptr[3] = rho_p;
+#endif
+          ec->n++;
+        }
+      } else {
+#endif
       /* compute host electron density */
       if (r2 < rho_h_tab.end[col])  {
         VAL_FUNC(rho_h, rho_h_tab, col,  inc, r2, is_short);
@@ -210,6 +265,9 @@ void do_forces(cell *p, cell *q, vektor pbc, real *Epot, real *Virial,
 #endif
         }
       }
+#ifdef EAM2_CACHE
+      }
+#endif
 #endif
 
 #ifdef COVALENT
@@ -269,3 +327,21 @@ void do_forces(cell *p, cell *q, vektor pbc, real *Epot, real *Virial,
 #endif 
 
 }
+
+#ifdef EAM2_CACHE
+
+/******************************************************************************
+*
+*  do_forces, without filling an EAM2 cache
+*
+******************************************************************************/
+
+void do_forces(cell *p, cell *q, vektor pbc, real *Epot, real *Virial, 
+               real *Vir_xx, real *Vir_yy, real *Vir_zz,
+               real *Vir_yz, real *Vir_zx, real *Vir_xy)
+{
+  do_forces_cache(p, q, pbc, NULL, Epot, Virial, 
+                  Vir_xx, Vir_yy, Vir_zz, Vir_yz, Vir_zx, Vir_xy);
+}
+
+#endif
@@ -423,3 +423,122 @@ void do_forces_eam2(cell *p, cell *q, vektor pbc, real *Virial,
 #endif 
 
 } /* do_forces_eam2 */
+
+#ifdef EAM2_CACHE
+
+/******************************************************************************
+*
+*  second force loop for EAM2, for the atom pairs and rho_h derivatives
+*  stored in the cache ec by do_forces_cache in the first force loop;
+*  only the distance vectors are recomputed
+*
+******************************************************************************/
+
+void do_forces_eam2_cache(cell *p, cell *q, vektor pbc, eam2_cache_t *ec,
+                          real *Virial, real *Vir_xx, real *Vir_yy, 
+                          real *Vir_zz, real *Vir_yz, real *Vir_zx, 
+                          real *Vir_xy)
+{
+  int i, j, l;
+  vektor d, force;
+  real r2, *dptr;
+  real *pfptr, *qfptr;
+  real tmp_virial=0.0;
+#ifdef P_AXIAL
+  vektor tmp_vir_vect = {0.0, 0.0, 0.0};
+#endif
+  real eam2_force, rho_i_strich, rho_j_strich;
+#ifdef EEAM
+  real rho_i, rho_j;
+#endif
+
+  /* for each cached pair of atoms */
+  for (l=0; l<ec->n; ++l) {
+
+    i = ec->ij[2*l  ];
+    j = ec->ij[2*l+1];
+
+    /* calculate distance, as in do_forces */
+    d.x = ORT(q,j,X) - (ORT(p,i,X) - pbc.x);
+    d.y = ORT(q,j,Y) - (ORT(p,i,Y) - pbc.y);
+    d.z = ORT(q,j,Z) - (ORT(p,i,Z) - pbc.z);
+    r2  = SPROD(d,d);
+
+    dptr = ec->drho + EAM2_CACHE_LEN * l;
+    rho_i_strich = dptr[0];
+    rho_j_strich = dptr[1];
+#ifdef EEAM
+    rho_i = dptr[2];
+    rho_j = dptr[3];
+#endif
+
+    /* put together (dF_i and dF_j are by 0.5 too big) */
+    eam2_force = 0.5 * (EAM_DF(p,i)*rho_j_strich+EAM_DF(q,j)*rho_i_strich);
+#ifdef EEAM
+    /* 0.5 times 2 from derivative simplified to 1 */
+    eam2_force += (EAM_DM(p,i) * rho_j * rho_j_strich +
+                 + EAM_DM(q,j) * rho_i * rho_i_strich);
+#endif
+
+    /* store force in temporary variable */
+    force.x = d.x * eam2_force;
+    force.y = d.y * eam2_force;
+    force.z = d.z * eam2_force;
+
+    /* accumulate forces */
+    pfptr = &KRAFT(p,i,X);
+    qfptr = &KRAFT(q,j,X);
+    *pfptr     += force.x; 
+    *qfptr     -= force.x; 
+    *(++pfptr) += force.y; 
+    *(++qfptr) -= force.y; 
+    *(++pfptr) += force.z; 
+    *(++qfptr) -= force.z; 
+
+#ifdef P_AXIAL
+    tmp_vir_vect.x -= d.x * force.x;
+    tmp_vir_vect.y -= d.y * force.y;
+    tmp_vir_vect.z -= d.z * force.z;
+#else
+    tmp_virial     -= r2  * eam2_force;
+#endif
+
+#ifdef STRESS_TENS
+    if (do_press_calc) {
+      /* avoid double counting of the virial */
+      force.x *= 0.5;
+      force.y *= 0.5;
+      force.z *= 0.5;
+ 
+      PRESSTENS(p,i,xx) -= d.x * force.x;
+      PRESSTENS(p,i,yy) -= d.y * force.y;
+      PRESSTENS(p,i,zz) -= d.z * force.z;
+      PRESSTENS(p,i,yz) -= d.y * force.z;
+      PRESSTENS(p,i,zx) -= d.z * force.x;
+      PRESSTENS(p,i,xy) -= d.x * force.y;
+
+      PRESSTENS(q,j,xx) -= d.x * force.x;
+      PRESSTENS(q,j,yy) -= d.y * force.y;
+      PRESSTENS(q,j,zz) -= d.z * force.z;
+      PRESSTENS(q,j,yz) -= d.y * force.z;
+      PRESSTENS(q,j,zx) -= d.z * force.x;
+      PRESSTENS(q,j,xy) -= d.x * force.y;
+    }
+#endif
+
+  } /* for l */
+
+#ifdef P_AXIAL
+  *Vir_xx += tmp_vir_vect.x;
+  *Vir_yy += tmp_vir_vect.y;
+  *Vir_zz += tmp_vir_vect.z;
+  *Virial += tmp_vir_vect.x;
+  *Virial += tmp_vir_vect.y;
+  *Virial += tmp_vir_vect.z;
+#else
+  *Virial += tmp_virial;
+#endif 
+
+} /* do_forces_eam2_cache */
+
+#endif /* EAM2_CACHE */
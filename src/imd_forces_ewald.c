@@ -89,7 +89,10 @@ void do_forces_ewald(int steps)
   }
 
   /* Fourier space part */
-  if (ew_kcut > 0) do_forces_ewald_fourier();
+  if (ew_kcut > 0) {
+    if (respa_steps > 1) do_forces_ewald_respa(steps);
+    else do_forces_ewald_fourier(1.0);
+  }
 
   if ((steps==0) && (ew_test) && (ew_kcut>0)) {
     imd_stop_timer( &ewald_time );
@@ -125,25 +128,101 @@ void do_forces_ewald(int steps)
 
 /******************************************************************************
 *
-*  do_forces_ewald_fourier
+*  do_forces_ewald_respa
+*
+*  multiple time step integration (r-RESPA, impulse version): the Fourier
+*  part is a slow force, which is computed only every respa_steps steps,
+*  and then applied with weight respa_steps. With the leapfrog integrators
+*  of IMD, this is the same as a half kick with the slow force at the
+*  beginning and at the end of each outer step. With SM, the charges are
+*  updated only just before an outer step, and with DIPOLE the dipoles
+*  are iterated only in outer steps; both stay fixed in between.
 *
-*  computes the fourier part of the Ewald sum
+*  In the steps between, the reported Epot and virial contain the Fourier
+*  part of the last outer step, which is stale: it is not recomputed for
+*  the moved atoms. The potential energies of the atoms do not contain
+*  the Fourier part in these steps.
 *
 ******************************************************************************/
 
-void do_forces_ewald_fourier(void)
+void do_forces_ewald_respa(int steps)
 {
+  static real epot, vir, vir_t[6];
+  real   e0, v0, v_t[6];
+
+  if ((steps - steps_min) % respa_steps) {
+    tot_pot_energy += epot;
+    virial         += vir;
+    vir_xx += vir_t[0];  vir_yy += vir_t[1];  vir_zz += vir_t[2];
+    vir_yz += vir_t[3];  vir_zx += vir_t[4];  vir_xy += vir_t[5];
+    return;
+  }
+
+  e0 = tot_pot_energy;
+  v0 = virial;
+  v_t[0] = vir_xx;  v_t[1] = vir_yy;  v_t[2] = vir_zz;
+  v_t[3] = vir_yz;  v_t[4] = vir_zx;  v_t[5] = vir_xy;
+  do_forces_ewald_fourier( (real) respa_steps );
+  epot     = tot_pot_energy - e0;
+  vir      = virial - v0;
+  vir_t[0] = vir_xx - v_t[0];  vir_t[1] = vir_yy - v_t[1];
+  vir_t[2] = vir_zz - v_t[2];  vir_t[3] = vir_yz - v_t[3];
+  vir_t[4] = vir_zx - v_t[4];  vir_t[5] = vir_xy - v_t[5];
+}
+
+/******************************************************************************
+*
+*  ewald_kr_tables
+*
+*  computes exp(ikr) of the local atoms for the components of the
+*  k-vectors; the tables are indexed by component * ew_nloc + atom
+*
+******************************************************************************/
 
-  int    i, j, k, l, m, n, c;
-  int    cnt, typ, offx, offy, offz;
+void ewald_kr_tables(void)
+{
+  int    i, j, c, cnt, n;
   int    px, py, pz, mx, my, mz;
-  real   tmp, tmp_virial=0.0, sum_cos, sum_sin;
-  real   kforce, kpot;
+  real   tmp;
+
+  /* number of local atoms, and room for them */
+  n = 0;
+  for (c=0; c<ncells; c++) n += CELLPTR(c)->n;
+  if (n > ew_nloc_max) {
+    ew_nloc_max = (int) (1.1 * n) + 1;
+    free(coskx); free(sinkx); free(cosky); free(sinky);
+    free(coskz); free(sinkz); free(coskr); free(sinkr);
+    coskx = (real *) malloc( ew_nloc_max * ew_dx * sizeof(real));
+    sinkx = (real *) malloc( ew_nloc_max * ew_dx * sizeof(real));
+    cosky = (real *) malloc( ew_nloc_max * ew_dy * sizeof(real));
+    sinky = (real *) malloc( ew_nloc_max * ew_dy * sizeof(real));
+    coskz = (real *) malloc( ew_nloc_max * ew_dz * sizeof(real));
+    sinkz = (real *) malloc( ew_nloc_max * ew_dz * sizeof(real));
+    coskr = (real *) malloc( ew_nloc_max         * sizeof(real));
+    sinkr = (real *) malloc( ew_nloc_max         * sizeof(real));
+    if( coskx == NULL || sinkx == NULL || cosky == NULL || sinky == NULL
+        || coskz == NULL || sinkz == NULL || coskr == NULL || sinkr == NULL )
+      error("EWALD: Cannot allocate memory for exp(ikr)");
+  }
+  ew_nloc = n;
+
+  /* Position independent initializations */
+  px = ew_nx * ew_nloc; 
+  py = ew_ny * ew_nloc; 
+  pz = ew_nz * ew_nloc;
+  for (i=0; i<ew_nloc; i++) {
+    coskx[px+i] = 1.0;
+    sinkx[px+i] = 0.0;
+    cosky[py+i] = 1.0;
+    sinky[py+i] = 0.0;
+    coskz[pz+i] = 1.0;
+    sinkz[pz+i] = 0.0;
+  }
 
   /* Compute exp(ikr) recursively */
-  px = (ew_nx+1) * natoms;  mx = (ew_nx-1) * natoms;
-  py = (ew_ny+1) * natoms;  my = (ew_ny-1) * natoms;
-  pz = (ew_nz+1) * natoms;  mz = (ew_nz-1) * natoms;
+  px = (ew_nx+1) * ew_nloc;  mx = (ew_nx-1) * ew_nloc;
+  py = (ew_ny+1) * ew_nloc;  my = (ew_ny-1) * ew_nloc;
+  pz = (ew_nz+1) * ew_nloc;  mz = (ew_nz-1) * ew_nloc;
   cnt = 0;
   for (c=0; c<ncells; c++) {
     cell *p = CELLPTR(c);
@@ -167,86 +246,157 @@ void do_forces_ewald_fourier(void)
 
   for (j=2; j<=ew_nx; j++) {
     int pp, qq, mm, ee, i;
-    pp  = (ew_nx+j  ) * natoms;
-    qq  = (ew_nx+j-1) * natoms;
-    mm  = (ew_nx-j  ) * natoms;
-    ee  = (ew_nx  +1) * natoms;
-    for (i=0; i<natoms; i++) {
+    pp  = (ew_nx+j  ) * ew_nloc;
+    qq  = (ew_nx+j-1) * ew_nloc;
+    mm  = (ew_nx-j  ) * ew_nloc;
+    ee  = (ew_nx  +1) * ew_nloc;
+    for (i=0; i<ew_nloc; i++) {
       coskx[pp+i] =   coskx[qq+i] * coskx[ee+i] - sinkx[qq+i] * sinkx[ee+i];
       coskx[mm+i] =   coskx[pp+i];
-      sinkx[pp+i] =   coskx[qq+i] * sinkx[ee+i] - sinkx[qq+i] * coskx[ee+i];
+      sinkx[pp+i] =   coskx[qq+i] * sinkx[ee+i] + sinkx[qq+i] * coskx[ee+i];
       sinkx[mm+i] = - sinkx[pp+i];
     }
   }
 
   for (j=2; j<=ew_ny; j++) {
     int pp, qq, mm, ee, i;
-    pp  = (ew_ny+j  ) * natoms;
-    qq  = (ew_ny+j-1) * natoms;
-    mm  = (ew_ny-j  ) * natoms;
-    ee  = (ew_ny  +1) * natoms;
-    for (i=0; i<natoms; i++) {
+    pp  = (ew_ny+j  ) * ew_nloc;
+    qq  = (ew_ny+j-1) * ew_nloc;
+    mm  = (ew_ny-j  ) * ew_nloc;
+    ee  = (ew_ny  +1) * ew_nloc;
+    for (i=0; i<ew_nloc; i++) {
       cosky[pp+i] =   cosky[qq+i] * cosky[ee+i] - sinky[qq+i] * sinky[ee+i];
       cosky[mm+i] =   cosky[pp+i];
-      sinky[pp+i] =   cosky[qq+i] * sinky[ee+i] - sinky[qq+i] * cosky[ee+i];
+      sinky[pp+i] =   cosky[qq+i] * sinky[ee+i] + sinky[qq+i] * cosky[ee+i];
       sinky[mm+i] = - sinky[pp+i];
     }
   }
 
   for (j=2; j<=ew_nz; j++) {
     int pp, qq, ee, i;
-    pp  = (ew_nz+j  ) * natoms;
-    qq  = (ew_nz+j-1) * natoms;
-    ee  = (ew_nz  +1) * natoms;
-    for (i=0; i<natoms; i++) {
+    pp  = (ew_nz+j  ) * ew_nloc;
+    qq  = (ew_nz+j-1) * ew_nloc;
+    ee  = (ew_nz  +1) * ew_nloc;
+    for (i=0; i<ew_nloc; i++) {
       coskz[pp+i] =   coskz[qq+i] * coskz[ee+i] - sinkz[qq+i] * sinkz[ee+i];
-      sinkz[pp+i] =   coskz[qq+i] * sinkz[ee+i] - sinkz[qq+i] * coskz[ee+i];
+      sinkz[pp+i] =   coskz[qq+i] * sinkz[ee+i] + sinkz[qq+i] * coskz[ee+i];
     }
   }
+}
 
-  /* Loop over all reciprocal vectors */
-  for (k=0; k<ew_totk; k++) {
+/******************************************************************************
+*
+*  ewald_kr
+*
+*  computes exp(ikr) of the local atoms for k-vector k, in coskr, sinkr
+*
+******************************************************************************/
 
-    cnt     = 0; 
-    offx    = ew_ivek[k].x * natoms;
-    offy    = ew_ivek[k].y * natoms;
-    offz    = ew_ivek[k].z * natoms;
-    sum_cos = 0.0;
-    sum_sin = 0.0;
+void ewald_kr(int k)
+{
+  int i, offx, offy, offz;
+
+  offx = ew_ivek[k].x * ew_nloc;
+  offy = ew_ivek[k].y * ew_nloc;
+  offz = ew_ivek[k].z * ew_nloc;
+  for (i=0; i<ew_nloc; i++) {
+    coskr[i] =   coskx[offx+i] * cosky[offy+i] * coskz[offz+i]
+               - sinkx[offx+i] * sinky[offy+i] * coskz[offz+i]
+               - sinkx[offx+i] * cosky[offy+i] * sinkz[offz+i] 
+               - coskx[offx+i] * sinky[offy+i] * sinkz[offz+i];
+    sinkr[i] = - sinkx[offx+i] * sinky[offy+i] * sinkz[offz+i]
+               + sinkx[offx+i] * cosky[offy+i] * coskz[offz+i]
+               + coskx[offx+i] * sinky[offy+i] * coskz[offz+i]
+               + coskx[offx+i] * cosky[offy+i] * sinkz[offz+i];
+  }
+}
 
-    /* Compute exp(ikr) and sums thereof */
-    for (c=0; c<ncells; c++) {
+/******************************************************************************
+*
+*  ewald_sum_kspace
+*
+*  adds up the partial structure factors ew_sum_cos, ew_sum_sin of all CPUs
+*
+******************************************************************************/
 
-      cell *p = CELLPTR(c);
+void ewald_sum_kspace(void)
+{
+#ifdef MPI
+  /* waiting for slower CPUs is counted as communication */
+  imd_start_timer(&time_comm);
+  MPI_Allreduce( ew_sum_cos, ew_sum_buf, 2 * ew_totk, REAL, MPI_SUM,
+                 cpugrid );
+  imd_stop_timer(&time_comm);
+  memcpy( ew_sum_cos, ew_sum_buf, 2 * ew_totk * sizeof(real) );
+#endif
+}
 
-      for (i=0; i<p->n; i++) {
+/******************************************************************************
+*
+*  do_forces_ewald_fourier
+*
+*  computes the fourier part of the Ewald sum; each CPU computes the
+*  structure factors of its own atoms, which are then added up.
+*  The forces are added with weight wgt (respa_steps for r-RESPA),
+*  energy and virial with weight 1.
+*
+******************************************************************************/
+
+void do_forces_ewald_fourier(real wgt)
+{
 
-        coskr[cnt] =   coskx[offx+cnt] * cosky[offy+cnt] * coskz[offz+cnt]
-                     - sinkx[offx+cnt] * sinky[offy+cnt] * coskz[offz+cnt]
-                     - sinkx[offx+cnt] * cosky[offy+cnt] * sinkz[offz+cnt] 
-                     - coskx[offx+cnt] * sinky[offy+cnt] * sinkz[offz+cnt];
+  int    i, k, c, cnt;
+  real   tmp, tmp_virial=0.0, sum_cos, sum_sin, q;
+  real   kforce, kpot;
+
+#ifdef PME
+  if (ew_pme) {
+    do_forces_pme(wgt);
+    return;
+  }
+#endif
 
-        sinkr[cnt] = - sinkx[offx+cnt] * sinky[offy+cnt] * sinkz[offz+cnt]
-                     + sinkx[offx+cnt] * cosky[offy+cnt] * coskz[offz+cnt]
-                     + coskx[offx+cnt] * sinky[offy+cnt] * coskz[offz+cnt]
-                     + coskx[offx+cnt] * cosky[offy+cnt] * sinkz[offz+cnt];
+  ewald_kr_tables();
 
-#ifdef VARCHG
+  /* partial structure factors of the local atoms */
+  for (k=0; k<ew_totk; k++) {
+
+    ewald_kr(k);
+    sum_cos = 0.0;
+    sum_sin = 0.0;
+    cnt     = 0; 
+    for (c=0; c<ncells; c++) {
+      cell *p = CELLPTR(c);
+      for (i=0; i<p->n; i++) {
         sum_cos += CHARGE(p,i) * coskr[cnt];
         sum_sin += CHARGE(p,i) * sinkr[cnt];
-#else
-        typ      = SORTE(p,i);
-        sum_cos += charge[typ] * coskr[cnt];
-        sum_sin += charge[typ] * sinkr[cnt];
-#endif
         cnt++;
       }
     }
+    ew_sum_cos[k] = sum_cos;
+    ew_sum_sin[k] = sum_sin;
+  }
 
-    /* update total potential energy */
-    tot_pot_energy += ew_expk[k] * (SQR(sum_sin) + SQR(sum_cos));
+  /* total structure factors */
+  ewald_sum_kspace();
+
+  /* Loop over all reciprocal vectors */
+  for (k=0; k<ew_totk; k++) {
+
+    sum_cos = ew_sum_cos[k];
+    sum_sin = ew_sum_sin[k];
+
+    /* update total potential energy and virial; the virial is that of
+       a uniform dilatation, sum_i r_i * F_i is not defined with pbc */
+    if (0==myid) {
+      tmp = ew_expk[k] * (SQR(sum_sin) + SQR(sum_cos));
+      tot_pot_energy += tmp;
+      tmp_virial     += tmp * (1.0 - SPROD(ew_kvek[k],ew_kvek[k])
+                                     / (2.0 * SQR(ew_kappa)));
+    }
 
     /* updates */
+    ewald_kr(k);
     cnt = 0;
     for (c=0; c<ncells; c++) {
 
@@ -254,29 +404,19 @@ void do_forces_ewald_fourier(void)
 
       for (i=0; i<p->n; i++) {
 
+        q = CHARGE(p,i);
+
         /* update potential energy */
-#ifdef VARCHG
-        kpot   = CHARGE(p,i) * ew_expk[k]
-	         * (sinkr[cnt] * sum_sin + coskr[cnt] * sum_cos);
-#else
-        typ    = SORTE(p,i);
-        kpot   = charge[typ] * ew_expk[k]
+        kpot   = q * ew_expk[k]
 	         * (sinkr[cnt] * sum_sin + coskr[cnt] * sum_cos);
-#endif
         POTENG(p,i)  += kpot;
 
-        /* update force */
-#ifdef VARCHG
-        kforce = CHARGE(p,i) * ew_expk[k] 
+        /* update force; the energy is quadratic in the sums */
+        kforce = 2.0 * wgt * q * ew_expk[k] 
                  * (sinkr[cnt] * sum_cos - coskr[cnt] * sum_sin);
-#else
-        kforce = charge[typ] * ew_expk[k] 
-                 * (sinkr[cnt] * sum_cos - coskr[cnt] * sum_sin);
-#endif
         KRAFT(p,i,X) += ew_kvek[k].x * kforce;
         KRAFT(p,i,Y) += ew_kvek[k].y * kforce;
         KRAFT(p,i,Z) += ew_kvek[k].z * kforce;
-        tmp_virial   += kforce * SPRODX(ORT,p,i,ew_kvek[k]);
 
         cnt++;
       }
@@ -457,7 +597,7 @@ void do_forces_ewald_real(void)
 void init_ewald(void)
 {
 
-  int    i, j, k, offx, offy, offz, count, num;
+  int    i, j, k, count, num;
   real   kvek2, vorf1;
 
   /* we implicitly assume a system of units, in which lengths are
@@ -471,11 +611,9 @@ void init_ewald(void)
   twopi    = 2.0 * M_PI;
 
   ew_vorf  = ew_kappa / SQRT( M_PI );
-  vorf1    = twopi * coul_eng / volume;
-
-  /* SM ?
-  ew_vorf  = 2.0 * ew_kappa / SQRT( M_PI );
-  vorf1    = 2.0 * twopi / volume; */
+  /* 4 pi / V; only half of the k-vectors are summed below, but each
+     of them represents the pair k, -k */
+  vorf1    = 2.0 * twopi * coul_eng / volume;
 
   if (!(ew_kcut > 0)) return;
 
@@ -486,6 +624,14 @@ void init_ewald(void)
   if (0==myid)
     printf("EWALD: nx = %d, ny = %d, nz = %d\n", ew_nx, ew_ny, ew_nz);
 
+#ifdef PME
+  /* no k-vectors needed with particle mesh Ewald */
+  if (ew_pme) {
+    init_pme();
+    return;
+  }
+#endif
+
   /* Allocate memory for k-vectors */
   num     = (2*ew_nx+1) * (2*ew_ny+1) * (ew_nz+1);
   ew_kvek = (vektor  *) malloc( num * sizeof(vektor) );
@@ -525,33 +671,16 @@ void init_ewald(void)
   if (0==myid)
     printf("EWALD: %d k-vectors\n", ew_totk); 
 
-  /* Allocate memory for exp(ikr) */
+  /* structure factors, and receive buffer for their sum */
+  ew_sum_cos = (real *) malloc( 4 * ew_totk * sizeof(real) );
+  if (NULL == ew_sum_cos)
+    error("EWALD: Cannot allocate memory for structure factors");
+  ew_sum_sin = ew_sum_cos + ew_totk;
+  ew_sum_buf = ew_sum_cos + 2 * ew_totk;
+
+  /* exp(ikr) tables grow with the number of local atoms */
   ew_dx = 2 * ew_nx + 1;
   ew_dy = 2 * ew_ny + 1;
   ew_dz = 2 * ew_nz + 1;
-  coskx = (real *) malloc( natoms * ew_dx * sizeof(real));
-  sinkx = (real *) malloc( natoms * ew_dx * sizeof(real));
-  cosky = (real *) malloc( natoms * ew_dy * sizeof(real));
-  sinky = (real *) malloc( natoms * ew_dy * sizeof(real));
-  coskz = (real *) malloc( natoms * ew_dz * sizeof(real));
-  sinkz = (real *) malloc( natoms * ew_dz * sizeof(real));
-  coskr = (real *) malloc( natoms         * sizeof(real));
-  sinkr = (real *) malloc( natoms         * sizeof(real));
-
-  if( coskx == NULL || sinkx == NULL || cosky == NULL || sinky == NULL
-      || coskz == NULL || sinkz == NULL || coskr == NULL || sinkr == NULL )
-    error("EWALD: Cannot allocate memory for exp(ikr)");
-
-  /* Position independent initializations */
-  offx = ew_nx * natoms; 
-  offy = ew_ny * natoms; 
-  offz = ew_nz * natoms;
-  for (i=0; i<natoms; i++) {
-    coskx[offx+i] = 1.0;
-    sinkx[offx+i] = 0.0;
-    cosky[offy+i] = 1.0;
-    sinky[offy+i] = 0.0;
-    coskz[offz+i] = 1.0;
-    sinkz[offz+i] = 0.0;
-  }
+  ew_nloc_max = 0;
 }
@@ -40,11 +40,178 @@
   scheme. It runs first over the atoms in the first inner cell, then those 
   in the second inner cell, etc.
 
+  With OpenMP, the force loops are threaded over cells. Each cell
+  updates only atoms in itself and its neighbor cells, which are at
+  most one cell away in each direction. The inner cells are therefore
+  sorted into 27 groups (colors), such that the cells within a group
+  are at least three cells apart and can be processed concurrently.
+  Groups are processed one after the other. nbl_cstart[k] is the
+  index of the first atom of cell k in the numbering used by tl.
+
+  With parameter nbl_full, full neighbor lists are built instead, in
+  which each pair of atoms appears twice, once for each partner. The
+  force loops in calc_forces_full then write only to the atom owning
+  the list, so that no forces need to be sent back from the buffer
+  cells, and the loops are threaded without coloring. This requires
+  all buffer cells to be filled, also those omitted in AR mode.
+
+  Unless Coulomb, covalent or Keating interactions are present, the
+  data of neighbor atoms is not accessed in the cells, but in packed
+  arrays nbl_ort, nbl_sorte, ..., which are indexed directly by the
+  atom numbers n stored in tb. They are filled with the positions and
+  types of all atoms (including buffer atoms) at each step. Quantities
+  accumulated for neighbor atoms go to packed arrays as well, which are
+  added to the cells after each force loop. This saves the lookups in
+  cl_num and cl_off for each neighbor. The NB_ macros access neighbor
+  atom j either way; in the packed case, the cell q is not used.
+
+  With compile option nbl16 (NBL16), the entries of tb are 16 bit wide,
+  which halves the size of the neighbor table and the memory traffic
+  of the force loops. An entry holds the position of the neighbor cell
+  in the list returned by nbl_cell_nbrs (5 bits), and the number of the
+  neighbor atom in that cell (11 bits). The cell and its first atom
+  number are looked up in the per-cell tables nbl_qcell and nbl_qoff.
+  Cells may then contain at most 2048 atoms. The NBL_NBR macros decode
+  the entries of tb for atoms in cell k either way.
+
+  With parameter nbl_cluster (4 or 8) and pure pair potentials, the
+  atoms of each cell are grouped into clusters of that many atoms
+  instead, and lists of pairs of clusters with close bounding boxes are
+  made. The pair loop in calc_pair_clusters then runs over all atom
+  pairs of two clusters, on contiguous arrays holding the clusters'
+  positions and forces. Its inner loop has a fixed length and no
+  data-dependent control flow, so that it can be vectorized.
+
+  Pure pair potentials on atom lists use calc_pair_blocks, which
+  evaluates the potential table for blocks of neighbors at once with
+  PAIR_INT_BLOCK, so that the table interpolation is vectorized, too.
+
 ******************************************************************************/
 
 #define NBLMINLEN 100000
 
-int  *tl=NULL, *tb=NULL, *cl_off=NULL, *cl_num=NULL, nb_max=0;
+/* threaded force loops, for all interactions writing only to neighbors */
+#if defined(_OPENMP) && !defined(COULOMB) && !defined(COVALENT) && !defined(FLAGEDATOMS)
+#define NBL_OMP
+#define NBL_NCOLORS 27
+#define NBL_COLOR(c) ( (((c) / (cell_dim.y * cell_dim.z)) % 3) * 9 + \
+                       (((c) / cell_dim.z) % cell_dim.y % 3) * 3 + \
+                        ((c) % cell_dim.z % 3) )
+#else
+#define NBL_NCOLORS 1
+#define NBL_COLOR(c) 0
+#endif
+
+#ifdef NBL16
+typedef unsigned short nbl_t;
+#define NBL16_SHIFT 11
+#define NBL16_MASK  0x7ff
+#define NBL_ENTRY(m,c2,j)  ((nbl_t) (((m) << NBL16_SHIFT) | (j)))
+#define NBL_NBR_CELL(k,v)  (nbl_qcell[27*(k) + ((v) >> NBL16_SHIFT)])
+#define NBL_NBR_ATOM(k,v)  ((v) & NBL16_MASK)
+#define NBL_NBR(k,v)       (nbl_qoff[27*(k) + ((v) >> NBL16_SHIFT)] + \
+                            ((v) & NBL16_MASK))
+int  *nbl_qcell=NULL, *nbl_qoff=NULL;
+#else
+typedef int nbl_t;
+#define NBL_ENTRY(m,c2,j)  (cl_off[c2] + (j))
+#define NBL_NBR_CELL(k,v)  (cl_num[v])
+#define NBL_NBR_ATOM(k,v)  ((v) - cl_off[cl_num[v]])
+#define NBL_NBR(k,v)       (v)
+#endif
+
+nbl_t *tb=NULL;
+int  *tl=NULL, *cl_off=NULL, *cl_num=NULL, nb_max=0;
+int  *nbl_cstart=NULL, *nbl_ccell=NULL, nbl_color_start[NBL_NCOLORS+1];
+
+/* packed neighbor data, for all interactions needing no other data */
+#if !defined(COULOMB) && !defined(COVALENT) && !defined(KEATING) && !defined(FLAGEDATOMS)
+#define NBL_PACKED
+#endif
+
+#ifdef NBL_PACKED
+#define NB_ORT(q,j,sub)         (nbl_ort   sub(j))
+#define NB_SORTE(q,j)           (nbl_sorte [j])
+#define NB_KRAFT(q,j,sub)       (nbl_kraft sub(j))
+#define NB_POTENG(q,j)          (nbl_pot   [j])
+#define NB_NBANZ(q,j)           (nbl_nbanz [j])
+#define NB_PRESSTENS(q,j,sub)   (nbl_press [j].sub)
+#define NB_EAM_RHO(q,j)         (nbl_rho   [j])
+#define NB_EAM_P(q,j)           (nbl_p     [j])
+#define NB_EAM_DF(q,j)          (nbl_dF    [j])
+#define NB_EAM_DM(q,j)          (nbl_dM    [j])
+#define NB_ADP_MU(q,j,sub)      (nbl_mu    sub(j))
+#define NB_ADP_LAMBDA(q,j,sub)  (nbl_lambda[j].sub)
+#else
+#define NB_ORT(q,j,sub)         ORT(q,j,sub)
+#define NB_SORTE(q,j)           SORTE(q,j)
+#define NB_KRAFT(q,j,sub)       KRAFT(q,j,sub)
+#define NB_POTENG(q,j)          POTENG(q,j)
+#define NB_NBANZ(q,j)           NBANZ(q,j)
+#define NB_PRESSTENS(q,j,sub)   PRESSTENS(q,j,sub)
+#define NB_EAM_RHO(q,j)         EAM_RHO(q,j)
+#define NB_EAM_P(q,j)           EAM_P(q,j)
+#define NB_EAM_DF(q,j)          EAM_DF(q,j)
+#define NB_EAM_DM(q,j)          EAM_DM(q,j)
+#define NB_ADP_MU(q,j,sub)      ADP_MU(q,j,sub)
+#define NB_ADP_LAMBDA(q,j,sub)  ADP_LAMBDA(q,j,sub)
+#endif
+
+int  nbl_nat=0;     /* number of atoms, including buffer atoms */
+
+/* cost measurements for the adaptive neighbor list margin */
+imd_timer nbl_build_time, nbl_force_time;
+real nbl_r2cut=0.0;        /* cutoff radius squared of neighbor lists */
+real nbl_force_work=0.0;   /* force steps, weighted with nbl_r2cut^1.5 */
+real nbl_disp_rate=0.0;    /* maximal displacement per step */
+int  nbl_steps=0;          /* steps since last neighbor list update */
+#ifdef NBL_PACKED
+int  nbl_pk_max=0, *nbl_sorte=NULL;
+real *nbl_ort=NULL, *nbl_kraft=NULL;
+#ifndef MONOLJ
+real *nbl_pot=NULL;
+#endif
+#ifdef NNBR
+int  *nbl_nbanz=NULL;
+#endif
+#ifdef STRESS_TENS
+sym_tensor *nbl_press=NULL;
+#endif
+#ifdef EAM2
+real *nbl_rho=NULL, *nbl_dF=NULL;
+#ifdef EEAM
+real *nbl_p=NULL, *nbl_dM=NULL;
+#endif
+#endif
+#ifdef ADP
+real *nbl_mu=NULL;
+sym_tensor *nbl_lambda=NULL;
+#endif
+#endif
+
+/* cluster pair lists and blocked force loops, for pure pair potentials */
+#if defined(NBL_PACKED) && defined(PAIR) && !defined(EAM2) && !defined(ADP) && \
+    !defined(TWOD) && !defined(LINPOT) && !defined(ORDPAR) && \
+    !defined(P_AXIAL) && !defined(LOADBALANCE)
+#define NBL_CLUSTER
+#define NBL_CLFAR 1e10     /* position of empty cluster slots */
+#define NBL_CLMAX 8        /* maximal cluster size */
+#define NBL_BLOCK 64       /* block size for table evaluations */
+int  nbl_cl_max=0, nbl_cp_max=0, *nbl_clstart=NULL;
+int  *nbl_clatom=NULL, *nbl_cltyp=NULL, *nbl_clnbs=NULL, *nbl_clnbn=NULL;
+int  *nbl_cltb=NULL;
+real *nbl_clx=NULL, *nbl_cly=NULL, *nbl_clz=NULL, *nbl_clbox=NULL;
+real *nbl_clfx=NULL, *nbl_clfy=NULL, *nbl_clfz=NULL;
+#ifndef MONOLJ
+real *nbl_clpot=NULL;
+#endif
+#ifdef NNBR
+int  *nbl_clnb=NULL;
+#endif
+#ifdef STRESS_TENS
+sym_tensor *nbl_clpress=NULL;
+#endif
+#endif
 
 
 /******************************************************************************
@@ -58,7 +225,7 @@ void deallocate_nblist(void)
 #if defined(DEBUG) || defined(TIMING)
   if (myid==0)
     printf("Size of neighbor table: %d MB\n", 
-           nb_max * sizeof(int) / SQR(1024) );
+           nb_max * sizeof(nbl_t) / SQR(1024) );
 #endif
   if (tb) free(tb);
   tb = NULL;
@@ -67,80 +234,129 @@ void deallocate_nblist(void)
 
 /******************************************************************************
 *
-*  estimate_nblist_size
+*  nbl_cell_nbrs - the cells searched for neighbors of atoms in cell c;
+*  the whole neighborhood for full neighbor lists, else that of cnbrs
 *
 ******************************************************************************/
 
-int estimate_nblist_size(void)
+int nbl_cell_nbrs(int c, int *nq)
 {
-  int  c, tn=1;
-
-  /* for all cells */
-  for (c=0; c<ncells2; c++) {
-
-    int i, c1 = cnbrs[c].np;
-    cell *p   = cell_array + c1;
+  int c1 = cnbrs[c].np, l, m, n, nn=0;
+
+  if (nbl_full) {
+    int ix = c1 / (cell_dim.y * cell_dim.z);
+    int iy = c1 / cell_dim.z % cell_dim.y;
+    int iz = c1 % cell_dim.z;
+    for (l=ix-1; l<=ix+1; l++)
+      for (m=iy-1; m<=iy+1; m++)
+        for (n=iz-1; n<=iz+1; n++)
+          nq[nn++] = (l * cell_dim.y + m) * cell_dim.z + n;
+  }
+  else {
+    for (nn=0; nn<NNBCELL; nn++) nq[nn] = cnbrs[c].nq[nn];
+  }
+  return nn;
+}
 
-    /* for each atom in cell */
-    for (i=0; i<p->n; i++) {
+/******************************************************************************
+*
+*  nbl_atom_nbrs - find the neighbors of atom i in cell c, and store
+*  their indices in buf, unless buf is NULL; returns their number
+*
+******************************************************************************/
 
-      int    m;
-      vektor d1;
+static int nbl_atom_nbrs(int c, int i, int *nq, int nnq, nbl_t *buf)
+{
+  int    m, tn=0, c1 = cnbrs[c].np;
+  cell   *p = cell_array + c1;
+  vektor d1;
 
-      d1.x = ORT(p,i,X);
-      d1.y = ORT(p,i,Y);
+  d1.x = ORT(p,i,X);
+  d1.y = ORT(p,i,Y);
 #ifndef TWOD
-      d1.z = ORT(p,i,Z);
-#endif
-
-      /* for each neighboring atom */
-      for (m=0; m<NNBCELL; m++) {   /* this is not TWOD ready! */
-
-        int    c2, jstart, j;
-        real   r2;
-        cell   *q;
-
-        c2 = cnbrs[c].nq[m];
-        if (c2<0) continue;
-        if (c2==c1) jstart = i+1;
-        else        jstart = 0;
-        q = cell_array + c2;
+  d1.z = ORT(p,i,Z);
+#endif
+
+  /* for each neighboring atom */
+  for (m=0; m<nnq; m++) {   /* this is not TWOD ready! */
+    int  c2, jstart, j;
+    cell *q;
+    c2 = nq[m];
+    if (c2<0) continue;
+    if ((c2==c1) && (0==nbl_full)) jstart = i+1;
+    else                           jstart = 0;
+    q = cell_array + c2;
 #ifdef ia64
 #pragma ivdep
 #endif
-        for (j=jstart; j<q->n; j++) {
-          vektor d;
-          d.x = ORT(q,j,X) - d1.x;
-          d.y = ORT(q,j,Y) - d1.y;
+    for (j=jstart; j<q->n; j++) {
+      vektor d;
+      real   r2;
+      d.x = ORT(q,j,X) - d1.x;
+      d.y = ORT(q,j,Y) - d1.y;
 #ifndef TWOD
-          d.z = ORT(q,j,Z) - d1.z;
+      d.z = ORT(q,j,Z) - d1.z;
 #endif
-          r2  = SPROD(d,d);
-          if (r2 < cellsz) tn++;
-        }
+      r2  = SPROD(d,d);
+      if ((r2 < nbl_r2cut) && ((j!=i) || (c2!=c1))) {
+        if (buf) buf[tn] = NBL_ENTRY(m,c2,j);
+        tn++;
       }
     }
   }
-#ifdef MPI
-  /* printf ("myid: %d nb-list size: %d\n",myid,tn);fflush(stdout); */
-#endif
   return tn;
 }
 
 /******************************************************************************
 *
-*  make_nblist
+*  nbl_alloc_tb - (re)allocate tb for a neighbor table of length len;
+*  its size follows the actual list length in both directions
+*
+******************************************************************************/
+
+static void nbl_alloc_tb(int len)
+{
+  if ((NULL==tb) || (len > nb_max) ||
+      (len * SQR(nbl_size) < nb_max - NBLMINLEN)) {
+    free(tb);
+    nb_max = MAX( (int) (nbl_size * len), len );
+    nb_max = MAX( nb_max, NBLMINLEN );
+    tb     = (nbl_t *) malloc(nb_max * sizeof(nbl_t));
+    if (NULL==tb) error("cannot allocate neighbor table");
+  }
+}
+
+/******************************************************************************
+*
+*  make_nblist - the neighbor lists are built in two passes over the
+*  atoms, which are both threaded: the first one counts the neighbors
+*  of each atom, from which the list offsets tl follow by a prefix sum;
+*  the second one then stores the neighbors in tb. The neighbor table
+*  thus always has the right size, up to the headroom nbl_size. With a
+*  single thread, both are done in one pass, enlarging tb when needed.
 *
 ******************************************************************************/
 
 void make_nblist(void)
 {
-  static int at_max=0, pa_max=0, ncell_max=0;
-  int  c, i, k, n, tn, at, cc;
+  static int at_max=0, ncell_max=0;
+  int  c, k, at, nin;
+
+  /* the cells are large enough for margin nbl_margin; with the
+     adaptive margin, the neighbor lists may use a smaller one */
+  if (nbl_skin <= 0.0) nbl_skin = nbl_margin;
+  if (nbl_skin < nbl_margin)
+    nbl_r2cut = SQR( SQRT(cellsz) - nbl_margin + nbl_skin );
+  else
+    nbl_r2cut = cellsz;
 
   /* update reference positions */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
   for (k=0; k<ncells; k++) {
     cell *p = cell_array + cnbrs[k].np;
+    int  i;
 #ifdef ia64
 #pragma ivdep,swp
 #endif
@@ -155,1129 +371,1371 @@ void make_nblist(void)
 
   /* (re)allocate cl_off */
   if (nallcells > ncell_max) {
-    cl_off = (int *) realloc( cl_off, nallcells * sizeof(int) );
-    if (cl_off==NULL) error("cannot allocate neighbor table");
+    cl_off     = (int *) realloc( cl_off,      nallcells    * sizeof(int) );
+    nbl_cstart = (int *) realloc( nbl_cstart, (nallcells+1) * sizeof(int) );
+    nbl_ccell  = (int *) realloc( nbl_ccell,   nallcells    * sizeof(int) );
+    if ((cl_off==NULL) || (nbl_cstart==NULL) || (nbl_ccell==NULL)) 
+      error("cannot allocate neighbor table");
+#ifdef NBL_CLUSTER
+    nbl_clstart = (int *) realloc( nbl_clstart, (nallcells+1) * sizeof(int) );
+    if (nbl_clstart==NULL) error("cannot allocate neighbor table");
+#endif
+#ifdef NBL16
+    nbl_qcell  = (int *) realloc( nbl_qcell, 27 * nallcells * sizeof(int) );
+    nbl_qoff   = (int *) realloc( nbl_qoff,  27 * nallcells * sizeof(int) );
+    if ((nbl_qcell==NULL) || (nbl_qoff==NULL)) 
+      error("cannot allocate neighbor table");
+#endif
     ncell_max = nallcells;
   }
 
+  /* sort inner cells into groups of independent cells */
+  make_nbl_colors();
+
   /* count atom numbers (including buffer atoms) */
   at=0;
   for (k=0; k<nallcells; k++) {
     cell *p = cell_array + k;
     cl_off[k] = at;
     at += p->n;
+#ifdef NBL16
+    if (p->n > NBL16_MASK + 1)
+      error("too many atoms in cell for nbl16 - use smaller cells");
+#endif
   }
+  nbl_nat = at;
 
-  /* (re-)allocate neighbor table */
-  if (at >= at_max) {
-    free(tl);
-    free(cl_num);
-    at_max = (int) (nbl_size * at);
-    tl     = (int *) malloc(at_max * sizeof(int));
-    cl_num = (int *) malloc(at_max * sizeof(int));
-  }
-  if (NULL==tb) {
-    if (0==last_nbl_len) 
-      nb_max = MAX(((int) (nbl_size * estimate_nblist_size())), (NBLMINLEN));
-    else
-      nb_max = (int) (nbl_size * last_nbl_len);
-    tb = (int *) malloc(nb_max * sizeof(int));
-  }
-  else if (last_nbl_len * sqrt(nbl_size) > nb_max) {
-    free(tb);
-    nb_max = (int  ) (nbl_size * last_nbl_len);
-    tb     = (int *) malloc(nb_max * sizeof(int));
+#ifdef NBL16
+  /* neighbor cells, and their first atom, for decoding tb */
+  for (c=0; c<ncells2; c++) {
+    int m, nq[27], nnq = nbl_cell_nbrs(c, nq);
+    for (m=0; m<nnq; m++) {
+      nbl_qcell[27*c+m] = nq[m];
+      nbl_qoff [27*c+m] = (nq[m] < 0) ? 0 : cl_off[nq[m]];
+    }
   }
+#endif
 
-#ifdef LOADBALANCE
-  if (lb_need_nbl_update == 1){
-	free(tl);
-	free(cl_num);
-	at_max = (int) (nbl_size * 2 * at);
-	tl     = (int *) malloc(at_max * sizeof(int));
-	cl_num = (int *) malloc(at_max * sizeof(int));
+  /* first atom of each cell in tl */
+  nin=0;
+  for (c=0; c<ncells2; c++) {
+    nbl_cstart[c] = nin;
+    nin += cell_array[cnbrs[c].np].n;
+  }
+  nbl_cstart[ncells2] = nin;
 
-	free(tb);
-	lb_need_nbl_update = 0;
-	int reqSize = (int)(nbl_size * estimate_nblist_size());
-	nb_max = MAX(reqSize, NBLMINLEN);
-	tb = (int *) malloc(nb_max * sizeof(int));
+  /* (re-)allocate tl and cl_num, which need one entry per atom */
+  if (at >= at_max) {
+    at_max = MAX( (int) (nbl_size * at), at + 1 );
+    tl     = (int *) realloc( tl,     at_max * sizeof(int) );
+    cl_num = (int *) realloc( cl_num, at_max * sizeof(int) );
+    if ((tl==NULL) || (cl_num==NULL)) 
+      error("cannot allocate neighbor table");
   }
+#ifdef LOADBALANCE
+  /* the domain has changed, but the neighbor table adapts by itself */
+  lb_need_nbl_update = 0;
 #endif
 
-  if ((tl==NULL) || (tb==NULL) || (cl_num==NULL)) 
-    error("cannot allocate neighbor table");
-
   /* set cl_num */
-  n=0;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
   for (k=0; k<nallcells; k++) {
     cell *p = cell_array + k;
+    int  i, n = cl_off[k];
     for (i=0; i<p->n; i++) cl_num[n++] = k;
   }
 
-  /* for all cells */
-  n=0; tn=0; tl[0]=0;
-  for (c=0; c<ncells2; c++) {
+#ifdef NBL_CLUSTER
+  if (nbl_cluster) {
+    /* cluster pair lists instead of atom neighbor lists */
+    make_nbl_clusters();
+  }
+  else
+#else
+  if (nbl_cluster) 
+    error("nbl_cluster is supported only for pair potentials");
+#endif
+#ifdef _OPENMP
+  if (omp_get_max_threads() > 1) {
+
+    /* first pass: count neighbors of each atom, store in tl[n+1] */
+#pragma omp parallel for schedule(runtime)
+    for (c=0; c<ncells2; c++) {
+      int  i, nq[27], nnq, n = nbl_cstart[c];
+      cell *p = cell_array + cnbrs[c].np;
+      nnq = nbl_cell_nbrs(c, nq);
+      for (i=0; i<p->n; i++)
+        tl[n+i+1] = nbl_atom_nbrs(c, i, nq, nnq, NULL);
+    }
 
-    int  c1 = cnbrs[c].np;
-    cell *p = cell_array + c1;
+    /* prefix sum yields the list offsets */
+    tl[0] = 0;
+    for (k=0; k<nin; k++) tl[k+1] += tl[k];
+    last_nbl_len = tl[nin];
+    nbl_alloc_tb(last_nbl_len);
+
+    /* second pass: store the neighbors */
+#pragma omp parallel for schedule(runtime)
+    for (c=0; c<ncells2; c++) {
+      int  i, nq[27], nnq, n = nbl_cstart[c];
+      cell *p = cell_array + cnbrs[c].np;
+      nnq = nbl_cell_nbrs(c, nq);
+      for (i=0; i<p->n; i++)
+        nbl_atom_nbrs(c, i, nq, nnq, tb + tl[n+i]);
+    }
+  }
+  else
+#endif
+  {
+    /* single thread: count and store in one pass, enlarging tb on demand */
+    int tn = 0;
+    nbl_alloc_tb(last_nbl_len);
+    tl[0] = 0;
+    for (c=0; c<ncells2; c++) {
+      int  i, m, nq[27], nnq, nmax=0, n = nbl_cstart[c];
+      cell *p = cell_array + cnbrs[c].np;
+      nnq = nbl_cell_nbrs(c, nq);
+      /* upper bound for the number of neighbors of an atom in this cell */
+      for (m=0; m<nnq; m++)
+        if (nq[m] >= 0) nmax += cell_array[nq[m]].n;
+      for (i=0; i<p->n; i++) {
+        if (tn + nmax > nb_max) {
+          /* extrapolate from the atoms treated so far */
+          nb_max = MAX( (int) (nbl_size * (real) tn / MAX(n+i,1) * nin), 
+                        MAX( nb_max + nb_max / 2, tn + nmax ) );
+          tb = (nbl_t *) realloc( tb, nb_max * sizeof(nbl_t) );
+          if (NULL==tb) error("cannot enlarge neighbor table");
+        }
+        tn += nbl_atom_nbrs(c, i, nq, nnq, tb + tn);
+        tl[n+i+1] = tn;
+      }
+    }
+    last_nbl_len = tn;
+  }
 
-    /* for each atom in cell */
-    for (i=0; i<p->n; i++) {
+  have_valid_nbl = 1;
+  nbl_count++;
+  nbl_steps = 0;
+}
 
-      int    m;
-      vektor d1;
+#ifdef NBL_CLUSTER
 
-      d1.x = ORT(p,i,X);
-      d1.y = ORT(p,i,Y);
-#ifndef TWOD
-      d1.z = ORT(p,i,Z);
-#endif
+/******************************************************************************
+*
+*  nbl_cluster_nbrs - find the clusters whose bounding box is closer than
+*  the neighbor list cutoff to the one of cluster ci in cell k, and store
+*  them in buf, unless buf is NULL; returns their number
+*
+******************************************************************************/
 
-      /* for each neighboring atom */
-      for (m=0; m<NNBCELL; m++) {   /* this is not TWOD ready! */
-        int  c2, jstart, j;
-        cell *q;
-        c2 = cnbrs[c].nq[m];
-        if (c2<0) continue;
-        if (c2==c1) jstart = i+1;
-        else        jstart = 0;
-        q = cell_array + c2;
-#ifdef ia64
-#pragma ivdep
-#endif
-        for (j=jstart; j<q->n; j++) {
-          vektor d;
-          real   r2;
-          d.x = ORT(q,j,X) - d1.x;
-          d.y = ORT(q,j,Y) - d1.y;
-#ifndef TWOD
-          d.z = ORT(q,j,Z) - d1.z;
-#endif
-          r2  = SPROD(d,d);
-          if (r2 < cellsz) {
-            tb[tn++] = cl_off[c2] + j;
-          }
-        }
-      }
-      pa_max = MAX(pa_max,tn-tl[n]);
-      tl[++n] = tn;
-      if (tn > nb_max-2*pa_max || n>at_max) {
-        error("neighbor table full - increase nbl_size");
+static int nbl_cluster_nbrs(int ci, int k, int *nq, int nnq, int *buf)
+{
+  real *bi = nbl_clbox + 6 * ci;
+  int  m, tn=0;
+
+  for (m=0; m<nnq; m++) {
+    int cj, k2 = nq[m];
+    if (k2<0) continue;
+    /* within the same cell, each pair only once */
+    for (cj=((k2==k) ? ci : nbl_clstart[k2]); cj<nbl_clstart[k2+1]; cj++) {
+      real *bj = nbl_clbox + 6 * cj;
+      real dx  = MAX( 0.0, MAX( bj[0] - bi[3], bi[0] - bj[3] ) );
+      real dy  = MAX( 0.0, MAX( bj[1] - bi[4], bi[1] - bj[4] ) );
+      real dz  = MAX( 0.0, MAX( bj[2] - bi[5], bi[2] - bj[5] ) );
+      if (dx * dx + dy * dy + dz * dz < nbl_r2cut) {
+        if (buf) buf[tn] = cj;
+        tn++;
       }
     }
   }
-  last_nbl_len   = tn;
-  have_valid_nbl = 1;
-  nbl_count++;
+  return tn;
 }
 
 /******************************************************************************
 *
-*  calc_forces
+*  make_nbl_clusters - group the atoms of each cell into clusters of
+*  nbl_cluster consecutive atoms, which are close in space if the cells
+*  are sorted, and make the lists of cluster pairs in two passes
 *
 ******************************************************************************/
 
-void calc_forces(int steps)
+void make_nbl_clusters(void)
 {
-  int  i, b, k, n=0, is_short=0, idummy=0;
-  real tmpvec1[8], tmpvec2[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  int c, k, n, ncl, w = nbl_cluster;
 
-#if defined(DIPOLE) || defined(KERMODE)
-  static int dp_E_calc=0; 	/* Number of field iterations */
-  int dp_it=0;			/* Number of dipole iterations */
-  int dp_p_calc=0;		/* Calculate dipoles or keep them */
-  /* TODO: Communicate! */
-  int dp_converged=0;
-  real dp_sum_old, dp_sum=1.,dp_sum_global=1.0;
-#ifndef KERMODE
-  real max_diff=10.;
+  /* number the clusters */
+  ncl = 0;
+  for (k=0; k<nallcells; k++) {
+    nbl_clstart[k] = ncl;
+    ncl += (cell_array[k].n + w - 1) / w;
+  }
+  nbl_clstart[nallcells] = ncl;
+
+  /* (re)allocate cluster data */
+  if (ncl > nbl_cl_max) {
+    nbl_cl_max = MAX( (int) (nbl_size * ncl), ncl );
+    n = nbl_cl_max * w;
+    nbl_clatom = (int  *) realloc( nbl_clatom, n * sizeof(int ) );
+    nbl_cltyp  = (int  *) realloc( nbl_cltyp,  n * sizeof(int ) );
+    nbl_clx    = (real *) realloc( nbl_clx,    n * sizeof(real) );
+    nbl_cly    = (real *) realloc( nbl_cly,    n * sizeof(real) );
+    nbl_clz    = (real *) realloc( nbl_clz,    n * sizeof(real) );
+    nbl_clfx   = (real *) realloc( nbl_clfx,   n * sizeof(real) );
+    nbl_clfy   = (real *) realloc( nbl_clfy,   n * sizeof(real) );
+    nbl_clfz   = (real *) realloc( nbl_clfz,   n * sizeof(real) );
+    nbl_clbox  = (real *) realloc( nbl_clbox,  6 * nbl_cl_max * sizeof(real) );
+    nbl_clnbs  = (int  *) realloc( nbl_clnbs,  nbl_cl_max * sizeof(int) );
+    nbl_clnbn  = (int  *) realloc( nbl_clnbn,  nbl_cl_max * sizeof(int) );
+    if ((NULL==nbl_clatom) || (NULL==nbl_cltyp) || (NULL==nbl_clx) || 
+        (NULL==nbl_cly) || (NULL==nbl_clz) || (NULL==nbl_clfx) || 
+        (NULL==nbl_clfy) || (NULL==nbl_clfz) || (NULL==nbl_clbox) || 
+        (NULL==nbl_clnbs) || (NULL==nbl_clnbn))
+      error("cannot allocate neighbor clusters");
+#ifndef MONOLJ
+    nbl_clpot  = (real *) realloc( nbl_clpot, n * sizeof(real) );
+    if (NULL==nbl_clpot) error("cannot allocate neighbor clusters");
 #endif
-#ifdef KERMODE
-  real pot1,pot2;
-  real max_diff=500.;
+#ifdef NNBR
+    nbl_clnb   = (int  *) realloc( nbl_clnb,  n * sizeof(int) );
+    if (NULL==nbl_clnb) error("cannot allocate neighbor clusters");
 #endif
-  real *dp_E_shift;
-  dp_p_calc = ((dp_fix-1 + dp_fix*dp_E_calc)>0 ) ? 0 : 1;
+#ifdef STRESS_TENS
+    nbl_clpress = (sym_tensor *) realloc( nbl_clpress, n * sizeof(sym_tensor) );
+    if (NULL==nbl_clpress) error("cannot allocate neighbor clusters");
 #endif
+  }
 
-  if (0==have_valid_nbl) {
-#ifdef MPI
-    /* check message buffer size */
-    if (0 == nbl_count % BUFSTEP) setup_buffers();
+  /* fill the clusters, and compute their bounding boxes */
+#ifdef _OPENMP
+#pragma omp parallel for
 #endif
-    /* update cell decomposition */
-    fix_cells();
+  for (k=0; k<nallcells; k++) {
+    cell *p = cell_array + k;
+    int  ci, l, i=0;
+    for (ci=nbl_clstart[k]; ci<nbl_clstart[k+1]; ci++) {
+      real *bb = nbl_clbox + 6 * ci;
+      bb[0] = bb[1] = bb[2] =  NBL_CLFAR;
+      bb[3] = bb[4] = bb[5] = -NBL_CLFAR;
+      for (l=ci*w; l<(ci+1)*w; l++, i++) {
+        if (i < p->n) {
+          nbl_clatom[l] = cl_off[k] + i;
+          nbl_cltyp [l] = SORTE(p,i);
+          bb[0] = MIN( bb[0], ORT(p,i,X) );
+          bb[1] = MIN( bb[1], ORT(p,i,Y) );
+          bb[2] = MIN( bb[2], ORT(p,i,Z) );
+          bb[3] = MAX( bb[3], ORT(p,i,X) );
+          bb[4] = MAX( bb[4], ORT(p,i,Y) );
+          bb[5] = MAX( bb[5], ORT(p,i,Z) );
+        }
+        else {
+          nbl_clatom[l] = -1;
+          nbl_cltyp [l] =  0;
+        }
+      }
+    }
   }
 
-  /* fill the buffer cells */
-  send_cells(copy_cell,pack_cell,unpack_cell);
+  /* first pass: count cluster pairs */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(runtime)
+#endif
+  for (c=0; c<ncells; c++) {
+    int ci, nq[27], nnq, k1 = cnbrs[c].np;
+    nnq = nbl_cell_nbrs(c, nq);
+    for (ci=nbl_clstart[k1]; ci<nbl_clstart[k1+1]; ci++)
+      nbl_clnbn[ci] = nbl_cluster_nbrs(ci, k1, nq, nnq, NULL);
+  }
 
-  /* make new neighbor lists */
-  if (0==have_valid_nbl) make_nblist();
+  /* list offsets, in the order of the inner cells */
+  n = 0;
+  for (c=0; c<ncells; c++) {
+    int ci, k1 = cnbrs[c].np;
+    for (ci=nbl_clstart[k1]; ci<nbl_clstart[k1+1]; ci++) {
+      nbl_clnbs[ci] = n;
+      n += nbl_clnbn[ci];
+    }
+  }
+  if (n > nbl_cp_max) {
+    nbl_cp_max = MAX( (int) (nbl_size * n), n );
+    nbl_cltb   = (int *) realloc( nbl_cltb, nbl_cp_max * sizeof(int) );
+    if (NULL==nbl_cltb) error("cannot allocate neighbor clusters");
+  }
+  last_nbl_len = n;
 
-  /* clear global accumulation variables */
-  tot_pot_energy = 0.0;
-#ifdef SM
-  tot_sm_es_energy = 0.0;
+  /* second pass: store cluster pairs */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(runtime)
 #endif
-  virial = 0.0;
-  vir_xx = 0.0;
-  vir_yy = 0.0;
-  vir_xy = 0.0;
-  vir_zz = 0.0;
-  vir_yz = 0.0;
-  vir_zx = 0.0;
-  nfc++;
+  for (c=0; c<ncells; c++) {
+    int ci, nq[27], nnq, k1 = cnbrs[c].np;
+    nnq = nbl_cell_nbrs(c, nq);
+    for (ci=nbl_clstart[k1]; ci<nbl_clstart[k1+1]; ci++)
+      nbl_cluster_nbrs(ci, k1, nq, nnq, nbl_cltb + nbl_clnbs[ci]);
+  }
+}
 
-  /* clear per atom accumulation variables, also in buffer cells */
-  for (k=0; k<nallcells; k++) {
-    cell *p = cell_array + k;
-#ifdef ia64
-#pragma ivdep,swp
-#endif
-    for (i=0; i<p->n; i++) {
-      KRAFT(p,i,X) = 0.0;
-      KRAFT(p,i,Y) = 0.0;
-#ifndef TWOD
-      KRAFT(p,i,Z) = 0.0;
-#endif
-#if defined(STRESS_TENS)
-      PRESSTENS(p,i,xx) = 0.0;
-      PRESSTENS(p,i,yy) = 0.0;
-      PRESSTENS(p,i,xy) = 0.0;
-#ifndef TWOD
-      PRESSTENS(p,i,zz) = 0.0;
-      PRESSTENS(p,i,yz) = 0.0;
-      PRESSTENS(p,i,zx) = 0.0;
-#endif
-#endif     
+/******************************************************************************
+*
+*  calc_pair_clusters - pair interactions on cluster pair lists. The
+*  positions of the cluster atoms are gathered from the packed arrays,
+*  the forces computed for all atom pairs of each pair of clusters,
+*  and the results added back to the packed arrays. Pairs beyond the
+*  cutoff, and those counted twice within a cluster, are masked out.
+*
+******************************************************************************/
+
+void calc_pair_clusters(int steps)
+{
+  int  b, col, l, nl, is_short=0, inc = ntypes * ntypes, w = nbl_cluster;
+
+  /* gather cluster positions, clear accumulators */
+  nl = nbl_clstart[nallcells] * w;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (l=0; l<nl; l++) {
+    int n = nbl_clatom[l];
+    if (n >= 0) {
+      nbl_clx[l] = nbl_ort X(n);
+      nbl_cly[l] = nbl_ort Y(n);
+      nbl_clz[l] = nbl_ort Z(n);
+    }
+    else {
+      nbl_clx[l] = nbl_cly[l] = nbl_clz[l] = NBL_CLFAR;
+    }
+    nbl_clfx[l] = 0.0;
+    nbl_clfy[l] = 0.0;
+    nbl_clfz[l] = 0.0;
 #ifndef MONOLJ
-      POTENG(p,i) = 0.0;
+    nbl_clpot[l] = 0.0;
 #endif
 #ifdef NNBR
-      NBANZ(p,i) = 0;
+    nbl_clnb[l] = 0;
 #endif
-#ifdef CNA
-      if (cna) MARK(p,i) = 0;
+#ifdef STRESS_TENS
+    nbl_clpress[l].xx = 0.0;
+    nbl_clpress[l].yy = 0.0;
+    nbl_clpress[l].zz = 0.0;
+    nbl_clpress[l].yz = 0.0;
+    nbl_clpress[l].zx = 0.0;
+    nbl_clpress[l].xy = 0.0;
 #endif
-#ifdef COVALENT
-      NEIGH(p,i)->n = 0;
+  }
+
+  /* for all cluster pairs, one group of cells after the other */
+  for (col=0; col<NBL_NCOLORS; col++) {
+#ifdef NBL_OMP
+#pragma omp parallel for schedule(runtime) \
+  reduction(+:tot_pot_energy,virial,is_short)
+#endif
+  for (b=nbl_color_start[col]; b<nbl_color_start[col+1]; b++) {
+    int ci, k = cnbrs[ nbl_ccell[b] ].np;
+    for (ci=nbl_clstart[k]; ci<nbl_clstart[k+1]; ci++) {
+
+      /* accumulators for each pair of lanes, so that the lane loop
+         below has neither reductions nor stores to global arrays */
+      real fxi[NBL_CLMAX*NBL_CLMAX], fyi[NBL_CLMAX*NBL_CLMAX];
+      real fzi[NBL_CLMAX*NBL_CLMAX], epi[NBL_CLMAX*NBL_CLMAX];
+      real vri[NBL_CLMAX*NBL_CLMAX];
+#ifdef NNBR
+      int  nbi[NBL_CLMAX*NBL_CLMAX];
 #endif
-#ifdef EAM2
-      EAM_RHO(p,i) = 0.0;
-#ifdef EEAM
-      EAM_P(p,i) = 0.0;
+#ifdef STRESS_TENS
+      real pxx[NBL_CLMAX*NBL_CLMAX], pyy[NBL_CLMAX*NBL_CLMAX];
+      real pzz[NBL_CLMAX*NBL_CLMAX], pyz[NBL_CLMAX*NBL_CLMAX];
+      real pzx[NBL_CLMAX*NBL_CLMAX], pxy[NBL_CLMAX*NBL_CLMAX];
 #endif
+      int  l, m, il, jl, bi = ci * w;
+
+      for (l=0; l<w*w; l++) {
+        fxi[l] = fyi[l] = fzi[l] = epi[l] = vri[l] = 0.0;
+#ifdef NNBR
+        nbi[l] = 0;
 #endif
-#ifdef ADP
-      ADP_MU    (p,i,X)  = 0.0;
-      ADP_MU    (p,i,Y)  = 0.0;
-      ADP_MU    (p,i,Z)  = 0.0;
-      ADP_LAMBDA(p,i,xx) = 0.0;
-      ADP_LAMBDA(p,i,yy) = 0.0;
-      ADP_LAMBDA(p,i,xy) = 0.0;
-      ADP_LAMBDA(p,i,zz) = 0.0;
-      ADP_LAMBDA(p,i,yz) = 0.0;
-      ADP_LAMBDA(p,i,zx) = 0.0;
+#ifdef STRESS_TENS
+        pxx[l] = pyy[l] = pzz[l] = pyz[l] = pzx[l] = pxy[l] = 0.0;
 #endif
-#if defined(DIPOLE) || defined(KERMODE)
-      DP_E_STAT(p,i,X) = 0.0;
-      DP_E_STAT(p,i,Y) = 0.0;
-      DP_E_STAT(p,i,Z) = 0.0;
-      DP_P_STAT(p,i,X) = 0.0;
-      DP_P_STAT(p,i,Y) = 0.0;
-      DP_P_STAT(p,i,Z) = 0.0;
-      DP_E_IND(p,i,X)  = 0.0;
-      DP_E_IND(p,i,Y)  = 0.0;
-      DP_E_IND(p,i,Z)  = 0.0;
-      if ( dp_p_calc ) {
-	DP_P_IND(p,i,X)  = 0.0;
-	DP_P_IND(p,i,Y)  = 0.0;
-	DP_P_IND(p,i,Z)  = 0.0;
       }
-#endif /* dipole */
-    }
-  }
 
-  /* clear total forces */
-#ifdef RIGID
-  if ( nsuperatoms>0 ) 
-    for(i=0; i<nsuperatoms; i++) {
-      superforce[i].x = 0.0;
-      superforce[i].y = 0.0;
-#ifndef TWOD
-      superforce[i].z = 0.0;
-#endif
-    }
-#endif
+      for (m=nbl_clnbs[ci]; m<nbl_clnbs[ci]+nbl_clnbn[ci]; m++) {
 
-#ifdef EWALD
-  if (steps==0) {
-    ewald_time.total = 0.0;
-    imd_start_timer( &ewald_time );
-  }
+        int  cj = nbl_cltb[m], bj = cj * w;
+        real fxj[NBL_CLMAX], fyj[NBL_CLMAX], fzj[NBL_CLMAX], epj[NBL_CLMAX];
+#ifdef NNBR
+        int  nbj[NBL_CLMAX];
+#endif
+#ifdef STRESS_TENS
+        real qxx[NBL_CLMAX], qyy[NBL_CLMAX], qzz[NBL_CLMAX];
+        real qyz[NBL_CLMAX], qzx[NBL_CLMAX], qxy[NBL_CLMAX];
 #endif
 
-  /* pair interactions - for all atoms */
-  n=0;
-  for (k=0; k<ncells; k++) {
-    cell *p = cell_array + cnbrs[k].np;
-    for (i=0; i<p->n; i++) {
+        for (jl=0; jl<w; jl++) {
+          fxj[jl] = fyj[jl] = fzj[jl] = epj[jl] = 0.0;
+#ifdef NNBR
+          nbj[jl] = 0;
+#endif
+#ifdef STRESS_TENS
+          qxx[jl] = qyy[jl] = qzz[jl] = qyz[jl] = qzx[jl] = qxy[jl] = 0.0;
+#endif
+        }
 
+        for (il=0; il<w; il++) {
+
+          real xi = nbl_clx[bi+il], yi = nbl_cly[bi+il], zi = nbl_clz[bi+il];
+          int  it = nbl_cltyp[bi+il], jmin = (cj == ci) ? il + 1 : 0;
+          if (nbl_clatom[bi+il] < 0) break;
+
+          /* all atoms of cluster cj, branch free */
+          for (jl=0; jl<w; jl++) {
+
+            int  jt   = nbl_cltyp[bj+jl], col1 = it * ntypes + jt;
+            real dx   = nbl_clx[bj+jl] - xi;
+            real dy   = nbl_cly[bj+jl] - yi;
+            real dz   = nbl_clz[bj+jl] - zi;
+            real r2   = dx * dx + dy * dy + dz * dz;
+            real end  = pair_pot.end[col1];
+            int  in   = (r2 <= end) & (jl >= jmin);
+            real pot, grad, fx, fy, fz;
+
+            l = il * w + jl;
+
+            /* evaluate masked pairs within the table, and discard them */
+            r2 = in ? r2 : end;
+            PAIR_INT(pot, grad, pair_pot, col1, inc, r2, is_short);
+            pot  *= in;
+            grad *= in;
+
+            fx = dx * grad;
+            fy = dy * grad;
+            fz = dz * grad;
+            fxj[jl] -= fx;
+            fyj[jl] -= fy;
+            fzj[jl] -= fz;
+            fxi[l]  += fx;
+            fyi[l]  += fy;
+            fzi[l]  += fz;
+            epi[l]  += pot;
+            epj[jl] += pot;
+            vri[l]  -= r2 * grad;
+#ifdef NNBR
+            nbi[l]  += in & (r2 < nb_r2_cut[col1]);
+            nbj[jl] += in & (r2 < nb_r2_cut[jt * ntypes + it]);
+#endif
 #ifdef STRESS_TENS
-#ifdef TWOD
-      sym_tensor pp = {0.0,0.0,0.0};
-#else
-      sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
+            /* avoid double counting of the virial */
+            fx *= 0.5;
+            fy *= 0.5;
+            fz *= 0.5;
+            pxx[l]  -= dx * fx;
+            pyy[l]  -= dy * fy;
+            pzz[l]  -= dz * fz;
+            pyz[l]  -= dy * fz;
+            pzx[l]  -= dz * fx;
+            pxy[l]  -= dx * fy;
+            qxx[jl] -= dx * fx;
+            qyy[jl] -= dy * fy;
+            qzz[jl] -= dz * fz;
+            qyz[jl] -= dy * fz;
+            qzx[jl] -= dz * fx;
+            qxy[jl] -= dx * fy;
 #endif
+          }
+        }
+
+        /* add up cluster cj */
+        for (jl=0; jl<w; jl++) {
+          nbl_clfx[bj+jl] += fxj[jl];
+          nbl_clfy[bj+jl] += fyj[jl];
+          nbl_clfz[bj+jl] += fzj[jl];
+#ifndef MONOLJ
+          nbl_clpot[bj+jl] += 0.5 * epj[jl];   /* avoid double counting */
 #endif
-#ifdef ADP
-      real       tmp;
-      vektor     mu = {0.0,0.0,0.0};
-      sym_tensor la = {0.0,0.0,0.0,0.0,0.0,0.0};
+#ifdef NNBR
+          nbl_clnb[bj+jl] += nbj[jl];
 #endif
-#ifdef COULOMB
-      real       phi, grphi, chg;
+#ifdef STRESS_TENS
+          if (do_press_calc) {
+            nbl_clpress[bj+jl].xx += qxx[jl];
+            nbl_clpress[bj+jl].yy += qyy[jl];
+            nbl_clpress[bj+jl].zz += qzz[jl];
+            nbl_clpress[bj+jl].yz += qyz[jl];
+            nbl_clpress[bj+jl].zx += qzx[jl];
+            nbl_clpress[bj+jl].xy += qxy[jl];
+          }
 #endif
-#if defined(DIPOLE) || defined(KERMODE)
-      real       tmp;
-      vektor     Estat = {0.0,0.0,0.0};
-      vektor     pstat = {0.0,0.0,0.0};
+        }
+      }
+
+      /* add up cluster ci */
+      for (il=0; il<w; il++) {
+        for (jl=0; jl<w; jl++) {
+          l = il * w + jl;
+          nbl_clfx[bi+il] += fxi[l];
+          nbl_clfy[bi+il] += fyi[l];
+          nbl_clfz[bi+il] += fzi[l];
+          tot_pot_energy  += epi[l];
+          virial          += vri[l];
+#ifndef MONOLJ
+          nbl_clpot[bi+il] += 0.5 * epi[l];
 #endif
-#ifdef TWOD
-      vektor d1, ff = {0.0,0.0};
-#else
-      vektor d1, ff = {0.0,0.0,0.0};
+#ifdef NNBR
+          nbl_clnb[bi+il] += nbi[l];
 #endif
-      real   ee = 0.0;
-      real   eam_r = 0.0, eam_p = 0.0;
-      int    m, it, nb = 0;
+#ifdef STRESS_TENS
+          if (do_press_calc) {
+            nbl_clpress[bi+il].xx += pxx[l];
+            nbl_clpress[bi+il].yy += pyy[l];
+            nbl_clpress[bi+il].zz += pzz[l];
+            nbl_clpress[bi+il].yz += pyz[l];
+            nbl_clpress[bi+il].zx += pzx[l];
+            nbl_clpress[bi+il].xy += pxy[l];
+          }
+#endif
+        }
+      }
+    }
+  }
+  }
+  if (is_short) fprintf(stderr,"Short distance, pair, step %d!\n",steps);
 
-      d1.x = ORT(p,i,X);
-      d1.y = ORT(p,i,Y);
-#ifndef TWOD
-      d1.z = ORT(p,i,Z);
+  /* add cluster results to the packed arrays */
+#ifdef _OPENMP
+#pragma omp parallel for
 #endif
-      it   = SORTE(p,i);
+  for (l=0; l<nl; l++) {
+    int n = nbl_clatom[l];
+    if (n < 0) continue;
+    nbl_kraft X(n) += nbl_clfx[l];
+    nbl_kraft Y(n) += nbl_clfy[l];
+    nbl_kraft Z(n) += nbl_clfz[l];
+#ifndef MONOLJ
+    nbl_pot[n] += nbl_clpot[l];
+#endif
+#ifdef NNBR
+    nbl_nbanz[n] += nbl_clnb[l];
+#endif
+#ifdef STRESS_TENS
+    if (do_press_calc) {
+      nbl_press[n].xx += nbl_clpress[l].xx;
+      nbl_press[n].yy += nbl_clpress[l].yy;
+      nbl_press[n].zz += nbl_clpress[l].zz;
+      nbl_press[n].yz += nbl_clpress[l].yz;
+      nbl_press[n].zx += nbl_clpress[l].zx;
+      nbl_press[n].xy += nbl_clpress[l].xy;
+    }
+#endif
+  }
+}
 
-      /* loop over neighbors */
-#ifdef ia64
-#pragma ivdep
+/******************************************************************************
+*
+*  calc_pair_blocks - pair interactions on the atom neighbor lists, for
+*  pure pair potentials. The neighbors of each atom are processed in
+*  blocks of NBL_BLOCK: the pairs within the cutoff are collected, their
+*  table entries evaluated all at once with PAIR_INT_BLOCK, which can
+*  be vectorized, and then the forces are accumulated.
+*
+******************************************************************************/
+
+void calc_pair_blocks(int steps)
+{
+  int b, col, is_short=0, inc = ntypes * ntypes;
+
+  /* for all atoms, one group of cells after the other */
+  for (col=0; col<NBL_NCOLORS; col++) {
+#ifdef NBL_OMP
+#pragma omp parallel for schedule(runtime) \
+  reduction(+:tot_pot_energy,virial,is_short)
 #endif
-      for (m=tl[n]; m<tl[n+1]; m++) {
+  for (b=nbl_color_start[col]; b<nbl_color_start[col+1]; b++) {
 
-        vektor d, force;
-        cell   *q;
-        real   pot, grad, r2, rho_h;
-        int    c, j, jt, col, col2, inc = ntypes * ntypes;
+    int  i, k = nbl_ccell[b], n = nbl_cstart[k];
+    cell *p = cell_array + cnbrs[k].np;
 
-        c = cl_num[ tb[m] ];
-        j = tb[m] - cl_off[c];
-        q = cell_array + c;
+    for (i=0; i<p->n; i++, n++) {
 
-        d.x = ORT(q,j,X) - d1.x;
-        d.y = ORT(q,j,Y) - d1.y;
-#ifndef TWOD
-        d.z = ORT(q,j,Z) - d1.z;
+      real dx[NBL_BLOCK], dy[NBL_BLOCK], dz[NBL_BLOCK], r2[NBL_BLOCK];
+      real pot[NBL_BLOCK], grad[NBL_BLOCK];
+      int  nbj[NBL_BLOCK], cl[NBL_BLOCK];
+      real xi = ORT(p,i,X), yi = ORT(p,i,Y), zi = ORT(p,i,Z);
+      real fxi = 0.0, fyi = 0.0, fzi = 0.0, epi = 0.0;
+      int  m0, it = SORTE(p,i);
+#ifdef NNBR
+      int  nbi = 0;
 #endif
-        r2  = SPROD(d,d);
-        jt  = SORTE(q,j);
-        col = it * ntypes + jt;
-        col2= jt * ntypes + it;
+#ifdef STRESS_TENS
+      sym_tensor ppi = {0.0,0.0,0.0,0.0,0.0,0.0};
+#endif
+
+      for (m0=tl[n]; m0<tl[n+1]; m0+=NBL_BLOCK) {
+
+        int m, l, nl = 0, m1 = MIN( m0 + NBL_BLOCK, tl[n+1] );
+
+        /* collect the pairs within the cutoff */
+        for (m=m0; m<m1; m++) {
+          int  j  = NBL_NBR(k,tb[m]), c = it * ntypes + nbl_sorte[j];
+          real x  = nbl_ort X(j) - xi;
+          real y  = nbl_ort Y(j) - yi;
+          real z  = nbl_ort Z(j) - zi;
+          real s  = x * x + y * y + z * z;
+          dx[nl]  = x;
+          dy[nl]  = y;
+          dz[nl]  = z;
+          r2[nl]  = s;
+          nbj[nl] = j;
+          cl[nl]  = c;
+          nl     += (s <= pair_pot.end[c]);
+        }
 
-        /* compute pair interactions */
-#if defined(PAIR) || defined(KEATING)
-        /* PAIR and KEATING are mutually exclusive */
-#if defined(PAIR)
-        if (r2 <= pair_pot.end[col])
-#elif defined(KEATING)
-        if (r2 < keat_r2_cut[it][jt]) 
+        /* evaluate the potential table for all of them */
+        PAIR_INT_BLOCK(pot, grad, pair_pot, cl, inc, r2, nl, is_short);
+
+        /* accumulate forces, energies, and virials */
+        for (l=0; l<nl; l++) {
+          int  j  = nbj[l];
+          real fx = dx[l] * grad[l];
+          real fy = dy[l] * grad[l];
+          real fz = dz[l] * grad[l];
+          nbl_kraft X(j) -= fx;
+          nbl_kraft Y(j) -= fy;
+          nbl_kraft Z(j) -= fz;
+          fxi            += fx;
+          fyi            += fy;
+          fzi            += fz;
+          tot_pot_energy += pot[l];
+          virial         -= r2[l] * grad[l];
+#ifndef MONOLJ
+          epi            += 0.5 * pot[l];   /* avoid double counting */
+          nbl_pot[j]     += 0.5 * pot[l];
 #endif
-	{
-#if defined(PAIR)
-#ifdef LINPOT
-          PAIR_INT_LIN(pot, grad, pair_pot_lin, col, inc, r2, is_short);
-#else
-	  PAIR_INT(pot, grad, pair_pot, col, inc, r2, is_short);
+#ifdef NNBR
+          if (r2[l] < nb_r2_cut[cl[l]]) nbi++;
+          if (r2[l] < nb_r2_cut[nbl_sorte[j] * ntypes + it]) nbl_nbanz[j]++;
 #endif
-#elif defined(KEATING)
-          PAIR_INT_KEATING(pot, grad, it, jt, r2);
+#ifdef STRESS_TENS
+          if (do_press_calc) {
+            /* avoid double counting of the virial */
+            fx *= 0.5;
+            fy *= 0.5;
+            fz *= 0.5;
+            ppi.xx            -= dx[l] * fx;
+            nbl_press[j].xx   -= dx[l] * fx;
+            ppi.yy            -= dy[l] * fy;
+            nbl_press[j].yy   -= dy[l] * fy;
+            ppi.xy            -= dx[l] * fy;
+            nbl_press[j].xy   -= dx[l] * fy;
+            ppi.zz            -= dz[l] * fz;
+            nbl_press[j].zz   -= dz[l] * fz;
+            ppi.yz            -= dy[l] * fz;
+            nbl_press[j].yz   -= dy[l] * fz;
+            ppi.zx            -= dz[l] * fx;
+            nbl_press[j].zx   -= dz[l] * fx;
+          }
 #endif
-          tot_pot_energy += pot;
-          force.x = d.x * grad;
-          force.y = d.y * grad;
-#ifndef TWOD
-          force.z = d.z * grad;
+        }
+      }
+      KRAFT(p,i,X) += fxi;
+      KRAFT(p,i,Y) += fyi;
+      KRAFT(p,i,Z) += fzi;
+#ifndef MONOLJ
+      POTENG(p,i)  += epi;
 #endif
-          KRAFT(q,j,X) -= force.x;
-          KRAFT(q,j,Y) -= force.y;
-#ifndef TWOD
-          KRAFT(q,j,Z) -= force.z;
+#ifdef NNBR
+      NBANZ(p,i)   += nbi;
 #endif
-          ff.x         += force.x;
-          ff.y         += force.y;
-#ifndef TWOD
-          ff.z         += force.z;
+#ifdef STRESS_TENS
+      if (do_press_calc) {
+        PRESSTENS(p,i,xx) += ppi.xx;
+        PRESSTENS(p,i,yy) += ppi.yy;
+        PRESSTENS(p,i,zz) += ppi.zz;
+        PRESSTENS(p,i,yz) += ppi.yz;
+        PRESSTENS(p,i,zx) += ppi.zx;
+        PRESSTENS(p,i,xy) += ppi.xy;
+      }
 #endif
+    }
+  }
+  }
+  if (is_short) fprintf(stderr,"Short distance, pair, step %d!\n",steps);
+}
 
-#ifdef FLAGEDATOMS
-	  if(VSORTE(q,j) == flagedatomstype && VSORTE(p,i) == flagedatomstype)
-	    {
-	      //	      printf("Atom nr %d of type %d interacting with %d: Pair forces : %e %e %e\n",
-	      printf("%d %d %d %e %e %e %e %e %e\n",
-		     NUMMER(p,i),VSORTE(p,i),NUMMER(q,j),d.x, d.y, d.z, force.x,force.y,force.z);
-	      fflush(stdout);
-	    }
-#endif
+#endif /* NBL_CLUSTER */
+
+/******************************************************************************
+*
+*  sort_nbl_cells - sort the atoms within each cell along a Morton
+*  (Z-order) curve through the cell, so that atoms close in space are
+*  also close in memory. Atoms drift out of such an order, because
+*  fix_cells appends incoming atoms and fills holes with the last atom.
+*
+******************************************************************************/
+
+void sort_nbl_cells(void)
+{
+  static cell tmp;
+  static int  *key=NULL, *ind=NULL, nmax=0;
+  int k;
+
+  for (k=0; k<ncells; k++) {
+
+    cell *p = CELLPTR(k);
+    int  i, j, sorted=1;
+
+    if (p->n > nmax) {
+      nmax = p->n + incrsz;
+      key  = (int *) realloc(key, nmax * sizeof(int));
+      ind  = (int *) realloc(ind, nmax * sizeof(int));
+      if ((NULL==key) || (NULL==ind)) error("cannot allocate sort keys");
+    }
+    if (p->n > tmp.n_max) alloc_cell(&tmp, p->n + incrsz);
+
+    /* Morton key from 10 bits of the position within the cell */
+    for (i=0; i<p->n; i++) {
+      real x = ORT(p,i,X), y = ORT(p,i,Y), z = ORT(p,i,Z);
+      real f;
+      int  ix, iy, iz, b;
+      f  = global_cell_dim.x * (x*tbox_x.x + y*tbox_x.y + z*tbox_x.z);
+      ix = (int) (1024 * (f - FLOOR(f)));
+      f  = global_cell_dim.y * (x*tbox_y.x + y*tbox_y.y + z*tbox_y.z);
+      iy = (int) (1024 * (f - FLOOR(f)));
+      f  = global_cell_dim.z * (x*tbox_z.x + y*tbox_z.y + z*tbox_z.z);
+      iz = (int) (1024 * (f - FLOOR(f)));
+      key[i] = 0;
+      for (b=9; b>=0; b--)
+        key[i] = (key[i] << 3) | (((ix >> b) & 1) << 2) 
+                               | (((iy >> b) & 1) << 1) | ((iz >> b) & 1);
+    }
+
+    /* insertion sort of the atom indices - cells are small */
+    for (i=0; i<p->n; i++) {
+      int ki = key[i];
+      for (j=i; (j>0) && (key[ind[j-1]] > ki); j--) {
+        ind[j] = ind[j-1];
+        sorted = 0;
+      }
+      ind[j] = i;
+    }
+    if (sorted) continue;
+
+    /* permute atoms via the scratch cell */
+    for (i=0; i<p->n; i++) copy_atom_cell_cell(&tmp, i, p, ind[i]);
+    for (i=0; i<p->n; i++) copy_atom_cell_cell(p, i, &tmp, i);
+  }
+}
+
+/******************************************************************************
+*
+*  make_nbl_colors - sort inner cells into groups of cells which are
+*  at least three cells apart in some direction. Atoms in cells from
+*  the same group have no common neighbor cells, so that the cells
+*  of a group can be processed by different threads.
+*
+******************************************************************************/
+
+void make_nbl_colors(void)
+{
+  int k, col, cnt[NBL_NCOLORS];
+
+  for (col=0; col<NBL_NCOLORS; col++) cnt[col] = 0;
+
+  /* count cells of each color */
+  for (k=0; k<ncells; k++) {
+    cnt[ NBL_COLOR(cnbrs[k].np) ]++;
+  }
 
+  /* offsets of the color groups */
+  nbl_color_start[0] = 0;
+  for (col=0; col<NBL_NCOLORS; col++) {
+    nbl_color_start[col+1] = nbl_color_start[col] + cnt[col];
+    cnt[col] = nbl_color_start[col];
+  }
+
+  /* sort cells into groups, keeping their order within a group */
+  for (k=0; k<ncells; k++) {
+    nbl_ccell[ cnt[ NBL_COLOR(cnbrs[k].np) ]++ ] = k;
+  }
+}
+
+#ifdef NBL_PACKED
+
+/******************************************************************************
+*
+*  nbl_pack_atoms - copy positions and types of all atoms, including
+*  buffer atoms, to the packed arrays, and clear the packed
+*  accumulation variables
+*
+******************************************************************************/
+
+void nbl_pack_atoms(void)
+{
+  int k;
+
+  /* (re)allocate packed arrays */
+  if (nbl_nat > nbl_pk_max) {
+    nbl_pk_max = MAX( (int) (nbl_size * nbl_nat), nbl_nat );
+    nbl_ort    = (real *) realloc(nbl_ort,   SDIM * nbl_pk_max * sizeof(real));
+    nbl_kraft  = (real *) realloc(nbl_kraft, SDIM * nbl_pk_max * sizeof(real));
+    nbl_sorte  = (int  *) realloc(nbl_sorte,        nbl_pk_max * sizeof(int));
+    if ((NULL==nbl_ort) || (NULL==nbl_kraft) || (NULL==nbl_sorte))
+      error("cannot allocate packed neighbor data");
 #ifndef MONOLJ
-          pot *= 0.5;   /* avoid double counting */
+    nbl_pot    = (real *) realloc(nbl_pot, nbl_pk_max * sizeof(real));
+    if (NULL==nbl_pot) error("cannot allocate packed neighbor data");
+#endif
 #ifdef NNBR
-          if (r2 < nb_r2_cut[col ]) nb++;
-          if (r2 < nb_r2_cut[col2]) NBANZ(q,j)++;
+    nbl_nbanz  = (int  *) realloc(nbl_nbanz, nbl_pk_max * sizeof(int));
+    if (NULL==nbl_nbanz) error("cannot allocate packed neighbor data");
 #endif
-#ifdef ORDPAR
-          if (r2 < op_r2_cut[col ]) ee          += op_weight[col ] * pot;
-          if (r2 < op_r2_cut[col2]) POTENG(q,j) += op_weight[col2] * pot;
-#else
-          ee          += pot;
-          POTENG(q,j) += pot;
+#ifdef STRESS_TENS
+    nbl_press  = (sym_tensor *) realloc(nbl_press, 
+                                        nbl_pk_max * sizeof(sym_tensor));
+    if (NULL==nbl_press) error("cannot allocate packed neighbor data");
 #endif
+#ifdef EAM2
+    nbl_rho    = (real *) realloc(nbl_rho, nbl_pk_max * sizeof(real));
+    nbl_dF     = (real *) realloc(nbl_dF,  nbl_pk_max * sizeof(real));
+    if ((NULL==nbl_rho) || (NULL==nbl_dF))
+      error("cannot allocate packed neighbor data");
+#ifdef EEAM
+    nbl_p      = (real *) realloc(nbl_p,   nbl_pk_max * sizeof(real));
+    nbl_dM     = (real *) realloc(nbl_dM,  nbl_pk_max * sizeof(real));
+    if ((NULL==nbl_p) || (NULL==nbl_dM))
+      error("cannot allocate packed neighbor data");
 #endif
-#ifdef P_AXIAL
-          vir_xx -= d.x * force.x;
-          vir_yy -= d.y * force.y;
-#ifndef TWOD
-          vir_zz -= d.z * force.z;
 #endif
-#else
-          virial -= r2  * grad;
+#ifdef ADP
+    nbl_mu     = (real *) realloc(nbl_mu, SDIM * nbl_pk_max * sizeof(real));
+    nbl_lambda = (sym_tensor *) realloc(nbl_lambda, 
+                                        nbl_pk_max * sizeof(sym_tensor));
+    if ((NULL==nbl_mu) || (NULL==nbl_lambda))
+      error("cannot allocate packed neighbor data");
 #endif
+  }
 
-#ifdef STRESS_TENS
-          if (do_press_calc) {
-            /* avoid double counting of the virial */
-            force.x *= 0.5;
-            force.y *= 0.5;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (k=0; k<nallcells; k++) {
+    cell *p = cell_array + k;
+    int  i, n = cl_off[k];
+    for (i=0; i<p->n; i++, n++) {
+      nbl_ort X(n) = ORT(p,i,X);
+      nbl_ort Y(n) = ORT(p,i,Y);
 #ifndef TWOD
-            force.z *= 0.5;
+      nbl_ort Z(n) = ORT(p,i,Z);
 #endif
-            pp.xx             -= d.x * force.x;
-            PRESSTENS(q,j,xx) -= d.x * force.x;
-            pp.yy             -= d.y * force.y;
-            PRESSTENS(q,j,yy) -= d.y * force.y;
-            pp.xy             -= d.x * force.y;
-            PRESSTENS(q,j,xy) -= d.x * force.y;
+      nbl_sorte[n] = SORTE(p,i);
+      /* with full neighbor lists, nothing is accumulated */
+      if (nbl_full) continue;
+      nbl_kraft X(n) = 0.0;
+      nbl_kraft Y(n) = 0.0;
 #ifndef TWOD
-            pp.zz             -= d.z * force.z;
-            PRESSTENS(q,j,zz) -= d.z * force.z;
-            pp.yz             -= d.y * force.z;
-            PRESSTENS(q,j,yz) -= d.y * force.z;
-            pp.zx             -= d.z * force.x;
-            PRESSTENS(q,j,zx) -= d.z * force.x;
+      nbl_kraft Z(n) = 0.0;
+#endif
+#ifndef MONOLJ
+      nbl_pot[n] = 0.0;
+#endif
+#ifdef NNBR
+      nbl_nbanz[n] = 0;
+#endif
+#ifdef STRESS_TENS
+      nbl_press[n].xx = 0.0;
+      nbl_press[n].yy = 0.0;
+      nbl_press[n].xy = 0.0;
+#ifndef TWOD
+      nbl_press[n].zz = 0.0;
+      nbl_press[n].yz = 0.0;
+      nbl_press[n].zx = 0.0;
 #endif
-	  }
 #endif
-        }
-
-#endif /* PAIR || KEATING */
-
 #ifdef EAM2
-        /* compute host electron density */
-        if (r2 < rho_h_tab.end[col])  {
-          VAL_FUNC(rho_h, rho_h_tab, col, inc, r2, is_short);
-          eam_r += rho_h;
+      nbl_rho[n] = 0.0;
 #ifdef EEAM
-          eam_p += rho_h*rho_h; 
+      nbl_p[n]   = 0.0;
 #endif
-        }
-        if (it==jt) {
-          if (r2 < rho_h_tab.end[col]) {
-            EAM_RHO(q,j) += rho_h;
-#ifdef EEAM
-            EAM_P(q,j) += rho_h*rho_h;
 #endif
-          } 
-        } else {
-          if (r2 < rho_h_tab.end[col2]) {
-            VAL_FUNC(rho_h, rho_h_tab, col2, inc, r2, is_short);
-            EAM_RHO(q,j) += rho_h; 
+#ifdef ADP
+      nbl_mu X(n) = 0.0;
+      nbl_mu Y(n) = 0.0;
+      nbl_mu Z(n) = 0.0;
+      nbl_lambda[n].xx = 0.0;
+      nbl_lambda[n].yy = 0.0;
+      nbl_lambda[n].zz = 0.0;
+      nbl_lambda[n].yz = 0.0;
+      nbl_lambda[n].zx = 0.0;
+      nbl_lambda[n].xy = 0.0;
+#endif
+    }
+  }
+}
+
+/******************************************************************************
+*
+*  nbl_add_packed - add the packed accumulation variables to the cells,
+*  only forces and stresses if all==0
+*
+******************************************************************************/
+
+void nbl_add_packed(int all)
+{
+  int k;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (k=0; k<nallcells; k++) {
+    cell *p = cell_array + k;
+    int  i, n = cl_off[k];
+    for (i=0; i<p->n; i++, n++) {
+      KRAFT(p,i,X) += nbl_kraft X(n);
+      KRAFT(p,i,Y) += nbl_kraft Y(n);
+#ifndef TWOD
+      KRAFT(p,i,Z) += nbl_kraft Z(n);
+#endif
+#ifdef STRESS_TENS
+      PRESSTENS(p,i,xx) += nbl_press[n].xx;
+      PRESSTENS(p,i,yy) += nbl_press[n].yy;
+      PRESSTENS(p,i,xy) += nbl_press[n].xy;
+#ifndef TWOD
+      PRESSTENS(p,i,zz) += nbl_press[n].zz;
+      PRESSTENS(p,i,yz) += nbl_press[n].yz;
+      PRESSTENS(p,i,zx) += nbl_press[n].zx;
+#endif
+#endif
+      if (0==all) continue;
+#ifndef MONOLJ
+      POTENG(p,i) += nbl_pot[n];
+#endif
+#ifdef NNBR
+      NBANZ(p,i)  += nbl_nbanz[n];
+#endif
+#ifdef EAM2
+      EAM_RHO(p,i) += nbl_rho[n];
 #ifdef EEAM
-            EAM_P(q,j) += rho_h*rho_h; 
+      EAM_P(p,i)   += nbl_p[n];
 #endif
-          }
-        }
 #endif
+#ifdef ADP
+      ADP_MU    (p,i,X)  += nbl_mu X(n);
+      ADP_MU    (p,i,Y)  += nbl_mu Y(n);
+      ADP_MU    (p,i,Z)  += nbl_mu Z(n);
+      ADP_LAMBDA(p,i,xx) += nbl_lambda[n].xx;
+      ADP_LAMBDA(p,i,yy) += nbl_lambda[n].yy;
+      ADP_LAMBDA(p,i,zz) += nbl_lambda[n].zz;
+      ADP_LAMBDA(p,i,yz) += nbl_lambda[n].yz;
+      ADP_LAMBDA(p,i,zx) += nbl_lambda[n].zx;
+      ADP_LAMBDA(p,i,xy) += nbl_lambda[n].xy;
+#endif
+    }
+  }
+}
+
+#ifdef EAM2
+
+/******************************************************************************
+*
+*  nbl_pack_dF - copy the derivative of the embedding energy (and the
+*  ADP dipole and quadrupole distortions) of all atoms to the packed
+*  arrays, and clear the packed forces and stresses
+*
+******************************************************************************/
+
+void nbl_pack_dF(void)
+{
+  int k;
 
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (k=0; k<nallcells; k++) {
+    cell *p = cell_array + k;
+    int  i, n = cl_off[k];
+    for (i=0; i<p->n; i++, n++) {
+      nbl_dF[n] = EAM_DF(p,i);
+#ifdef EEAM
+      nbl_dM[n] = EAM_DM(p,i);
+#endif
 #ifdef ADP
-        /* compute adp_mu */
-        if (r2 < adp_upot.end[col])  {
-          VAL_FUNC(pot, adp_upot, col, inc, r2, is_short);
-          tmp = pot * d.x;  mu.x += tmp;  ADP_MU(q,j,X) -= tmp;
-          tmp = pot * d.y;  mu.y += tmp;  ADP_MU(q,j,Y) -= tmp;
-          tmp = pot * d.z;  mu.z += tmp;  ADP_MU(q,j,Z) -= tmp;
-        }
-        /* compute adp_lambda */
-        if (r2 < adp_wpot.end[col])  {
-          VAL_FUNC(pot, adp_wpot, col, inc, r2, is_short);
-          tmp = pot * d.x * d.x;  la.xx += tmp;  ADP_LAMBDA(q,j,xx) += tmp;
-          tmp = pot * d.y * d.y;  la.yy += tmp;  ADP_LAMBDA(q,j,yy) += tmp;
-          tmp = pot * d.z * d.z;  la.zz += tmp;  ADP_LAMBDA(q,j,zz) += tmp;
-          tmp = pot * d.y * d.z;  la.yz += tmp;  ADP_LAMBDA(q,j,yz) += tmp;
-          tmp = pot * d.z * d.x;  la.zx += tmp;  ADP_LAMBDA(q,j,zx) += tmp;
-          tmp = pot * d.x * d.y;  la.xy += tmp;  ADP_LAMBDA(q,j,xy) += tmp;
-        }
-#endif /* ADP */
+      nbl_mu X(n)      = ADP_MU    (p,i,X);
+      nbl_mu Y(n)      = ADP_MU    (p,i,Y);
+      nbl_mu Z(n)      = ADP_MU    (p,i,Z);
+      nbl_lambda[n].xx = ADP_LAMBDA(p,i,xx);
+      nbl_lambda[n].yy = ADP_LAMBDA(p,i,yy);
+      nbl_lambda[n].zz = ADP_LAMBDA(p,i,zz);
+      nbl_lambda[n].yz = ADP_LAMBDA(p,i,yz);
+      nbl_lambda[n].zx = ADP_LAMBDA(p,i,zx);
+      nbl_lambda[n].xy = ADP_LAMBDA(p,i,xy);
+#endif
+      if (nbl_full) continue;
+      nbl_kraft X(n) = 0.0;
+      nbl_kraft Y(n) = 0.0;
+      nbl_kraft Z(n) = 0.0;
+#ifdef STRESS_TENS
+      nbl_press[n].xx = 0.0;
+      nbl_press[n].yy = 0.0;
+      nbl_press[n].zz = 0.0;
+      nbl_press[n].yz = 0.0;
+      nbl_press[n].zx = 0.0;
+      nbl_press[n].xy = 0.0;
+#endif
+    }
+  }
+}
 
-#ifdef COULOMB
-#ifdef VARCHG
-        chg = CHARGE(p,i) * CHARGE(q,j);
-#else
-	chg = charge[it]  * charge[jt];
+#endif /* EAM2 */
+
+#endif /* NBL_PACKED */
+
+/******************************************************************************
+*
+*  calc_forces
+*
+******************************************************************************/
+
+void calc_forces(int steps)
+{
+  int  i, b, k, is_short=0;
+#if !defined(NBL_CLUSTER) || defined(COVALENT) || defined(DIPOLE) || defined(KERMODE)
+  int  n=0;
 #endif
+#ifndef NBL_CLUSTER
+  int  col;
+#endif
+  real tmpvec1[8], tmpvec2[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+#if defined(DIPOLE) || defined(KERMODE)
+  static int dp_E_calc=0; 	/* Number of field iterations */
+  int dp_it=0;			/* Number of dipole iterations */
+  int dp_p_calc=0;		/* Calculate dipoles or keep them */
+  /* TODO: Communicate! */
+  int dp_converged=0;
+  real dp_sum_old, dp_sum=1.,dp_sum_global=1.0;
 #ifndef KERMODE
-	if (r2 < ew_r2_cut) {
+  real max_diff=10.;
 #endif
 #ifdef KERMODE
-        if (r2 < ke_tot_r2cut) {
+  real pot1,pot2;
+  real max_diff=500.;
 #endif
-	  if (SQR(chg)>0.) {
-#ifdef SM
-            real cr_pot=0.0, cr_gr=0.0, na_pot_p=0.0, na_pot_q=0.0, na_gr_p=0.0, na_gr_q=0.0, sm_es_energy=0.0;
-            real z_sm_p = sm_Z[it] * CHARGE(q,j) * coul_eng;
-            real z_sm_q = sm_Z[jt] * CHARGE(p,i) * coul_eng;
+  real *dp_E_shift;
+  dp_p_calc = ((dp_fix-1 + dp_fix*dp_E_calc)>0 ) ? 0 : 1;
+#ifdef EWALD
+  /* r-RESPA: iterate the dipoles only in outer steps, keep them in between */
+  if ((respa_steps > 1) && ((steps - steps_min) % respa_steps)) dp_p_calc = 0;
 #endif
-	    /* Constant electric field from charges */
-	    /* Coulomb potential is in column 0 */
-            int incr = coul_table.ncols;
-	    PAIR_INT(phi, grphi, coul_table, 0, incr, r2, is_short);
-
-	    /* Coulomb Energy */
-	    pot     = chg * phi;
-#ifdef SM
-	    sm_es_energy  = chg * phi;
 #endif
-	    grad    = chg * grphi;
-#ifdef SM
-            /* Coulomb repulsion potential */
-            if (r2 < cr_pot_tab.end[col]) {
-              PAIR_INT(cr_pot, cr_gr, cr_pot_tab, col, inc, r2, is_short);
-              pot  += cr_pot * (chg * coul_eng - z_sm_p - z_sm_q);
-	      sm_es_energy  += cr_pot * (chg * coul_eng - z_sm_p - z_sm_q);
-              grad += cr_gr * (chg * coul_eng - z_sm_p - z_sm_q);
-            }
-            /* nuclear attraction potential */
-            if (r2 < na_pot_tab.end[col]) {
-              PAIR_INT(na_pot_p, na_gr_p, na_pot_tab, col, inc, r2, is_short);
-            }
-            if (r2 < na_pot_tab.end[col2]) {
-              PAIR_INT(na_pot_q, na_gr_q, na_pot_tab, col2, inc, r2,is_short);
-            }
-              pot  += z_sm_q * na_pot_p + z_sm_p * na_pot_q;
-              sm_es_energy += z_sm_q * na_pot_p + z_sm_p * na_pot_q;
-              grad += z_sm_q * na_gr_p + z_sm_p * na_gr_q;
 
+  if (0==have_valid_nbl) {
+    if (nbl_adapt) imd_start_timer(&nbl_build_time);
+#ifdef MPI
+    /* check message buffer size */
+    if (0 == nbl_count % BUFSTEP) setup_buffers();
 #endif
+    /* update cell decomposition */
+    fix_cells();
+    /* restore spatial order of atoms in cells, always for clusters */
+    if (nbl_cluster || ((nbl_sort > 0) && (0 == nbl_count % nbl_sort)))
+      sort_nbl_cells();
+    if (nbl_adapt) imd_stop_timer(&nbl_build_time);
+  }
 
-#ifdef SM
-	    tot_sm_es_energy += sm_es_energy;	
+  /* fill the buffer cells; between neighbor list updates, 
+     only the positions need to be updated */
+#ifdef COMM_LISTS
+  if (nbl_comm_lists && have_valid_nbl) send_cells_lists();
+  else
 #endif
+  send_cells(copy_cell,pack_cell,unpack_cell);
 
-	    tot_pot_energy += pot;
-	    force.x = d.x * grad;
-	    force.y = d.y * grad;
-	    force.z = d.z * grad;
+  /* make new neighbor lists */
+  if (0==have_valid_nbl) {
+    if (nbl_adapt) imd_start_timer(&nbl_build_time);
+    make_nblist();
+#ifdef COMM_LISTS
+    if (nbl_comm_lists) make_comm_lists();
+#endif
+    if (nbl_adapt) imd_stop_timer(&nbl_build_time);
+  }
+  if (nbl_adapt) {
+    imd_start_timer(&nbl_force_time);
+    nbl_force_work += nbl_r2cut * SQRT(nbl_r2cut);
+  }
 
-#ifdef EXTF
-	    real chg_single;
-#ifdef VARCHG
-	    chg_single = CHARGE(p,i);
-#else
-	    chg_single = charge[it];
+#ifdef NBL_PACKED
+  /* copy positions and types to packed arrays */
+  nbl_pack_atoms();
 #endif
-	    force.x += chg_single * extf.x; 
-	    force.y += chg_single * extf.y; 
-	    force.z += chg_single * extf.z; 
-#endif /* EXTF */
-            
-	    KRAFT(q,j,X) -= force.x;
-	    KRAFT(q,j,Y) -= force.y;
-	    KRAFT(q,j,Z) -= force.z;
-	    ff.x         += force.x;
-	    ff.y         += force.y;
-	    ff.z         += force.z;
-            pot          *= 0.5;   /* avoid double counting */
-	    ee           += pot;
-	    POTENG(q,j)  += pot;
-#ifdef P_AXIAL
-	    vir_xx -= d.x * force.x;
-	    vir_yy -= d.y * force.y;
-	    vir_zz -= d.z * force.z;
-#else
-	    virial -= r2  * grad;
+
+  /* clear global accumulation variables */
+  tot_pot_energy = 0.0;
+#ifdef SM
+  tot_sm_es_energy = 0.0;
 #endif
+  virial = 0.0;
+  vir_xx = 0.0;
+  vir_yy = 0.0;
+  vir_xy = 0.0;
+  vir_zz = 0.0;
+  vir_yz = 0.0;
+  vir_zx = 0.0;
+  nfc++;
 
-#ifdef STRESS_TENS
-	    if (do_press_calc) {
-	      /* avoid double counting of the virial */
-	      force.x *= 0.5;
-	      force.y *= 0.5;
-	      force.z *= 0.5;
-	      pp.xx             -= d.x * force.x;
-	      PRESSTENS(q,j,xx) -= d.x * force.x;
-	      pp.yy             -= d.y * force.y;
-	      PRESSTENS(q,j,yy) -= d.y * force.y;
-	      pp.xy             -= d.x * force.y;
-	      PRESSTENS(q,j,xy) -= d.x * force.y;
-	      pp.zz             -= d.z * force.z;
-	      PRESSTENS(q,j,zz) -= d.z * force.z;
-	      pp.yz             -= d.y * force.z;
-	      PRESSTENS(q,j,yz) -= d.y * force.z;
-	      pp.zx             -= d.z * force.x;
-	      PRESSTENS(q,j,zx) -= d.z * force.x;
-	    }
+#ifdef NBL_PACKED
+  /* full neighbor lists have their own force loops */
+  if (nbl_full) {
+    calc_forces_full(steps);
+    if (nbl_adapt) imd_stop_timer(&nbl_force_time);
+    return;
+  }
 #endif
 
-#if defined(DIPOLE) || defined(KERMODE)
-#ifdef VARCHG
-	    /* Field for Dipole calculation */
-	    if (dp_p_calc) {
-#ifdef SM
-	      Estat.x += d.x * grphi * CHARGE(q,j)
-		+ d.x * coul_eng * (CHARGE(q,j)-sm_Z[jt])*na_gr_q;
-	      Estat.y += d.y * grphi * CHARGE(q,j)
-		+ d.y * coul_eng * (CHARGE(q,j)-sm_Z[jt])*na_gr_q;
-	      Estat.z += d.z * grphi * CHARGE(q,j)
-		+ d.z * coul_eng * (CHARGE(q,j)-sm_Z[jt])*na_gr_q;
-	      DP_E_STAT(q,j,X) -= d.x * grphi * CHARGE(p,i)
-		+ d.x * coul_eng * (CHARGE(p,i)-sm_Z[it])*na_gr_p;
-	      DP_E_STAT(q,j,Y) -= d.y * grphi * CHARGE(p,i)
-		+ d.y * coul_eng * (CHARGE(p,i)-sm_Z[it])*na_gr_p;
-	      DP_E_STAT(q,j,Z) -= d.z * grphi * CHARGE(p,i)
-		+ d.z * coul_eng * (CHARGE(p,i)-sm_Z[it])*na_gr_p;
-#else
-	      Estat.x += d.x * grphi * CHARGE(q,j);
-	      Estat.y += d.y * grphi * CHARGE(q,j);
-	      Estat.z += d.z * grphi * CHARGE(q,j);
-	      DP_E_STAT(q,j,X) -= d.x * grphi * CHARGE(p,i);
-	      DP_E_STAT(q,j,Y) -= d.y * grphi * CHARGE(p,i);
-	      DP_E_STAT(q,j,Z) -= d.z * grphi * CHARGE(p,i);
+  /* clear per atom accumulation variables, also in buffer cells */
+#ifdef _OPENMP
+#pragma omp parallel for private(i)
 #endif
-            }
-#else
-	    /* Field for Dipole calculation */
-	    if (dp_p_calc) {
-#ifndef KERMODE
-	      Estat.x += d.x * grphi * charge[jt];
-	      Estat.y += d.y * grphi * charge[jt];
-	      Estat.z += d.z * grphi * charge[jt];
-	      DP_E_STAT(q,j,X) -= d.x * grphi * charge[it];
-	      DP_E_STAT(q,j,Y) -= d.y * grphi * charge[it];
-	      DP_E_STAT(q,j,Z) -= d.z * grphi * charge[it];
+  for (k=0; k<nallcells; k++) {
+    cell *p = cell_array + k;
+#ifdef ia64
+#pragma ivdep,swp
 #endif
-#ifdef KERMODE
-	      //{1/r*exp(-br)*fc}
-              VAL_FUNC(pot1,coul_table,0, 2+ntypepairs, r2, is_short);
-              pot1 /=r2;
-              Estat.x -= d.x * pot1 * charge[jt];
-              Estat.y -= d.y * pot1 * charge[jt];
-              Estat.z -= d.z * pot1 * charge[jt];
-              DP_E_STAT(q,j,X) += d.x * pot1 * charge[it];
-              DP_E_STAT(q,j,Y) += d.y * pot1 * charge[it];
-              DP_E_STAT(q,j,Z) += d.z * pot1 * charge[it];    
-#endif
-#ifdef EXTF
-	      Estat.x += extf.x;
-	      Estat.y += extf.y;
-	      Estat.z += extf.z;
-	      DP_E_STAT(q,j,X) += extf.x;
-	      DP_E_STAT(q,j,Y) += extf.y;
-	      DP_E_STAT(q,j,Z) += extf.z;
-#endif
-	    }
-#endif
-#endif
-	  }
-#if defined(DIPOLE) || defined(KERMODE)
-#ifdef VARCHG
-	  /* calculate short-range dipoles field */
-	  /* short-range fn.: 3rd column ff. */
-	  if (dp_p_calc) {
-	    col=(it <= jt) ?
-	      it * ntypes + jt - ((it * (it + 1))/2)
-	      : jt * ntypes + it - ((jt * (jt + 1))/2);
-	    VAL_FUNC(pot,coul_table,2+col, 2+ntypepairs, r2, is_short);
-	    tmp = pot*CHARGE(q,j)*dp_alpha[it];
-	    if (SQR(tmp)>0) {
-	      pstat.x -= tmp * d.x;
-	      pstat.y -= tmp * d.y;
-	      pstat.z -= tmp * d.z;
-	    }
-	    tmp = pot*CHARGE(p,i)*dp_alpha[jt];
-	    if (SQR(tmp)>0){
-	      DP_P_STAT(q,j,X) += tmp * d.x;
-	      DP_P_STAT(q,j,Y) += tmp * d.y;
-	      DP_P_STAT(q,j,Z) += tmp * d.z;
-	    }
-	  }
-#else
-	  /* calculate short-range dipoles field */
-	  /* short-range fn.: 3rd column ff. */
-	  if (dp_p_calc) {
-	    col=(it <= jt) ?
-	      it * ntypes + jt - ((it * (it + 1))/2)
-	      : jt * ntypes + it - ((jt * (jt + 1))/2);
-#ifndef KERMODE
-	    VAL_FUNC(pot,coul_table,2+col, 2+ntypepairs, r2, is_short);
-	    tmp = pot*charge[jt]*dp_alpha[it];
-#endif
-#ifdef KERMODE
-            //{gij}
-            VAL_FUNC(pot2,coul_table,2+col, 2+ntypepairs, r2, is_short);
-            tmp = pot2*charge[jt]*dp_alpha[it]*pot1;     
-#endif
-	    if (SQR(tmp)>0) {
-	      pstat.x -= tmp * d.x;
-	      pstat.y -= tmp * d.y;
-	      pstat.z -= tmp * d.z;
-#ifdef EXTF
-	      pstat.x += dp_alpha[it] * extf.x;
-	      pstat.y += dp_alpha[it] * extf.y;
-	      pstat.z += dp_alpha[it] * extf.z;
+    for (i=0; i<p->n; i++) {
+      KRAFT(p,i,X) = 0.0;
+      KRAFT(p,i,Y) = 0.0;
+#ifndef TWOD
+      KRAFT(p,i,Z) = 0.0;
 #endif
-	    }
-#ifndef KERMODE
-	    tmp = pot*charge[it]*dp_alpha[jt];
+#if defined(STRESS_TENS)
+      PRESSTENS(p,i,xx) = 0.0;
+      PRESSTENS(p,i,yy) = 0.0;
+      PRESSTENS(p,i,xy) = 0.0;
+#ifndef TWOD
+      PRESSTENS(p,i,zz) = 0.0;
+      PRESSTENS(p,i,yz) = 0.0;
+      PRESSTENS(p,i,zx) = 0.0;
 #endif
-#ifdef KERMODE
-            tmp = pot2*charge[it]*dp_alpha[jt]*pot1;      
+#endif     
+#ifndef MONOLJ
+      POTENG(p,i) = 0.0;
 #endif
-	    if (SQR(tmp)>0){
-	      DP_P_STAT(q,j,X) += tmp * d.x;
-	      DP_P_STAT(q,j,Y) += tmp * d.y;
-	      DP_P_STAT(q,j,Z) += tmp * d.z;
-#ifdef EXTF
-	      DP_P_STAT(q,j,X) += dp_alpha[jt] * extf.x;
-	      DP_P_STAT(q,j,Y) += dp_alpha[jt] * extf.y;
-	      DP_P_STAT(q,j,Z) += dp_alpha[jt] * extf.z;
+#ifdef NNBR
+      NBANZ(p,i) = 0;
 #endif
-	    }
-	  }
+#ifdef CNA
+      if (cna) MARK(p,i) = 0;
 #endif
-#endif /* DIPOLE */
-	}
-#endif /* COULOMB */
-
 #ifdef COVALENT
-        /* make neighbor tables for covalent systems */
-        if (r2 < neightab_r2cut[col]) {
-
-          neightab *neigh;
-
-          /* update neighbor table of particle i */
-          neigh = NEIGH(p,i);
-          if (neigh->n_max <= neigh->n) {
-            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
-          }
-          neigh->typ[neigh->n] = jt;
-          neigh->cl [neigh->n] = q;
-          neigh->num[neigh->n] = j;
-          neigh->dist[3*neigh->n  ] = d.x;
-          neigh->dist[3*neigh->n+1] = d.y;
-          neigh->dist[3*neigh->n+2] = d.z;
-          neigh->n++;
-
-          /* update neighbor table of particle j */
-          neigh = NEIGH(q,j);
-          if (neigh->n_max <= neigh->n) {
-            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
-          }
-          neigh->typ[neigh->n] = it;
-          neigh->cl [neigh->n] = p;
-          neigh->num[neigh->n] = i;
-          neigh->dist[3*neigh->n  ] = -d.x;
-          neigh->dist[3*neigh->n+1] = -d.y;
-          neigh->dist[3*neigh->n+2] = -d.z;
-          neigh->n++;
-        }
-#endif  /* COVALENT */
-
-      }
-      KRAFT(p,i,X) += ff.x;
-      KRAFT(p,i,Y) += ff.y;
-      KRAFT(p,i,Z) += ff.z;
-#ifndef MONOLJ
-      POTENG(p,i)  += ee;
+      NEIGH(p,i)->n = 0;
 #endif
 #ifdef EAM2
-      EAM_RHO(p,i) += eam_r;
+      EAM_RHO(p,i) = 0.0;
 #ifdef EEAM
-      EAM_P(p,i)   += eam_p;
+      EAM_P(p,i) = 0.0;
 #endif
 #endif
 #ifdef ADP
-      ADP_MU    (p,i,X)  += mu.x;
-      ADP_MU    (p,i,Y)  += mu.y;
-      ADP_MU    (p,i,Z)  += mu.z;
-      ADP_LAMBDA(p,i,xx) += la.xx;
-      ADP_LAMBDA(p,i,yy) += la.yy;
-      ADP_LAMBDA(p,i,zz) += la.zz;
-      ADP_LAMBDA(p,i,yz) += la.yz;
-      ADP_LAMBDA(p,i,zx) += la.zx;
-      ADP_LAMBDA(p,i,xy) += la.xy;
+      ADP_MU    (p,i,X)  = 0.0;
+      ADP_MU    (p,i,Y)  = 0.0;
+      ADP_MU    (p,i,Z)  = 0.0;
+      ADP_LAMBDA(p,i,xx) = 0.0;
+      ADP_LAMBDA(p,i,yy) = 0.0;
+      ADP_LAMBDA(p,i,xy) = 0.0;
+      ADP_LAMBDA(p,i,zz) = 0.0;
+      ADP_LAMBDA(p,i,yz) = 0.0;
+      ADP_LAMBDA(p,i,zx) = 0.0;
 #endif
 #if defined(DIPOLE) || defined(KERMODE)
-      if (dp_p_calc) {
-	DP_E_STAT(p,i,X)   += Estat.x;
-	DP_E_STAT(p,i,Y)   += Estat.y;
-	DP_E_STAT(p,i,Z)   += Estat.z;
-	DP_P_STAT(p,i,X)   += pstat.x;
-	DP_P_STAT(p,i,Y)   += pstat.y;
-	DP_P_STAT(p,i,Z)   += pstat.z;
-	/* Field Extrapolation */
-	if (dp_E_calc>2) {
-	  DP_E_IND(p,i,X) = 3.*DP_E_OLD_1(p,i,X) - 3.*DP_E_OLD_2(p,i,X) +
-	    DP_E_OLD_3(p,i,X);
-	  DP_E_IND(p,i,Y) = 3.*DP_E_OLD_1(p,i,Y) - 3.*DP_E_OLD_2(p,i,Y) +
-	    DP_E_OLD_3(p,i,Y);
-	  DP_E_IND(p,i,Z) = 3.*DP_E_OLD_1(p,i,Z) - 3.*DP_E_OLD_2(p,i,Z) +
-	    DP_E_OLD_3(p,i,Z);
-	  DP_E_OLD_3(p,i,X) = 0.;
-	  DP_E_OLD_3(p,i,Y) = 0.;
-	  DP_E_OLD_3(p,i,Z) = 0.;
-	} else {
-	  DP_E_IND(p,i,X) = DP_E_OLD_1(p,i,X);
-	  DP_E_IND(p,i,Y) = DP_E_OLD_1(p,i,Y);
-	  DP_E_IND(p,i,Z) = DP_E_OLD_1(p,i,Z);
-	}
+      DP_E_STAT(p,i,X) = 0.0;
+      DP_E_STAT(p,i,Y) = 0.0;
+      DP_E_STAT(p,i,Z) = 0.0;
+      DP_P_STAT(p,i,X) = 0.0;
+      DP_P_STAT(p,i,Y) = 0.0;
+      DP_P_STAT(p,i,Z) = 0.0;
+      DP_E_IND(p,i,X)  = 0.0;
+      DP_E_IND(p,i,Y)  = 0.0;
+      DP_E_IND(p,i,Z)  = 0.0;
+      if ( dp_p_calc ) {
+	DP_P_IND(p,i,X)  = 0.0;
+	DP_P_IND(p,i,Y)  = 0.0;
+	DP_P_IND(p,i,Z)  = 0.0;
       }
-#endif
-#ifdef STRESS_TENS
-      if (do_press_calc) {
-        PRESSTENS(p,i,xx) += pp.xx;
-        PRESSTENS(p,i,yy) += pp.yy;
-        PRESSTENS(p,i,xy) += pp.xy;
+#endif /* dipole */
+    }
+  }
+
+  /* clear total forces */
+#ifdef RIGID
+  if ( nsuperatoms>0 ) 
+    for(i=0; i<nsuperatoms; i++) {
+      superforce[i].x = 0.0;
+      superforce[i].y = 0.0;
 #ifndef TWOD
-        PRESSTENS(p,i,zz) += pp.zz;
-        PRESSTENS(p,i,yz) += pp.yz;
-        PRESSTENS(p,i,zx) += pp.zx;
-#endif
-      }
-#endif
-#ifdef NNBR
-      NBANZ(p,i)    += nb;
+      superforce[i].z = 0.0;
 #endif
-      n++;
-    }
-#if defined(DIPOLE) || defined(KERMODE)
-    if (dp_p_calc) {
-      dp_E_shift = p->dp_E_old_3;
-      p->dp_E_old_3 = p->dp_E_old_2;
-      p->dp_E_old_2 = p->dp_E_old_1;
-      p->dp_E_old_1 = dp_E_shift;
     }
-#endif /* DIPOLE */
-  }
-  if (is_short) fprintf(stderr,"Short distance, pair, step %d!\n",steps);
+#endif
 
 #ifdef EWALD
   if (steps==0) {
-    imd_stop_timer( &ewald_time );
+    ewald_time.total = 0.0;
+    imd_start_timer( &ewald_time );
   }
 #endif
 
-#ifdef COVALENT
-
-  /* complete neighbor tables for covalent systems */
-  for (k=ncells; k<ncells2; k++) {
-    cell *p = cell_array +cnbrs[k].np;
+#ifdef NBL_CLUSTER
+  /* pure pair interactions, on cluster pairs or in blocks of neighbors */
+  if (nbl_cluster) calc_pair_clusters(steps);
+  else             calc_pair_blocks(steps);
+#else
+  /* pair interactions - for all atoms, one group of cells after the other */
+  for (col=0; col<NBL_NCOLORS; col++) {
+#ifdef NBL_OMP
+#pragma omp parallel for schedule(runtime) private(k,i,n) \
+  reduction(+:tot_pot_energy,virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy,is_short)
+#endif
+  for (b=nbl_color_start[col]; b<nbl_color_start[col+1]; b++) {
+    cell *p;
+    k = nbl_ccell[b];
+    n = nbl_cstart[k];
+    p = cell_array + cnbrs[k].np;
     for (i=0; i<p->n; i++) {
 
-      vektor d1;
-      int    m, it;
-
-      d1.x = ORT(p,i,X);
-      d1.y = ORT(p,i,Y);
-      d1.z = ORT(p,i,Z);
-      it   = SORTE(p,i);
-
-      /* loop over neighbors */
-      for (m=tl[n]; m<tl[n+1]; m++) {
-
-        int    c, j, jt, col, inc = ntypes * ntypes; 
-        vektor d;
-        real   r2;
-        cell   *q;
-
-        c = cl_num[ tb[m] ];
-        j = tb[m] - cl_off[c];
-        q = cell_array + c;
-
-        d.x = ORT(q,j,X) - d1.x;
-        d.y = ORT(q,j,Y) - d1.y;
-        d.z = ORT(q,j,Z) - d1.z;
-        r2  = SPROD(d,d);
-        jt  = SORTE(q,j);
-        col = it * ntypes + jt;
-
-        /* make neighbor tables */
-        if (r2 <= neightab_r2cut[col]) {
-
-          neightab *neigh;
-
-          /* update neighbor table of particle i */
-          neigh = NEIGH(p,i);
-          if (neigh->n_max <= neigh->n) {
-            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
-          }
-          neigh->typ[neigh->n] = jt;
-          neigh->cl [neigh->n] = q;
-          neigh->num[neigh->n] = j;
-          neigh->dist[3*neigh->n  ] = d.x;
-          neigh->dist[3*neigh->n+1] = d.y;
-          neigh->dist[3*neigh->n+2] = d.z;
-          neigh->n++;
-
-          /* update neighbor table of particle j */
-          /* we do not need a neighbor table in buffer cells
-          neigh = NEIGH(q,j);
-          if (neigh->n_max <= neigh->n) {
-            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
-          }
-          neigh->typ[neigh->n] = it;
-          neigh->cl [neigh->n] = p;
-          neigh->num[neigh->n] = i;
-          neigh->dist[3*neigh->n  ] = -d.x;
-          neigh->dist[3*neigh->n+1] = -d.y;
-          neigh->dist[3*neigh->n+2] = -d.z;
-          neigh->n++;
-          */
-        }
-      }
-      n++;
-    }
-  }
-
-#ifndef CNA
-  /* second force loop for covalent systems */
-  for (k=0; k<ncells; ++k) {
-    do_forces2(cell_array + cnbrs[k].np,
-               &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
-                                         &vir_yz, &vir_zx, &vir_xy);
-  }
-#endif
-
-#endif /* COVALENT */
-
-#ifdef EAM2
-
-  /* collect host electron density */
-  send_forces(add_rho,pack_rho,unpack_add_rho);
-
-  /* compute embedding energy and its derivative */
-  for (k=0; k<ncells; k++) {
-    cell *p = CELLPTR(k);
-    real pot, tmp, tr;
-#ifdef ia64
-#pragma ivdep,swp
+#ifdef STRESS_TENS
+#ifdef TWOD
+      sym_tensor pp = {0.0,0.0,0.0};
+#else
+      sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
 #endif
-    for (i=0; i<p->n; i++) {
-      PAIR_INT( pot, EAM_DF(p,i), embed_pot, SORTE(p,i), 
-                ntypes, EAM_RHO(p,i), idummy);
-      POTENG(p,i)    += pot;
-      tot_pot_energy += pot;
-#ifdef EEAM
-      PAIR_INT( pot, EAM_DM(p,i), emod_pot, SORTE(p,i), 
-                ntypes, EAM_P(p,i), idummy);
-      POTENG(p,i)    += pot;
-      tot_pot_energy += pot;
 #endif
 #ifdef ADP
-      tr  = (ADP_LAMBDA(p,i,xx) + ADP_LAMBDA(p,i,yy) + ADP_LAMBDA(p,i,zz))/3.0;
-      tmp = ADP_LAMBDA(p,i,xx) - tr; pot  = SQR(tmp);
-      tmp = ADP_LAMBDA(p,i,yy) - tr; pot += SQR(tmp);
-      tmp = ADP_LAMBDA(p,i,zz) - tr; pot += SQR(tmp);
-      tmp = ADP_LAMBDA(p,i,yz);      pot += SQR(tmp) * 2.0;
-      tmp = ADP_LAMBDA(p,i,zx);      pot += SQR(tmp) * 2.0;
-      tmp = ADP_LAMBDA(p,i,xy);      pot += SQR(tmp) * 2.0;
-      tmp = ADP_MU    (p,i,X);       pot += SQR(tmp);
-      tmp = ADP_MU    (p,i,Y);       pot += SQR(tmp);
-      tmp = ADP_MU    (p,i,Z);       pot += SQR(tmp);
-      pot *= 0.5;
-      POTENG(p,i)    += pot;
-      tot_pot_energy += pot;
+      real       tmp;
+      vektor     mu = {0.0,0.0,0.0};
+      sym_tensor la = {0.0,0.0,0.0,0.0,0.0,0.0};
 #endif
-    }
-  }
-
-  /* distribute derivative of embedding energy */
-  send_cells(copy_dF,pack_dF,unpack_dF);
-
-  /* EAM interactions - for all atoms */
-  n=0;
-  for (k=0; k<ncells; k++) {
-    cell *p = CELLPTR(k);
-    for (i=0; i<p->n; i++) {
-
-#ifdef STRESS_TENS
-      sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
+#ifdef COULOMB
+      real       phi, grphi, chg;
 #endif
-#ifdef ADP
-      sym_tensor la1;
-      vektor mu1;
+#if defined(DIPOLE) || defined(KERMODE)
+      real       tmp;
+      vektor     Estat = {0.0,0.0,0.0};
+      vektor     pstat = {0.0,0.0,0.0};
 #endif
+#ifdef TWOD
+      vektor d1, ff = {0.0,0.0};
+#else
       vektor d1, ff = {0.0,0.0,0.0};
-      int m, it;
+#endif
+      real   ee = 0.0;
+      real   eam_r = 0.0, eam_p = 0.0;
+      int    m, it, nb = 0;
 
       d1.x = ORT(p,i,X);
       d1.y = ORT(p,i,Y);
+#ifndef TWOD
       d1.z = ORT(p,i,Z);
-#ifdef ADP
-      mu1.x  = ADP_MU    (p,i,X);
-      mu1.y  = ADP_MU    (p,i,Y);
-      mu1.z  = ADP_MU    (p,i,Z);
-      la1.xx = ADP_LAMBDA(p,i,xx);
-      la1.yy = ADP_LAMBDA(p,i,yy);
-      la1.zz = ADP_LAMBDA(p,i,zz);
-      la1.yz = ADP_LAMBDA(p,i,yz);
-      la1.zx = ADP_LAMBDA(p,i,zx);
-      la1.xy = ADP_LAMBDA(p,i,xy);
 #endif
       it   = SORTE(p,i);
 
       /* loop over neighbors */
 #ifdef ia64
-#pragma ivdep,swp
+#pragma ivdep
 #endif
       for (m=tl[n]; m<tl[n+1]; m++) {
 
-        vektor d, force = {0.0,0.0,0.0};
-        real   r2;
-        int    c, j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
+        vektor d, force;
+#ifndef NBL_PACKED
         cell   *q;
+        int    c;
+#endif
+        real   pot, grad, r2, rho_h;
+        int    j, jt, col, col2, inc = ntypes * ntypes;
 
-        c = cl_num[ tb[m] ];
-        j = tb[m] - cl_off[c];
+#ifdef NBL_PACKED
+        j = NBL_NBR(k,tb[m]);
+#else
+        c = NBL_NBR_CELL(k,tb[m]);
+        j = NBL_NBR_ATOM(k,tb[m]);
         q = cell_array + c;
+#endif
 
-        d.x  = ORT(q,j,X) - d1.x;
-        d.y  = ORT(q,j,Y) - d1.y;
-        d.z  = ORT(q,j,Z) - d1.z;
-        r2   = SPROD(d,d);
-        jt   = SORTE(q,j);
-        col1 = jt * ntypes + it;
-        col2 = it * ntypes + jt;
-
-        if ((r2 < rho_h_tab.end[col1]) || (r2 < rho_h_tab.end[col2])) {
-
-          real pot, grad, rho_i_strich, rho_j_strich, rho_i, rho_j;
-
-          /* take care: particle i gets its rho from particle j.    */
-          /* This is tabulated in column it*ntypes+jt.              */
-          /* Here we need the giving part from column jt*ntypes+it. */
-
-          /* rho_strich_i(r_ij) */
-#ifndef EEAM
-          DERIV_FUNC(rho_i_strich, rho_h_tab, col1, inc, r2, is_short);
-#else
-          /* rho_strich_i(r_ij) and rho_i(r_ij) */
-          PAIR_INT(rho_i, rho_i_strich, rho_h_tab, col1, inc, r2, is_short);
+        d.x = NB_ORT(q,j,X) - d1.x;
+        d.y = NB_ORT(q,j,Y) - d1.y;
+#ifndef TWOD
+        d.z = NB_ORT(q,j,Z) - d1.z;
 #endif
+        r2  = SPROD(d,d);
+        jt  = NB_SORTE(q,j);
+        col = it * ntypes + jt;
+        col2= jt * ntypes + it;
 
-          /* rho_strich_j(r_ij) */
-          if (col1==col2) {
-            rho_j_strich = rho_i_strich;
-#ifdef EEAM
-            rho_j = rho_i;
+        /* compute pair interactions */
+#if defined(PAIR) || defined(KEATING)
+        /* PAIR and KEATING are mutually exclusive */
+#if defined(PAIR)
+        if (r2 <= pair_pot.end[col])
+#elif defined(KEATING)
+        if (r2 < keat_r2_cut[it][jt]) 
 #endif
-          } else {
-#ifndef EEAM
-            DERIV_FUNC(rho_j_strich, rho_h_tab, col2, inc, r2, is_short);
+	{
+#if defined(PAIR)
+#ifdef LINPOT
+          PAIR_INT_LIN(pot, grad, pair_pot_lin, col, inc, r2, is_short);
 #else
-            PAIR_INT(rho_j, rho_j_strich, rho_h_tab, col2, inc, r2, is_short);
+	  PAIR_INT(pot, grad, pair_pot, col, inc, r2, is_short);
 #endif
-	  }
-
-          /* put together (dF_i and dF_j are by 0.5 too big) */
-          grad = 0.5 * (EAM_DF(p,i)*rho_j_strich + EAM_DF(q,j)*rho_i_strich);
-#ifdef EEAM
-          /* 0.5 times 2 from derivative simplified to 1 */
-          grad += (EAM_DM(p,i) * rho_j * rho_j_strich +
-                   EAM_DM(q,j) * rho_i * rho_i_strich);
+#elif defined(KEATING)
+          PAIR_INT_KEATING(pot, grad, it, jt, r2);
 #endif
-
-          /* store force in temporary variable */
+          tot_pot_energy += pot;
           force.x = d.x * grad;
           force.y = d.y * grad;
+#ifndef TWOD
           force.z = d.z * grad;
-          have_force=1;
-        }
-
-#ifdef ADP
-        /* forces due to dipole distortion */
-        if (r2 < adp_upot.end[col1]) {
-          vektor mu;
-          real pot, grad, tmp;
-          PAIR_INT(pot, grad, adp_upot, col1, inc, r2, is_short);
-          mu.x = mu1.x - ADP_MU(q,j,X);
-          mu.y = mu1.y - ADP_MU(q,j,Y);
-          mu.z = mu1.z - ADP_MU(q,j,Z);
-          tmp  = SPROD(mu,d) * grad;
-          force.x += mu.x * pot + tmp * d.x;
-          force.y += mu.y * pot + tmp * d.y;
-          force.z += mu.z * pot + tmp * d.z;
-          have_force=1;
-        }
-        /* forces due to quadrupole distortion */
-        if (r2 < adp_wpot.end[col1]) {
-          sym_tensor la;
-          vektor v;
-          real pot, grad, nu, f1, f2;
-          PAIR_INT(pot, grad, adp_wpot, col1, inc, r2, is_short);
-          la.xx = la1.xx + ADP_LAMBDA(q,j,xx);
-          la.yy = la1.yy + ADP_LAMBDA(q,j,yy);
-          la.zz = la1.zz + ADP_LAMBDA(q,j,zz);
-          la.yz = la1.yz + ADP_LAMBDA(q,j,yz);
-          la.zx = la1.zx + ADP_LAMBDA(q,j,zx);
-          la.xy = la1.xy + ADP_LAMBDA(q,j,xy);
-          v.x = la.xx * d.x + la.xy * d.y + la.zx * d.z;
-          v.y = la.xy * d.x + la.yy * d.y + la.yz * d.z;
-          v.z = la.zx * d.x + la.yz * d.y + la.zz * d.z;
-          nu  = (la.xx + la.yy + la.zz) / 3.0;
-          f1  = 2.0 * pot;
-          f2  = (SPROD(v,d) - nu * r2) * grad - nu * f1; 
-          force.x += f1 * v.x + f2 * d.x;
-          force.y += f1 * v.y + f2 * d.y;
-          force.z += f1 * v.z + f2 * d.z;
-          have_force=1;
-        }
 #endif
-
-#ifdef FLAGEDATOMS
-	  if(VSORTE(q,j) == flagedatomstype && VSORTE(p,i) == flagedatomstype)
-	    {
-	      //	      printf("Atom nr %d of type %d interacting with %d: Embed forces : %e %e %e\n",
-	      //     NUMMER(p,i),VSORTE(p,i),NUMMER(q,j),force.x,force.y,force.z);
+          NB_KRAFT(q,j,X) -= force.x;
+          NB_KRAFT(q,j,Y) -= force.y;
+#ifndef TWOD
+          NB_KRAFT(q,j,Z) -= force.z;
+#endif
+          ff.x         += force.x;
+          ff.y         += force.y;
+#ifndef TWOD
+          ff.z         += force.z;
+#endif
+
+#ifdef FLAGEDATOMS
+	  if(VSORTE(q,j) == flagedatomstype && VSORTE(p,i) == flagedatomstype)
+	    {
+	      //	      printf("Atom nr %d of type %d interacting with %d: Pair forces : %e %e %e\n",
 	      printf("%d %d %d %e %e %e %e %e %e\n",
 		     NUMMER(p,i),VSORTE(p,i),NUMMER(q,j),d.x, d.y, d.z, force.x,force.y,force.z);
 	      fflush(stdout);
 	    }
 #endif
-        /* accumulate forces */
-        if (have_force) {
-          KRAFT(q,j,X) -= force.x;
-          KRAFT(q,j,Y) -= force.y;
-          KRAFT(q,j,Z) -= force.z;
-          ff.x         += force.x;
-          ff.y         += force.y;
-          ff.z         += force.z;
+
+#ifndef MONOLJ
+          pot *= 0.5;   /* avoid double counting */
+#ifdef NNBR
+          if (r2 < nb_r2_cut[col ]) nb++;
+          if (r2 < nb_r2_cut[col2]) NB_NBANZ(q,j)++;
+#endif
+#ifdef ORDPAR
+          if (r2 < op_r2_cut[col ]) ee          += op_weight[col ] * pot;
+          if (r2 < op_r2_cut[col2]) NB_POTENG(q,j) += op_weight[col2] * pot;
+#else
+          ee          += pot;
+          NB_POTENG(q,j) += pot;
+#endif
+#endif
 #ifdef P_AXIAL
-          vir_xx       -= d.x * force.x;
-          vir_yy       -= d.y * force.y;
-          vir_zz       -= d.z * force.z;
+          vir_xx -= d.x * force.x;
+          vir_yy -= d.y * force.y;
+#ifndef TWOD
+          vir_zz -= d.z * force.z;
+#endif
 #else
-          virial       -= SPROD(d,force);
+          virial -= r2  * grad;
 #endif
 
 #ifdef STRESS_TENS
@@ -1285,692 +1743,1872 @@ void calc_forces(int steps)
             /* avoid double counting of the virial */
             force.x *= 0.5;
             force.y *= 0.5;
+#ifndef TWOD
             force.z *= 0.5;
- 
-            pp.xx -= d.x * force.x;
-            pp.yy -= d.y * force.y;
-            pp.zz -= d.z * force.z;
-            pp.yz -= d.y * force.z;
-            pp.zx -= d.z * force.x;
-            pp.xy -= d.x * force.y;
+#endif
+            pp.xx             -= d.x * force.x;
+            NB_PRESSTENS(q,j,xx) -= d.x * force.x;
+            pp.yy             -= d.y * force.y;
+            NB_PRESSTENS(q,j,yy) -= d.y * force.y;
+            pp.xy             -= d.x * force.y;
+            NB_PRESSTENS(q,j,xy) -= d.x * force.y;
+#ifndef TWOD
+            pp.zz             -= d.z * force.z;
+            NB_PRESSTENS(q,j,zz) -= d.z * force.z;
+            pp.yz             -= d.y * force.z;
+            NB_PRESSTENS(q,j,yz) -= d.y * force.z;
+            pp.zx             -= d.z * force.x;
+            NB_PRESSTENS(q,j,zx) -= d.z * force.x;
+#endif
+	  }
+#endif
+        }
 
-            PRESSTENS(q,j,xx) -= d.x * force.x;
-            PRESSTENS(q,j,yy) -= d.y * force.y;
-            PRESSTENS(q,j,zz) -= d.z * force.z;
-            PRESSTENS(q,j,yz) -= d.y * force.z;
-            PRESSTENS(q,j,zx) -= d.z * force.x;
-            PRESSTENS(q,j,xy) -= d.x * force.y;
-          }
+#endif /* PAIR || KEATING */
+
+#ifdef EAM2
+        /* compute host electron density */
+        if (r2 < rho_h_tab.end[col])  {
+          VAL_FUNC(rho_h, rho_h_tab, col, inc, r2, is_short);
+          eam_r += rho_h;
+#ifdef EEAM
+          eam_p += rho_h*rho_h; 
 #endif
         }
-      }
-      KRAFT(p,i,X) += ff.x;
-      KRAFT(p,i,Y) += ff.y;
-      KRAFT(p,i,Z) += ff.z;
-#ifdef STRESS_TENS
-      if (do_press_calc) {
-        PRESSTENS(p,i,xx) += pp.xx;
-        PRESSTENS(p,i,yy) += pp.yy;
-        PRESSTENS(p,i,zz) += pp.zz;
-        PRESSTENS(p,i,yz) += pp.yz;
-        PRESSTENS(p,i,zx) += pp.zx;
-        PRESSTENS(p,i,xy) += pp.xy;
-      }
+        if (it==jt) {
+          if (r2 < rho_h_tab.end[col]) {
+            NB_EAM_RHO(q,j) += rho_h;
+#ifdef EEAM
+            NB_EAM_P(q,j) += rho_h*rho_h;
+#endif
+          } 
+        } else {
+          if (r2 < rho_h_tab.end[col2]) {
+            VAL_FUNC(rho_h, rho_h_tab, col2, inc, r2, is_short);
+            NB_EAM_RHO(q,j) += rho_h; 
+#ifdef EEAM
+            NB_EAM_P(q,j) += rho_h*rho_h; 
+#endif
+          }
+        }
 #endif
-      n++;
-    }
-  }
-  if (is_short) fprintf(stderr, "\n Short distance, EAM, step %d!\n",steps);
 
-#endif /* EAM2 */
-#ifndef KERMODE
+#ifdef ADP
+        /* compute adp_mu */
+        if (r2 < adp_upot.end[col])  {
+          VAL_FUNC(pot, adp_upot, col, inc, r2, is_short);
+          tmp = pot * d.x;  mu.x += tmp;  NB_ADP_MU(q,j,X) -= tmp;
+          tmp = pot * d.y;  mu.y += tmp;  NB_ADP_MU(q,j,Y) -= tmp;
+          tmp = pot * d.z;  mu.z += tmp;  NB_ADP_MU(q,j,Z) -= tmp;
+        }
+        /* compute adp_lambda */
+        if (r2 < adp_wpot.end[col])  {
+          VAL_FUNC(pot, adp_wpot, col, inc, r2, is_short);
+          tmp = pot * d.x * d.x;  la.xx += tmp;  NB_ADP_LAMBDA(q,j,xx) += tmp;
+          tmp = pot * d.y * d.y;  la.yy += tmp;  NB_ADP_LAMBDA(q,j,yy) += tmp;
+          tmp = pot * d.z * d.z;  la.zz += tmp;  NB_ADP_LAMBDA(q,j,zz) += tmp;
+          tmp = pot * d.y * d.z;  la.yz += tmp;  NB_ADP_LAMBDA(q,j,yz) += tmp;
+          tmp = pot * d.z * d.x;  la.zx += tmp;  NB_ADP_LAMBDA(q,j,zx) += tmp;
+          tmp = pot * d.x * d.y;  la.xy += tmp;  NB_ADP_LAMBDA(q,j,xy) += tmp;
+        }
+#endif /* ADP */
+
 #ifdef COULOMB
-  /* coulomb self energy part */
-  for (k=0; k<ncells; k++) {
-    cell *p = CELLPTR(k);
-    for (i=0; i<p->n; i++) {
-      real chg = CHARGE(p,i);
-#ifdef SM
-      int  t   = SORTE(p,i);
-      real pot = (0.5*(2*ew_vorf * coul_eng - sm_J_0[t]) * chg - sm_chi_0[t]) * chg;
+#ifdef VARCHG
+        chg = CHARGE(p,i) * CHARGE(q,j);
 #else
-      real pot = ew_vorf * SQR(chg) * coul_eng;
+	chg = charge[it]  * charge[jt];
 #endif
-#ifdef SM
-      tot_sm_es_energy -= pot;
+#ifndef KERMODE
+	if (r2 < ew_r2_cut) {
 #endif
-      tot_pot_energy -= pot;
-      POTENG(p,i)    -= pot;
-    }
-  }
+#ifdef KERMODE
+        if (r2 < ke_tot_r2cut) {
 #endif
+	  if (SQR(chg)>0.) {
+#ifdef SM
+            real cr_pot=0.0, cr_gr=0.0, na_pot_p=0.0, na_pot_q=0.0, na_gr_p=0.0, na_gr_q=0.0, sm_es_energy=0.0;
+            real z_sm_p = sm_Z[it] * CHARGE(q,j) * coul_eng;
+            real z_sm_q = sm_Z[jt] * CHARGE(p,i) * coul_eng;
 #endif
+	    /* Constant electric field from charges */
+	    /* Coulomb potential is in column 0 */
+            int incr = coul_table.ncols;
+	    PAIR_INT(phi, grphi, coul_table, 0, incr, r2, is_short);
 
-#if defined(DIPOLE) || defined(KERMODE)
-
-  /* collect constant electric fields and dipole moments */
-  send_forces(add_dipole,pack_dipole,unpack_add_dipole);
- 
- /*********************************  Dipole convergence starts here **************************** */ 
-  
-  if (dp_p_calc) {
-    while (dp_converged==0) {
-      dp_sum_old=dp_sum;
-      dp_sum=0.0;
-      dp_sum_global=0.0;      
-      n=0;
-      /* Set field, dipoles */
-      for (k=0; k<ncells; k++) { 
-	cell *p = CELLPTR(k);
-#ifdef ia64 
-#pragma ivdep,swp
+	    /* Coulomb Energy */
+	    pot     = chg * phi;
+#ifdef SM
+	    sm_es_energy  = chg * phi;
 #endif
-	for (i=0; i<p->n; i++) {
-	  int it;
-	  vektor Etot;
-	  it   = SORTE(p,i);
-	  if (SQR(dp_alpha[it])>0) {
-	    if (dp_it) {
-	      Etot.x = dp_mix * DP_E_IND(p,i,X)
-		+ (1.-dp_mix) * DP_E_OLD_1(p,i,X)
-		+ DP_E_STAT(p,i,X);
-	      Etot.y = dp_mix * DP_E_IND(p,i,Y)
-		+ (1.-dp_mix) * DP_E_OLD_1(p,i,Y)
-		+ DP_E_STAT(p,i,Y);
-	      Etot.z = dp_mix * DP_E_IND(p,i,Z)
-		+ (1.-dp_mix) * DP_E_OLD_1(p,i,Z)
-		+ DP_E_STAT(p,i,Z);
-	    } else {
-	      Etot.x = DP_E_IND(p,i,X) + DP_E_STAT(p,i,X);
-	      Etot.y = DP_E_IND(p,i,Y) + DP_E_STAT(p,i,Y);
-	      Etot.z = DP_E_IND(p,i,Z) + DP_E_STAT(p,i,Z);
-	    }
-	    DP_P_IND(p,i,X) = Etot.x * dp_alpha[it] + DP_P_STAT(p,i,X);
-	    DP_P_IND(p,i,Y) = Etot.y * dp_alpha[it] + DP_P_STAT(p,i,Y);
-	    DP_P_IND(p,i,Z) = Etot.z * dp_alpha[it] + DP_P_STAT(p,i,Z);
-	    
-/* #ifdef DEBUG */
-/* 	    printf("%d\t%d\t%g\t%g\t%g\t", NUMMER(p,i),it,ORT(p,i,X), */
-/* 		   ORT(p,i,Y),ORT(p,i,Z)); */
-/* 	    printf("%10.6f\t%10.6f\t%10.6f\t",Etot.x,Etot.y,Etot.z); */
-/* 	    printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t", */
-/* 		   DP_E_IND(p,i,X), DP_E_IND(p,i,Y),DP_E_IND(p,i,Z), */
-/* 		   DP_P_IND(p,i,X), DP_P_IND(p,i,Y),DP_P_IND(p,i,Z)); */
-/* 	    printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n", */
-/* 		   DP_P_STAT(p,i,X), DP_P_STAT(p,i,Y),DP_P_STAT(p,i,Z), */
-/* 		   DP_E_STAT(p,i,X), DP_E_STAT(p,i,Y),DP_E_STAT(p,i,Z)); */
-/* 	  printf("%d\t1\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n",NUMMER(p,i),Etot.x, */
-/* 		 DP_E_IND(p,i,X), DP_P_IND(p,i,X), DP_P_STAT(p,i,X)); */
-/* 	  printf("%d\t2\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n",NUMMER(p,i),Etot.y, */
-/* 		 DP_E_IND(p,i,Y), DP_P_IND(p,i,Y), DP_P_STAT(p,i,Y)); */
-/* 	  printf("%d\t3\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n",NUMMER(p,i),Etot.z, */
-/* 		 DP_E_IND(p,i,Z), DP_P_IND(p,i,Z), DP_P_STAT(p,i,Z)); */
-/* #endif */
-	    
-	    DP_E_OLD_1(p,i,X) = DP_E_IND(p,i,X);
-	    DP_E_OLD_1(p,i,Y) = DP_E_IND(p,i,Y);
-	    DP_E_OLD_1(p,i,Z) = DP_E_IND(p,i,Z);
-	    /* Self Term */
-/* 	    DP_E_IND(p,i,X) = DP_P_IND(p,i,X) * dp_self; */
-/* 	    DP_E_IND(p,i,Y) = DP_P_IND(p,i,Y) * dp_self; */
-/* 	    DP_E_IND(p,i,Z) = DP_P_IND(p,i,Z) * dp_self; */
-
-	  }
-          DP_E_IND(p,i,X) = 0.;
-          DP_E_IND(p,i,Y) = 0.;
-          DP_E_IND(p,i,Z) = 0.;
-	}
-      }
-      /* Distribute dipole moments */
-      send_cells(copy_pind,pack_pind,unpack_pind);
+	    grad    = chg * grphi;
+#ifdef SM
+            /* Coulomb repulsion potential */
+            if (r2 < cr_pot_tab.end[col]) {
+              PAIR_INT(cr_pot, cr_gr, cr_pot_tab, col, inc, r2, is_short);
+              pot  += cr_pot * (chg * coul_eng - z_sm_p - z_sm_q);
+	      sm_es_energy  += cr_pot * (chg * coul_eng - z_sm_p - z_sm_q);
+              grad += cr_gr * (chg * coul_eng - z_sm_p - z_sm_q);
+            }
+            /* nuclear attraction potential */
+            if (r2 < na_pot_tab.end[col]) {
+              PAIR_INT(na_pot_p, na_gr_p, na_pot_tab, col, inc, r2, is_short);
+            }
+            if (r2 < na_pot_tab.end[col2]) {
+              PAIR_INT(na_pot_q, na_gr_q, na_pot_tab, col2, inc, r2,is_short);
+            }
+              pot  += z_sm_q * na_pot_p + z_sm_p * na_pot_q;
+              sm_es_energy += z_sm_q * na_pot_p + z_sm_p * na_pot_q;
+              grad += z_sm_q * na_gr_p + z_sm_p * na_gr_q;
 
-      /* compute DIPOLE strength  */
-      for (k=0; k<ncells; k++) { 
-	cell *p = CELLPTR(k); 
-#ifdef ia64 
-#pragma ivdep,swp
 #endif
-	for (i=0; i<p->n; i++) {
-	  int    m, it, nb = 0;
-	  vektor d1, pi, Eind={0.0,0.0,0.0};
-	  it   = SORTE(p,i);
 
-	  if ( SQR(dp_alpha[it])>0) { 
+#ifdef SM
+	    tot_sm_es_energy += sm_es_energy;	
+#endif
 
-	    d1.x = ORT(p,i,X);
-	    d1.y = ORT(p,i,Y);
-	    d1.z = ORT(p,i,Z);
-
-      
-	    pi.x = DP_P_IND(p,i,X);
-	    pi.y = DP_P_IND(p,i,Y);
-	    pi.z = DP_P_IND(p,i,Z);
-      
+	    tot_pot_energy += pot;
+	    force.x = d.x * grad;
+	    force.y = d.y * grad;
+	    force.z = d.z * grad;
 
-	    /* loop over neighbors */
-#ifdef ia64
-#pragma ivdep,swp
+#ifdef EXTF
+	    real chg_single;
+#ifdef VARCHG
+	    chg_single = CHARGE(p,i);
+#else
+	    chg_single = charge[it];
+#endif
+	    force.x += chg_single * extf.x; 
+	    force.y += chg_single * extf.y; 
+	    force.z += chg_single * extf.z; 
+#endif /* EXTF */
+            
+	    KRAFT(q,j,X) -= force.x;
+	    KRAFT(q,j,Y) -= force.y;
+	    KRAFT(q,j,Z) -= force.z;
+	    ff.x         += force.x;
+	    ff.y         += force.y;
+	    ff.z         += force.z;
+            pot          *= 0.5;   /* avoid double counting */
+	    ee           += pot;
+	    POTENG(q,j)  += pot;
+#ifdef P_AXIAL
+	    vir_xx -= d.x * force.x;
+	    vir_yy -= d.y * force.y;
+	    vir_zz -= d.z * force.z;
+#else
+	    virial -= r2  * grad;
 #endif
-	    for (m=tl[n]; m<tl[n+1]; m++) {
-
-	      vektor d;
-	      real   r2;
-	      int    c, j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
-	      cell   *q;
-              real inv_r2,temp1; // Sudheer
-	  
-	      c = cl_num[ tb[m] ];
-	      j = tb[m] - cl_off[c];
-	      q = cell_array + c;
 
-	      d.x  = ORT(q,j,X) - d1.x;
-	      d.y  = ORT(q,j,Y) - d1.y;
-	      d.z  = ORT(q,j,Z) - d1.z;
-	      r2   = SPROD(d,d);
-	      jt   = SORTE(q,j);
-	      col1 = jt * ntypes + it;
-	      col2 = it * ntypes + jt;
-	  
-	      /* Dipole-Dipole */
-#ifndef KERMODE
-	      if ( (SQR(dp_alpha[jt])>0) && (r2 < ew_r2_cut )) {
+#ifdef STRESS_TENS
+	    if (do_press_calc) {
+	      /* avoid double counting of the virial */
+	      force.x *= 0.5;
+	      force.y *= 0.5;
+	      force.z *= 0.5;
+	      pp.xx             -= d.x * force.x;
+	      PRESSTENS(q,j,xx) -= d.x * force.x;
+	      pp.yy             -= d.y * force.y;
+	      PRESSTENS(q,j,yy) -= d.y * force.y;
+	      pp.xy             -= d.x * force.y;
+	      PRESSTENS(q,j,xy) -= d.x * force.y;
+	      pp.zz             -= d.z * force.z;
+	      PRESSTENS(q,j,zz) -= d.z * force.z;
+	      pp.yz             -= d.y * force.z;
+	      PRESSTENS(q,j,yz) -= d.y * force.z;
+	      pp.zx             -= d.z * force.x;
+	      PRESSTENS(q,j,zx) -= d.z * force.x;
+	    }
 #endif
-#ifdef KERMODE
-              if ( (SQR(dp_alpha[jt])>0) && (r2 < ke_tot_r2cut )) {
+
+#if defined(DIPOLE) || defined(KERMODE)
+#ifdef VARCHG
+	    /* Field for Dipole calculation */
+	    if (dp_p_calc) {
+#ifdef SM
+	      Estat.x += d.x * grphi * CHARGE(q,j)
+		+ d.x * coul_eng * (CHARGE(q,j)-sm_Z[jt])*na_gr_q;
+	      Estat.y += d.y * grphi * CHARGE(q,j)
+		+ d.y * coul_eng * (CHARGE(q,j)-sm_Z[jt])*na_gr_q;
+	      Estat.z += d.z * grphi * CHARGE(q,j)
+		+ d.z * coul_eng * (CHARGE(q,j)-sm_Z[jt])*na_gr_q;
+	      DP_E_STAT(q,j,X) -= d.x * grphi * CHARGE(p,i)
+		+ d.x * coul_eng * (CHARGE(p,i)-sm_Z[it])*na_gr_p;
+	      DP_E_STAT(q,j,Y) -= d.y * grphi * CHARGE(p,i)
+		+ d.y * coul_eng * (CHARGE(p,i)-sm_Z[it])*na_gr_p;
+	      DP_E_STAT(q,j,Z) -= d.z * grphi * CHARGE(p,i)
+		+ d.z * coul_eng * (CHARGE(p,i)-sm_Z[it])*na_gr_p;
+#else
+	      Estat.x += d.x * grphi * CHARGE(q,j);
+	      Estat.y += d.y * grphi * CHARGE(q,j);
+	      Estat.z += d.z * grphi * CHARGE(q,j);
+	      DP_E_STAT(q,j,X) -= d.x * grphi * CHARGE(p,i);
+	      DP_E_STAT(q,j,Y) -= d.y * grphi * CHARGE(p,i);
+	      DP_E_STAT(q,j,Z) -= d.z * grphi * CHARGE(p,i);
 #endif
-		real pot,tmp;
-		vektor pj;
-		pj.x=DP_P_IND(q,j,X);
-		pj.y=DP_P_IND(q,j,Y);
-		pj.z=DP_P_IND(q,j,Z);
+            }
+#else
+	    /* Field for Dipole calculation */
+	    if (dp_p_calc) {
 #ifndef KERMODE
-		/* smooth r^3 cutoff */
-		VAL_FUNC(pot,coul_table,1,2+ntypepairs,r2,is_short);
-		pot *= coul_eng;
+	      Estat.x += d.x * grphi * charge[jt];
+	      Estat.y += d.y * grphi * charge[jt];
+	      Estat.z += d.z * grphi * charge[jt];
+	      DP_E_STAT(q,j,X) -= d.x * grphi * charge[it];
+	      DP_E_STAT(q,j,Y) -= d.y * grphi * charge[it];
+	      DP_E_STAT(q,j,Z) -= d.z * grphi * charge[it];
 #endif
 #ifdef KERMODE
-                inv_r2 = 1.0/r2;
-                //{1/r*exp(-br)*fc}
-                VAL_FUNC(pot1,coul_table,0, 2+ntypepairs, r2, is_short);
-                pot1 *=inv_r2;
-                tmp=SPROD(pj,d);
-                temp1 = tmp*inv_r2;
-                //original eq is Eind.x += yuk_expfactorfc* ((3.0/r2)*tmp*d.x - pj.x)/rij3;
-                // i.e (3/r2*(pj.d)*d.x - pj.x)*exp(-br)*fc/r3
-                Eind.x += pot1* (3.0*temp1*d.x - pj.x);
-                Eind.y += pot1* (3.0*temp1*d.y - pj.y);
-                Eind.z += pot1* (3.0*temp1*d.z - pj.z);
-                tmp=SPROD(pi,d);
-                temp1 = tmp*inv_r2;
-                DP_E_IND(q,j,X) += pot1 * (3.0*temp1*d.x -pi.x);
-                DP_E_IND(q,j,Y) += pot1 * (3.0*temp1*d.y -pi.y);
-                DP_E_IND(q,j,Z) += pot1 * (3.0*temp1*d.z -pi.z);
+	      //{1/r*exp(-br)*fc}
+              VAL_FUNC(pot1,coul_table,0, 2+ntypepairs, r2, is_short);
+              pot1 /=r2;
+              Estat.x -= d.x * pot1 * charge[jt];
+              Estat.y -= d.y * pot1 * charge[jt];
+              Estat.z -= d.z * pot1 * charge[jt];
+              DP_E_STAT(q,j,X) += d.x * pot1 * charge[it];
+              DP_E_STAT(q,j,Y) += d.y * pot1 * charge[it];
+              DP_E_STAT(q,j,Z) += d.z * pot1 * charge[it];    
 #endif
-#ifndef KERMODE
-		tmp=SPROD(pj,d);
-		Eind.x += pot* ((3.0/r2)*tmp*d.x - pj.x);
-		Eind.y += pot* ((3.0/r2)*tmp*d.y - pj.y);
-		Eind.z += pot* ((3.0/r2)*tmp*d.z - pj.z);
-		tmp=SPROD(pi,d);
-		DP_E_IND(q,j,X) += pot * ((3.0/r2)*tmp*d.x -pi.x);
-		DP_E_IND(q,j,Y) += pot * ((3.0/r2)*tmp*d.y -pi.y);
-		DP_E_IND(q,j,Z) += pot * ((3.0/r2)*tmp*d.z -pi.z);
+#ifdef EXTF
+	      Estat.x += extf.x;
+	      Estat.y += extf.y;
+	      Estat.z += extf.z;
+	      DP_E_STAT(q,j,X) += extf.x;
+	      DP_E_STAT(q,j,Y) += extf.y;
+	      DP_E_STAT(q,j,Z) += extf.z;
 #endif
-	      }	  
 	    }
-	    DP_E_IND(p,i,X) += Eind.x;
-	    DP_E_IND(p,i,Y) += Eind.y;
-	    DP_E_IND(p,i,Z) += Eind.z;
-	  }
-	  n++;
-	}
-      }
-      /* Collect Electric fields */
-      send_forces(add_field,pack_field,unpack_add_field);
-      n=0;
-      for (k=0; k<ncells; k++) {
-	cell *p = CELLPTR(k);
-	for (i=0; i<p->n; i++) {
-	  int it;
-	  real dp_tmp;
-	  it   = SORTE(p,i);
-	  if(SQR(dp_alpha[it])>0){
-	    dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,X)-DP_E_IND(p,i,X)));
-	    dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,Y)-DP_E_IND(p,i,Y)));
-#ifndef KERMODE
-	    dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,Y)-DP_E_IND(p,i,Y)));
 #endif
-#ifdef KERMODE
-            dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,Z)-DP_E_IND(p,i,Z)));
 #endif
 	  }
-	}
-      }
-#ifdef MPI
-      MPI_Allreduce(&dp_sum, &dp_sum_global, 1, REAL, MPI_SUM, MPI_COMM_WORLD);
+#if defined(DIPOLE) || defined(KERMODE)
+#ifdef VARCHG
+	  /* calculate short-range dipoles field */
+	  /* short-range fn.: 3rd column ff. */
+	  if (dp_p_calc) {
+	    col=(it <= jt) ?
+	      it * ntypes + jt - ((it * (it + 1))/2)
+	      : jt * ntypes + it - ((jt * (jt + 1))/2);
+	    VAL_FUNC(pot,coul_table,2+col, 2+ntypepairs, r2, is_short);
+	    tmp = pot*CHARGE(q,j)*dp_alpha[it];
+	    if (SQR(tmp)>0) {
+	      pstat.x -= tmp * d.x;
+	      pstat.y -= tmp * d.y;
+	      pstat.z -= tmp * d.z;
+	    }
+	    tmp = pot*CHARGE(p,i)*dp_alpha[jt];
+	    if (SQR(tmp)>0){
+	      DP_P_STAT(q,j,X) += tmp * d.x;
+	      DP_P_STAT(q,j,Y) += tmp * d.y;
+	      DP_P_STAT(q,j,Z) += tmp * d.z;
+	    }
+	  }
 #else
-      dp_sum_global = dp_sum;
-#endif      
+	  /* calculate short-range dipoles field */
+	  /* short-range fn.: 3rd column ff. */
+	  if (dp_p_calc) {
+	    col=(it <= jt) ?
+	      it * ntypes + jt - ((it * (it + 1))/2)
+	      : jt * ntypes + it - ((jt * (jt + 1))/2);
 #ifndef KERMODE
-      dp_sum_global /= 3.0*natoms;
+	    VAL_FUNC(pot,coul_table,2+col, 2+ntypepairs, r2, is_short);
+	    tmp = pot*charge[jt]*dp_alpha[it];
 #endif
 #ifdef KERMODE
-      dp_sum_global /= natoms;
+            //{gij}
+            VAL_FUNC(pot2,coul_table,2+col, 2+ntypepairs, r2, is_short);
+            tmp = pot2*charge[jt]*dp_alpha[it]*pot1;     
 #endif
-      dp_sum_global=sqrt(dp_sum_global);
-#ifdef DEBUG
-      printf("#dipole deviation at step %d: %g\n",steps,dp_sum);
-#endif /*DEBUG */
+	    if (SQR(tmp)>0) {
+	      pstat.x -= tmp * d.x;
+	      pstat.y -= tmp * d.y;
+	      pstat.z -= tmp * d.z;
+#ifdef EXTF
+	      pstat.x += dp_alpha[it] * extf.x;
+	      pstat.y += dp_alpha[it] * extf.y;
+	      pstat.z += dp_alpha[it] * extf.z;
+#endif
+	    }
 #ifndef KERMODE
-      if ((dp_sum_global > max_diff) || ( dp_it>50)) { 
+	    tmp = pot*charge[it]*dp_alpha[jt];
 #endif
 #ifdef KERMODE
-      if ((dp_sum_global > max_diff) || ( dp_it>60)) { 
+            tmp = pot2*charge[it]*dp_alpha[jt]*pot1;      
+#endif
+	    if (SQR(tmp)>0){
+	      DP_P_STAT(q,j,X) += tmp * d.x;
+	      DP_P_STAT(q,j,Y) += tmp * d.y;
+	      DP_P_STAT(q,j,Z) += tmp * d.z;
+#ifdef EXTF
+	      DP_P_STAT(q,j,X) += dp_alpha[jt] * extf.x;
+	      DP_P_STAT(q,j,Y) += dp_alpha[jt] * extf.y;
+	      DP_P_STAT(q,j,Z) += dp_alpha[jt] * extf.z;
 #endif
-	fprintf(stderr, "\n Convergence Error, dipole, step %d: ", \
-			steps);
-	fprintf(stderr,"dp_sum_global = %g, dp_it=%d \n",dp_sum_global,dp_it);
-	n=0;
-	for (k=0; k<ncells; k++) {
-	  cell *p = CELLPTR(k);
-	  for (i=0; i<p->n; i++) {
-	    int it;
-	    real dp_tmp;
-	    it   = SORTE(p,i);
-	    if(SQR(dp_alpha[it])>0){
-	      DP_P_IND(p,i,X) = dp_alpha[it]*DP_E_STAT(p,i,X)+DP_P_STAT(p,i,X);
-	      DP_P_IND(p,i,Y) = dp_alpha[it]*DP_E_STAT(p,i,Y)+DP_P_STAT(p,i,Y);
-	      DP_P_IND(p,i,Z) = dp_alpha[it]*DP_E_STAT(p,i,Z)+DP_P_STAT(p,i,Z);
-	      DP_E_IND(p,i,X) = DP_E_STAT(p,i,X);
-	      DP_E_IND(p,i,Y) = DP_E_STAT(p,i,Y);
-	      DP_E_IND(p,i,Z) = DP_E_STAT(p,i,Z);
 	    }
-	    n++;
 	  }
+#endif
+#endif /* DIPOLE */
 	}
-	send_cells(copy_pind,pack_pind,unpack_pind);
-	dp_converged=1;
-	dp_sum_global=1.;
+#endif /* COULOMB */
+
+#ifdef COVALENT
+        /* make neighbor tables for covalent systems */
+        if (r2 < neightab_r2cut[col]) {
+
+          neightab *neigh;
+
+          /* update neighbor table of particle i */
+          neigh = NEIGH(p,i);
+          if (neigh->n_max <= neigh->n) {
+            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
+          }
+          neigh->typ[neigh->n] = jt;
+          neigh->cl [neigh->n] = q;
+          neigh->num[neigh->n] = j;
+          neigh->dist[3*neigh->n  ] = d.x;
+          neigh->dist[3*neigh->n+1] = d.y;
+          neigh->dist[3*neigh->n+2] = d.z;
+          neigh->n++;
+
+          /* update neighbor table of particle j */
+          neigh = NEIGH(q,j);
+          if (neigh->n_max <= neigh->n) {
+            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
+          }
+          neigh->typ[neigh->n] = it;
+          neigh->cl [neigh->n] = p;
+          neigh->num[neigh->n] = i;
+          neigh->dist[3*neigh->n  ] = -d.x;
+          neigh->dist[3*neigh->n+1] = -d.y;
+          neigh->dist[3*neigh->n+2] = -d.z;
+          neigh->n++;
+        }
+#endif  /* COVALENT */
+
       }
-/*       if  (fabs(dp_sum)-dp_sum_old) < dp_tol) /\* reasonable? *\/ */
-      //printf("Sudheer-> dp_sum = %.17lf, dp_it=%d \n",dp_sum,dp_it);
-      if (dp_sum_global < dp_tol)
-	dp_converged=1;
-      dp_it++;
+      KRAFT(p,i,X) += ff.x;
+      KRAFT(p,i,Y) += ff.y;
+      KRAFT(p,i,Z) += ff.z;
+#ifndef MONOLJ
+      POTENG(p,i)  += ee;
+#endif
+#ifdef EAM2
+      EAM_RHO(p,i) += eam_r;
+#ifdef EEAM
+      EAM_P(p,i)   += eam_p;
+#endif
+#endif
+#ifdef ADP
+      ADP_MU    (p,i,X)  += mu.x;
+      ADP_MU    (p,i,Y)  += mu.y;
+      ADP_MU    (p,i,Z)  += mu.z;
+      ADP_LAMBDA(p,i,xx) += la.xx;
+      ADP_LAMBDA(p,i,yy) += la.yy;
+      ADP_LAMBDA(p,i,zz) += la.zz;
+      ADP_LAMBDA(p,i,yz) += la.yz;
+      ADP_LAMBDA(p,i,zx) += la.zx;
+      ADP_LAMBDA(p,i,xy) += la.xy;
+#endif
+#if defined(DIPOLE) || defined(KERMODE)
+      if (dp_p_calc) {
+	DP_E_STAT(p,i,X)   += Estat.x;
+	DP_E_STAT(p,i,Y)   += Estat.y;
+	DP_E_STAT(p,i,Z)   += Estat.z;
+	DP_P_STAT(p,i,X)   += pstat.x;
+	DP_P_STAT(p,i,Y)   += pstat.y;
+	DP_P_STAT(p,i,Z)   += pstat.z;
+	/* Field Extrapolation */
+	if (dp_E_calc>2) {
+	  DP_E_IND(p,i,X) = 3.*DP_E_OLD_1(p,i,X) - 3.*DP_E_OLD_2(p,i,X) +
+	    DP_E_OLD_3(p,i,X);
+	  DP_E_IND(p,i,Y) = 3.*DP_E_OLD_1(p,i,Y) - 3.*DP_E_OLD_2(p,i,Y) +
+	    DP_E_OLD_3(p,i,Y);
+	  DP_E_IND(p,i,Z) = 3.*DP_E_OLD_1(p,i,Z) - 3.*DP_E_OLD_2(p,i,Z) +
+	    DP_E_OLD_3(p,i,Z);
+	  DP_E_OLD_3(p,i,X) = 0.;
+	  DP_E_OLD_3(p,i,Y) = 0.;
+	  DP_E_OLD_3(p,i,Z) = 0.;
+	} else {
+	  DP_E_IND(p,i,X) = DP_E_OLD_1(p,i,X);
+	  DP_E_IND(p,i,Y) = DP_E_OLD_1(p,i,Y);
+	  DP_E_IND(p,i,Z) = DP_E_OLD_1(p,i,Z);
+	}
+      }
+#endif
+#ifdef STRESS_TENS
+      if (do_press_calc) {
+        PRESSTENS(p,i,xx) += pp.xx;
+        PRESSTENS(p,i,yy) += pp.yy;
+        PRESSTENS(p,i,xy) += pp.xy;
+#ifndef TWOD
+        PRESSTENS(p,i,zz) += pp.zz;
+        PRESSTENS(p,i,yz) += pp.yz;
+        PRESSTENS(p,i,zx) += pp.zx;
+#endif
+      }
+#endif
+#ifdef NNBR
+      NBANZ(p,i)    += nb;
+#endif
+      n++;
+    }
+#if defined(DIPOLE) || defined(KERMODE)
+    if (dp_p_calc) {
+      dp_E_shift = p->dp_E_old_3;
+      p->dp_E_old_3 = p->dp_E_old_2;
+      p->dp_E_old_2 = p->dp_E_old_1;
+      p->dp_E_old_1 = dp_E_shift;
+    }
+#endif /* DIPOLE */
+  }
+  }
+#endif /* NBL_CLUSTER */
+  if (is_short) fprintf(stderr,"Short distance, pair, step %d!\n",steps);
 
-    } /* Dipole iteration */
+#ifdef NBL_PACKED
+  /* add contributions to neighbors */
+  nbl_add_packed(1);
+#endif
+
+#ifdef EWALD
+  if (steps==0) {
+    imd_stop_timer( &ewald_time );
+  }
+#endif
+
+#ifdef COVALENT
+
+  /* complete neighbor tables for covalent systems */
+  n = nbl_cstart[ncells];
+  for (k=ncells; k<ncells2; k++) {
+    cell *p = cell_array +cnbrs[k].np;
+    for (i=0; i<p->n; i++) {
+
+      vektor d1;
+      int    m, it;
+
+      d1.x = ORT(p,i,X);
+      d1.y = ORT(p,i,Y);
+      d1.z = ORT(p,i,Z);
+      it   = SORTE(p,i);
+
+      /* loop over neighbors */
+      for (m=tl[n]; m<tl[n+1]; m++) {
+
+        int    c, j, jt, col, inc = ntypes * ntypes; 
+        vektor d;
+        real   r2;
+        cell   *q;
+
+        c = NBL_NBR_CELL(k,tb[m]);
+        j = NBL_NBR_ATOM(k,tb[m]);
+        q = cell_array + c;
+
+        d.x = ORT(q,j,X) - d1.x;
+        d.y = ORT(q,j,Y) - d1.y;
+        d.z = ORT(q,j,Z) - d1.z;
+        r2  = SPROD(d,d);
+        jt  = SORTE(q,j);
+        col = it * ntypes + jt;
+
+        /* make neighbor tables */
+        if (r2 <= neightab_r2cut[col]) {
+
+          neightab *neigh;
+
+          /* update neighbor table of particle i */
+          neigh = NEIGH(p,i);
+          if (neigh->n_max <= neigh->n) {
+            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
+          }
+          neigh->typ[neigh->n] = jt;
+          neigh->cl [neigh->n] = q;
+          neigh->num[neigh->n] = j;
+          neigh->dist[3*neigh->n  ] = d.x;
+          neigh->dist[3*neigh->n+1] = d.y;
+          neigh->dist[3*neigh->n+2] = d.z;
+          neigh->n++;
+
+          /* update neighbor table of particle j */
+          /* we do not need a neighbor table in buffer cells
+          neigh = NEIGH(q,j);
+          if (neigh->n_max <= neigh->n) {
+            increase_neightab( neigh, neigh->n_max + NEIGH_LEN_INC );
+          }
+          neigh->typ[neigh->n] = it;
+          neigh->cl [neigh->n] = p;
+          neigh->num[neigh->n] = i;
+          neigh->dist[3*neigh->n  ] = -d.x;
+          neigh->dist[3*neigh->n+1] = -d.y;
+          neigh->dist[3*neigh->n+2] = -d.z;
+          neigh->n++;
+          */
+        }
+      }
+      n++;
+    }
+  }
+
+#ifndef CNA
+  /* second force loop for covalent systems */
+  for (k=0; k<ncells; ++k) {
+    do_forces2(cell_array + cnbrs[k].np,
+               &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
+                                         &vir_yz, &vir_zx, &vir_xy);
+  }
+#endif
+
+#endif /* COVALENT */
+
+#ifdef EAM2
+
+  /* collect host electron density */
+  send_forces(add_rho,pack_rho,unpack_add_rho);
+
+  /* compute embedding energy and its derivative */
+  do_embedding_energy_nbl();
+
+  /* distribute derivative of embedding energy */
+  send_cells(copy_dF,pack_dF,unpack_dF);
+#ifdef NBL_PACKED
+  nbl_pack_dF();
+#endif
+
+  /* EAM interactions - for all atoms, one group of cells after the other */
+  for (col=0; col<NBL_NCOLORS; col++) {
+#ifdef NBL_OMP
+#pragma omp parallel for schedule(runtime) private(k,i,n) \
+  reduction(+:virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy,is_short)
+#endif
+  for (b=nbl_color_start[col]; b<nbl_color_start[col+1]; b++) {
+    cell *p;
+    k = nbl_ccell[b];
+    n = nbl_cstart[k];
+    p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+
+#ifdef STRESS_TENS
+      sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
+#endif
+#ifdef ADP
+      sym_tensor la1;
+      vektor mu1;
+#endif
+      vektor d1, ff = {0.0,0.0,0.0};
+      int m, it;
+
+      d1.x = ORT(p,i,X);
+      d1.y = ORT(p,i,Y);
+      d1.z = ORT(p,i,Z);
+#ifdef ADP
+      mu1.x  = ADP_MU    (p,i,X);
+      mu1.y  = ADP_MU    (p,i,Y);
+      mu1.z  = ADP_MU    (p,i,Z);
+      la1.xx = ADP_LAMBDA(p,i,xx);
+      la1.yy = ADP_LAMBDA(p,i,yy);
+      la1.zz = ADP_LAMBDA(p,i,zz);
+      la1.yz = ADP_LAMBDA(p,i,yz);
+      la1.zx = ADP_LAMBDA(p,i,zx);
+      la1.xy = ADP_LAMBDA(p,i,xy);
+#endif
+      it   = SORTE(p,i);
+
+      /* loop over neighbors */
+#ifdef ia64
+#pragma ivdep,swp
+#endif
+      for (m=tl[n]; m<tl[n+1]; m++) {
+
+        vektor d, force = {0.0,0.0,0.0};
+        real   r2;
+        int    j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
+#ifndef NBL_PACKED
+        int    c;
+        cell   *q;
+#endif
+
+#ifdef NBL_PACKED
+        j = NBL_NBR(k,tb[m]);
+#else
+        c = NBL_NBR_CELL(k,tb[m]);
+        j = NBL_NBR_ATOM(k,tb[m]);
+        q = cell_array + c;
+#endif
+
+        d.x  = NB_ORT(q,j,X) - d1.x;
+        d.y  = NB_ORT(q,j,Y) - d1.y;
+        d.z  = NB_ORT(q,j,Z) - d1.z;
+        r2   = SPROD(d,d);
+        jt   = NB_SORTE(q,j);
+        col1 = jt * ntypes + it;
+        col2 = it * ntypes + jt;
+
+        if ((r2 < rho_h_tab.end[col1]) || (r2 < rho_h_tab.end[col2])) {
+
+          real pot, grad, rho_i_strich, rho_j_strich, rho_i, rho_j;
+
+          /* take care: particle i gets its rho from particle j.    */
+          /* This is tabulated in column it*ntypes+jt.              */
+          /* Here we need the giving part from column jt*ntypes+it. */
+
+          /* rho_strich_i(r_ij) */
+#ifndef EEAM
+          DERIV_FUNC(rho_i_strich, rho_h_tab, col1, inc, r2, is_short);
+#else
+          /* rho_strich_i(r_ij) and rho_i(r_ij) */
+          PAIR_INT(rho_i, rho_i_strich, rho_h_tab, col1, inc, r2, is_short);
+#endif
+
+          /* rho_strich_j(r_ij) */
+          if (col1==col2) {
+            rho_j_strich = rho_i_strich;
+#ifdef EEAM
+            rho_j = rho_i;
+#endif
+          } else {
+#ifndef EEAM
+            DERIV_FUNC(rho_j_strich, rho_h_tab, col2, inc, r2, is_short);
+#else
+            PAIR_INT(rho_j, rho_j_strich, rho_h_tab, col2, inc, r2, is_short);
+#endif
+	  }
+
+          /* put together (dF_i and dF_j are by 0.5 too big) */
+          grad = 0.5 * (EAM_DF(p,i)*rho_j_strich + NB_EAM_DF(q,j)*rho_i_strich);
+#ifdef EEAM
+          /* 0.5 times 2 from derivative simplified to 1 */
+          grad += (EAM_DM(p,i) * rho_j * rho_j_strich +
+                   NB_EAM_DM(q,j) * rho_i * rho_i_strich);
+#endif
+
+          /* store force in temporary variable */
+          force.x = d.x * grad;
+          force.y = d.y * grad;
+          force.z = d.z * grad;
+          have_force=1;
+        }
+
+#ifdef ADP
+        /* forces due to dipole distortion */
+        if (r2 < adp_upot.end[col1]) {
+          vektor mu;
+          real pot, grad, tmp;
+          PAIR_INT(pot, grad, adp_upot, col1, inc, r2, is_short);
+          mu.x = mu1.x - NB_ADP_MU(q,j,X);
+          mu.y = mu1.y - NB_ADP_MU(q,j,Y);
+          mu.z = mu1.z - NB_ADP_MU(q,j,Z);
+          tmp  = SPROD(mu,d) * grad;
+          force.x += mu.x * pot + tmp * d.x;
+          force.y += mu.y * pot + tmp * d.y;
+          force.z += mu.z * pot + tmp * d.z;
+          have_force=1;
+        }
+        /* forces due to quadrupole distortion */
+        if (r2 < adp_wpot.end[col1]) {
+          sym_tensor la;
+          vektor v;
+          real pot, grad, nu, f1, f2;
+          PAIR_INT(pot, grad, adp_wpot, col1, inc, r2, is_short);
+          la.xx = la1.xx + NB_ADP_LAMBDA(q,j,xx);
+          la.yy = la1.yy + NB_ADP_LAMBDA(q,j,yy);
+          la.zz = la1.zz + NB_ADP_LAMBDA(q,j,zz);
+          la.yz = la1.yz + NB_ADP_LAMBDA(q,j,yz);
+          la.zx = la1.zx + NB_ADP_LAMBDA(q,j,zx);
+          la.xy = la1.xy + NB_ADP_LAMBDA(q,j,xy);
+          v.x = la.xx * d.x + la.xy * d.y + la.zx * d.z;
+          v.y = la.xy * d.x + la.yy * d.y + la.yz * d.z;
+          v.z = la.zx * d.x + la.yz * d.y + la.zz * d.z;
+          nu  = (la.xx + la.yy + la.zz) / 3.0;
+          f1  = 2.0 * pot;
+          f2  = (SPROD(v,d) - nu * r2) * grad - nu * f1; 
+          force.x += f1 * v.x + f2 * d.x;
+          force.y += f1 * v.y + f2 * d.y;
+          force.z += f1 * v.z + f2 * d.z;
+          have_force=1;
+        }
+#endif
+
+#ifdef FLAGEDATOMS
+	  if(VSORTE(q,j) == flagedatomstype && VSORTE(p,i) == flagedatomstype)
+	    {
+	      //	      printf("Atom nr %d of type %d interacting with %d: Embed forces : %e %e %e\n",
+	      //     NUMMER(p,i),VSORTE(p,i),NUMMER(q,j),force.x,force.y,force.z);
+	      printf("%d %d %d %e %e %e %e %e %e\n",
+		     NUMMER(p,i),VSORTE(p,i),NUMMER(q,j),d.x, d.y, d.z, force.x,force.y,force.z);
+	      fflush(stdout);
+	    }
+#endif
+        /* accumulate forces */
+        if (have_force) {
+          NB_KRAFT(q,j,X) -= force.x;
+          NB_KRAFT(q,j,Y) -= force.y;
+          NB_KRAFT(q,j,Z) -= force.z;
+          ff.x         += force.x;
+          ff.y         += force.y;
+          ff.z         += force.z;
+#ifdef P_AXIAL
+          vir_xx       -= d.x * force.x;
+          vir_yy       -= d.y * force.y;
+          vir_zz       -= d.z * force.z;
+#else
+          virial       -= SPROD(d,force);
+#endif
+
+#ifdef STRESS_TENS
+          if (do_press_calc) {
+            /* avoid double counting of the virial */
+            force.x *= 0.5;
+            force.y *= 0.5;
+            force.z *= 0.5;
+ 
+            pp.xx -= d.x * force.x;
+            pp.yy -= d.y * force.y;
+            pp.zz -= d.z * force.z;
+            pp.yz -= d.y * force.z;
+            pp.zx -= d.z * force.x;
+            pp.xy -= d.x * force.y;
+
+            NB_PRESSTENS(q,j,xx) -= d.x * force.x;
+            NB_PRESSTENS(q,j,yy) -= d.y * force.y;
+            NB_PRESSTENS(q,j,zz) -= d.z * force.z;
+            NB_PRESSTENS(q,j,yz) -= d.y * force.z;
+            NB_PRESSTENS(q,j,zx) -= d.z * force.x;
+            NB_PRESSTENS(q,j,xy) -= d.x * force.y;
+          }
+#endif
+        }
+      }
+      KRAFT(p,i,X) += ff.x;
+      KRAFT(p,i,Y) += ff.y;
+      KRAFT(p,i,Z) += ff.z;
+#ifdef STRESS_TENS
+      if (do_press_calc) {
+        PRESSTENS(p,i,xx) += pp.xx;
+        PRESSTENS(p,i,yy) += pp.yy;
+        PRESSTENS(p,i,zz) += pp.zz;
+        PRESSTENS(p,i,yz) += pp.yz;
+        PRESSTENS(p,i,zx) += pp.zx;
+        PRESSTENS(p,i,xy) += pp.xy;
+      }
+#endif
+      n++;
+    }
+  }
+  }
+  if (is_short) fprintf(stderr, "\n Short distance, EAM, step %d!\n",steps);
+
+#ifdef NBL_PACKED
+  /* add forces on neighbors */
+  nbl_add_packed(0);
+#endif
+
+#endif /* EAM2 */
+#ifndef KERMODE
+#ifdef COULOMB
+  /* coulomb self energy part */
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      real chg = CHARGE(p,i);
+#ifdef SM
+      int  t   = SORTE(p,i);
+      real pot = (0.5*(2*ew_vorf * coul_eng - sm_J_0[t]) * chg - sm_chi_0[t]) * chg;
+#else
+      real pot = ew_vorf * SQR(chg) * coul_eng;
+#endif
+#ifdef SM
+      tot_sm_es_energy -= pot;
+#endif
+      tot_pot_energy -= pot;
+      POTENG(p,i)    -= pot;
+    }
+  }
+#endif
+#endif
+
+#if defined(DIPOLE) || defined(KERMODE)
+
+  /* collect constant electric fields and dipole moments */
+  send_forces(add_dipole,pack_dipole,unpack_add_dipole);
+ 
+ /*********************************  Dipole convergence starts here **************************** */ 
+  
+  if (dp_p_calc) {
+    while (dp_converged==0) {
+      dp_sum_old=dp_sum;
+      dp_sum=0.0;
+      dp_sum_global=0.0;      
+      n=0;
+      /* Set field, dipoles */
+      for (k=0; k<ncells; k++) { 
+	cell *p = CELLPTR(k);
+#ifdef ia64 
+#pragma ivdep,swp
+#endif
+	for (i=0; i<p->n; i++) {
+	  int it;
+	  vektor Etot;
+	  it   = SORTE(p,i);
+	  if (SQR(dp_alpha[it])>0) {
+	    if (dp_it) {
+	      Etot.x = dp_mix * DP_E_IND(p,i,X)
+		+ (1.-dp_mix) * DP_E_OLD_1(p,i,X)
+		+ DP_E_STAT(p,i,X);
+	      Etot.y = dp_mix * DP_E_IND(p,i,Y)
+		+ (1.-dp_mix) * DP_E_OLD_1(p,i,Y)
+		+ DP_E_STAT(p,i,Y);
+	      Etot.z = dp_mix * DP_E_IND(p,i,Z)
+		+ (1.-dp_mix) * DP_E_OLD_1(p,i,Z)
+		+ DP_E_STAT(p,i,Z);
+	    } else {
+	      Etot.x = DP_E_IND(p,i,X) + DP_E_STAT(p,i,X);
+	      Etot.y = DP_E_IND(p,i,Y) + DP_E_STAT(p,i,Y);
+	      Etot.z = DP_E_IND(p,i,Z) + DP_E_STAT(p,i,Z);
+	    }
+	    DP_P_IND(p,i,X) = Etot.x * dp_alpha[it] + DP_P_STAT(p,i,X);
+	    DP_P_IND(p,i,Y) = Etot.y * dp_alpha[it] + DP_P_STAT(p,i,Y);
+	    DP_P_IND(p,i,Z) = Etot.z * dp_alpha[it] + DP_P_STAT(p,i,Z);
+	    
+/* #ifdef DEBUG */
+/* 	    printf("%d\t%d\t%g\t%g\t%g\t", NUMMER(p,i),it,ORT(p,i,X), */
+/* 		   ORT(p,i,Y),ORT(p,i,Z)); */
+/* 	    printf("%10.6f\t%10.6f\t%10.6f\t",Etot.x,Etot.y,Etot.z); */
+/* 	    printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t", */
+/* 		   DP_E_IND(p,i,X), DP_E_IND(p,i,Y),DP_E_IND(p,i,Z), */
+/* 		   DP_P_IND(p,i,X), DP_P_IND(p,i,Y),DP_P_IND(p,i,Z)); */
+/* 	    printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n", */
+/* 		   DP_P_STAT(p,i,X), DP_P_STAT(p,i,Y),DP_P_STAT(p,i,Z), */
+/* 		   DP_E_STAT(p,i,X), DP_E_STAT(p,i,Y),DP_E_STAT(p,i,Z)); */
+/* 	  printf("%d\t1\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n",NUMMER(p,i),Etot.x, */
+/* 		 DP_E_IND(p,i,X), DP_P_IND(p,i,X), DP_P_STAT(p,i,X)); */
+/* 	  printf("%d\t2\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n",NUMMER(p,i),Etot.y, */
+/* 		 DP_E_IND(p,i,Y), DP_P_IND(p,i,Y), DP_P_STAT(p,i,Y)); */
+/* 	  printf("%d\t3\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n",NUMMER(p,i),Etot.z, */
+/* 		 DP_E_IND(p,i,Z), DP_P_IND(p,i,Z), DP_P_STAT(p,i,Z)); */
+/* #endif */
+	    
+	    DP_E_OLD_1(p,i,X) = DP_E_IND(p,i,X);
+	    DP_E_OLD_1(p,i,Y) = DP_E_IND(p,i,Y);
+	    DP_E_OLD_1(p,i,Z) = DP_E_IND(p,i,Z);
+	    /* Self Term */
+/* 	    DP_E_IND(p,i,X) = DP_P_IND(p,i,X) * dp_self; */
+/* 	    DP_E_IND(p,i,Y) = DP_P_IND(p,i,Y) * dp_self; */
+/* 	    DP_E_IND(p,i,Z) = DP_P_IND(p,i,Z) * dp_self; */
+
+	  }
+          DP_E_IND(p,i,X) = 0.;
+          DP_E_IND(p,i,Y) = 0.;
+          DP_E_IND(p,i,Z) = 0.;
+	}
+      }
+      /* Distribute dipole moments */
+      send_cells(copy_pind,pack_pind,unpack_pind);
+
+      /* compute DIPOLE strength  */
+      for (k=0; k<ncells; k++) { 
+	cell *p = CELLPTR(k); 
+#ifdef ia64 
+#pragma ivdep,swp
+#endif
+	for (i=0; i<p->n; i++) {
+	  int    m, it, nb = 0;
+	  vektor d1, pi, Eind={0.0,0.0,0.0};
+	  it   = SORTE(p,i);
+
+	  if ( SQR(dp_alpha[it])>0) { 
+
+	    d1.x = ORT(p,i,X);
+	    d1.y = ORT(p,i,Y);
+	    d1.z = ORT(p,i,Z);
+
+      
+	    pi.x = DP_P_IND(p,i,X);
+	    pi.y = DP_P_IND(p,i,Y);
+	    pi.z = DP_P_IND(p,i,Z);
+      
+
+	    /* loop over neighbors */
+#ifdef ia64
+#pragma ivdep,swp
+#endif
+	    for (m=tl[n]; m<tl[n+1]; m++) {
+
+	      vektor d;
+	      real   r2;
+	      int    c, j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
+	      cell   *q;
+              real inv_r2,temp1; // Sudheer
+	  
+	      c = NBL_NBR_CELL(k,tb[m]);
+	      j = NBL_NBR_ATOM(k,tb[m]);
+	      q = cell_array + c;
+
+	      d.x  = ORT(q,j,X) - d1.x;
+	      d.y  = ORT(q,j,Y) - d1.y;
+	      d.z  = ORT(q,j,Z) - d1.z;
+	      r2   = SPROD(d,d);
+	      jt   = SORTE(q,j);
+	      col1 = jt * ntypes + it;
+	      col2 = it * ntypes + jt;
+	  
+	      /* Dipole-Dipole */
+#ifndef KERMODE
+	      if ( (SQR(dp_alpha[jt])>0) && (r2 < ew_r2_cut )) {
+#endif
+#ifdef KERMODE
+              if ( (SQR(dp_alpha[jt])>0) && (r2 < ke_tot_r2cut )) {
+#endif
+		real pot,tmp;
+		vektor pj;
+		pj.x=DP_P_IND(q,j,X);
+		pj.y=DP_P_IND(q,j,Y);
+		pj.z=DP_P_IND(q,j,Z);
+#ifndef KERMODE
+		/* smooth r^3 cutoff */
+		VAL_FUNC(pot,coul_table,1,2+ntypepairs,r2,is_short);
+		pot *= coul_eng;
+#endif
+#ifdef KERMODE
+                inv_r2 = 1.0/r2;
+                //{1/r*exp(-br)*fc}
+                VAL_FUNC(pot1,coul_table,0, 2+ntypepairs, r2, is_short);
+                pot1 *=inv_r2;
+                tmp=SPROD(pj,d);
+                temp1 = tmp*inv_r2;
+                //original eq is Eind.x += yuk_expfactorfc* ((3.0/r2)*tmp*d.x - pj.x)/rij3;
+                // i.e (3/r2*(pj.d)*d.x - pj.x)*exp(-br)*fc/r3
+                Eind.x += pot1* (3.0*temp1*d.x - pj.x);
+                Eind.y += pot1* (3.0*temp1*d.y - pj.y);
+                Eind.z += pot1* (3.0*temp1*d.z - pj.z);
+                tmp=SPROD(pi,d);
+                temp1 = tmp*inv_r2;
+                DP_E_IND(q,j,X) += pot1 * (3.0*temp1*d.x -pi.x);
+                DP_E_IND(q,j,Y) += pot1 * (3.0*temp1*d.y -pi.y);
+                DP_E_IND(q,j,Z) += pot1 * (3.0*temp1*d.z -pi.z);
+#endif
+#ifndef KERMODE
+		tmp=SPROD(pj,d);
+		Eind.x += pot* ((3.0/r2)*tmp*d.x - pj.x);
+		Eind.y += pot* ((3.0/r2)*tmp*d.y - pj.y);
+		Eind.z += pot* ((3.0/r2)*tmp*d.z - pj.z);
+		tmp=SPROD(pi,d);
+		DP_E_IND(q,j,X) += pot * ((3.0/r2)*tmp*d.x -pi.x);
+		DP_E_IND(q,j,Y) += pot * ((3.0/r2)*tmp*d.y -pi.y);
+		DP_E_IND(q,j,Z) += pot * ((3.0/r2)*tmp*d.z -pi.z);
+#endif
+	      }	  
+	    }
+	    DP_E_IND(p,i,X) += Eind.x;
+	    DP_E_IND(p,i,Y) += Eind.y;
+	    DP_E_IND(p,i,Z) += Eind.z;
+	  }
+	  n++;
+	}
+      }
+      /* Collect Electric fields */
+      send_forces(add_field,pack_field,unpack_add_field);
+      n=0;
+      for (k=0; k<ncells; k++) {
+	cell *p = CELLPTR(k);
+	for (i=0; i<p->n; i++) {
+	  int it;
+	  real dp_tmp;
+	  it   = SORTE(p,i);
+	  if(SQR(dp_alpha[it])>0){
+	    dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,X)-DP_E_IND(p,i,X)));
+	    dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,Y)-DP_E_IND(p,i,Y)));
+#ifndef KERMODE
+	    dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,Y)-DP_E_IND(p,i,Y)));
+#endif
+#ifdef KERMODE
+            dp_sum += SQR(dp_alpha[it]*(DP_E_OLD_1(p,i,Z)-DP_E_IND(p,i,Z)));
+#endif
+	  }
+	}
+      }
+#ifdef MPI
+      MPI_Allreduce(&dp_sum, &dp_sum_global, 1, REAL, MPI_SUM, MPI_COMM_WORLD);
+#else
+      dp_sum_global = dp_sum;
+#endif      
+#ifndef KERMODE
+      dp_sum_global /= 3.0*natoms;
+#endif
+#ifdef KERMODE
+      dp_sum_global /= natoms;
+#endif
+      dp_sum_global=sqrt(dp_sum_global);
+#ifdef DEBUG
+      printf("#dipole deviation at step %d: %g\n",steps,dp_sum);
+#endif /*DEBUG */
+#ifndef KERMODE
+      if ((dp_sum_global > max_diff) || ( dp_it>50)) { 
+#endif
+#ifdef KERMODE
+      if ((dp_sum_global > max_diff) || ( dp_it>60)) { 
+#endif
+	fprintf(stderr, "\n Convergence Error, dipole, step %d: ", \
+			steps);
+	fprintf(stderr,"dp_sum_global = %g, dp_it=%d \n",dp_sum_global,dp_it);
+	n=0;
+	for (k=0; k<ncells; k++) {
+	  cell *p = CELLPTR(k);
+	  for (i=0; i<p->n; i++) {
+	    int it;
+	    real dp_tmp;
+	    it   = SORTE(p,i);
+	    if(SQR(dp_alpha[it])>0){
+	      DP_P_IND(p,i,X) = dp_alpha[it]*DP_E_STAT(p,i,X)+DP_P_STAT(p,i,X);
+	      DP_P_IND(p,i,Y) = dp_alpha[it]*DP_E_STAT(p,i,Y)+DP_P_STAT(p,i,Y);
+	      DP_P_IND(p,i,Z) = dp_alpha[it]*DP_E_STAT(p,i,Z)+DP_P_STAT(p,i,Z);
+	      DP_E_IND(p,i,X) = DP_E_STAT(p,i,X);
+	      DP_E_IND(p,i,Y) = DP_E_STAT(p,i,Y);
+	      DP_E_IND(p,i,Z) = DP_E_STAT(p,i,Z);
+	    }
+	    n++;
+	  }
+	}
+	send_cells(copy_pind,pack_pind,unpack_pind);
+	dp_converged=1;
+	dp_sum_global=1.;
+      }
+/*       if  (fabs(dp_sum)-dp_sum_old) < dp_tol) /\* reasonable? *\/ */
+      //printf("Sudheer-> dp_sum = %.17lf, dp_it=%d \n",dp_sum,dp_it);
+      if (dp_sum_global < dp_tol)
+	dp_converged=1;
+      dp_it++;
+
+    } /* Dipole iteration */
+  }
+  /* DIPOLE interactions - for all atoms */
+  
+  /********************************  Dipole convergence ends here **************************** */ 
+
+#ifdef DEBUG
+/* Don't use this unless you are prepared for massive output */
+//  printf("No,type,pos,force,p_ind,E_ind,p_stat,E_stat\n");
+#endif
+
+  n=0;
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+
+#ifdef STRESS_TENS
+      sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
+#endif
+      vektor d1, pi, ff = {0.0,0.0,0.0};
+      real   ee = 0.0;
+      real   dp_energy = 0.0;
+      int    m, it, nb = 0;
+       
+      d1.x = ORT(p,i,X);
+      d1.y = ORT(p,i,Y);
+      d1.z = ORT(p,i,Z);
+      it   = SORTE(p,i);
+
+      
+      pi.x = DP_P_IND(p,i,X);
+      pi.y = DP_P_IND(p,i,Y);
+      pi.z = DP_P_IND(p,i,Z);
+
+#ifdef VARCHG
+real pconst_i=SQR(CHARGE(p,i))+SQR(dp_alpha[it]);
+#else
+real pconst_i=SQR(charge[it])+SQR(dp_alpha[it]);
+#endif
+
+      if (pconst_i>0) { 
+	/* loop over neighbors */
+#ifdef ia64
+#pragma ivdep,swp
+#endif
+	for (m=tl[n]; m<tl[n+1]; m++) {
+
+	  vektor d, force = {0.0,0.0,0.0};
+	  real   r2;
+	  int    c, j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
+	  cell   *q;
+	  
+	  c = NBL_NBR_CELL(k,tb[m]);
+	  j = NBL_NBR_ATOM(k,tb[m]);
+	  q = cell_array + c;
+
+	  d.x  = ORT(q,j,X) - d1.x;
+	  d.y  = ORT(q,j,Y) - d1.y;
+	  d.z  = ORT(q,j,Z) - d1.z;
+	  r2   = SPROD(d,d);
+	  jt   = SORTE(q,j);
+	  col1 = jt * ntypes + it;
+	  col2 = it * ntypes + jt;
+#ifndef KERMODE	  
+	  if (r2 < ew_r2_cut ) {
+#endif
+#ifdef KERMODE
+          if (r2 < ke_tot_r2cut ) { 
+#endif
+	    /* XXX */
+	    real pot, grad, val, dval, pdotd, tmp, pdotp, proj_i, proj_j;
+	    real valsr,dvalsr;
+	    vektor pj;
+
+	    pot=0.0; grad=0.0;
+
+	    pj.x=DP_P_IND(q,j,X);
+	    pj.y=DP_P_IND(q,j,Y);
+	    pj.z=DP_P_IND(q,j,Z);
+#ifdef KERMODE
+            real inv_r2,rij,inv_rij,inv_yukfc,yuk_dgdr,grad_gij;
+            real temp_dqfact1,temp2,temp3,temp4,temp5,temp6,temp7,temp8,temp9,temp_dd;
+            vektor temp_dqf1,temp_dqf2;
+            inv_r2  = 1.0/r2;
+            rij = sqrt(r2);
+            inv_rij = 1.0/rij;
+
+            //{fc, (1/r)*dfc/dr}
+            PAIR_INT(yuk_fc,yuk_dfc,coul_table,1,2+ntypepairs,r2,is_short);
+            yuk_dfc *= rij;
+            inv_yukfc = 1.0/yuk_fc;
+            temp_dqfact1 = (inv_yukfc*yuk_dfc-yuk_beta-3.0*inv_rij);
+            temp_dqfact1 *=inv_rij;
+            //{1/r*exp(-br)*fc}
+            VAL_FUNC(pot1,coul_table,0, 2+ntypepairs, r2, is_short);
+            pot1 *=inv_r2;
+
+            col1=(it <= jt) ?
+              it * ntypes + jt - ((it * (it + 1))/2)
+              :jt * ntypes + it - ((jt * (jt + 1))/2);
+            //{gij, 1/r*dg/dr}}
+            PAIR_INT(pot2,grad_gij,coul_table,2+col1, 2+ntypepairs, r2, is_short);
+            yuk_dgdr = grad_gij*rij;
+#endif
+#ifndef KERMODE
+	    /* smooth cutoff function is 2nd in coul_table */
+	    PAIR_INT(val, dval, coul_table, 1, 2+ntypepairs, r2, is_short);
+	    
+	    val  *= coul_eng;
+	    dval *= coul_eng;
+	    /* short-range function is 3rd in coul_table */
+	    col1=(it <= jt) ?
+	      it * ntypes + jt - ((it * (it + 1))/2)
+	      :jt * ntypes + it - ((jt * (jt + 1))/2);
+	    PAIR_INT(valsr,dvalsr,coul_table,2+col1,2+ntypepairs,
+		     r2,is_short);
+#endif
+	    /* Dipole at i -Charge at j interaction */
+#ifdef VARCHG
+	      if (SQR(dp_alpha[it])*SQR(CHARGE(q,j))>0) {
+
+	      pdotd=SPROD(pi,d);
+	      pot += val*CHARGE(q,j)*pdotd;
+	      force.x += CHARGE(q,j) * (dval * pdotd * d.x + val * pi.x);
+	      force.y += CHARGE(q,j) * (dval * pdotd * d.y + val * pi.y);
+	      force.z += CHARGE(q,j) * (dval * pdotd * d.z + val * pi.z);
+	      
+	      /* short range interaction */
+	      pot += CHARGE(q,j)*pdotd*valsr;
+	      force.x += CHARGE(q,j) * (dvalsr*pdotd *d.x +valsr*pi.x);
+	      force.y += CHARGE(q,j) * (dvalsr*pdotd *d.y +valsr*pi.y);
+	      force.z += CHARGE(q,j) * (dvalsr*pdotd *d.z +valsr*pi.z);
+
+	      have_force=1;
+	    }
+#else
+	    if (SQR(dp_alpha[it])*SQR(charge[jt])>0) {
+
+	      pdotd=SPROD(pi,d);
+#ifndef KERMODE
+	      pot += val*charge[jt]*pdotd;
+	      force.x += charge[jt] * (dval * pdotd * d.x + val * pi.x);
+	      force.y += charge[jt] * (dval * pdotd * d.y + val * pi.y);
+	      force.z += charge[jt] * (dval * pdotd * d.z + val * pi.z);
+	      
+	      /* short range interaction */
+	      pot += charge[jt]*pdotd*valsr;
+	      force.x += charge[jt] * (dvalsr*pdotd *d.x +valsr*pi.x);
+	      force.y += charge[jt] * (dvalsr*pdotd *d.y +valsr*pi.y);
+	      force.z += charge[jt] * (dvalsr*pdotd *d.z +valsr*pi.z);
+#endif
+#ifdef KERMODE
+              proj_i=charge[jt]*pdotd;
+              pot += proj_i*pot1;
+              temp2 = temp_dqfact1*proj_i*pot1;
+              temp3 = charge[jt]*pot1;
+              
+              temp_dqf1.x = temp2*d.x + temp3*pi.x ;
+              temp_dqf1.y = temp2*d.y + temp3*pi.y ;
+              temp_dqf1.z = temp2*d.z + temp3*pi.z ;
+
+              force.x +=temp_dqf1.x;
+              force.y +=temp_dqf1.y;
+              force.z +=temp_dqf1.z;
+
+// Short Range Dipole Charge
+              pot += proj_i*pot2*pot1;
+              temp4 = yuk_dgdr*proj_i*pot1*inv_rij;
+            
+              force.x += temp_dqf1.x*pot2 + temp4 * d.x;
+              force.y += temp_dqf1.y*pot2 + temp4 * d.y;
+              force.z += temp_dqf1.z*pot2 + temp4 * d.z;
+
+#endif
+	      have_force=1;
+	    }
+#endif
+	    /* Dipole at j -Charge at i interaction */
+#ifdef VARCHG
+	    if (SQR(dp_alpha[jt])*SQR(CHARGE(p,i))>0) {
+	      /* smooth cutoff function is 2nd in coul_table */
+
+	      pdotd=SPROD(pj,d);
+	      pot -= val*CHARGE(p,i)*pdotd;
+	      force.x -= CHARGE(p,i) * (dval * pdotd * d.x + val * pj.x);
+	      force.y -= CHARGE(p,i) * (dval * pdotd * d.y + val * pj.y);
+	      force.z -= CHARGE(p,i) * (dval * pdotd * d.z + val * pj.z);
+
+	      /* short range interaction */
+	      pot -= CHARGE(p,i)*pdotd*valsr;
+	      force.x -= CHARGE(p,i) * (dvalsr*pdotd *d.x +valsr*pj.x);
+	      force.y -= CHARGE(p,i) * (dvalsr*pdotd *d.y +valsr*pj.y);
+	      force.z -= CHARGE(p,i) * (dvalsr*pdotd *d.z +valsr*pj.z);
+	      have_force=1;
+	    }
+#else
+	    if (SQR(dp_alpha[jt])*SQR(charge[it])>0) {
+	      /* smooth cutoff function is 2nd in coul_table */
+
+	      pdotd=SPROD(pj,d);
+#ifndef KERMODE              
+	      pot -= val*charge[it]*pdotd;
+	      force.x -= charge[it] * (dval * pdotd * d.x + val * pj.x);
+	      force.y -= charge[it] * (dval * pdotd * d.y + val * pj.y);
+	      force.z -= charge[it] * (dval * pdotd * d.z + val * pj.z);
+
+	      /* short range interaction */
+	      pot -= charge[it]*pdotd*valsr;
+	      force.x -= charge[it] * (dvalsr*pdotd *d.x +valsr*pj.x);
+	      force.y -= charge[it] * (dvalsr*pdotd *d.y +valsr*pj.y);
+	      force.z -= charge[it] * (dvalsr*pdotd *d.z +valsr*pj.z);
+#endif
+#ifdef KERMODE
+              proj_j=charge[it]*pdotd;
+              pot -= proj_j*pot1;
+              temp5 = temp_dqfact1*proj_j*pot1;
+              temp6 = charge[it]*pot1;
+              
+              
+              temp_dqf2.x = temp5*d.x + temp6*pj.x ;
+              temp_dqf2.y = temp5*d.y + temp6*pj.y ;
+              temp_dqf2.z = temp5*d.z + temp6*pj.z ;
+
+              force.x -=temp_dqf2.x;
+              force.y -=temp_dqf2.y;
+              force.z -=temp_dqf2.z;
+              
+//Short Range Dipole-Charge
+              pot -=proj_j*pot2*pot1;
+              temp7 = yuk_dgdr*proj_j*pot1*inv_rij;
+                            
+              force.x -= temp_dqf2.x*pot2 + temp7*d.x;
+              force.y -= temp_dqf2.y*pot2 + temp7*d.y;
+              force.z -= temp_dqf2.z*pot2 + temp7*d.z;
+
+#endif
+	      have_force=1;
+	    }
+#endif
+	    /* Dipole-Dipole interaction */
+	    if (SQR(dp_alpha[it])*SQR(dp_alpha[jt])>0) {
+	      pdotp=SPROD(pi,pj);
+	      proj_i=SPROD(pi,d);
+	      proj_j=SPROD(pj,d);
+	      tmp = pdotp - 3.0 * proj_i * proj_j /r2; 
+#ifndef KERMODE
+	      pot += val * tmp;
+	      force.x -= -dval * tmp * d.x 
+		- val * ( 6.0 / SQR(r2) *proj_i *proj_j * d.x 
+			  - 3.0 / r2 * (proj_i * pj.x + proj_j * pi.x));
+	      force.y -= -dval * tmp * d.y 
+		- val * ( 6.0 / SQR(r2) *proj_i *proj_j * d.y 
+			  - 3.0 / r2 * (proj_i * pj.y + proj_j * pi.y));
+	      force.z -= -dval * tmp * d.z 
+		- val * ( 6.0 / SQR(r2) *proj_i *proj_j * d.z 
+			  - 3.0 / r2 * (proj_i * pj.z + proj_j * pi.z));
+#endif
+#ifdef KERMODE
+              temp_dd = tmp*pot1;
+              pot +=temp_dd;
+              
+              temp8 = temp_dd*temp_dqfact1;
+              temp9 = 6.0*inv_r2*proj_i*proj_j;
+              
+              force.x += temp8*d.x + (temp9*d.x - 3.0*(pi.x*proj_j+pj.x*proj_i))*inv_r2*pot1;
+              force.y += temp8*d.y + (temp9*d.y - 3.0*(pi.y*proj_j+pj.y*proj_i))*inv_r2*pot1;
+              force.z += temp8*d.z + (temp9*d.z - 3.0*(pi.z*proj_j+pj.z*proj_i))*inv_r2*pot1;
+
+#endif
+	      have_force = 1;
+	    }
+
+	    if (have_force) {
+	      tot_pot_energy += pot;
+
+	      KRAFT(q,j,X) -= force.x;
+	      KRAFT(q,j,Y) -= force.y;
+	      KRAFT(q,j,Z) -= force.z;
+	      ff.x         += force.x;
+	      ff.y         += force.y;
+	      ff.z         += force.z;
+              pot          *= 0.5;   /* avoid double counting */
+	      ee           += pot;
+	      POTENG(q,j)  += pot;
+	      
+#ifdef P_AXIAL
+	      vir_xx -= d.x * force.x;
+	      vir_yy -= d.y * force.y;
+	      vir_zz -= d.z * force.z;
+#else
+	      virial       -= SPROD(d,force);
+#endif
+	    
+#ifdef STRESS_TENS
+	      if (do_press_calc) {
+		/* avoid double counting of the virial */
+		force.x *= 0.5;
+		force.y *= 0.5;
+		force.z *= 0.5;
+		pp.xx             -= d.x * force.x;
+		PRESSTENS(q,j,xx) -= d.x * force.x;
+		pp.yy             -= d.y * force.y;
+		PRESSTENS(q,j,yy) -= d.y * force.y;
+		pp.xy             -= d.x * force.y;
+		PRESSTENS(q,j,xy) -= d.x * force.y;
+		pp.zz             -= d.z * force.z;
+		PRESSTENS(q,j,zz) -= d.z * force.z;
+		pp.yz             -= d.y * force.z;
+		PRESSTENS(q,j,yz) -= d.y * force.z;
+		pp.zx             -= d.z * force.x;
+		PRESSTENS(q,j,zx) -= d.z * force.x;
+	      }
+#endif
+	    }
+	  }	  
+        }	
+        /* Dipole self energy */
+	dp_energy = (SQR(dp_alpha[it])>0)?0.5*SPROD(pi,pi)/dp_alpha[it]:0.;
+	tot_pot_energy += dp_energy; /* avoid double counting */
+	ee += dp_energy;
+
+	POTENG(p,i)  += ee;
+	KRAFT(p,i,X) += ff.x;
+	KRAFT(p,i,Y) += ff.y;
+	KRAFT(p,i,Z) += ff.z;
+
+#ifdef STRESS_TENS
+	if (do_press_calc) {
+	  PRESSTENS(p,i,xx) += pp.xx;
+	  PRESSTENS(p,i,yy) += pp.yy;
+	  PRESSTENS(p,i,zz) += pp.zz;
+	  PRESSTENS(p,i,yz) += pp.yz;
+	  PRESSTENS(p,i,zx) += pp.zx;
+	  PRESSTENS(p,i,xy) += pp.xy;
+	}
+#endif
+      }
+      n++;
+#ifdef DEBUG
+/* Don't use this unless you are prepared for massive output*/
+
+/*       printf("%d\t%d\t%10.6f\t%10.6f\t%10.6f\t",  */
+/* 	     NUMMER(p,i),it,d1.x,d1.y,d1.z); */
+/*       printf("%10.6f\t%10.6f\t%10.6f\t",  */
+/* 	     KRAFT(p,i,X),KRAFT(p,i,Y),KRAFT(p,i,Z)); */
+/*       printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t", */
+/* 	     pi.x,pi.y,pi.z,DP_E_IND(p,i,X),DP_E_IND(p,i,Y),DP_E_IND(p,i,Z)); */
+/*       printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n", */
+/* 		   DP_P_STAT(p,i,X), DP_P_STAT(p,i,Y),DP_P_STAT(p,i,Z), */
+/* 		   DP_E_STAT(p,i,X), DP_E_STAT(p,i,Y),DP_E_STAT(p,i,Z)); */
+
+#endif
+    }
+    /* Shift Field history */
+    dp_E_shift = p->dp_E_old_1;
+    p->dp_E_old_1 = p->dp_E_ind;
+    p->dp_E_ind = dp_E_shift;
+    
+  }
+  
+  if (is_short) fprintf(stderr, "\n Short distance, dipole, step %d!\n",\
+			steps);
+  dp_E_calc++; 			/* increase field calc counter */
+#endif /* DIPOLE */
+
+  /* the real space sum over image boxes of EWALD is not parallelized */
+#ifdef EWALD 
+#ifdef MPI
+  if (ew_nmax >= 0)
+    error("option EWALD is only partially parallelized");
+#endif
+  do_forces_ewald(steps);
+#endif 
+
+#ifdef MPI
+  /* sum up results of different CPUs */
+  tmpvec1[0]     = tot_pot_energy;
+  tmpvec1[1]     = virial;
+  tmpvec1[2]     = vir_xx;
+  tmpvec1[3]     = vir_yy;
+  tmpvec1[4]     = vir_zz;
+  tmpvec1[5]     = vir_xy;
+  tmpvec1[6]     = vir_yz;
+  tmpvec1[7]     = vir_zx;
+  /* waiting for slower CPUs is counted as communication */
+  imd_start_timer(&time_comm);
+  MPI_Allreduce( tmpvec1, tmpvec2, 8, REAL, MPI_SUM, cpugrid); 
+  imd_stop_timer(&time_comm);
+  tot_pot_energy = tmpvec2[0];
+  virial         = tmpvec2[1];
+  vir_xx         = tmpvec2[2];
+  vir_yy         = tmpvec2[3];
+  vir_zz         = tmpvec2[4];
+  vir_xy         = tmpvec2[5];
+  vir_yz         = tmpvec2[6];
+  vir_zx         = tmpvec2[7];
+#endif
+
+  /* add forces back to original cells/cpus */
+#ifdef COMM_LISTS
+  if (nbl_comm_lists) send_forces_lists();
+  else
+#endif
+  send_forces(add_forces,pack_forces,unpack_forces);
+
+  if (nbl_adapt) imd_stop_timer(&nbl_force_time);
+}
+
+#ifdef NBL_PACKED
+
+/******************************************************************************
+*
+*  calc_forces_full -- force loops for full neighbor lists
+*
+*  Each pair interaction is computed twice, once for each partner, and
+*  only the atom owning the neighbor list is updated. The per atom
+*  quantities are therefore assigned rather than accumulated, the
+*  buffer cells are read only, and no forces are sent back.
+*
+******************************************************************************/
+
+void calc_forces_full(int steps)
+{
+  int  k, is_short=0;
+#ifdef MPI
+  real tmpvec1[8], tmpvec2[8];
+#endif
+
+  /* clear total forces */
+#ifdef RIGID
+  if ( nsuperatoms>0 ) 
+    for(k=0; k<nsuperatoms; k++) {
+      superforce[k].x = 0.0;
+      superforce[k].y = 0.0;
+#ifndef TWOD
+      superforce[k].z = 0.0;
+#endif
+    }
+#endif
+
+  /* pair interactions and host electron density */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(runtime) \
+  reduction(+:tot_pot_energy,virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy,is_short)
+#endif
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    int  i, n = nbl_cstart[k];
+    for (i=0; i<p->n; i++, n++) {
+
+#ifdef STRESS_TENS
+#ifdef TWOD
+      sym_tensor pp = {0.0,0.0,0.0};
+#else
+      sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
+#endif
+#endif
+#ifdef TWOD
+      vektor     d1, ff = {0.0,0.0};
+#else
+      vektor     d1, ff = {0.0,0.0,0.0};
+#endif
+#ifdef ADP
+      vektor     mu = {0.0,0.0,0.0};
+      sym_tensor la = {0.0,0.0,0.0,0.0,0.0,0.0};
+#endif
+      real   ee = 0.0;
+#ifdef EAM2
+      real   eam_r = 0.0;
+#endif
+#ifdef EEAM
+      real   eam_p = 0.0;
+#endif
+#ifdef NNBR
+      int    nb = 0;
+#endif
+      int    m, it;
+
+      d1.x = ORT(p,i,X);
+      d1.y = ORT(p,i,Y);
+#ifndef TWOD
+      d1.z = ORT(p,i,Z);
+#endif
+      it   = SORTE(p,i);
+
+      /* loop over neighbors */
+      for (m=tl[n]; m<tl[n+1]; m++) {
+
+        vektor d, force;
+        real   pot, grad, r2, rho_h;
+        int    j, jt, col, inc = ntypes * ntypes;
+
+        j = NBL_NBR(k,tb[m]);
+
+        d.x = NB_ORT(q,j,X) - d1.x;
+        d.y = NB_ORT(q,j,Y) - d1.y;
+#ifndef TWOD
+        d.z = NB_ORT(q,j,Z) - d1.z;
+#endif
+        r2  = SPROD(d,d);
+        jt  = NB_SORTE(q,j);
+        col = it * ntypes + jt;
+
+#ifdef PAIR
+        /* compute pair interactions */
+        if (r2 <= pair_pot.end[col]) {
+#ifdef LINPOT
+          PAIR_INT_LIN(pot, grad, pair_pot_lin, col, inc, r2, is_short);
+#else
+          PAIR_INT(pot, grad, pair_pot, col, inc, r2, is_short);
+#endif
+          pot  *= 0.5;   /* avoid double counting */
+          tot_pot_energy += pot;
+          force.x = d.x * grad;
+          force.y = d.y * grad;
+#ifndef TWOD
+          force.z = d.z * grad;
+#endif
+          ff.x   += force.x;
+          ff.y   += force.y;
+#ifndef TWOD
+          ff.z   += force.z;
+#endif
+#ifndef MONOLJ
+#ifdef NNBR
+          if (r2 < nb_r2_cut[col]) nb++;
+#endif
+#ifdef ORDPAR
+          if (r2 < op_r2_cut[col]) ee += op_weight[col] * pot;
+#else
+          ee += pot;
+#endif
+#endif
+          /* avoid double counting of the virial */
+          force.x *= 0.5;
+          force.y *= 0.5;
+#ifndef TWOD
+          force.z *= 0.5;
+#endif
+#ifdef P_AXIAL
+          vir_xx -= d.x * force.x;
+          vir_yy -= d.y * force.y;
+#ifndef TWOD
+          vir_zz -= d.z * force.z;
+#endif
+#else
+          virial -= 0.5 * r2 * grad;
+#endif
+#ifdef STRESS_TENS
+          if (do_press_calc) {
+            pp.xx -= d.x * force.x;
+            pp.yy -= d.y * force.y;
+            pp.xy -= d.x * force.y;
+#ifndef TWOD
+            pp.zz -= d.z * force.z;
+            pp.yz -= d.y * force.z;
+            pp.zx -= d.z * force.x;
+#endif
+          }
+#endif
+        }
+#endif /* PAIR */
+
+#ifdef EAM2
+        /* compute host electron density */
+        if (r2 < rho_h_tab.end[col]) {
+          VAL_FUNC(rho_h, rho_h_tab, col, inc, r2, is_short);
+          eam_r += rho_h;
+#ifdef EEAM
+          eam_p += rho_h * rho_h;
+#endif
+        }
+#endif
+
+#ifdef ADP
+        /* compute adp_mu */
+        if (r2 < adp_upot.end[col]) {
+          VAL_FUNC(pot, adp_upot, col, inc, r2, is_short);
+          mu.x += pot * d.x;
+          mu.y += pot * d.y;
+          mu.z += pot * d.z;
+        }
+        /* compute adp_lambda */
+        if (r2 < adp_wpot.end[col]) {
+          VAL_FUNC(pot, adp_wpot, col, inc, r2, is_short);
+          la.xx += pot * d.x * d.x;
+          la.yy += pot * d.y * d.y;
+          la.zz += pot * d.z * d.z;
+          la.yz += pot * d.y * d.z;
+          la.zx += pot * d.z * d.x;
+          la.xy += pot * d.x * d.y;
+        }
+#endif
+      }
+
+      KRAFT(p,i,X) = ff.x;
+      KRAFT(p,i,Y) = ff.y;
+#ifndef TWOD
+      KRAFT(p,i,Z) = ff.z;
+#endif
+#ifndef MONOLJ
+      POTENG(p,i)  = ee;
+#endif
+#ifdef NNBR
+      NBANZ(p,i)   = nb;
+#endif
+#ifdef CNA
+      if (cna) MARK(p,i) = 0;
+#endif
+#ifdef STRESS_TENS
+      PRESSTENS(p,i,xx) = pp.xx;
+      PRESSTENS(p,i,yy) = pp.yy;
+      PRESSTENS(p,i,xy) = pp.xy;
+#ifndef TWOD
+      PRESSTENS(p,i,zz) = pp.zz;
+      PRESSTENS(p,i,yz) = pp.yz;
+      PRESSTENS(p,i,zx) = pp.zx;
+#endif
+#endif
+#ifdef EAM2
+      EAM_RHO(p,i) = eam_r;
+#ifdef EEAM
+      EAM_P(p,i)   = eam_p;
+#endif
+#endif
+#ifdef ADP
+      ADP_MU    (p,i,X)  = mu.x;
+      ADP_MU    (p,i,Y)  = mu.y;
+      ADP_MU    (p,i,Z)  = mu.z;
+      ADP_LAMBDA(p,i,xx) = la.xx;
+      ADP_LAMBDA(p,i,yy) = la.yy;
+      ADP_LAMBDA(p,i,zz) = la.zz;
+      ADP_LAMBDA(p,i,yz) = la.yz;
+      ADP_LAMBDA(p,i,zx) = la.zx;
+      ADP_LAMBDA(p,i,xy) = la.xy;
+#endif
+    }
   }
-  /* DIPOLE interactions - for all atoms */
-  
-  /********************************  Dipole convergence ends here **************************** */ 
+  if (is_short) fprintf(stderr,"Short distance, pair, step %d!\n",steps);
 
-#ifdef DEBUG
-/* Don't use this unless you are prepared for massive output */
-//  printf("No,type,pos,force,p_ind,E_ind,p_stat,E_stat\n");
-#endif
+#ifdef EAM2
 
-  n=0;
+  /* compute embedding energy and its derivative */
+  do_embedding_energy_nbl();
+
+  /* distribute derivative of embedding energy */
+  send_cells(copy_dF,pack_dF,unpack_dF);
+  nbl_pack_dF();
+
+  /* EAM interactions */
+  is_short = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(runtime) \
+  reduction(+:virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy,is_short)
+#endif
   for (k=0; k<ncells; k++) {
     cell *p = CELLPTR(k);
-    for (i=0; i<p->n; i++) {
+    int  i, n = nbl_cstart[k];
+    for (i=0; i<p->n; i++, n++) {
 
 #ifdef STRESS_TENS
       sym_tensor pp = {0.0,0.0,0.0,0.0,0.0,0.0};
 #endif
-      vektor d1, pi, ff = {0.0,0.0,0.0};
-      real   ee = 0.0;
-      real   dp_energy = 0.0;
-      int    m, it, nb = 0;
-       
+#ifdef ADP
+      sym_tensor la1;
+      vektor mu1;
+#endif
+      vektor d1, ff = {0.0,0.0,0.0};
+      int m, it;
+
       d1.x = ORT(p,i,X);
       d1.y = ORT(p,i,Y);
       d1.z = ORT(p,i,Z);
-      it   = SORTE(p,i);
-
-      
-      pi.x = DP_P_IND(p,i,X);
-      pi.y = DP_P_IND(p,i,Y);
-      pi.z = DP_P_IND(p,i,Z);
-
-#ifdef VARCHG
-real pconst_i=SQR(CHARGE(p,i))+SQR(dp_alpha[it]);
-#else
-real pconst_i=SQR(charge[it])+SQR(dp_alpha[it]);
-#endif
-
-      if (pconst_i>0) { 
-	/* loop over neighbors */
-#ifdef ia64
-#pragma ivdep,swp
-#endif
-	for (m=tl[n]; m<tl[n+1]; m++) {
-
-	  vektor d, force = {0.0,0.0,0.0};
-	  real   r2;
-	  int    c, j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
-	  cell   *q;
-	  
-	  c = cl_num[ tb[m] ];
-	  j = tb[m] - cl_off[c];
-	  q = cell_array + c;
-
-	  d.x  = ORT(q,j,X) - d1.x;
-	  d.y  = ORT(q,j,Y) - d1.y;
-	  d.z  = ORT(q,j,Z) - d1.z;
-	  r2   = SPROD(d,d);
-	  jt   = SORTE(q,j);
-	  col1 = jt * ntypes + it;
-	  col2 = it * ntypes + jt;
-#ifndef KERMODE	  
-	  if (r2 < ew_r2_cut ) {
-#endif
-#ifdef KERMODE
-          if (r2 < ke_tot_r2cut ) { 
-#endif
-	    /* XXX */
-	    real pot, grad, val, dval, pdotd, tmp, pdotp, proj_i, proj_j;
-	    real valsr,dvalsr;
-	    vektor pj;
-
-	    pot=0.0; grad=0.0;
-
-	    pj.x=DP_P_IND(q,j,X);
-	    pj.y=DP_P_IND(q,j,Y);
-	    pj.z=DP_P_IND(q,j,Z);
-#ifdef KERMODE
-            real inv_r2,rij,inv_rij,inv_yukfc,yuk_dgdr,grad_gij;
-            real temp_dqfact1,temp2,temp3,temp4,temp5,temp6,temp7,temp8,temp9,temp_dd;
-            vektor temp_dqf1,temp_dqf2;
-            inv_r2  = 1.0/r2;
-            rij = sqrt(r2);
-            inv_rij = 1.0/rij;
-
-            //{fc, (1/r)*dfc/dr}
-            PAIR_INT(yuk_fc,yuk_dfc,coul_table,1,2+ntypepairs,r2,is_short);
-            yuk_dfc *= rij;
-            inv_yukfc = 1.0/yuk_fc;
-            temp_dqfact1 = (inv_yukfc*yuk_dfc-yuk_beta-3.0*inv_rij);
-            temp_dqfact1 *=inv_rij;
-            //{1/r*exp(-br)*fc}
-            VAL_FUNC(pot1,coul_table,0, 2+ntypepairs, r2, is_short);
-            pot1 *=inv_r2;
-
-            col1=(it <= jt) ?
-              it * ntypes + jt - ((it * (it + 1))/2)
-              :jt * ntypes + it - ((jt * (jt + 1))/2);
-            //{gij, 1/r*dg/dr}}
-            PAIR_INT(pot2,grad_gij,coul_table,2+col1, 2+ntypepairs, r2, is_short);
-            yuk_dgdr = grad_gij*rij;
-#endif
-#ifndef KERMODE
-	    /* smooth cutoff function is 2nd in coul_table */
-	    PAIR_INT(val, dval, coul_table, 1, 2+ntypepairs, r2, is_short);
-	    
-	    val  *= coul_eng;
-	    dval *= coul_eng;
-	    /* short-range function is 3rd in coul_table */
-	    col1=(it <= jt) ?
-	      it * ntypes + jt - ((it * (it + 1))/2)
-	      :jt * ntypes + it - ((jt * (jt + 1))/2);
-	    PAIR_INT(valsr,dvalsr,coul_table,2+col1,2+ntypepairs,
-		     r2,is_short);
+#ifdef ADP
+      mu1.x  = ADP_MU    (p,i,X);
+      mu1.y  = ADP_MU    (p,i,Y);
+      mu1.z  = ADP_MU    (p,i,Z);
+      la1.xx = ADP_LAMBDA(p,i,xx);
+      la1.yy = ADP_LAMBDA(p,i,yy);
+      la1.zz = ADP_LAMBDA(p,i,zz);
+      la1.yz = ADP_LAMBDA(p,i,yz);
+      la1.zx = ADP_LAMBDA(p,i,zx);
+      la1.xy = ADP_LAMBDA(p,i,xy);
 #endif
-	    /* Dipole at i -Charge at j interaction */
-#ifdef VARCHG
-	      if (SQR(dp_alpha[it])*SQR(CHARGE(q,j))>0) {
+      it   = SORTE(p,i);
 
-	      pdotd=SPROD(pi,d);
-	      pot += val*CHARGE(q,j)*pdotd;
-	      force.x += CHARGE(q,j) * (dval * pdotd * d.x + val * pi.x);
-	      force.y += CHARGE(q,j) * (dval * pdotd * d.y + val * pi.y);
-	      force.z += CHARGE(q,j) * (dval * pdotd * d.z + val * pi.z);
-	      
-	      /* short range interaction */
-	      pot += CHARGE(q,j)*pdotd*valsr;
-	      force.x += CHARGE(q,j) * (dvalsr*pdotd *d.x +valsr*pi.x);
-	      force.y += CHARGE(q,j) * (dvalsr*pdotd *d.y +valsr*pi.y);
-	      force.z += CHARGE(q,j) * (dvalsr*pdotd *d.z +valsr*pi.z);
+      /* loop over neighbors */
+      for (m=tl[n]; m<tl[n+1]; m++) {
 
-	      have_force=1;
-	    }
-#else
-	    if (SQR(dp_alpha[it])*SQR(charge[jt])>0) {
+        vektor d, force = {0.0,0.0,0.0};
+        real   r2;
+        int    j, jt, col1, col2, inc = ntypes * ntypes, have_force=0;
 
-	      pdotd=SPROD(pi,d);
-#ifndef KERMODE
-	      pot += val*charge[jt]*pdotd;
-	      force.x += charge[jt] * (dval * pdotd * d.x + val * pi.x);
-	      force.y += charge[jt] * (dval * pdotd * d.y + val * pi.y);
-	      force.z += charge[jt] * (dval * pdotd * d.z + val * pi.z);
-	      
-	      /* short range interaction */
-	      pot += charge[jt]*pdotd*valsr;
-	      force.x += charge[jt] * (dvalsr*pdotd *d.x +valsr*pi.x);
-	      force.y += charge[jt] * (dvalsr*pdotd *d.y +valsr*pi.y);
-	      force.z += charge[jt] * (dvalsr*pdotd *d.z +valsr*pi.z);
-#endif
-#ifdef KERMODE
-              proj_i=charge[jt]*pdotd;
-              pot += proj_i*pot1;
-              temp2 = temp_dqfact1*proj_i*pot1;
-              temp3 = charge[jt]*pot1;
-              
-              temp_dqf1.x = temp2*d.x + temp3*pi.x ;
-              temp_dqf1.y = temp2*d.y + temp3*pi.y ;
-              temp_dqf1.z = temp2*d.z + temp3*pi.z ;
+        j = NBL_NBR(k,tb[m]);
 
-              force.x +=temp_dqf1.x;
-              force.y +=temp_dqf1.y;
-              force.z +=temp_dqf1.z;
+        d.x  = NB_ORT(q,j,X) - d1.x;
+        d.y  = NB_ORT(q,j,Y) - d1.y;
+        d.z  = NB_ORT(q,j,Z) - d1.z;
+        r2   = SPROD(d,d);
+        jt   = NB_SORTE(q,j);
+        col1 = jt * ntypes + it;
+        col2 = it * ntypes + jt;
 
-// Short Range Dipole Charge
-              pot += proj_i*pot2*pot1;
-              temp4 = yuk_dgdr*proj_i*pot1*inv_rij;
-            
-              force.x += temp_dqf1.x*pot2 + temp4 * d.x;
-              force.y += temp_dqf1.y*pot2 + temp4 * d.y;
-              force.z += temp_dqf1.z*pot2 + temp4 * d.z;
+        if ((r2 < rho_h_tab.end[col1]) || (r2 < rho_h_tab.end[col2])) {
 
+          real grad, rho_i_strich, rho_j_strich;
+#ifdef EEAM
+          real rho_i, rho_j;
 #endif
-	      have_force=1;
-	    }
-#endif
-	    /* Dipole at j -Charge at i interaction */
-#ifdef VARCHG
-	    if (SQR(dp_alpha[jt])*SQR(CHARGE(p,i))>0) {
-	      /* smooth cutoff function is 2nd in coul_table */
-
-	      pdotd=SPROD(pj,d);
-	      pot -= val*CHARGE(p,i)*pdotd;
-	      force.x -= CHARGE(p,i) * (dval * pdotd * d.x + val * pj.x);
-	      force.y -= CHARGE(p,i) * (dval * pdotd * d.y + val * pj.y);
-	      force.z -= CHARGE(p,i) * (dval * pdotd * d.z + val * pj.z);
 
-	      /* short range interaction */
-	      pot -= CHARGE(p,i)*pdotd*valsr;
-	      force.x -= CHARGE(p,i) * (dvalsr*pdotd *d.x +valsr*pj.x);
-	      force.y -= CHARGE(p,i) * (dvalsr*pdotd *d.y +valsr*pj.y);
-	      force.z -= CHARGE(p,i) * (dvalsr*pdotd *d.z +valsr*pj.z);
-	      have_force=1;
-	    }
+          /* rho_strich_i(r_ij) */
+#ifndef EEAM
+          DERIV_FUNC(rho_i_strich, rho_h_tab, col1, inc, r2, is_short);
 #else
-	    if (SQR(dp_alpha[jt])*SQR(charge[it])>0) {
-	      /* smooth cutoff function is 2nd in coul_table */
-
-	      pdotd=SPROD(pj,d);
-#ifndef KERMODE              
-	      pot -= val*charge[it]*pdotd;
-	      force.x -= charge[it] * (dval * pdotd * d.x + val * pj.x);
-	      force.y -= charge[it] * (dval * pdotd * d.y + val * pj.y);
-	      force.z -= charge[it] * (dval * pdotd * d.z + val * pj.z);
-
-	      /* short range interaction */
-	      pot -= charge[it]*pdotd*valsr;
-	      force.x -= charge[it] * (dvalsr*pdotd *d.x +valsr*pj.x);
-	      force.y -= charge[it] * (dvalsr*pdotd *d.y +valsr*pj.y);
-	      force.z -= charge[it] * (dvalsr*pdotd *d.z +valsr*pj.z);
+          PAIR_INT(rho_i, rho_i_strich, rho_h_tab, col1, inc, r2, is_short);
 #endif
-#ifdef KERMODE
-              proj_j=charge[it]*pdotd;
-              pot -= proj_j*pot1;
-              temp5 = temp_dqfact1*proj_j*pot1;
-              temp6 = charge[it]*pot1;
-              
-              
-              temp_dqf2.x = temp5*d.x + temp6*pj.x ;
-              temp_dqf2.y = temp5*d.y + temp6*pj.y ;
-              temp_dqf2.z = temp5*d.z + temp6*pj.z ;
-
-              force.x -=temp_dqf2.x;
-              force.y -=temp_dqf2.y;
-              force.z -=temp_dqf2.z;
-              
-//Short Range Dipole-Charge
-              pot -=proj_j*pot2*pot1;
-              temp7 = yuk_dgdr*proj_j*pot1*inv_rij;
-                            
-              force.x -= temp_dqf2.x*pot2 + temp7*d.x;
-              force.y -= temp_dqf2.y*pot2 + temp7*d.y;
-              force.z -= temp_dqf2.z*pot2 + temp7*d.z;
 
+          /* rho_strich_j(r_ij) */
+          if (col1==col2) {
+            rho_j_strich = rho_i_strich;
+#ifdef EEAM
+            rho_j = rho_i;
 #endif
-	      have_force=1;
-	    }
-#endif
-	    /* Dipole-Dipole interaction */
-	    if (SQR(dp_alpha[it])*SQR(dp_alpha[jt])>0) {
-	      pdotp=SPROD(pi,pj);
-	      proj_i=SPROD(pi,d);
-	      proj_j=SPROD(pj,d);
-	      tmp = pdotp - 3.0 * proj_i * proj_j /r2; 
-#ifndef KERMODE
-	      pot += val * tmp;
-	      force.x -= -dval * tmp * d.x 
-		- val * ( 6.0 / SQR(r2) *proj_i *proj_j * d.x 
-			  - 3.0 / r2 * (proj_i * pj.x + proj_j * pi.x));
-	      force.y -= -dval * tmp * d.y 
-		- val * ( 6.0 / SQR(r2) *proj_i *proj_j * d.y 
-			  - 3.0 / r2 * (proj_i * pj.y + proj_j * pi.y));
-	      force.z -= -dval * tmp * d.z 
-		- val * ( 6.0 / SQR(r2) *proj_i *proj_j * d.z 
-			  - 3.0 / r2 * (proj_i * pj.z + proj_j * pi.z));
+          } else {
+#ifndef EEAM
+            DERIV_FUNC(rho_j_strich, rho_h_tab, col2, inc, r2, is_short);
+#else
+            PAIR_INT(rho_j, rho_j_strich, rho_h_tab, col2, inc, r2, is_short);
 #endif
-#ifdef KERMODE
-              temp_dd = tmp*pot1;
-              pot +=temp_dd;
-              
-              temp8 = temp_dd*temp_dqfact1;
-              temp9 = 6.0*inv_r2*proj_i*proj_j;
-              
-              force.x += temp8*d.x + (temp9*d.x - 3.0*(pi.x*proj_j+pj.x*proj_i))*inv_r2*pot1;
-              force.y += temp8*d.y + (temp9*d.y - 3.0*(pi.y*proj_j+pj.y*proj_i))*inv_r2*pot1;
-              force.z += temp8*d.z + (temp9*d.z - 3.0*(pi.z*proj_j+pj.z*proj_i))*inv_r2*pot1;
+          }
 
+          /* put together (dF_i and dF_j are by 0.5 too big) */
+          grad = 0.5 * (EAM_DF(p,i)*rho_j_strich + NB_EAM_DF(q,j)*rho_i_strich);
+#ifdef EEAM
+          /* 0.5 times 2 from derivative simplified to 1 */
+          grad += (EAM_DM(p,i) * rho_j * rho_j_strich +
+                   NB_EAM_DM(q,j) * rho_i * rho_i_strich);
 #endif
-	      have_force = 1;
-	    }
+          force.x = d.x * grad;
+          force.y = d.y * grad;
+          force.z = d.z * grad;
+          have_force=1;
+        }
 
-	    if (have_force) {
-	      tot_pot_energy += pot;
+#ifdef ADP
+        /* forces due to dipole distortion */
+        if (r2 < adp_upot.end[col1]) {
+          vektor mu;
+          real pot, grad, tmp;
+          PAIR_INT(pot, grad, adp_upot, col1, inc, r2, is_short);
+          mu.x = mu1.x - NB_ADP_MU(q,j,X);
+          mu.y = mu1.y - NB_ADP_MU(q,j,Y);
+          mu.z = mu1.z - NB_ADP_MU(q,j,Z);
+          tmp  = SPROD(mu,d) * grad;
+          force.x += mu.x * pot + tmp * d.x;
+          force.y += mu.y * pot + tmp * d.y;
+          force.z += mu.z * pot + tmp * d.z;
+          have_force=1;
+        }
+        /* forces due to quadrupole distortion */
+        if (r2 < adp_wpot.end[col1]) {
+          sym_tensor la;
+          vektor v;
+          real pot, grad, nu, f1, f2;
+          PAIR_INT(pot, grad, adp_wpot, col1, inc, r2, is_short);
+          la.xx = la1.xx + NB_ADP_LAMBDA(q,j,xx);
+          la.yy = la1.yy + NB_ADP_LAMBDA(q,j,yy);
+          la.zz = la1.zz + NB_ADP_LAMBDA(q,j,zz);
+          la.yz = la1.yz + NB_ADP_LAMBDA(q,j,yz);
+          la.zx = la1.zx + NB_ADP_LAMBDA(q,j,zx);
+          la.xy = la1.xy + NB_ADP_LAMBDA(q,j,xy);
+          v.x = la.xx * d.x + la.xy * d.y + la.zx * d.z;
+          v.y = la.xy * d.x + la.yy * d.y + la.yz * d.z;
+          v.z = la.zx * d.x + la.yz * d.y + la.zz * d.z;
+          nu  = (la.xx + la.yy + la.zz) / 3.0;
+          f1  = 2.0 * pot;
+          f2  = (SPROD(v,d) - nu * r2) * grad - nu * f1; 
+          force.x += f1 * v.x + f2 * d.x;
+          force.y += f1 * v.y + f2 * d.y;
+          force.z += f1 * v.z + f2 * d.z;
+          have_force=1;
+        }
+#endif
 
-	      KRAFT(q,j,X) -= force.x;
-	      KRAFT(q,j,Y) -= force.y;
-	      KRAFT(q,j,Z) -= force.z;
-	      ff.x         += force.x;
-	      ff.y         += force.y;
-	      ff.z         += force.z;
-              pot          *= 0.5;   /* avoid double counting */
-	      ee           += pot;
-	      POTENG(q,j)  += pot;
-	      
+        /* accumulate forces */
+        if (have_force) {
+          ff.x += force.x;
+          ff.y += force.y;
+          ff.z += force.z;
+          /* avoid double counting of the virial */
+          force.x *= 0.5;
+          force.y *= 0.5;
+          force.z *= 0.5;
 #ifdef P_AXIAL
-	      vir_xx -= d.x * force.x;
-	      vir_yy -= d.y * force.y;
-	      vir_zz -= d.z * force.z;
+          vir_xx -= d.x * force.x;
+          vir_yy -= d.y * force.y;
+          vir_zz -= d.z * force.z;
 #else
-	      virial       -= SPROD(d,force);
+          virial -= SPROD(d,force);
 #endif
-	    
 #ifdef STRESS_TENS
-	      if (do_press_calc) {
-		/* avoid double counting of the virial */
-		force.x *= 0.5;
-		force.y *= 0.5;
-		force.z *= 0.5;
-		pp.xx             -= d.x * force.x;
-		PRESSTENS(q,j,xx) -= d.x * force.x;
-		pp.yy             -= d.y * force.y;
-		PRESSTENS(q,j,yy) -= d.y * force.y;
-		pp.xy             -= d.x * force.y;
-		PRESSTENS(q,j,xy) -= d.x * force.y;
-		pp.zz             -= d.z * force.z;
-		PRESSTENS(q,j,zz) -= d.z * force.z;
-		pp.yz             -= d.y * force.z;
-		PRESSTENS(q,j,yz) -= d.y * force.z;
-		pp.zx             -= d.z * force.x;
-		PRESSTENS(q,j,zx) -= d.z * force.x;
-	      }
+          if (do_press_calc) {
+            pp.xx -= d.x * force.x;
+            pp.yy -= d.y * force.y;
+            pp.zz -= d.z * force.z;
+            pp.yz -= d.y * force.z;
+            pp.zx -= d.z * force.x;
+            pp.xy -= d.x * force.y;
+          }
 #endif
-	    }
-	  }	  
-        }	
-        /* Dipole self energy */
-	dp_energy = (SQR(dp_alpha[it])>0)?0.5*SPROD(pi,pi)/dp_alpha[it]:0.;
-	tot_pot_energy += dp_energy; /* avoid double counting */
-	ee += dp_energy;
-
-	POTENG(p,i)  += ee;
-	KRAFT(p,i,X) += ff.x;
-	KRAFT(p,i,Y) += ff.y;
-	KRAFT(p,i,Z) += ff.z;
-
+        }
+      }
+      KRAFT(p,i,X) += ff.x;
+      KRAFT(p,i,Y) += ff.y;
+      KRAFT(p,i,Z) += ff.z;
 #ifdef STRESS_TENS
-	if (do_press_calc) {
-	  PRESSTENS(p,i,xx) += pp.xx;
-	  PRESSTENS(p,i,yy) += pp.yy;
-	  PRESSTENS(p,i,zz) += pp.zz;
-	  PRESSTENS(p,i,yz) += pp.yz;
-	  PRESSTENS(p,i,zx) += pp.zx;
-	  PRESSTENS(p,i,xy) += pp.xy;
-	}
-#endif
+      if (do_press_calc) {
+        PRESSTENS(p,i,xx) += pp.xx;
+        PRESSTENS(p,i,yy) += pp.yy;
+        PRESSTENS(p,i,zz) += pp.zz;
+        PRESSTENS(p,i,yz) += pp.yz;
+        PRESSTENS(p,i,zx) += pp.zx;
+        PRESSTENS(p,i,xy) += pp.xy;
       }
-      n++;
-#ifdef DEBUG
-/* Don't use this unless you are prepared for massive output*/
-
-/*       printf("%d\t%d\t%10.6f\t%10.6f\t%10.6f\t",  */
-/* 	     NUMMER(p,i),it,d1.x,d1.y,d1.z); */
-/*       printf("%10.6f\t%10.6f\t%10.6f\t",  */
-/* 	     KRAFT(p,i,X),KRAFT(p,i,Y),KRAFT(p,i,Z)); */
-/*       printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t", */
-/* 	     pi.x,pi.y,pi.z,DP_E_IND(p,i,X),DP_E_IND(p,i,Y),DP_E_IND(p,i,Z)); */
-/*       printf("%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\t%10.6f\n", */
-/* 		   DP_P_STAT(p,i,X), DP_P_STAT(p,i,Y),DP_P_STAT(p,i,Z), */
-/* 		   DP_E_STAT(p,i,X), DP_E_STAT(p,i,Y),DP_E_STAT(p,i,Z)); */
-
 #endif
     }
-    /* Shift Field history */
-    dp_E_shift = p->dp_E_old_1;
-    p->dp_E_old_1 = p->dp_E_ind;
-    p->dp_E_ind = dp_E_shift;
-    
   }
-  
-  if (is_short) fprintf(stderr, "\n Short distance, dipole, step %d!\n",\
-			steps);
-  dp_E_calc++; 			/* increase field calc counter */
-#endif /* DIPOLE */
+  if (is_short) fprintf(stderr, "\n Short distance, EAM, step %d!\n",steps);
 
-  /* EWALD is only partially parallelized */
-#ifdef EWALD 
-#ifdef MPI
-  if ((ew_nmax >= 0) || (ew_kcut > 0)) 
-    error("option EWALD is only partially parallelized");
-#endif
-  do_forces_ewald(steps);
-#endif 
+#endif /* EAM2 */
 
 #ifdef MPI
   /* sum up results of different CPUs */
@@ -1982,7 +3620,10 @@ real pconst_i=SQR(charge[it])+SQR(dp_alpha[it]);
   tmpvec1[5]     = vir_xy;
   tmpvec1[6]     = vir_yz;
   tmpvec1[7]     = vir_zx;
+  /* waiting for slower CPUs is counted as communication */
+  imd_start_timer(&time_comm);
   MPI_Allreduce( tmpvec1, tmpvec2, 8, REAL, MPI_SUM, cpugrid); 
+  imd_stop_timer(&time_comm);
   tot_pot_energy = tmpvec2[0];
   virial         = tmpvec2[1];
   vir_xx         = tmpvec2[2];
@@ -1992,12 +3633,64 @@ real pconst_i=SQR(charge[it])+SQR(dp_alpha[it]);
   vir_yz         = tmpvec2[6];
   vir_zx         = tmpvec2[7];
 #endif
+}
 
-  /* add forces back to original cells/cpus */
-  send_forces(add_forces,pack_forces,unpack_forces);
+#endif /* NBL_PACKED */
 
+#ifdef EAM2
+
+/******************************************************************************
+*
+*  do_embedding_energy_nbl - embedding energy and its derivative
+*
+******************************************************************************/
+
+void do_embedding_energy_nbl(void)
+{
+  int k;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(runtime) reduction(+:tot_pot_energy)
+#endif
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    real pot, tmp, tr;
+    int  i, idummy=0;
+#ifdef ia64
+#pragma ivdep,swp
+#endif
+    for (i=0; i<p->n; i++) {
+      PAIR_INT( pot, EAM_DF(p,i), embed_pot, SORTE(p,i), 
+                ntypes, EAM_RHO(p,i), idummy);
+      POTENG(p,i)    += pot;
+      tot_pot_energy += pot;
+#ifdef EEAM
+      PAIR_INT( pot, EAM_DM(p,i), emod_pot, SORTE(p,i), 
+                ntypes, EAM_P(p,i), idummy);
+      POTENG(p,i)    += pot;
+      tot_pot_energy += pot;
+#endif
+#ifdef ADP
+      tr  = (ADP_LAMBDA(p,i,xx) + ADP_LAMBDA(p,i,yy) + ADP_LAMBDA(p,i,zz))/3.0;
+      tmp = ADP_LAMBDA(p,i,xx) - tr; pot  = SQR(tmp);
+      tmp = ADP_LAMBDA(p,i,yy) - tr; pot += SQR(tmp);
+      tmp = ADP_LAMBDA(p,i,zz) - tr; pot += SQR(tmp);
+      tmp = ADP_LAMBDA(p,i,yz);      pot += SQR(tmp) * 2.0;
+      tmp = ADP_LAMBDA(p,i,zx);      pot += SQR(tmp) * 2.0;
+      tmp = ADP_LAMBDA(p,i,xy);      pot += SQR(tmp) * 2.0;
+      tmp = ADP_MU    (p,i,X);       pot += SQR(tmp);
+      tmp = ADP_MU    (p,i,Y);       pot += SQR(tmp);
+      tmp = ADP_MU    (p,i,Z);       pot += SQR(tmp);
+      pot *= 0.5;
+      POTENG(p,i)    += pot;
+      tot_pot_energy += pot;
+#endif
+    }
+  }
 }
 
+#endif
+
 /******************************************************************************
 *
 *  check_nblist
@@ -2033,7 +3726,65 @@ void check_nblist()
 #else
   max2 = max1;
 #endif
-  if (max2 > SQR(0.5*nbl_margin)) have_valid_nbl = 0;
+  nbl_steps++;
+  if (max2 > SQR(0.5*nbl_skin)) {
+    have_valid_nbl = 0;
+    if (nbl_adapt) adapt_nbl_margin(max2);
+  }
+}
+
+/******************************************************************************
+*
+*  adapt_nbl_margin - choose the neighbor list margin which minimizes
+*  the time per step. The update costs a measured, roughly constant time
+*  t_u, which is amortized over s / (2 v) steps, where s is the margin
+*  and v the maximal displacement per step. The force computation costs
+*  t_f per step, which is proportional to the neighbor list length, and
+*  thus to the cube of the list cutoff rc + s. The margin cannot exceed
+*  nbl_margin, for which the cells have been set up.
+*
+******************************************************************************/
+
+void adapt_nbl_margin(real max2)
+{
+  static int nupd=0;
+  double cost[2];
+  real   rc, s, n, t, t_min=0.0, v;
+  int    k;
+#ifdef MPI
+  double tmp[2];
+#endif
+
+  /* maximal displacement per step, averaged over updates */
+  v = SQRT(max2) / MAX(nbl_steps,1);
+  nbl_disp_rate = (0==nupd) ? v : 0.5 * (nbl_disp_rate + v);
+  nupd++;
+
+  /* wait until some updates have been timed */
+  if ((nbl_count < 3) || (nbl_force_work <= 0.0) ||
+      (nbl_build_time.total <= 0.0)) return;
+
+  /* time per update, and per step and unit list volume */
+  cost[0] = nbl_build_time.total / nbl_count;
+  cost[1] = nbl_force_time.total / nbl_force_work;
+#ifdef MPI
+  /* the slowest CPU counts */
+  MPI_Allreduce( cost, tmp, 2, MPI_DOUBLE, MPI_MAX, cpugrid);
+  cost[0] = tmp[0];
+  cost[1] = tmp[1];
+#endif
+
+  /* scan the admissible range of margins */
+  rc = SQRT(cellsz) - nbl_margin;
+  for (k=1; k<=50; k++) {
+    s = nbl_margin * k / 50.0;
+    n = (nbl_disp_rate > 0.0) ? MAX(1.0, 0.5 * s / nbl_disp_rate) : 1e10;
+    t = cost[0] / n + cost[1] * (rc + s) * (rc + s) * (rc + s);
+    if ((1==k) || (t < t_min)) {
+      t_min    = t;
+      nbl_skin = s;
+    }
+  }
 }
 
 
@@ -2081,8 +3832,8 @@ void calc_sm_pot()
 
         vektor d;
         real   r2, ch_j;
-        int    c  = cl_num[ tb[m] ];
-        int    j  = tb[m] - cl_off[c];
+        int    c  = NBL_NBR_CELL(k,tb[m]);
+        int    j  = NBL_NBR_ATOM(k,tb[m]);
         cell   *q = cell_array + c;
         int    col2;
 
@@ -2145,6 +3896,8 @@ void calc_sm_chi()
 #endif
     /* update cell decomposition */
     fix_cells();
+    /* restore spatial order of atoms in cells */
+    if ((nbl_sort > 0) && (0 == nbl_count % nbl_sort)) sort_nbl_cells();
   }
 
   /* make new neighbor lists */
@@ -2181,8 +3934,8 @@ void calc_sm_chi()
 
         vektor d;
         real   r2, z_sm_q, ch_j;
-        int    c  = cl_num[ tb[m] ];
-        int    j  = tb[m] - cl_off[c];
+        int    c  = NBL_NBR_CELL(k,tb[m]);
+        int    j  = NBL_NBR_ATOM(k,tb[m]);
         cell   *q = cell_array + c;
         int    q_typ, col1, col2, inc=ntypes*ntypes;;
 
@@ -31,7 +31,7 @@
 
 void setup_mpi_topology( void )
 {
-  int period[3] = { 1, 1, 1 };
+  int i, period[3] = { 1, 1, 1 };
   ivektor cpuc, nbcoord;
 
   /* Set up process topology */
@@ -85,6 +85,37 @@ void setup_mpi_topology( void )
   nbcoord = my_coord; ++nbcoord.x; ++nbcoord.y; ++nbcoord.z; nbdsw = cpu_grid_coord( nbcoord );
   nbcoord = my_coord; ++nbcoord.x; --nbcoord.y; ++nbcoord.z; nbdwn = cpu_grid_coord( nbcoord );
 
+#ifdef MPI3
+  /* neighborhoods along the axes, for comm_mode 1: we send first to the
+     lower, then to the upper neighbor, and receive first from the upper,
+     then from the lower one, so that messages are matched correctly
+     even if both neighbors are the same CPU */
+  for (i=0; i<3; ++i) {
+    int lohi[2], hilo[2], wgt[2] = { 1, 1 };
+    lohi[0] = hilo[1] = (i==0) ? nbeast : ((i==1) ? nbnorth : nbup  );
+    lohi[1] = hilo[0] = (i==0) ? nbwest : ((i==1) ? nbsouth : nbdown);
+    MPI_Dist_graph_create_adjacent(cpugrid, 2, hilo, wgt, 
+      2, lohi, wgt, MPI_INFO_NULL, 0, &cpugrid_axis[i]);
+  }
+
+  /* neighbors on the same node, for comm_mode 2 */
+  if (comm_mode==2) {
+    MPI_Group grid_group, node_group;
+    int nb[6];
+    nb[0] = nbeast;  nb[1] = nbwest;
+    nb[2] = nbnorth; nb[3] = nbsouth;
+    nb[4] = nbup;    nb[5] = nbdown;
+    MPI_Comm_split_type(cpugrid, MPI_COMM_TYPE_SHARED, myid, MPI_INFO_NULL,
+                        &cpugrid_node);
+    MPI_Comm_group(cpugrid,      &grid_group);
+    MPI_Comm_group(cpugrid_node, &node_group);
+    MPI_Group_translate_ranks(grid_group, 6, nb, node_group, 
+                              &nb_node_rank[0][0]);
+    MPI_Group_free(&grid_group);
+    MPI_Group_free(&node_group);
+  }
+#endif
+
   init_io();
 
 }
@@ -61,39 +61,47 @@ void flush_outbuf(FILE *out, int *len, int tag)
 
 /******************************************************************************
 *
-*  write_config_select writes selected data of a configuration to a 
-*  file with number fzhlr and specified suffix. The data is written
-*  (and selected) by the function *write_atoms_fun, which is supposed 
-*  to write the data of one cell.
+*  config_file_name makes the name of the output file with number fzhlr
+*  (-1 final, other negative numbers interm) and specified suffix,
+*  followed by tail
 *
 ******************************************************************************/
 
-void write_config_select(int fzhlr, char *suffix, 
-  void (*write_atoms_fun)(FILE *out), void (*write_header_fun)(FILE *out))
+void config_file_name(str255 fname, int fzhlr, char *suffix, char *tail)
 {
-  FILE *out=NULL;
-  str255 fname;
-
-  is_big_endian = endian();
+  int len;
+
+  if (fzhlr >= 0) 
+    len = snprintf(fname, sizeof(str255), "%s.%05d.%s%s", 
+                   outfilename, fzhlr, suffix, tail);
+  else if (fzhlr==-1) 
+    len = snprintf(fname, sizeof(str255), "%s-final.%s%s", 
+                   outfilename, suffix, tail);
+  else 
+    len = snprintf(fname, sizeof(str255), "%s-interm.%s%s", 
+                   outfilename, suffix, tail);
+  if (len >= sizeof(str255)) error_str("Output file name too long: %s",fname);
+}
 
-#if defined(BG) && defined(NBLIST)
-  deallocate_nblist();
-#endif
+/******************************************************************************
+*
+*  open_config_file opens the output file with number fzhlr and
+*  specified suffix on the output CPUs, and writes the header;
+*  returns NULL on the CPUs which send their data elsewhere
+*
+******************************************************************************/
 
-#ifdef MPI2
-  MPI_Alloc_mem(outbuf_size * sizeof(char), MPI_INFO_NULL, &outbuf);
-#else
-  outbuf = (char *) malloc(outbuf_size * sizeof(char));
-#endif
-  if (NULL==outbuf) error("cannot allocate output buffer");
+FILE *open_config_file(int fzhlr, char *suffix, 
+  void (*write_header_fun)(FILE *out))
+{
+  FILE *out=NULL;
+  str255 fname;
 
 #ifdef MPI
   if (1==parallel_output) {
     /* write header to separate file */
     if ((myid==0) && (use_header)) {
-      if (fzhlr>=0) sprintf(fname,"%s.%05d.%s.head",outfilename,fzhlr,suffix);
-      else if (fzhlr==-1) sprintf(fname,"%s-final.%s.head",outfilename,suffix);
-      else sprintf(fname,"%s-interm.%s.head",outfilename,suffix);
+      config_file_name(fname, fzhlr, suffix, ".head");
       out = fopen(fname, "w");
       if (NULL == out) error_str("Cannot open output file %s",fname);
       (*write_header_fun)(out);
@@ -101,12 +109,9 @@ void write_config_select(int fzhlr, char *suffix,
     }
     /* open output file */
     if (myid == my_out_id) {
-      if (fzhlr>=0) 
-        sprintf(fname,"%s.%05d.%s.%u",outfilename,fzhlr,suffix,my_out_grp);
-      else if (fzhlr==-1) 
-        sprintf(fname,"%s-final.%s.%u", outfilename,suffix,my_out_grp);
-      else 
-        sprintf(fname,"%s-interm.%s.%u", outfilename,suffix,my_out_grp);
+      char grp[16];
+      sprintf(grp, ".%u", my_out_grp);
+      config_file_name(fname, fzhlr, suffix, grp);
       out = fopen(fname,"w");
       if (NULL == out) error_str("Cannot open output file %s",fname);
     }
@@ -114,15 +119,53 @@ void write_config_select(int fzhlr, char *suffix,
 #endif
   if (0==myid) {
     /* open output file */
-    if (fzhlr >= 0) sprintf(fname,"%s.%05d.%s", outfilename,fzhlr,suffix);
-    else if (fzhlr==-1) sprintf(fname,"%s-final.%s", outfilename,suffix);
-    else sprintf(fname,"%s-interm.%s", outfilename,suffix);
+    config_file_name(fname, fzhlr, suffix, "");
     out = fopen(fname,"w");
     if (NULL == out) error_str("Cannot open output file %s",fname);
     /* write header */
     if (use_header) (*write_header_fun)(out);
   }
 
+  return out;
+}
+
+/******************************************************************************
+*
+*  write_config_select writes selected data of a configuration to a 
+*  file with number fzhlr and specified suffix. The data is written
+*  (and selected) by the function *write_atoms_fun, which is supposed 
+*  to write the data of one cell.
+*
+******************************************************************************/
+
+void write_config_select(int fzhlr, char *suffix, 
+  void (*write_atoms_fun)(FILE *out), void (*write_header_fun)(FILE *out))
+{
+  FILE *out=NULL;
+
+#ifdef MPI
+  /* checkpoints in column layout are written collectively */
+  if ((2==parallel_output) && (write_atoms_fun==write_atoms_config)) {
+    write_config_mpiio(fzhlr, suffix);
+    return;
+  }
+#endif
+
+  is_big_endian = endian();
+
+#if defined(BG) && defined(NBLIST)
+  deallocate_nblist();
+#endif
+
+#ifdef MPI2
+  MPI_Alloc_mem(outbuf_size * sizeof(char), MPI_INFO_NULL, &outbuf);
+#else
+  outbuf = (char *) malloc(outbuf_size * sizeof(char));
+#endif
+  if (NULL==outbuf) error("cannot allocate output buffer");
+
+  out = open_config_file(fzhlr, suffix, write_header_fun);
+
   /* write or send own data */
   (*write_atoms_fun)(out);
 
@@ -174,12 +217,243 @@ void write_config(int fzhlr, int steps)
   if (1==parallel_output) fix_cells();
 
   /* write checkpoint */
+#ifdef ASYNC_CKPT
+  /* in the background, if every CPU writes only its own atoms; the
+     iteration file marks the checkpoint as complete, so it gets its
+     final name only in wait_config_async */
+  if ((async_checkpoint) && (1==out_grp_size) && (parallel_output < 2)) {
+    write_config_async(fzhlr, "chkpt");
+    if (myid == 0) write_itr_file(fzhlr, steps,"part");
+    return;
+  }
+#endif
   write_config_select(fzhlr, "chkpt", write_atoms_config, write_header_config);
 
   /* write iteration file */
   if (myid == 0) write_itr_file(fzhlr, steps,"");
 }
 
+#ifdef ASYNC_CKPT
+
+/******************************************************************************
+*
+*  write_config_thread formats and writes the atoms of the checkpoint
+*  snapshot; runs in the background and must not call MPI or error()
+*
+******************************************************************************/
+
+void *write_config_thread(void *arg)
+{
+  FILE *out = (FILE *) arg;
+  int i, len=0;
+
+  for (i=0; i<ckpt_cell.n; i++) {
+    len += format_atom_config(ckpt_buf+len, &ckpt_cell, i);
+    if (len > ckpt_buf_size - 256) {
+      fwrite(ckpt_buf, 1, len, out);
+      len = 0;
+    }
+  }
+  if (len>0) fwrite(ckpt_buf, 1, len, out);
+  fclose(out);
+  return NULL;
+}
+
+/******************************************************************************
+*
+*  write_config_async copies the local atoms to a snapshot and returns;
+*  the snapshot is written by write_config_thread. Only one checkpoint
+*  is in progress at a time, so the extra memory is bounded by one copy
+*  of the local atoms and one output buffer, which are freed when the
+*  checkpoint is complete.
+*
+******************************************************************************/
+
+void write_config_async(int fzhlr, char *suffix)
+{
+  FILE *out;
+  int i, k, n=0;
+
+  /* the previous checkpoint must be complete */
+  wait_config_async();
+
+  is_big_endian = endian();
+  out = open_config_file(fzhlr, suffix, write_header_config);
+
+  /* copy the atoms to the snapshot */
+  for (k=0; k<NCELLS; k++) n += CELLPTR(k)->n;
+  alloc_cell(&ckpt_cell, MAX(n,1));
+#ifdef NYETENSOR
+  /* the cells hold only pointers to the tensors, which are updated
+     while the snapshot is written, so we copy the tensors, too */
+  ckpt_nye = (nyeTensorInfo *) malloc(MAX(n,1) * sizeof(nyeTensorInfo));
+  if (NULL==ckpt_nye) error("cannot allocate checkpoint Nye tensors");
+#endif
+  ckpt_cell.n = 0;
+  for (k=0; k<NCELLS; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      copy_atom_cell_cell(&ckpt_cell, ckpt_cell.n, p, i);
+#ifdef NYETENSOR
+      if (NYE(p,i) != NULL) {
+        ckpt_nye[ckpt_cell.n] = *NYE(p,i);
+        NYE(&ckpt_cell, ckpt_cell.n) = ckpt_nye + ckpt_cell.n;
+      }
+      else NYE(&ckpt_cell, ckpt_cell.n) = NULL;
+#endif
+      ckpt_cell.n++;
+    }
+  }
+
+  ckpt_buf_size = outbuf_size;
+  ckpt_buf = (char *) malloc(ckpt_buf_size * sizeof(char));
+  if (NULL==ckpt_buf) error("cannot allocate checkpoint buffer");
+
+  /* start the writer thread */
+  if (pthread_create(&ckpt_thread, NULL, write_config_thread, out))
+    error("cannot start checkpoint thread");
+  ckpt_fzhlr   = fzhlr;
+  ckpt_pending = 1;
+}
+
+/******************************************************************************
+*
+*  wait_config_async waits until the checkpoint in progress is on disk
+*  on all CPUs, gives its iteration file the final name, and frees the
+*  snapshot; must be called by all CPUs together
+*
+******************************************************************************/
+
+void wait_config_async(void)
+{
+  str255 part, fname;
+
+  if (ckpt_pending) {
+    pthread_join(ckpt_thread, NULL);
+#ifdef MPI
+    MPI_Barrier(cpugrid);
+#endif
+    if (myid == 0) {
+      config_file_name(part,  ckpt_fzhlr, "itr", ".part");
+      config_file_name(fname, ckpt_fzhlr, "itr", "");
+      if (rename(part, fname)) error_str("Cannot rename %s", part);
+    }
+    alloc_cell(&ckpt_cell, 0);
+    free(ckpt_buf);
+    ckpt_buf = NULL;
+#ifdef NYETENSOR
+    free(ckpt_nye);
+    ckpt_nye = NULL;
+#endif
+    ckpt_pending = 0;
+  }
+}
+
+#endif /* ASYNC_CKPT */
+
+#ifdef MPI
+
+/******************************************************************************
+*
+*  write_config_mpiio writes a checkpoint to a single file, shared by
+*  all CPUs (parallel_output 2). After the header, written by CPU 0,
+*  the file contains the atom numbers and types as 4 byte integers,
+*  followed by the remaining items, one column of doubles per item.
+*  Each CPU writes its part of every column, at an offset given by the
+*  number of atoms on the CPUs before it. The header format is S or s,
+*  for big or little endian data.
+*
+******************************************************************************/
+
+void write_config_mpiio(int fzhlr, char *suffix)
+{
+  MPI_File   fh;
+  MPI_Status status;
+  FILE       *out;
+  str255     fname;
+  i_or_r     data[2*MAX_ITEMS_CONFIG];
+  long long  hlen=0, ntot, nfirst=0, n=0;
+  int        *num, *typ, i, k, l, m, ncols=0, nc;
+  double     *col;
+#ifdef DOUBLE
+  int        nint = 1;   /* number and type share the first item */
+#else
+  int        nint = 2;
+#endif
+
+  is_big_endian = endian();
+
+  config_file_name(fname, fzhlr, suffix, "");
+
+  /* header */
+  if (0==myid) {
+    out = fopen(fname,"w");
+    if (NULL == out) error_str("Cannot open output file %s",fname);
+    write_header_config(out);
+    hlen = ftell(out);
+    fclose(out);
+  }
+  MPI_Bcast( &hlen, 1, MPI_LONG_LONG, 0, cpugrid);
+
+  /* offset of my atoms, and number of columns */
+  for (k=0; k<NCELLS; k++) n += CELLPTR(k)->n;
+  MPI_Exscan( &n, &nfirst, 1, MPI_LONG_LONG, MPI_SUM, cpugrid);
+  if (0==myid) nfirst = 0;
+  MPI_Allreduce( &n, &ntot, 1, MPI_LONG_LONG, MPI_SUM, cpugrid);
+  for (k=0; (k<NCELLS) && (0==ncols); k++)
+    if (CELLPTR(k)->n > 0) ncols = pack_atom_config(data, CELLPTR(k), 0) - nint;
+  MPI_Allreduce( &ncols, &nc, 1, MPI_INT, MPI_MAX, cpugrid);
+  ncols = nc;
+
+  /* transpose my atoms to columns */
+  num = (int    *) malloc( MAX(n,1) * sizeof(int) );
+  typ = (int    *) malloc( MAX(n,1) * sizeof(int) );
+  col = (double *) malloc( MAX(n,1) * ncols * sizeof(double) );
+  if ((NULL==num) || (NULL==typ) || (NULL==col))
+    error("cannot allocate column buffers");
+  l = 0;
+  for (k=0; k<NCELLS; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      pack_atom_config(data, p, i);
+#ifdef DOUBLE
+      num[l] = data[0].i[0];
+      typ[l] = data[0].i[1];
+#else
+      num[l] = data[0].i;
+      typ[l] = data[1].i;
+#endif
+      for (m=0; m<ncols; m++) col[m*n+l] = (double) data[nint+m].r;
+      l++;
+    }
+  }
+
+  /* collective write of all columns; file errors are returned, not fatal */
+  if (MPI_SUCCESS != MPI_File_open( cpugrid, fname, MPI_MODE_WRONLY, 
+                                    MPI_INFO_NULL, &fh ))
+    error_str("Cannot open output file %s",fname);
+  if (MPI_SUCCESS != MPI_File_write_at_all( fh, hlen + nfirst * sizeof(int), 
+                                            num, (int) n, MPI_INT, &status ))
+    error_str("Cannot write output file %s",fname);
+  if (MPI_SUCCESS != MPI_File_write_at_all( fh, 
+                       hlen + (ntot + nfirst) * sizeof(int), 
+                       typ, (int) n, MPI_INT, &status ))
+    error_str("Cannot write output file %s",fname);
+  for (m=0; m<ncols; m++)
+    if (MPI_SUCCESS != MPI_File_write_at_all( fh, hlen + 2 * ntot * sizeof(int) 
+                         + (m * ntot + nfirst) * sizeof(double),
+                         col + m*n, (int) n, MPI_DOUBLE, &status ))
+      error_str("Cannot write output file %s",fname);
+  if (MPI_SUCCESS != MPI_File_close( &fh ))
+    error_str("Cannot close output file %s",fname);
+
+  free(num);
+  free(typ);
+  free(col);
+}
+
+#endif /* MPI */
+
 #ifdef RELAX
 /******************************************************************************
 *
@@ -3157,7 +3431,9 @@ void write_header_config(FILE *out)
   time_t now;
 
   /* format line */
-  if (binary_output)
+  if (2==parallel_output)
+    c = is_big_endian ? 'S' : 's';
+  else if (binary_output)
 #ifdef DOUBLE
     c = is_big_endian ? 'B' : 'L';
 #else
@@ -3413,7 +3689,8 @@ int read_header(header_info_t *info, str255 infilename)
       info->n_vel    = nv;
       info->n_data   = nd;
       info->n_items  = n + t + m + np + nv + nd;
-      if ((info->format == 'B') || (info->format == 'b'))
+      if ((info->format == 'B') || (info->format == 'b') || 
+          (info->format == 'S'))
         info->endian = 1;
       else
         info->endian = 0;
@@ -3893,6 +4170,33 @@ void write_lb_file(int steps, int balanced) {
 }
 
 
+/* Write max load predicted after the last balancing step, max load achieved
+   since then (measured force computation time) and migrated atoms into file*/
+void write_lbcost_file(int steps) {
+	str255 fname;
+	long migrated;
+
+	MPI_Reduce(&lb_migratedAtoms, &migrated, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	lb_migratedAtoms = 0;
+
+	if (myid == 0) {
+		if (NULL == lbcost_file) {
+			if (snprintf(fname, sizeof(str255), "%s.lbcost", outfilename) 
+			    >= sizeof(str255))
+				error_str("Output file name too long: %s", fname);
+			lbcost_file = fopen(fname, "w");
+			if (NULL == lbcost_file)
+				error_str("Cannot open load balancer cost file %s", fname);
+			fprintf(lbcost_file, "# step predicted_max achieved_max next_max migrated (load measure %d)\n",
+					lb_loadMeasure);
+		}
+
+		fprintf(lbcost_file, "%i %f %f %f %ld\n", steps, lb_predictedMaxLoad,
+				lb_achievedMaxLoad, lb_maxLoad, migrated);
+		fflush(lbcost_file);
+	}
+}
+
 void write_lb_status(int nr)
 {
   write_config_select(nr,"lb",write_config_lb,write_header_lb);
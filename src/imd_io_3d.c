@@ -20,6 +20,7 @@
 ******************************************************************************/
 
 #include "imd.h"
+#include "numparse.h"
 
 /******************************************************************************
 *
@@ -50,6 +51,9 @@ void read_atoms(str255 infilename)
   long addnumber = 0;
   int  p=0, k, maxc1=0, maxc2, count_atom;
   int  i, s, n, to_cpu, have_header=0, count;
+  int  coll_read=0, j=0, nread=0;
+  int  *col_num=NULL, *col_typ=NULL, *col_cnt=NULL;
+  double   *col_dat=NULL;
   vektor   pos, axe;
   ivektor  cellc;
   real     m, d[MAX_ITEMS_CONFIG];
@@ -117,6 +121,26 @@ void read_atoms(str255 infilename)
   /* size of temporary input buffers */
   if (inp_grp_size > 1) inbuf_size /= (sizeof(real) * (inp_grp_size-1)); 
 
+  /* files in column layout (parallel_output 2), and with parallel_input 2
+     also ASCII files, are read by all CPUs together */
+  if (0==myid) {
+    infile = fopen(infilename,"r");
+    if (NULL!=infile) {
+      fclose(infile);
+      infile = NULL;
+      have_header = read_header(&info, infilename);
+      if (have_header) 
+        coll_read = ((info.format=='S') || (info.format=='s'));
+      if ((2==parallel_input) && ((0==have_header) || (info.format=='A')))
+        coll_read = 1;
+    }
+  }
+  MPI_Bcast( &coll_read, 1, MPI_INT, 0, MPI_COMM_WORLD); 
+  if (coll_read) {
+    MPI_Bcast( &have_header, 1, MPI_INT, 0, MPI_COMM_WORLD); 
+    if (have_header) broadcast_header(&info);
+  } else
+
 #ifndef BG
   /* Try opening first a per cpu file - not supported on BlueGene/L */
   if (1==parallel_input) {
@@ -143,14 +167,14 @@ void read_atoms(str255 infilename)
     return;
   }
 
-  if (NULL==infile) {
+  if ((NULL==infile) && (0==coll_read)) {
     infile = fopen(infilename,"r");
     if (NULL==infile) error_str("File %s not found", infilename);
     have_header = read_header( &info, infilename );
   }
 
   /* allocate temporary input buffer */
-  if (inp_grp_size > 1) {
+  if ((inp_grp_size > 1) || (coll_read)) {
     input_buf = (msgbuf *) malloc( num_cpus * sizeof(msgbuf) );
     if (NULL==input_buf) error("cannot allocate input buffers");
     input_buf[0].data  = NULL;
@@ -161,11 +185,11 @@ void read_atoms(str255 infilename)
       input_buf[i].n     = 0;
       input_buf[i].n_max = 0;
 #ifdef BG
-      if ((i != myid) && ((parallel_input==0) || (my_inp_grp == io_grps[i])))
+      if ((i != myid) && ((parallel_input!=1) || (my_inp_grp == io_grps[i])))
 #else
       if (i != myid)
 #endif
-        alloc_msgbuf(input_buf+i, inbuf_size);
+        alloc_msgbuf(input_buf+i, coll_read ? 64 * atom_size : inbuf_size);
     }
   }
 
@@ -174,6 +198,8 @@ void read_atoms(str255 infilename)
   infile = fopen(infilename, "r");
   if (NULL==infile) error_str("File %s not found", infilename);
   have_header = read_header(&info, infilename);
+  if ((have_header) && ((info.format=='S') || (info.format=='s')))
+    error("Configuration files in column layout require MPI");
 
 #endif /* MPI or not MPI */
 
@@ -212,6 +238,18 @@ void read_atoms(str255 infilename)
 #endif
   }
 
+#ifdef MPI
+  /* read my share of the atoms, if all CPUs read together */
+  if (coll_read) {
+    if (info.format=='A')
+      nread = read_atoms_ascii(infilename, &info, 
+                               &col_num, &col_typ, &col_dat, &col_cnt);
+    else
+      nread = read_atoms_mpiio(infilename, &info, 
+                               &col_num, &col_typ, &col_dat);
+  }
+#endif
+
   /* Set up 1 atom input cell */
   input = (cell *) malloc(sizeof(cell));
   if (0==input) error("Cannot allocate input cell.");
@@ -225,7 +263,7 @@ void read_atoms(str255 infilename)
 #endif
 
   /* read away header; if have_header==2, header is in separate file */
-  if (have_header==1) {
+  if ((have_header==1) && (0==coll_read)) {
     do {
       char *s;
       s=fgets(buf,sizeof(buf),infile);
@@ -233,27 +271,26 @@ void read_atoms(str255 infilename)
   }
 
   /* Read the input file line by line */
-  while(!feof(infile)) {
-
+  while ((coll_read) ? (j < nread) : !feof(infile)) {
+
+    /* atoms read in advance, by all CPUs together */
+    if (coll_read) {
+      n = col_num[j];
+      s = col_typ[j];
+      p = (col_cnt) ? col_cnt[j] : info.n_items;
+      for (k=0; k < info.n_items-2; k++) 
+        d[k] = (real) col_dat[k * nread + j];
+      j++;
+    }
     /* ASCII input */
-    if (info.format == 'A') {
+    else if (info.format == 'A') {
       p = 1;
       if (NULL==fgets(buf,sizeof(buf),infile)) p=0;
       /* eat comments */
       while (('#'==buf[0]) && !feof(infile))
         if (NULL==fgets(buf,sizeof(buf),infile)) p=0;
       if (p==0) break;
-#ifdef DOUBLE
-      p = sscanf( buf,
-       "%d %d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
-        &n,&s,&d[0],&d[1],&d[2],&d[3],&d[4],&d[5],&d[6],&d[7],&d[8],
-        &d[9],&d[10],&d[11],&d[12],&d[13],&d[14],&d[15]);
-#else
-      p = sscanf( buf,
-       "%d %d %f %f %f %f %f %f %f %f %f %f %f %f %f %f %f %f",
-        &n,&s,&d[0],&d[1],&d[2],&d[3],&d[4],&d[5],&d[6],&d[7],&d[8],
-        &d[9],&d[10],&d[11],&d[12],&d[13],&d[14],&d[15]);
-#endif
+      p = parse_config_line(buf, &n, &s, d, MAX_ITEMS_CONFIG);
     }
     /* double precision input */
     else if ((info.format=='B') || (info.format=='L')) {
@@ -436,11 +473,15 @@ void read_atoms(str255 infilename)
 #ifdef MPI
 
       /* to_cpu is in my input group, but not myself */
-      if ((inp_grp_size > 1) && (myid != to_cpu)) {
+      if (((inp_grp_size > 1) || (coll_read)) && (myid != to_cpu)) {
         b = input_buf + to_cpu;
         if (b->data != NULL) {
           copy_atom_cell_buf(b, to_cpu, input, 0);
-          if (b->n_max - b->n < atom_size) {
+          /* if all CPUs read, all buffers are sent at the end */
+          if ((coll_read) && (b->n_max - b->n < atom_size)) {
+            realloc_msgbuf(b, 2 * b->n_max);
+          }
+          else if (b->n_max - b->n < atom_size) {
             MPI_Send(b->data, b->n, REAL, to_cpu, INBUF_TAG, cpugrid);
             b->n = 0;
           }
@@ -486,10 +527,40 @@ void read_atoms(str255 infilename)
       }
     } /* (p>0) */
   } /* !feof(infile) */
-  fclose(infile);  
+  if (infile) fclose(infile);  
 
 #ifdef MPI
-  if (inp_grp_size > 1) {
+  if (coll_read) {
+    send_input_atoms(input_buf);
+    for (s=0; s<num_cpus; s++)
+      if (input_buf[s].data) free_msgbuf(input_buf+s);
+    free(input_buf);
+    free(col_num);
+    free(col_typ);
+    free(col_dat);
+    free(col_cnt);
+    /* read_atoms_cleanup adds up the atoms only with parallel_input 1 */
+    if (1!=parallel_input) {
+      long tmp;
+      MPI_Reduce( &natoms,  &tmp, 1, MPI_LONG, MPI_SUM, 0, cpugrid);
+      natoms = tmp;
+      MPI_Reduce( &nactive, &tmp, 1, MPI_LONG, MPI_SUM, 0, cpugrid);
+      nactive = tmp;
+#ifdef UNIAX
+      MPI_Reduce( &nactive_rot, &tmp, 1, MPI_LONG, MPI_SUM, 0, cpugrid);
+      nactive_rot = tmp;
+#endif
+      for (i=0; i<ntypes; i++) {
+        MPI_Reduce( &num_sort[i], &tmp, 1, MPI_LONG, MPI_SUM, 0, cpugrid);
+        num_sort[i] = tmp;
+      }
+      for (i=0; i<vtypes; i++) {
+        MPI_Reduce( &num_vsort[i], &tmp, 1, MPI_LONG, MPI_SUM, 0, cpugrid);
+        num_vsort[i] = tmp;
+      }
+    }
+  }
+  else if (inp_grp_size > 1) {
     /* The last buffer is sent with a different tag, which tells the
        target CPU that reading is finished; we increase the size by
        one, so that the buffer is sent even if it is empty */
@@ -683,130 +754,314 @@ void recv_atoms(void)
   free_msgbuf(&b);
 }
 
-#endif /* MPI */ 
+/******************************************************************************
+*
+*  read_atoms_mpiio reads my share of the atoms from a file in column
+*  layout (see write_config_mpiio), collectively with all other CPUs;
+*  the atoms are divided evenly, independent of who wrote them.
+*  Returns the number of atoms read.
+*
+******************************************************************************/
 
+int read_atoms_mpiio(str255 infilename, header_info_t *info, 
+                     int **num, int **typ, double **dat)
+{
+  MPI_File   fh;
+  MPI_Status status;
+  MPI_Offset size;
+  FILE       *infile;
+  char       line[1024];
+  long long  hlen=0, rec, ntot, nfirst;
+  int        i, k, n, ncols = info->n_items - 2;
+
+  /* the data starts after the endheader line */
+  if (0==myid) {
+    infile = fopen(infilename,"r");
+    if (NULL==infile) error_str("File %s not found", infilename);
+    do {
+      if (NULL==fgets(line, sizeof(line), infile)) 
+        error_str("No endheader line in %s", infilename);
+    } while ((line[0]!='#') || (line[1]!='E'));
+    hlen = ftell(infile);
+    fclose(infile);
+  }
+  MPI_Bcast( &hlen, 1, MPI_LONG_LONG, 0, cpugrid);
+
+  /* file errors are returned, not fatal */
+  if (MPI_SUCCESS != MPI_File_open( cpugrid, infilename, MPI_MODE_RDONLY, 
+                                    MPI_INFO_NULL, &fh ))
+    error_str("File %s not found", infilename);
+  if (MPI_SUCCESS != MPI_File_get_size( fh, &size ))
+    error_str("Cannot read file %s", infilename);
+  rec  = 2 * sizeof(int) + ncols * sizeof(double);
+  if ((size - hlen) % rec != 0) 
+    error_str("File %s has incomplete columns", infilename);
+  ntot   = (size - hlen) / rec;
+  nfirst = (ntot * myid) / num_cpus;
+  n      = (int) ((ntot * (myid+1)) / num_cpus - nfirst);
+
+  *num = (int    *) malloc( MAX(n,1) * sizeof(int) );
+  *typ = (int    *) malloc( MAX(n,1) * sizeof(int) );
+  *dat = (double *) malloc( MAX(n,1) * ncols * sizeof(double) );
+  if ((NULL==*num) || (NULL==*typ) || (NULL==*dat))
+    error("cannot allocate column buffers");
+
+  if (MPI_SUCCESS != MPI_File_read_at_all( fh, hlen + nfirst * sizeof(int), 
+                                           *num, n, MPI_INT, &status ))
+    error_str("Cannot read file %s", infilename);
+  if (MPI_SUCCESS != MPI_File_read_at_all( fh, 
+                       hlen + (ntot + nfirst) * sizeof(int), 
+                       *typ, n, MPI_INT, &status ))
+    error_str("Cannot read file %s", infilename);
+  for (k=0; k<ncols; k++)
+    if (MPI_SUCCESS != MPI_File_read_at_all( fh, hlen + 2 * ntot * sizeof(int) 
+                         + (k * ntot + nfirst) * sizeof(double),
+                         *dat + k*n, n, MPI_DOUBLE, &status ))
+      error_str("Cannot read file %s", infilename);
+  MPI_File_close( &fh );
+
+  if (info->endian != is_big_endian) {
+    for (i=0; i<n; i++) {
+      (*num)[i] = SwappedInteger((*num)[i]);
+      (*typ)[i] = SwappedInteger((*typ)[i]);
+    }
+    for (i=0; i<n*ncols; i++) (*dat)[i] = SwappedDouble((*dat)[i]);
+  }
+  return n;
+}
 
 /******************************************************************************
 *
-*  filter function for write_config_select
-*  writes data of all atoms for checkpoints
+*  read_atoms_ascii reads my share of the atoms from an ASCII file,
+*  collectively with all other CPUs (parallel_input 2). Each CPU takes
+*  the lines beginning in its part of the file, divided evenly by bytes.
+*  Comment and header lines are skipped. The values are stored in the
+*  same column layout as with read_atoms_mpiio, together with the number
+*  of items in each line. Returns the number of atoms read.
 *
 ******************************************************************************/
 
-void write_atoms_config(FILE *out)
+int read_atoms_ascii(str255 infilename, header_info_t *info, 
+                     int **num, int **typ, double **dat, int **cnt)
 {
-  int i, k, n, len=0;
-  i_or_r *data;
-#ifdef CNA
-  int crist, nn, nn_other, nn_1421, nn_1422;
-#endif
+  FILE      *infile;
+  char      buf[1024];
+  long long size, lo, hi, pos;
+  int       c, i, k, n=0, n_max=0, ncols = info->n_items - 2;
+  real      d[MAX_ITEMS_CONFIG];
+  double    *rows=NULL;
+
+  infile = fopen(infilename,"r");
+  if (NULL==infile) error_str("File %s not found", infilename);
+  setvbuf(infile, NULL, _IOFBF, 1048576);
+  fseeko(infile, 0, SEEK_END);
+  size = ftello(infile);
+  lo   = (size * myid    ) / num_cpus;
+  hi   = (size * (myid+1)) / num_cpus;
+
+  /* the first line beginning at or after lo is mine */
+  pos = 0;
+  fseeko(infile, 0, SEEK_SET);
+  if (lo > 0) {
+    fseeko(infile, lo-1, SEEK_SET);
+    pos = lo-1;
+    do { c = getc(infile); pos++; } while ((c != '\n') && (c != EOF));
+  }
 
-#ifdef HPO
-#define RESOL1 " %12.16f"
-#define RESOL2 " %12.16f %12.16f"
-#define RESOL3 " %12.16f %12.16f %12.16f"
-#else
-#define RESOL1 " %f"
-#define RESOL2 " %f %f"
-#define RESOL3 " %f %f %f"
-#endif
+  *num = NULL;
+  *typ = NULL;
+  *cnt = NULL;
+  while ((pos < hi) && (NULL != fgets(buf, sizeof(buf), infile))) {
+    pos += strlen(buf);
+    if ('#'==buf[0]) continue;
+    if (n == n_max) {
+      n_max = MAX(1024, 2 * n_max);
+      *num = (int    *) realloc( *num, n_max * sizeof(int) );
+      *typ = (int    *) realloc( *typ, n_max * sizeof(int) );
+      *cnt = (int    *) realloc( *cnt, n_max * sizeof(int) );
+      rows = (double *) realloc( rows, n_max * ncols * sizeof(double) );
+      if ((NULL==*num) || (NULL==*typ) || (NULL==*cnt) || (NULL==rows))
+        error("cannot allocate input columns");
+    }
+    (*cnt)[n] = parse_config_line(buf, *num + n, *typ + n, d, 
+                                  MIN(ncols, MAX_ITEMS_CONFIG));
+    if ((*cnt)[n] <= 0) continue;   /* empty line */
+    for (k=0; k<ncols; k++) 
+      rows[n * ncols + k] = (k < (*cnt)[n] - 2) ? d[k] : 0.0;
+    n++;
+  }
+  fclose(infile);
+
+  /* to column layout */
+  *dat = (double *) malloc( MAX(n,1) * ncols * sizeof(double) );
+  if (NULL==*dat) error("cannot allocate input columns");
+  for (i=0; i<n; i++)
+    for (k=0; k<ncols; k++)
+      (*dat)[k * n + i] = rows[i * ncols + k];
+  free(rows);
+  return n;
+}
+
+/******************************************************************************
+*
+*  send_input_atoms sends the atoms in the input buffers to their
+*  owners, and inserts the atoms received; all CPUs take part
+*
+******************************************************************************/
+
+void send_input_atoms(msgbuf *input_buf)
+{
+  MPI_Request *req;
+  msgbuf      *recv_buf;
+  int         *nsend, *nrecv, i, m=0;
+
+  nsend    = (int *) calloc( num_cpus, sizeof(int) );
+  nrecv    = (int *) calloc( num_cpus, sizeof(int) );
+  recv_buf = (msgbuf *) calloc( num_cpus, sizeof(msgbuf) );
+  req      = (MPI_Request *) malloc( 2 * num_cpus * sizeof(MPI_Request) );
+  if ((NULL==nsend) || (NULL==nrecv) || (NULL==recv_buf) || (NULL==req))
+    error("cannot allocate input buffers");
+
+  for (i=0; i<num_cpus; i++) 
+    if (input_buf[i].data) nsend[i] = input_buf[i].n;
+  MPI_Alltoall( nsend, 1, MPI_INT, nrecv, 1, MPI_INT, cpugrid );
+
+  for (i=0; i<num_cpus; i++) {
+    if (nrecv[i] > 0) {
+      alloc_msgbuf(recv_buf+i, nrecv[i]);
+      irecv_buf(recv_buf+i, i, req + m++);
+    }
+    if (nsend[i] > 0) isend_buf(input_buf+i, i, req + m++);
+  }
+  MPI_Waitall( m, req, MPI_STATUSES_IGNORE );
+
+  for (i=0; i<num_cpus; i++) {
+    if (nrecv[i] > 0) {
+      recv_buf[i].n = nrecv[i];
+      process_buffer(recv_buf+i);
+      free_msgbuf(recv_buf+i);
+    }
+  }
+  free(nsend);
+  free(nrecv);
+  free(recv_buf);
+  free(req);
+}
+
+#endif /* MPI */ 
 
-  for (k=0; k<NCELLS; k++) {
-    cell *p;
-    p = CELLPTR(k);
-    for (i=0; i<p->n; i++) {
 
 #ifdef CNA
-      if (cna_crist>0) {
-	nn_other = MARK(p,i) % 100; 
-	nn_1422  = ( MARK(p,i) / 100 ) % 100;
-	nn_1421  = ( MARK(p,i) / 10000 ) % 100;
-	nn       = nn_1421 + nn_1422 + nn_other;
-	  
-	/* fcc */
-	if ( nn == 12 && nn_1421 == 12 )
-	  crist = 0;
-	/* hcp */
-	else if ( nn == 12 && nn_1421 == 6 && nn_1422 == 6 )
-	  crist = 1;
-	/* other 12 */
-	else if ( nn == 12 )
-	  crist = 2;
-	/* other */
-	else
-	  crist = 3;
-      }
+
+/******************************************************************************
+*
+*  config_crist classifies atom i in cell p from its CNA signature:
+*  0 fcc, 1 hcp, 2 other 12-fold coordinated, 3 other
+*
+******************************************************************************/
+
+int config_crist(cell *p, int i)
+{
+  int nn, nn_other, nn_1421, nn_1422;
+
+  nn_other = MARK(p,i) % 100; 
+  nn_1422  = ( MARK(p,i) / 100 ) % 100;
+  nn_1421  = ( MARK(p,i) / 10000 ) % 100;
+  nn       = nn_1421 + nn_1422 + nn_other;
+
+  /* fcc */
+  if ( nn == 12 && nn_1421 == 12 )
+    return 0;
+  /* hcp */
+  else if ( nn == 12 && nn_1421 == 6 && nn_1422 == 6 )
+    return 1;
+  /* other 12 */
+  else if ( nn == 12 )
+    return 2;
+  /* other */
+  else
+    return 3;
+}
+
 #endif
 
-      if (binary_output) {
-        n = 0;
-        data = (i_or_r *) (outbuf+len);
+/******************************************************************************
+*
+*  pack_atom_config stores the checkpoint data of atom i in cell p
+*  in binary form; returns the number of items written to data
+*
+******************************************************************************/
+
+int pack_atom_config(i_or_r *data, cell *p, int i)
+{
+  int n = 0;
+
 #ifdef DOUBLE
-        data[n  ].i[0] = NUMMER(p,i);
-        data[n++].i[1] = VSORTE(p,i);
+  data[n  ].i[0] = NUMMER(p,i);
+  data[n++].i[1] = VSORTE(p,i);
 #else
-        data[n++].i    = NUMMER(p,i);
-        data[n++].i    = VSORTE(p,i);
+  data[n++].i    = NUMMER(p,i);
+  data[n++].i    = VSORTE(p,i);
 #endif
-        data[n++].r = MASSE(p,i);
-        data[n++].r = ORT(p,i,X);
-        data[n++].r = ORT(p,i,Y);
+  data[n++].r = MASSE(p,i);
+  data[n++].r = ORT(p,i,X);
+  data[n++].r = ORT(p,i,Y);
 #ifndef TWOD
-        data[n++].r = ORT(p,i,Z);
+  data[n++].r = ORT(p,i,Z);
 #endif
 #ifdef UNIAX
-        data[n++].r = ACHSE(p,i,X);
-        data[n++].r = ACHSE(p,i,Y);
-        data[n++].r = ACHSE(p,i,Z);
+  data[n++].r = ACHSE(p,i,X);
+  data[n++].r = ACHSE(p,i,Y);
+  data[n++].r = ACHSE(p,i,Z);
 #endif
-        if (ensemble != ENS_CG) {
-          data[n++].r = (IMPULS(p,i,X) / MASSE(p,i));
-          data[n++].r = (IMPULS(p,i,Y) / MASSE(p,i));
+  if (ensemble != ENS_CG) {
+    data[n++].r = (IMPULS(p,i,X) / MASSE(p,i));
+    data[n++].r = (IMPULS(p,i,Y) / MASSE(p,i));
 #ifndef TWOD
-          data[n++].r = (IMPULS(p,i,Z) / MASSE(p,i));
+    data[n++].r = (IMPULS(p,i,Z) / MASSE(p,i));
 #endif
-	}
+  }
 #ifdef UNIAX
-        data[n++].r = DREH_IMPULS(p,i,X) / uniax_inert;
-        data[n++].r = DREH_IMPULS(p,i,Y) / uniax_inert;
-        data[n++].r = DREH_IMPULS(p,i,Z) / uniax_inert; 
+  data[n++].r = DREH_IMPULS(p,i,X) / uniax_inert;
+  data[n++].r = DREH_IMPULS(p,i,Y) / uniax_inert;
+  data[n++].r = DREH_IMPULS(p,i,Z) / uniax_inert; 
 #endif
-        data[n++].r = POTENG(p,i);
+  data[n++].r = POTENG(p,i);
 #if defined(VARCHG) || defined(EWALD) || defined(USEFCS)
-        data[n++].r = CHARGE(p,i);
+  data[n++].r = CHARGE(p,i);
 #endif
 #ifdef NNBR
-        data[n++].r = (real) NBANZ(p,i);
+  data[n++].r = (real) NBANZ(p,i);
 #endif
 #ifdef REFPOS
-        data[n++].r = REF_POS(p,i,X);
-        data[n++].r = REF_POS(p,i,Y);
+  data[n++].r = REF_POS(p,i,X);
+  data[n++].r = REF_POS(p,i,Y);
 #ifndef TWOD
-        data[n++].r = REF_POS(p,i,Z);
+  data[n++].r = REF_POS(p,i,Z);
 #endif
 #endif
 #ifdef DISLOC
-        data[n++].r = ORT_REF(p,i,X);
-        data[n++].r = ORT_REF(p,i,Y);
+  data[n++].r = ORT_REF(p,i,X);
+  data[n++].r = ORT_REF(p,i,Y);
 #ifndef TWOD
-        data[n++].r = ORT_REF(p,i,Z);
+  data[n++].r = ORT_REF(p,i,Z);
 #endif
-        data[n++].r = EPOT_REF(p,i);
+  data[n++].r = EPOT_REF(p,i);
 #endif
 #if defined(EAM2) && !defined(NORHOH)
-        data[n++].r = EAM_RHO(p,i);
+  data[n++].r = EAM_RHO(p,i);
 #ifdef EEAM
-        data[n++].r = EAM_P(p,i);
+  data[n++].r = EAM_P(p,i);
 #endif
 #endif
 #ifdef DAMP
-        data[n++].r = DAMPF(p,i);
+  data[n++].r = DAMPF(p,i);
 #endif
 #ifdef ADA
 #ifdef DOUBLE
-        data[n++].i[0] = ADATYPE(p,i);
+  data[n++].i[0] = ADATYPE(p,i);
 #else
-        data[n++].i = ADATYPE(p,i);
+  data[n++].i = ADATYPE(p,i);
 #endif
 #endif
 #ifdef NYETENSOR
@@ -824,9 +1079,8 @@ void write_atoms_config(FILE *out)
 		}
 #endif
 #ifdef CNA
-	if (cna_crist>0) {	  
-	  data[n++].r = (real) crist;
-	}
+  if (cna_crist>0) 
+    data[n++].r = (real) config_crist(p,i);
 #endif
 #ifdef LOADBALANCE
 	if (lb_writeStatus)
@@ -835,104 +1089,156 @@ void write_atoms_config(FILE *out)
 #ifdef VISCOUS
 	 data[n++].r = p->viscous_friction[i];
 #endif
-        len += n * sizeof(i_or_r);
-      }
-      else {
-        len += sprintf(outbuf+len, "%d %d", NUMMER(p,i), VSORTE(p,i));
-        len += sprintf(outbuf+len, RESOL1, MASSE(p,i));
+  return n;
+}
+
+/******************************************************************************
+*
+*  format_atom_config writes the checkpoint data of atom i in cell p
+*  to buf, in binary or ASCII form; returns the number of bytes written
+*
+******************************************************************************/
+
+int format_atom_config(char *buf, cell *p, int i)
+{
+  int n, len=0;
+#ifdef CNA
+  int crist;
+#endif
+
+#ifdef HPO
+#define RESOL1 " %12.16f"
+#define RESOL2 " %12.16f %12.16f"
+#define RESOL3 " %12.16f %12.16f %12.16f"
+#else
+#define RESOL1 " %f"
+#define RESOL2 " %f %f"
+#define RESOL3 " %f %f %f"
+#endif
+
+#ifdef CNA
+  if (cna_crist>0) crist = config_crist(p,i);
+#endif
+
+  if (binary_output) {
+    n = pack_atom_config((i_or_r *) (buf+len), p, i);
+    len += n * sizeof(i_or_r);
+  }
+  else {
+    len += sprintf(buf+len, "%d %d", NUMMER(p,i), VSORTE(p,i));
+    len += sprintf(buf+len, RESOL1, MASSE(p,i));
 #ifdef TWOD
-        len += sprintf(outbuf+len, 
-          RESOL2, ORT(p,i,X), ORT(p,i,Y) );
+    len += sprintf(buf+len, 
+      RESOL2, ORT(p,i,X), ORT(p,i,Y) );
 #else
-        len += sprintf(outbuf+len, 
-          RESOL3, ORT(p,i,X), ORT(p,i,Y), ORT(p,i,Z) );
+    len += sprintf(buf+len, 
+      RESOL3, ORT(p,i,X), ORT(p,i,Y), ORT(p,i,Z) );
 #endif
 #ifdef UNIAX
-        len += sprintf(outbuf+len, 
-          RESOL3, ACHSE(p,i,X), ACHSE(p,i,Y), ACHSE(p,i,Z) );
+    len += sprintf(buf+len, 
+      RESOL3, ACHSE(p,i,X), ACHSE(p,i,Y), ACHSE(p,i,Z) );
 #endif
 #ifdef TWOD
-        if (ensemble != ENS_CG)
-          len += sprintf(outbuf+len, RESOL2,
-            IMPULS(p,i,X) / MASSE(p,i), 
-            IMPULS(p,i,Y) / MASSE(p,i) );
+    if (ensemble != ENS_CG)
+      len += sprintf(buf+len, RESOL2,
+        IMPULS(p,i,X) / MASSE(p,i), 
+        IMPULS(p,i,Y) / MASSE(p,i) );
 #else
-        if (ensemble != ENS_CG)
-          len += sprintf(outbuf+len, RESOL3,
-            IMPULS(p,i,X) / MASSE(p,i), 
-            IMPULS(p,i,Y) / MASSE(p,i), 
-            IMPULS(p,i,Z) / MASSE(p,i) );
+    if (ensemble != ENS_CG)
+      len += sprintf(buf+len, RESOL3,
+        IMPULS(p,i,X) / MASSE(p,i), 
+        IMPULS(p,i,Y) / MASSE(p,i), 
+        IMPULS(p,i,Z) / MASSE(p,i) );
 #endif
 #ifdef UNIAX
-        len += sprintf(outbuf+len, RESOL3,
-          DREH_IMPULS(p,i,X) / uniax_inert,
-          DREH_IMPULS(p,i,Y) / uniax_inert,
-          DREH_IMPULS(p,i,Z) / uniax_inert ); 
+    len += sprintf(buf+len, RESOL3,
+      DREH_IMPULS(p,i,X) / uniax_inert,
+      DREH_IMPULS(p,i,Y) / uniax_inert,
+      DREH_IMPULS(p,i,Z) / uniax_inert ); 
 #endif
-        len += sprintf(outbuf+len, RESOL1, POTENG(p,i));
+    len += sprintf(buf+len, RESOL1, POTENG(p,i));
 #if defined(VARCHG) || defined(EWALD) || defined(USEFCS)
-        len += sprintf(outbuf+len, RESOL1, CHARGE(p,i));
+    len += sprintf(buf+len, RESOL1, CHARGE(p,i));
 #endif
 #ifdef NNBR
-        len += sprintf(outbuf+len, " %d",  NBANZ(p,i));
+    len += sprintf(buf+len, " %d",  NBANZ(p,i));
 #endif
 #ifdef REFPOS
 #ifdef TWOD
-        len += sprintf(outbuf+len, 
-          RESOL2, REF_POS(p,i,X), REF_POS(p,i,Y));
+    len += sprintf(buf+len, 
+      RESOL2, REF_POS(p,i,X), REF_POS(p,i,Y));
 #else
-        len += sprintf(outbuf+len, 
-          RESOL3, REF_POS(p,i,X), REF_POS(p,i,Y), REF_POS(p,i,Z));
+    len += sprintf(buf+len, 
+      RESOL3, REF_POS(p,i,X), REF_POS(p,i,Y), REF_POS(p,i,Z));
 #endif
 #endif
 #ifdef DISLOC
 #ifdef TWOD
-        len += sprintf(outbuf+len, 
-          RESOL2, ORT_REF(p,i,X), ORT_REF(p,i,Y));
+    len += sprintf(buf+len, 
+      RESOL2, ORT_REF(p,i,X), ORT_REF(p,i,Y));
 #else
-        len += sprintf(outbuf+len, 
-          RESOL3, ORT_REF(p,i,X), ORT_REF(p,i,Y), ORT_REF(p,i,Z));
+    len += sprintf(buf+len, 
+      RESOL3, ORT_REF(p,i,X), ORT_REF(p,i,Y), ORT_REF(p,i,Z));
 #endif
-        len += sprintf(outbuf+len, RESOL1, EPOT_REF(p,i));
+    len += sprintf(buf+len, RESOL1, EPOT_REF(p,i));
 #endif
 #if defined(EAM2) && !defined(NORHOH)
-        len += sprintf(outbuf+len, RESOL1, EAM_RHO(p,i));
+    len += sprintf(buf+len, RESOL1, EAM_RHO(p,i));
 #ifdef EEAM
-        len += sprintf(outbuf+len, RESOL1, EAM_P(p,i));
+    len += sprintf(buf+len, RESOL1, EAM_P(p,i));
 #endif
 #endif
 #if defined(DIPOLE) || defined(KERMODE)
-	len += sprintf(outbuf+len, RESOL3, 
+	len += sprintf(buf+len, RESOL3, 
 		       DP_P_IND(p,i,X), DP_P_IND(p,i,Y), DP_P_IND(p,i,Z)); 
 #endif	/* DIPOLE */
 #ifdef DAMP
-        len += sprintf(outbuf+len, RESOL1, DAMPF(p,i));
+    len += sprintf(buf+len, RESOL1, DAMPF(p,i));
 #endif
 #ifdef ADA
-        len += sprintf(outbuf+len, " %d", ADATYPE(p,i));
+    len += sprintf(buf+len, " %d", ADATYPE(p,i));
 #endif
 #ifdef NYETENSOR
-        nyeTensorInfo *info = NYE(p,i);
-       	if (info != NULL) {
-       		len += sprintf(outbuf+len, RESOL3, info->ls[0], info->ls[1], info->ls[2] );
-       		len += sprintf(outbuf+len, RESOL3, info->bv[0], info->bv[1], info->bv[2] );
-       	} else {
-       		len += sprintf(outbuf + len," 0. 0. 0. 0. 0. 0.");
-       	}
+    nyeTensorInfo *info = NYE(p,i);
+   	if (info != NULL) {
+   		len += sprintf(buf+len, RESOL3, info->ls[0], info->ls[1], info->ls[2] );
+   		len += sprintf(buf+len, RESOL3, info->bv[0], info->bv[1], info->bv[2] );
+   	} else {
+   		len += sprintf(buf + len," 0. 0. 0. 0. 0. 0.");
+   	}
 #endif
 #ifdef CNA
 	if (cna_crist>0) 
-	  len += sprintf(outbuf+len, " %d", crist);
+	  len += sprintf(buf+len, " %d", crist);
 #endif
 #ifdef LOADBALANCE
 	if (lb_writeStatus)
-		len += sprintf(outbuf+len, " %i", myid);
+		len += sprintf(buf+len, " %i", myid);
 #endif
 #ifdef VISCOUS
-		len += sprintf(outbuf+len, RESOL1, p->viscous_friction[i]);
+		len += sprintf(buf+len, RESOL1, p->viscous_friction[i]);
 #endif
-        len += sprintf(outbuf+len,"\n");
-      }
+    len += sprintf(buf+len,"\n");
+  }
+  return len;
+}
+
+/******************************************************************************
+*
+*  filter function for write_config_select
+*  writes data of all atoms for checkpoints
+*
+******************************************************************************/
+
+void write_atoms_config(FILE *out)
+{
+  int i, k, len=0;
+
+  for (k=0; k<NCELLS; k++) {
+    cell *p;
+    p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      len += format_atom_config(outbuf+len, p, i);
       /* flush or send outbuf if it is full */
       if (len > outbuf_size - 256) flush_outbuf(out,&len,OUTBUF_TAG);
     }
@@ -956,6 +1262,10 @@ void write_itr_file(int fzhlr, int steps, char *suffix)
     if (fzhlr>=0) sprintf(fname,"%s.%05d.%sitr",outfilename,fzhlr,suffix);
     else          sprintf(fname,"%s-final.%sitr",outfilename,suffix);
   }
+  /* checkpoint still being written, see wait_config_async */
+  else if (strcasecmp(suffix,"part")==0) {
+    config_file_name(fname, fzhlr, "itr", ".part");
+  }
   else {
     if (fzhlr>=0)       sprintf(fname,"%s.%05d.itr",outfilename,fzhlr);
     else if (fzhlr==-1) sprintf(fname,"%s-final.itr",outfilename);
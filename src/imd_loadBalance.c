@@ -241,6 +241,29 @@ void init_loadBalance() {
 		}
 	}
 
+	if (lb_balancingType == 3){
+		if (global_cell_dim.x < LB_MIN_CELLS * cpu_dim.x ||
+				global_cell_dim.y < LB_MIN_CELLS * cpu_dim.y ||
+				global_cell_dim.z < LB_MIN_CELLS * cpu_dim.z)
+			error("lb_balancingType 3 requires at least two cells per CPU in each direction");
+
+		x_bounds = malloc((cpu_dim.x+1) * sizeof *x_bounds);
+		y_bounds = malloc(cpu_dim.x*(cpu_dim.y+1) * sizeof *y_bounds);
+		z_bounds = malloc(cpu_dim.x*cpu_dim.y*(cpu_dim.z+1) * sizeof *z_bounds);
+		if (x_bounds == NULL || y_bounds == NULL || z_bounds == NULL)
+			error("Cannot allocate bounds for recursive bisection");
+
+		/* Initially, the domains are those of the regular CPU grid */
+		for (i=0; i<=cpu_dim.x;i++)
+			x_bounds[i] = global_cell_dim.x/cpu_dim.x*i;
+		for (x=0; x<cpu_dim.x; x++)
+			for (i=0; i<=cpu_dim.y;i++)
+				y_bounds[x*(cpu_dim.y+1)+i] = global_cell_dim.y/cpu_dim.y*i;
+		for (x=0; x<cpu_dim.x*cpu_dim.y; x++)
+			for (i=0; i<=cpu_dim.z;i++)
+				z_bounds[x*(cpu_dim.z+1)+i] = global_cell_dim.z/cpu_dim.z*i;
+	}
+
 	if (lb_balancingType == 2){
 		x_bounds = malloc((cpu_dim.x+1) * sizeof *x_bounds);
 		y_bounds = malloc((cpu_dim.y+1) * sizeof *y_bounds);
@@ -281,6 +304,10 @@ int balanceLoad(real (*getLoad)(void), vektor (*getCog)(void), int reset, int cy
 
 	vektor oldPositions[8];
 
+	/* Recursive bisection finds the new domains in one step */
+	if (lb_balancingType == 3)
+		return balanceBisection();
+
 	for (i=0; i<8;i++){
 		oldPositions[i].x = lb_domain.corners[i].p.x;
 		oldPositions[i].y = lb_domain.corners[i].p.y;
@@ -884,10 +911,20 @@ cell* lb_accessCell(cell* cellArray, int x, int y, int z, ivektor cellDim){
 }
 
 real lb_getLoad(){
-	real load = lb_countAtoms();
-	/*Scale load, in case of an evenly distribution, each cpu has a load of exactly 1.*/
-	load *= (cpu_dim.x*cpu_dim.y*cpu_dim.z) / (real)natoms;
-	return load;
+	real load, total;
+	if (lb_loadMeasure == 0){
+		load = lb_countAtoms();
+		/*Scale load, in case of an evenly distribution, each cpu has a load of exactly 1.*/
+		load *= (cpu_dim.x*cpu_dim.y*cpu_dim.z) / (real)natoms;
+		return load;
+	}
+	/* Measured time or cost model, both extrapolated from the cells in the current domain */
+	load = lb_getCost();
+	if (lb_loadMeasure == 1) load *= lb_costRate;
+	MPI_Allreduce(&load, &total, 1, REAL, MPI_SUM, MPI_COMM_WORLD);
+	/*Scale load, the average load is exactly 1.*/
+	if (total <= 0.) return 1.;
+	return load * (cpu_dim.x*cpu_dim.y*cpu_dim.z) / total;
 }
 
 void lb_makeNormals(lb_domainInfo *dom){
@@ -1248,6 +1285,83 @@ int lb_countAtoms(){
 	return n;
 }
 
+/**
+ * Cost model of a real cell: the number of atom pairs between the cell and
+ * the 27 cells around it (including itself). Cells of other CPUs, whose
+ * copies may be outdated during balancing, are assumed to be as dense as the
+ * cell itself; cells outside a non-periodic box are empty.
+ */
+real lb_getCellCost(int x, int y, int z){
+	cell *c, *nb;
+	int i,j,k;
+	real n = 0.;
+
+	c = PTR_3D_V(cell_array, x, y, z, cell_dim);
+	if (c->n == 0) return 0.;
+	for (i = -1; i <= 1; i++)
+		for (j = -1; j <= 1; j++)
+			for (k = -1; k <= 1; k++){
+				nb = lb_accessCell(cell_array, x+i, y+j, z+k, cell_dim);
+				if (nb != NULL && nb->lb_cell_type == LB_REAL_CELL)
+					n += nb->n;
+				else if (nb == NULL || nb->lb_cell_type != LB_NON_PBC_BUFFER_CELL)
+					n += c->n;
+			}
+	return c->n * n;
+}
+
+/**
+ * Load of a real cell according to lb_loadMeasure, not normalized
+ */
+real lb_getCellLoad(int x, int y, int z){
+	cell *c = PTR_3D_V(cell_array, x, y, z, cell_dim);
+	if (lb_loadMeasure == 0) return c->n;
+	if (lb_loadMeasure == 1) return lb_costRate * lb_getCellCost(x, y, z);
+	return lb_getCellCost(x, y, z);
+}
+
+/**
+ * Return the cost model summed over the real cells in this domain
+ */
+real lb_getCost(){
+	int x, y, z;
+	real cost = 0.;
+	for (x=0; x<cell_dim.x; ++x)
+		for (y=0; y<cell_dim.y; ++y)
+			for (z=0; z<cell_dim.z; ++z)
+				if (PTR_3D_V(cell_array, x, y, z, cell_dim)->lb_cell_type == LB_REAL_CELL)
+					cost += lb_getCellCost(x, y, z);
+	return cost;
+}
+
+/**
+ * Measure the time spent in the force computation (including neighbor
+ * lists) since the last call, without communication and without waiting
+ * for other CPUs. Sets the maximum normalized load of this interval, and
+ * the time per cost unit of this CPU, used by lb_loadMeasure 1.
+ */
+void lb_measureLoad(){
+	double work, maxWork, loc[2], sum[2];
+
+	work = (time_forces.total - lb_lastForceTime) - (time_comm.total - lb_lastCommTime);
+	if (work < 0.) work = 0.;
+	lb_lastForceTime = time_forces.total;
+	lb_lastCommTime  = time_comm.total;
+
+	loc[0] = work;
+	loc[1] = lb_getCost();
+	MPI_Allreduce(loc, sum, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Allreduce(&work, &maxWork, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+	if (sum[0] <= 0.) return;		/* nothing measured yet */
+	lb_achievedMaxLoad = maxWork * (cpu_dim.x*cpu_dim.y*cpu_dim.z) / sum[0];
+	/* CPUs without atoms get the average rate */
+	if (loc[1] > 0.)
+		lb_costRate = work / loc[1];
+	else if (sum[1] > 0.)
+		lb_costRate = sum[0] / sum[1];
+}
+
 void lb_computeVariance(){
 	int i;
 	real load = lb_getLoad();
@@ -1281,9 +1395,9 @@ void lb_computeVariance(){
 void balanceOrtho(){
 	int i,x,y,z;
 
-	int *x_count_local = malloc(global_cell_dim.x * sizeof *x_count_local);
-	int *y_count_local = malloc(global_cell_dim.y * sizeof *y_count_local);
-	int *z_count_local = malloc(global_cell_dim.z * sizeof *z_count_local);
+	long *x_count_local = malloc(global_cell_dim.x * sizeof *x_count_local);
+	long *y_count_local = malloc(global_cell_dim.y * sizeof *y_count_local);
+	long *z_count_local = malloc(global_cell_dim.z * sizeof *z_count_local);
 	for (i = 0; i<global_cell_dim.x; i++)
 		x_count_local[i] = 0;
 	for (i = 0; i<global_cell_dim.y; i++)
@@ -1291,21 +1405,35 @@ void balanceOrtho(){
 	for (i = 0; i<global_cell_dim.z; i++)
 		z_count_local[i] = 0;
 
-	//count & reduce number of atoms in each cell layer
+	/* Other load measures are converted to integer weights, */
+	/* LB_COST_UNITS per atom on average; the sums are long, */
+	/* as LB_COST_UNITS * natoms may exceed the range of int */
+	real scale = 1.;
+	if (lb_loadMeasure != 0){
+		real load = lb_getCost(), total;
+		if (lb_loadMeasure == 1) load *= lb_costRate;
+		MPI_Allreduce(&load, &total, 1, REAL, MPI_SUM, MPI_COMM_WORLD);
+		scale = (total > 0.) ? LB_COST_UNITS * natoms / total : 0.;
+	}
+
+	//count & reduce number of atoms (or load units) in each cell layer
 	for (x=1; x<cell_dim.x-1; ++x){
 		for (y=1; y<cell_dim.y-1; ++y){
 			for (z=1; z<cell_dim.z-1; ++z){
 				cell *c = PTR_3D_V(cell_array, x, y, z, cell_dim);
 				if (c->lb_cell_type == LB_REAL_CELL){
-					x_count_local[x+lb_cell_offset.x]+=c->n;
-					y_count_local[y+lb_cell_offset.y]+=c->n;
-					z_count_local[z+lb_cell_offset.z]+=c->n;
+					long w = c->n;
+					if (lb_loadMeasure != 0)
+						w = (long) (scale * lb_getCellLoad(x, y, z) + 0.5);
+					x_count_local[x+lb_cell_offset.x]+=w;
+					y_count_local[y+lb_cell_offset.y]+=w;
+					z_count_local[z+lb_cell_offset.z]+=w;
 				}
 			}
 		}
 	}
 
-	int *x_count = NULL ,*y_count = NULL, *z_count = NULL;
+	long *x_count = NULL ,*y_count = NULL, *z_count = NULL;
 	if (myid==0){
 		x_count = malloc(global_cell_dim.x * sizeof *x_count);
 		y_count = malloc(global_cell_dim.y * sizeof *y_count);
@@ -1313,9 +1441,9 @@ void balanceOrtho(){
 	}
 
 
-	MPI_Reduce(x_count_local, x_count, global_cell_dim.x, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
-	MPI_Reduce(y_count_local, y_count, global_cell_dim.y, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
-	MPI_Reduce(z_count_local, z_count, global_cell_dim.z, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Reduce(x_count_local, x_count, global_cell_dim.x, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Reduce(y_count_local, y_count, global_cell_dim.y, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Reduce(z_count_local, z_count, global_cell_dim.z, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
 	free(x_count_local);
 	free(y_count_local);
 	free(z_count_local);
@@ -1362,9 +1490,9 @@ void balanceOrtho(){
 	lb_updateDomain(&lb_domain);
 }
 
-void lb_balanceOneAxisOrthogonal(int numCellsInDirection, int numProcessorLayer, int* atomsPerCellLayer, int* bounds){
+void lb_balanceOneAxisOrthogonal(int numCellsInDirection, int numProcessorLayer, long* atomsPerCellLayer, int* bounds){
 	int i;
-	int remainingAtoms = 0;
+	long remainingAtoms = 0;
 
 	int *tmp_bounds = malloc((numProcessorLayer+1)*sizeof *tmp_bounds);
 
@@ -1375,8 +1503,8 @@ void lb_balanceOneAxisOrthogonal(int numCellsInDirection, int numProcessorLayer,
 		remainingAtoms+=atomsPerCellLayer[i];
 
 	for (i = 0; i<numProcessorLayer-1;i++){
-		int currentNumberOfAtoms = 0;
-		int targetNumberOfAtoms = remainingAtoms/(numProcessorLayer-i);
+		long currentNumberOfAtoms = 0;
+		long targetNumberOfAtoms = remainingAtoms/(numProcessorLayer-i);
 		int j;
 		for (j=tmp_bounds[i]; j<tmp_bounds[i+1];j++)
 			currentNumberOfAtoms += atomsPerCellLayer[j];
@@ -1384,8 +1512,8 @@ void lb_balanceOneAxisOrthogonal(int numCellsInDirection, int numProcessorLayer,
 		int newLayerPosition = tmp_bounds[i+1];
 		if (currentNumberOfAtoms < targetNumberOfAtoms){
 			if (numCellsInDirection-tmp_bounds[i+1]>numProcessorLayer-i){	//Leave enough cells for the following layers
-				int numberOfAtomsMovedUp = currentNumberOfAtoms+atomsPerCellLayer[tmp_bounds[i+1]+1];
-				if (abs(targetNumberOfAtoms-numberOfAtomsMovedUp) < abs(targetNumberOfAtoms-currentNumberOfAtoms)){
+				long numberOfAtomsMovedUp = currentNumberOfAtoms+atomsPerCellLayer[tmp_bounds[i+1]+1];
+				if (labs(targetNumberOfAtoms-numberOfAtomsMovedUp) < labs(targetNumberOfAtoms-currentNumberOfAtoms)){
 
 					newLayerPosition++;
 					remainingAtoms-=numberOfAtomsMovedUp;
@@ -1393,8 +1521,8 @@ void lb_balanceOneAxisOrthogonal(int numCellsInDirection, int numProcessorLayer,
 			} else remainingAtoms -= currentNumberOfAtoms;
 		} else {
 			if (tmp_bounds[i] != tmp_bounds[i+1]-1){	//Do not collapse the layer to zero
-				int numberOfAtomsMovedDown = currentNumberOfAtoms-atomsPerCellLayer[tmp_bounds[i+1]-1];
-				if (abs(targetNumberOfAtoms-numberOfAtomsMovedDown) < abs(targetNumberOfAtoms-currentNumberOfAtoms)){
+				long numberOfAtomsMovedDown = currentNumberOfAtoms-atomsPerCellLayer[tmp_bounds[i+1]-1];
+				if (labs(targetNumberOfAtoms-numberOfAtomsMovedDown) < labs(targetNumberOfAtoms-currentNumberOfAtoms)){
 					newLayerPosition--;
 					remainingAtoms-=numberOfAtomsMovedDown;
 				} else remainingAtoms -= currentNumberOfAtoms;
@@ -1410,3 +1538,219 @@ void lb_balanceOneAxisOrthogonal(int numCellsInDirection, int numProcessorLayer,
 	free(tmp_bounds);
 }
 
+/* Load balancing by hierarchical recursive bisection
+ * The box is cut into cpu_dim.x slabs along x, each slab independently into
+ * cpu_dim.y columns along y, and each column into cpu_dim.z domains along z.
+ * The cuts are placed on cell boundaries by recursive bisection of the load
+ * profile, so the new decomposition is found in a single step, no matter how
+ * far it is from the old one. The CPU at my_coord gets the domain at the same
+ * position in the hierarchy, atoms are then migrated directly to their new CPU.
+ */
+int balanceBisection(){
+	int i,x,y,z;
+	int slab, column;
+	cell *c, *cell_array_old;
+	ivektor lo, hi, lb_cell_offset_old, cell_dim_old;
+
+	int n = MAX(global_cell_dim.x, MAX(cpu_dim.x * global_cell_dim.y,
+			cpu_dim.x * cpu_dim.y * global_cell_dim.z));
+	real *load_local = malloc(n * sizeof *load_local);
+	real *load = malloc(n * sizeof *load);
+	if (load_local == NULL || load == NULL)
+		error("Cannot allocate load profiles in balanceBisection");
+
+	/* Cut the box into slabs */
+	for (i = 0; i<global_cell_dim.x; i++)
+		load_local[i] = 0.;
+	for (x=1; x<cell_dim.x-1; ++x)
+		for (y=1; y<cell_dim.y-1; ++y)
+			for (z=1; z<cell_dim.z-1; ++z)
+				if (PTR_3D_V(cell_array, x, y, z, cell_dim)->lb_cell_type == LB_REAL_CELL)
+					load_local[x+lb_cell_offset.x] += lb_getCellLoad(x, y, z);
+
+	MPI_Reduce(load_local, load, global_cell_dim.x, REAL, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (myid == 0)
+		lb_bisectLoad(load, 0, global_cell_dim.x, cpu_dim.x, x_bounds);
+	MPI_Bcast(x_bounds, cpu_dim.x+1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	/* Cut each slab into columns */
+	for (i = 0; i<cpu_dim.x*global_cell_dim.y; i++)
+		load_local[i] = 0.;
+	for (x=1; x<cell_dim.x-1; ++x)
+		for (y=1; y<cell_dim.y-1; ++y)
+			for (z=1; z<cell_dim.z-1; ++z)
+				if (PTR_3D_V(cell_array, x, y, z, cell_dim)->lb_cell_type == LB_REAL_CELL){
+					slab = lb_findInterval(x_bounds, cpu_dim.x, x+lb_cell_offset.x);
+					load_local[slab*global_cell_dim.y + y+lb_cell_offset.y] += lb_getCellLoad(x, y, z);
+				}
+
+	MPI_Reduce(load_local, load, cpu_dim.x*global_cell_dim.y, REAL, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (myid == 0)
+		for (slab = 0; slab<cpu_dim.x; slab++)
+			lb_bisectLoad(load + slab*global_cell_dim.y, 0, global_cell_dim.y, cpu_dim.y,
+					y_bounds + slab*(cpu_dim.y+1));
+	MPI_Bcast(y_bounds, cpu_dim.x*(cpu_dim.y+1), MPI_INT, 0, MPI_COMM_WORLD);
+
+	/* Cut each column into domains */
+	for (i = 0; i<cpu_dim.x*cpu_dim.y*global_cell_dim.z; i++)
+		load_local[i] = 0.;
+	for (x=1; x<cell_dim.x-1; ++x)
+		for (y=1; y<cell_dim.y-1; ++y)
+			for (z=1; z<cell_dim.z-1; ++z)
+				if (PTR_3D_V(cell_array, x, y, z, cell_dim)->lb_cell_type == LB_REAL_CELL){
+					slab = lb_findInterval(x_bounds, cpu_dim.x, x+lb_cell_offset.x);
+					column = slab*cpu_dim.y + lb_findInterval(y_bounds + slab*(cpu_dim.y+1),
+							cpu_dim.y, y+lb_cell_offset.y);
+					load_local[column*global_cell_dim.z + z+lb_cell_offset.z] += lb_getCellLoad(x, y, z);
+				}
+
+	MPI_Reduce(load_local, load, cpu_dim.x*cpu_dim.y*global_cell_dim.z, REAL, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (myid == 0)
+		for (column = 0; column<cpu_dim.x*cpu_dim.y; column++)
+			lb_bisectLoad(load + column*global_cell_dim.z, 0, global_cell_dim.z, cpu_dim.z,
+					z_bounds + column*(cpu_dim.z+1));
+	MPI_Bcast(z_bounds, cpu_dim.x*cpu_dim.y*(cpu_dim.z+1), MPI_INT, 0, MPI_COMM_WORLD);
+
+	free(load_local);
+	free(load);
+
+	/* The new domain of this CPU, in global cell indices */
+	column = my_coord.x*cpu_dim.y + my_coord.y;
+	lo.x = x_bounds[my_coord.x];
+	hi.x = x_bounds[my_coord.x+1];
+	lo.y = y_bounds[my_coord.x*(cpu_dim.y+1) + my_coord.y];
+	hi.y = y_bounds[my_coord.x*(cpu_dim.y+1) + my_coord.y+1];
+	lo.z = z_bounds[column*(cpu_dim.z+1) + my_coord.z];
+	hi.z = z_bounds[column*(cpu_dim.z+1) + my_coord.z+1];
+
+	for (i=0; i<8; i++){
+		lb_domain.corners[i].p.x = lb_cell_size.x * ((i&1)      ? hi.x : lo.x);
+		lb_domain.corners[i].p.y = lb_cell_size.y * (((i&2)>>1) ? hi.y : lo.y);
+		lb_domain.corners[i].p.z = lb_cell_size.z * (((i&4)>>2) ? hi.z : lo.z);
+	}
+	lb_updateDomain(&lb_domain);
+
+	/* New cell array, with one layer of buffer cells */
+	cell_array_old = cell_array;
+	lb_cell_offset_old = lb_cell_offset;
+	cell_dim_old = cell_dim;
+
+	lb_cell_offset.x = lo.x-1;
+	lb_cell_offset.y = lo.y-1;
+	lb_cell_offset.z = lo.z-1;
+	cell_dim.x = hi.x-lo.x+2;
+	cell_dim.y = hi.y-lo.y+2;
+	cell_dim.z = hi.z-lo.z+2;
+	cellmin.x = 1; cellmin.y = 1; cellmin.z = 1;
+	cellmax.x = cell_dim.x-1; cellmax.y = cell_dim.y-1; cellmax.z = cell_dim.z-1;
+
+	cell_array = malloc(cell_dim.x * cell_dim.y * cell_dim.z * sizeof *cell_array);
+	if (NULL == cell_array)
+		error("Cannot allocate memory for cells");
+	memset(cell_array, 0, cell_dim.x * cell_dim.y * cell_dim.z * sizeof *cell_array);
+
+	for (x=0; x<cell_dim.x; ++x){
+		for (y=0; y<cell_dim.y; ++y){
+			for (z=0; z<cell_dim.z; ++z){
+				c = PTR_3D_V(cell_array, x, y, z, cell_dim);
+				if (x>0 && x<cell_dim.x-1 && y>0 && y<cell_dim.y-1 && z>0 && z<cell_dim.z-1){
+					c->lb_cell_type = LB_REAL_CELL;
+					c->lb_cpu_affinity = myid;
+					c->lb_neighbor_index = -LB_REAL_CELL;
+				}
+			}
+		}
+	}
+	for (x=0; x<cell_dim.x; ++x){
+		for (y=0; y<cell_dim.y; ++y){
+			for (z=0; z<cell_dim.z; ++z){
+				c = PTR_3D_V(cell_array, x, y, z, cell_dim);
+				if (c->lb_cell_type != LB_REAL_CELL){
+					c->lb_cell_type = lb_identifyCellType(x,y,z);
+					c->lb_neighbor_index = -c->lb_cell_type;
+					c->lb_cpu_affinity = -1;
+				}
+			}
+		}
+	}
+
+	/* Cannot fail, every cell has exactly one owner */
+	if (!lb_syncBufferCellAffinity())
+		error("Load Balance: invalid decomposition in recursive bisection");
+
+	lb_migrateParticles(lb_cell_offset_old, cell_dim_old, cell_array_old);
+
+	for (x=0; x<cell_dim_old.x; ++x){
+		for (y=0; y<cell_dim_old.y; ++y){
+			for (z=0; z<cell_dim_old.z; ++z){
+				c = PTR_3D_V(cell_array_old, x, y, z, cell_dim_old);
+				alloc_cell( c, 0 );
+			}
+		}
+	}
+	free(cell_array_old);
+
+	make_cell_lists();
+
+#ifdef NBLIST
+	lb_need_nbl_update = 1;
+	have_valid_nbl = 0;
+#endif
+
+	setup_buffers();
+
+	return 1;
+}
+
+/* Split the cells [lo, hi) of a load profile into n intervals of about equal load
+ * by recursive bisection, each at least LB_MIN_CELLS wide. The n+1 interval
+ * bounds are stored in bounds. Among cuts of equal quality, the one closest to
+ * the geometric middle is taken, so that empty regions are split evenly.
+ */
+void lb_bisectLoad(real *load, int lo, int hi, int n, int *bounds){
+	int i, cut, best, mid;
+	int n1 = n/2;
+	real total = 0., sum = 0., target, diff, bestDiff;
+
+	bounds[0] = lo;
+	bounds[n] = hi;
+	if (n == 1) return;
+
+	for (i=lo; i<hi; i++)
+		total += load[i];
+	target = total * n1 / n;
+	mid = lo + (hi-lo) * n1 / n;
+
+	best = lo + LB_MIN_CELLS*n1;
+	for (i=lo; i<best; i++)
+		sum += load[i];
+	bestDiff = FABS(sum-target);
+
+	for (cut = best+1; cut <= hi - LB_MIN_CELLS*(n-n1); cut++){
+		sum += load[cut-1];
+		diff = FABS(sum-target);
+		if (diff < bestDiff || (diff == bestDiff && ABS(cut-mid) < ABS(best-mid))){
+			bestDiff = diff;
+			best = cut;
+		}
+	}
+
+	lb_bisectLoad(load, lo, best, n1, bounds);
+	lb_bisectLoad(load, best, hi, n-n1, bounds+n1);
+}
+
+/* Return k such that bounds[k] <= i < bounds[k+1] */
+int lb_findInterval(int *bounds, int n, int i){
+	int k = 0;
+	while (k < n-1 && i >= bounds[k+1]) k++;
+	return k;
+}
+
+/* Return the CPU owning the cell with the given global index in recursive bisection */
+int lb_bisectionOwner(int x, int y, int z){
+	ivektor coord;
+	coord.x = lb_findInterval(x_bounds, cpu_dim.x, x);
+	coord.y = lb_findInterval(y_bounds + coord.x*(cpu_dim.y+1), cpu_dim.y, y);
+	coord.z = lb_findInterval(z_bounds + (coord.x*cpu_dim.y+coord.y)*(cpu_dim.z+1), cpu_dim.z, z);
+	return *PTR_3D_VV(cpu_ranks, coord, cpu_dim);
+}
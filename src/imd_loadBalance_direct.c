@@ -12,6 +12,8 @@ void lb_initDirect() {
 			printf("LOAD BALANCING: Communication with any CPU enabled by \"lb_balancingType 1\"\n");
 		else if (lb_balancingType == 2)
 			printf("LOAD BALANCING: Balancing using orthogonal domains \"lb_balancingType 2\"\n");
+		else if (lb_balancingType == 3)
+			printf("LOAD BALANCING: Balancing by recursive bisection \"lb_balancingType 3\"\n");
 		else printf("LOAD BALANCING: Communication limited to direct neighbors by \"lb_balancingType 0\"\n");
 	}
 
@@ -182,6 +184,12 @@ int lb_syncBufferCellAffinity() {
 	for (i = 0; i < num_cpus; i++) {
 		numBufferCellsToCPU[i] = 0;
 		lutCommIndex[i] = -1;
+		/* In bisection, domains are not bound to the CPU grid, periodic images are found below */
+		if (lb_balancingType == 3){
+			lb_pbcFlag[i].x = 0;
+			lb_pbcFlag[i].y = 0;
+			lb_pbcFlag[i].z = 0;
+		}
 	}
 
 	int listNeighbors[26];
@@ -257,6 +265,17 @@ int lb_syncBufferCellAffinity() {
 					if (indexY >= global_cell_dim.y) {indexY -= global_cell_dim.y; pbcWrap.y = 1;}
 					if (indexZ >= global_cell_dim.z) {indexZ -= global_cell_dim.z; pbcWrap.z = 1;}
 
+					/* In bisection, the owner is known from the cuts directly */
+					if (lb_balancingType == 3){
+						cell->lb_cpu_affinity = lb_bisectionOwner(indexX, indexY, indexZ);
+						if (cell->lb_cell_type == LB_BUFFER_CELL){
+							lb_pbcFlag[cell->lb_cpu_affinity].x |= pbcWrap.x;
+							lb_pbcFlag[cell->lb_cpu_affinity].y |= pbcWrap.y;
+							lb_pbcFlag[cell->lb_cpu_affinity].z |= pbcWrap.z;
+						}
+						continue;
+					}
+
 					vektor center = lb_getCellCenter(indexX, indexY, indexZ);
 					int cellAssigned = 0;
 					for (j = 0; j < 26; j++) { /*Test first the 26 nearest neighbors */
@@ -505,7 +524,9 @@ int lb_syncBufferCellAffinity() {
 void send_cells(void (*copy_func)(int, int, int, int, int, int, vektor),
 		void (*pack_func)(msgbuf*, int, int, int, vektor),
 		void (*unpack_func)(msgbuf*, int, int, int)) {
+	imd_start_timer(&time_comm);
 	sync_cells_direct(*copy_func, *pack_func, *unpack_func, 0);
+	imd_stop_timer(&time_comm);
 }
 
 /******************************************************************************
@@ -525,6 +546,7 @@ void send_forces(void (*add_func)   (int, int, int, int, int, int),
 
 	MPI_Status stat;
 
+	imd_start_timer(&time_comm);
 	empty_mpi_buffers();
 	int offset = lb_nTotalComms - lb_nForceComms;
 
@@ -556,6 +578,7 @@ void send_forces(void (*add_func)   (int, int, int, int, int, int),
 		lb_requests[finished] = lb_requests[i-1];
 		lb_request_indices[finished] = lb_request_indices[i-1];
 	}
+	imd_stop_timer(&time_comm);
 }
 
 void sync_cells(void (*copy_func)(int, int, int, int, int, int, vektor),
@@ -897,6 +920,7 @@ void lb_relocateParticles(ivektor oldOffset, ivektor oldSize, cell* oldCells){
 
 					to_cpu = cell_new->lb_cpu_affinity;
 					buf = &sendBuf[to_cpu];
+					lb_migratedAtoms += cell_old->n;
 					for (i=0; i<cell_old->n; i++) {
 						copy_one_atom(buf, to_cpu, cell_old, i, 0);
 #ifdef CLONE
@@ -960,6 +984,126 @@ void lb_relocateParticles(ivektor oldOffset, ivektor oldSize, cell* oldCells){
 	free(numCellsToReceive);
 }
 
+/**
+ * Move all atoms to the new owners of their cells, after the domains have been
+ * changed arbitrarily (recursive bisection). The new cell_array must be set up
+ * already. Atoms are packed and unpacked as in send_atoms, but since the new owner
+ * need not be a communication partner, the number of atoms is exchanged first.
+ */
+void lb_migrateParticles(ivektor oldOffset, ivektor oldSize, cell* oldCells){
+	int x,y,z, i, k, to_cpu;
+	cell *cell_new, *cell_old;
+	int *numAtomsToSend = malloc(num_cpus*sizeof *numAtomsToSend);
+	int *numAtomsToReceive = malloc(num_cpus*sizeof *numAtomsToReceive);
+	if (numAtomsToSend == NULL || numAtomsToReceive == NULL)
+		error("Cannot allocate send/recv Buffer in lb_migrateParticles");
+
+	for (i = 0; i < num_cpus; i++)
+		numAtomsToSend[i] = 0;
+
+	/*Count how many atoms go to which CPU*/
+	for (x=1; x<oldSize.x-1; ++x){
+		for (y=1; y<oldSize.y-1; ++y){
+			for (z=1; z<oldSize.z-1; ++z){
+				cell_old = PTR_3D_V(oldCells, x, y, z, oldSize);
+				if (cell_old->lb_cell_type != LB_REAL_CELL) continue;
+				to_cpu = lb_bisectionOwner(x+oldOffset.x, y+oldOffset.y, z+oldOffset.z);
+				if (to_cpu != myid)
+					numAtomsToSend[to_cpu] += cell_old->n;
+			}
+		}
+	}
+	MPI_Alltoall(numAtomsToSend, 1, MPI_INT, numAtomsToReceive, 1, MPI_INT, MPI_COMM_WORLD);
+
+	/*Allocate buffer for send & receive*/
+	msgbuf *sendBuf = NULL;
+	memalloc(&sendBuf, num_cpus, sizeof(msgbuf), sizeof(void*), 0, 1, "sendBuf");
+	msgbuf *recvBuf = NULL;
+	memalloc(&recvBuf, num_cpus, sizeof(msgbuf), sizeof(void*), 0, 1, "recvBuf");
+	if (sendBuf == NULL || recvBuf == NULL)
+		error("Cannot allocate send/recv Buffer in lb_migrateParticles");
+
+	int totalOperations = 0;
+	for (i = 0; i < num_cpus; i++){
+		if (numAtomsToReceive[i] != 0) {
+			alloc_msgbuf(&recvBuf[i], atom_size*numAtomsToReceive[i]);
+			totalOperations++;
+		}
+		if (numAtomsToSend[i] != 0){
+			alloc_msgbuf(&sendBuf[i], atom_size*numAtomsToSend[i]);
+			totalOperations++;
+		}
+	}
+
+	/*Keep atoms staying on this CPU, put the others in the buffers*/
+	for (x=1; x<oldSize.x-1; ++x){
+		for (y=1; y<oldSize.y-1; ++y){
+			for (z=1; z<oldSize.z-1; ++z){
+				cell_old = PTR_3D_V(oldCells, x, y, z, oldSize);
+				if (cell_old->lb_cell_type != LB_REAL_CELL) continue;
+				to_cpu = lb_bisectionOwner(x+oldOffset.x, y+oldOffset.y, z+oldOffset.z);
+				if (to_cpu == myid){
+					cell_new = PTR_3D_V(cell_array, x+oldOffset.x-lb_cell_offset.x,
+							y+oldOffset.y-lb_cell_offset.y, z+oldOffset.z-lb_cell_offset.z, cell_dim);
+					alloc_cell(cell_new, cell_old->n_max);
+					for (i=0; i<cell_old->n; ++i){
+						copy_atom_cell_cell(cell_new, cell_new->n, cell_old, i);
+						++cell_new->n;
+					}
+				} else {
+					lb_migratedAtoms += cell_old->n;
+					for (i=0; i<cell_old->n; ++i)
+						copy_one_atom(&sendBuf[to_cpu], to_cpu, cell_old, i, 0);
+				}
+				alloc_cell(cell_old, 0);
+			}
+		}
+	}
+
+	/*Send/receive buffers*/
+	MPI_Request *requests = malloc(totalOperations * sizeof *requests);
+	int *indices = malloc(totalOperations * sizeof *indices);
+	MPI_Status stat;
+
+	k = 0;
+	for (i = 0; i < num_cpus; ++i) {
+		if (numAtomsToSend[i] != 0){
+			isend_buf(&sendBuf[i], i, &requests[k]);
+			indices[k++] = -1;
+		}
+		if (numAtomsToReceive[i] != 0){
+			irecv_buf(&recvBuf[i], i, &requests[k]);
+			indices[k++] = i;
+		}
+	}
+
+	/*Receive and process data as soon as something is available*/
+	for (i = totalOperations; i>0; i--){
+		int finished;
+		MPI_Waitany(i, requests, &finished, &stat);
+		int ind = indices[finished];
+		if (ind != -1){
+			MPI_Get_count(&stat, REAL, &recvBuf[ind].n);
+			process_buffer( &recvBuf[ind]);
+		}
+		requests[finished] = requests[i-1];
+		indices[finished] = indices[i-1];
+	}
+
+	free(requests);
+	free(indices);
+
+	/*Clean up*/
+	for (i = 0; i < num_cpus; i++){
+		if (numAtomsToReceive[i] != 0) free_msgbuf(&recvBuf[i]);
+		if (numAtomsToSend[i] != 0) free_msgbuf(&sendBuf[i]);
+	}
+	free(sendBuf);
+	free(recvBuf);
+	free(numAtomsToSend);
+	free(numAtomsToReceive);
+}
+
 
 int lb_isGeometryChangeValid(){
 	int i,j,k,x,y,z;
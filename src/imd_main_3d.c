@@ -386,7 +386,7 @@ int nyeDone;
 #endif
 #endif
 
-#ifdef TIMING
+#if defined(TIMING) || defined(LOADBALANCE)
     imd_start_timer(&time_forces);
 #endif
 #if defined (CG) && !defined(ACG)
@@ -419,7 +419,7 @@ int nyeDone;
 #ifdef FEFL
     calc_fefl();
 #endif
-#ifdef TIMING
+#if defined(TIMING) || defined(LOADBALANCE)
     imd_stop_timer(&time_forces);
 #endif
 
@@ -531,11 +531,11 @@ int nyeDone;
 
 #ifdef SM
 #ifdef NBLIST
-    if ((!sm_fixed_charges) && ((charge_update_steps > 0) && steps % charge_update_steps == 0)){
+    if (charge_update_due(steps)){
       charge_update_sm();
 	}
 #else
-    if ((!sm_fixed_charges) && ((charge_update_steps > 0) && steps % charge_update_steps == 0)){
+    if (charge_update_due(steps)){
       do_charge_update();
        }
 #endif
@@ -817,6 +817,7 @@ int nyeDone;
 
 #ifdef LOADBALANCE
     if (lb_frequency != 0 && steps % lb_frequency == 0 ) {
+    	lb_measureLoad();
     	lb_computeVariance();
     	
     	int balanced = 0;
@@ -862,6 +863,8 @@ int nyeDone;
     	}
 
     	write_lb_file(steps, balanced);
+    	write_lbcost_file(steps);
+    	lb_predictedMaxLoad = lb_maxLoad;
 
     	lb_stepsSinceReset++;
     }
@@ -21,6 +21,154 @@
 
 #include "imd.h"
 
+/* inner forces can be computed while the buffer cells are exchanged */
+#if !defined(SR) && !defined(LOADBALANCE)
+#define COMM_OVERLAP
+#endif
+
+/* number of cell pairs between checks for arrived messages */
+#define OVERLAP_CHUNK 64
+
+/******************************************************************************
+*
+*  clear_cell_acc - clear per atom accumulation variables of a cell
+*
+******************************************************************************/
+
+static void clear_cell_acc(cell *p)
+{
+  int i;
+
+  for (i=0; i<p->n; ++i) {
+    KRAFT(p,i,X) = 0.0;
+    KRAFT(p,i,Y) = 0.0;
+    KRAFT(p,i,Z) = 0.0;
+#ifdef UNIAX
+    DREH_MOMENT(p,i,X) = 0.0;
+    DREH_MOMENT(p,i,Y) = 0.0;
+    DREH_MOMENT(p,i,Z) = 0.0;
+#endif
+#if defined(STRESS_TENS)
+    PRESSTENS(p,i,xx) = 0.0;
+    PRESSTENS(p,i,yy) = 0.0;
+    PRESSTENS(p,i,zz) = 0.0;
+    PRESSTENS(p,i,yz) = 0.0;
+    PRESSTENS(p,i,zx) = 0.0;
+    PRESSTENS(p,i,xy) = 0.0;
+#endif      
+#ifndef MONOLJ
+    POTENG(p,i) = 0.0;
+#endif
+#ifdef NNBR
+    NBANZ(p,i) = 0;
+#endif
+#ifdef CNA
+    if (cna)
+      MARK(p,i) = 0;
+#endif
+#ifdef COVALENT
+    NEIGH(p,i)->n = 0;
+#endif
+#ifdef EAM2
+    EAM_RHO(p,i) = 0.0; /* zero host electron density at atom site */
+#ifdef EEAM
+    EAM_P(p,i) = 0.0; /* zero host electron density at atom site */
+#endif
+#endif
+  }
+}
+
+/******************************************************************************
+*
+*  buffer_cell - is cell k of cell_array a buffer cell?
+*
+******************************************************************************/
+
+static int buffer_cell(int k)
+{
+  int i = k / (cell_dim.y * cell_dim.z);
+  int j = (k / cell_dim.z) % cell_dim.y;
+  int l = k % cell_dim.z;
+
+  return (i==0) || (i==cell_dim.x-1) || (j==0) || (j==cell_dim.y-1) ||
+         (l==0) || (l==cell_dim.z-1);
+}
+
+/******************************************************************************
+*
+*  calc_pair_forces - compute forces for the pairs of cells in the lists,
+*  for all of them (sel==0), only for those between inner cells (sel==1),
+*  or only for those involving a buffer cell (sel==2). With sel==1, the
+*  buffer cell exchange in progress is driven on between chunks of pairs,
+*  by the master thread of a single parallel region per list.
+*  With eam2, the second EAM2 loop is done. With eam2_cache, the first
+*  EAM2 loop stores the atom pairs of each cell pair for the second one.
+*
+******************************************************************************/
+
+static void calc_pair_forces(int sel, int eam2)
+{
+  int n, k, k0;
+
+  for (n=0; n<nlists; ++n) {
+    int chunk = (sel==1) ? OVERLAP_CHUNK : MAX(npairs[n], 1);
+#ifdef _OPENMP
+#pragma omp parallel private(k0,k) \
+  reduction(+:tot_pot_energy,virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy)
+#endif
+    for (k0=0; k0<npairs[n]; k0+=chunk) {
+      int k1 = MIN(k0 + chunk, npairs[n]);
+#ifdef _OPENMP
+#pragma omp for schedule(runtime)
+#endif
+      for (k=k0; k<k1; ++k) {
+        vektor pbc;
+        pair *P;
+        P = pairs[n] + k;
+        if (sel && ((sel==2) != (buffer_cell(P->np) || buffer_cell(P->nq))))
+          continue;
+        pbc.x = P->ipbc[0]*box_x.x + P->ipbc[1]*box_y.x + P->ipbc[2]*box_z.x;
+        pbc.y = P->ipbc[0]*box_x.y + P->ipbc[1]*box_y.y + P->ipbc[2]*box_z.y;
+        pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
+#ifdef EAM2_CACHE
+        if (eam2_cache) {
+          if (eam2)
+            do_forces_eam2_cache(cell_array + P->np, cell_array + P->nq, pbc,
+              eam2_pcache[n] + k, 
+              &virial, &vir_xx, &vir_yy, &vir_zz, &vir_yz, &vir_zx, &vir_xy);
+          else
+            do_forces_cache(cell_array + P->np, cell_array + P->nq, pbc,
+              eam2_pcache[n] + k, 
+              &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
+                                        &vir_yz, &vir_zx, &vir_xy);
+          continue;
+        }
+#endif
+#ifdef EAM2
+        if (eam2)
+          do_forces_eam2(cell_array + P->np, cell_array + P->nq, pbc,
+            &virial, &vir_xx, &vir_yy, &vir_zz, &vir_yz, &vir_zx, &vir_xy);
+        else
+#endif
+        do_forces(cell_array + P->np, cell_array + P->nq, pbc,
+                  &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
+                                            &vir_yz, &vir_zx, &vir_xy);
+      }
+#ifdef COMM_OVERLAP
+      if (sel==1) {
+#ifdef _OPENMP
+#pragma omp master
+#endif
+        send_cells_test();
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+      }
+#endif
+    }
+  }
+}
+
 /******************************************************************************
 *
 * calc_forces 
@@ -41,15 +189,29 @@
 *      that are on the upper surface
 * iv)  or send forces back and add them
 *
+* With comm_overlap, the forces between inner cells are computed while
+* the buffer cells are being filled, and those involving buffer cells
+* afterwards. The same is done in the second EAM2 loop.
+*
 ******************************************************************************/
 
 void calc_forces(int steps)
 {
-  int n, k;
+  int k;
+#if defined(COVALENT) || !defined(AR)
+  int n;
+#endif
   real tmpvec1[8], tmpvec2[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
 
   /* fill the buffer cells */
   if ((steps == steps_min) || (0 == steps % BUFSTEP)) setup_buffers();
+#ifdef EAM2_CACHE
+  if (eam2_cache) alloc_eam2_cache();
+#endif
+#ifdef COMM_OVERLAP
+  if (comm_overlap) send_cells_begin(copy_cell,pack_cell,unpack_cell);
+  else
+#endif
   send_cells(copy_cell,pack_cell,unpack_cell);
 
   /* clear global accumulation variables */
@@ -63,51 +225,16 @@ void calc_forces(int steps)
   vir_xy = 0.0;
   nfc++;
 
-  /* clear per atom accumulation variables */
+  /* clear per atom accumulation variables, in buffer cells only
+     after they have been filled */
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
   for (k=0; k<nallcells; ++k) {
-    int  i;
-    cell *p;
-    p = cell_array + k;
-    for (i=0; i<p->n; ++i) {
-      KRAFT(p,i,X) = 0.0;
-      KRAFT(p,i,Y) = 0.0;
-      KRAFT(p,i,Z) = 0.0;
-#ifdef UNIAX
-      DREH_MOMENT(p,i,X) = 0.0;
-      DREH_MOMENT(p,i,Y) = 0.0;
-      DREH_MOMENT(p,i,Z) = 0.0;
-#endif
-#if defined(STRESS_TENS)
-      PRESSTENS(p,i,xx) = 0.0;
-      PRESSTENS(p,i,yy) = 0.0;
-      PRESSTENS(p,i,zz) = 0.0;
-      PRESSTENS(p,i,yz) = 0.0;
-      PRESSTENS(p,i,zx) = 0.0;
-      PRESSTENS(p,i,xy) = 0.0;
-#endif      
-#ifndef MONOLJ
-      POTENG(p,i) = 0.0;
-#endif
-#ifdef NNBR
-      NBANZ(p,i) = 0;
-#endif
-#ifdef CNA
-      if (cna)
-	MARK(p,i) = 0;
-#endif
-#ifdef COVALENT
-      NEIGH(p,i)->n = 0;
+#ifdef COMM_OVERLAP
+    if (comm_overlap && buffer_cell(k)) continue;
 #endif
-#ifdef EAM2
-      EAM_RHO(p,i) = 0.0; /* zero host electron density at atom site */
-#ifdef EEAM
-      EAM_P(p,i) = 0.0; /* zero host electron density at atom site */
-#endif
-#endif
-    }
+    clear_cell_acc(cell_array + k);
   }
 
 #ifdef RIGID
@@ -124,23 +251,20 @@ void calc_forces(int steps)
      loop acting on our local data cells */
 
   /* compute forces for all pairs of cells */
-  for (n=0; n<nlists; ++n) {
+#ifdef COMM_OVERLAP
+  if (comm_overlap) {
+    calc_pair_forces(1, 0);
+    send_cells_end();
 #ifdef _OPENMP
-#pragma omp parallel for schedule(runtime) \
-  reduction(+:tot_pot_energy,virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy)
+#pragma omp parallel for
 #endif
-    for (k=0; k<npairs[n]; ++k) {
-      vektor pbc;
-      pair *P;
-      P = pairs[n] + k;
-      pbc.x = P->ipbc[0]*box_x.x + P->ipbc[1]*box_y.x + P->ipbc[2]*box_z.x;
-      pbc.y = P->ipbc[0]*box_x.y + P->ipbc[1]*box_y.y + P->ipbc[2]*box_z.y;
-      pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
-      do_forces(cell_array + P->np, cell_array + P->nq, pbc,
-                &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
-                                          &vir_yz, &vir_zx, &vir_xy);
-    }
+    for (k=0; k<nallcells; ++k)
+      if (buffer_cell(k)) clear_cell_acc(cell_array + k);
+    calc_pair_forces(2, 0);
   }
+  else
+#endif
+  calc_pair_forces(0, 0);
 
 #ifdef COVALENT
   /* complete neighbor tables for remaining pairs of cells */
@@ -196,6 +320,14 @@ void calc_forces(int steps)
       pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
       /* potential energy and virial are already complete;          */
       /* to avoid double counting, we update only the dummy tmpvec2 */
+#ifdef EAM2_CACHE
+      if (eam2_cache)
+        do_forces_cache(cell_array + P->np, cell_array + P->nq, pbc,
+                  eam2_pcache[n] + k,
+                  tmpvec2, tmpvec2+1, tmpvec2+2, tmpvec2+3, tmpvec2+4,
+                                      tmpvec2+5, tmpvec2+6, tmpvec2+7);
+      else
+#endif
       do_forces(cell_array + P->np, cell_array + P->nq, pbc,
                 tmpvec2, tmpvec2+1, tmpvec2+2, tmpvec2+3, tmpvec2+4,
                                     tmpvec2+5, tmpvec2+6, tmpvec2+7);
@@ -211,25 +343,20 @@ void calc_forces(int steps)
 #endif
   /* compute embedding energy and its derivative */
   do_embedding_energy();
-  /* distribute derivative of embedding energy */
-  send_cells(copy_dF,pack_dF,unpack_dF);
-
-  /* second EAM2 loop over all cells pairs */
-  for (n=0; n<nlists; ++n) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(runtime) \
-  reduction(+:virial,vir_xx,vir_yy,vir_zz,vir_yz,vir_zx,vir_xy)
+  /* distribute derivative of embedding energy, and
+     second EAM2 loop over all cells pairs */
+#ifdef COMM_OVERLAP
+  if (comm_overlap) {
+    send_cells_begin(copy_dF,pack_dF,unpack_dF);
+    calc_pair_forces(1, 1);
+    send_cells_end();
+    calc_pair_forces(2, 1);
+  }
+  else
 #endif
-    for (k=0; k<npairs[n]; ++k) {
-      vektor pbc;
-      pair *P;
-      P = pairs[n]+k;
-      pbc.x = P->ipbc[0]*box_x.x + P->ipbc[1]*box_y.x + P->ipbc[2]*box_z.x;
-      pbc.y = P->ipbc[0]*box_x.y + P->ipbc[1]*box_y.y + P->ipbc[2]*box_z.y;
-      pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
-      do_forces_eam2(cell_array + P->np, cell_array + P->nq, pbc,
-        &virial, &vir_xx, &vir_yy, &vir_zz, &vir_yz, &vir_zx, &vir_xy);
-    }
+  {
+    send_cells(copy_dF,pack_dF,unpack_dF);
+    calc_pair_forces(0, 1);
   }
 
 #ifndef AR
@@ -251,6 +378,14 @@ void calc_forces(int steps)
       pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
       /* potential energy and virial are already complete;          */
       /* to avoid double counting, we update only the dummy tmpvec2 */
+#ifdef EAM2_CACHE
+      if (eam2_cache)
+        do_forces_eam2_cache(cell_array + P->np, cell_array + P->nq, pbc,
+                       eam2_pcache[n] + k,
+                       tmpvec2, tmpvec2+1, tmpvec2+2, tmpvec2+3, tmpvec2+4,
+                                           tmpvec2+5, tmpvec2+6, tmpvec2+7);
+      else
+#endif
       do_forces_eam2(cell_array + P->np, cell_array + P->nq, pbc,
                      tmpvec2, tmpvec2+1, tmpvec2+2, tmpvec2+3, tmpvec2+4,
                                          tmpvec2+5, tmpvec2+6, tmpvec2+7);
@@ -260,6 +395,14 @@ void calc_forces(int steps)
 
 #endif /* EAM2 */
 
+  /* k-space and self energy part of EWALD; the real space sum over
+     image boxes is not parallelized */
+#ifdef EWALD
+  if (ew_nmax >= 0)
+    error("option EWALD is only partially parallelized");
+  do_forces_ewald(steps);
+#endif
+
   /* sum up results of different CPUs */
   tmpvec1[0] = tot_pot_energy;
   tmpvec1[1] = virial;
@@ -270,7 +413,10 @@ void calc_forces(int steps)
   tmpvec1[6] = vir_zx;
   tmpvec1[7] = vir_xy;
 
+  /* waiting for slower CPUs is counted as communication */
+  imd_start_timer(&time_comm);
   MPI_Allreduce( tmpvec1, tmpvec2, 8, REAL, MPI_SUM, cpugrid); 
+  imd_stop_timer(&time_comm);
 
   tot_pot_energy = tmpvec2[0];
   virial         = tmpvec2[1];
@@ -32,6 +32,10 @@ void calc_forces(int steps)
 {
   int n, k;
 
+#ifdef EAM2_CACHE
+  if (eam2_cache) alloc_eam2_cache();
+#endif
+
   /* clear global accumulation variables */
   tot_pot_energy = 0.0;
   virial = 0.0;
@@ -119,6 +123,14 @@ void calc_forces(int steps)
       pbc.x = P->ipbc[0]*box_x.x + P->ipbc[1]*box_y.x + P->ipbc[2]*box_z.x;
       pbc.y = P->ipbc[0]*box_x.y + P->ipbc[1]*box_y.y + P->ipbc[2]*box_z.y;
       pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
+#ifdef EAM2_CACHE
+      if (eam2_cache)
+        do_forces_cache(cell_array + P->np, cell_array + P->nq, pbc,
+                  eam2_pcache[n] + k,
+                  &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
+                                            &vir_yz, &vir_zx, &vir_xy);
+      else
+#endif
       do_forces(cell_array + P->np, cell_array + P->nq, pbc,
                 &tot_pot_energy, &virial, &vir_xx, &vir_yy, &vir_zz,
                                           &vir_yz, &vir_zx, &vir_xy);
@@ -147,6 +159,13 @@ void calc_forces(int steps)
       pbc.x = P->ipbc[0]*box_x.x + P->ipbc[1]*box_y.x + P->ipbc[2]*box_z.x;
       pbc.y = P->ipbc[0]*box_x.y + P->ipbc[1]*box_y.y + P->ipbc[2]*box_z.y;
       pbc.z = P->ipbc[0]*box_x.z + P->ipbc[1]*box_y.z + P->ipbc[2]*box_z.z;
+#ifdef EAM2_CACHE
+      if (eam2_cache)
+        do_forces_eam2_cache(cell_array + P->np, cell_array + P->nq, pbc,
+          eam2_pcache[n] + k,
+          &virial, &vir_xx, &vir_yy, &vir_zz, &vir_yz, &vir_zx, &vir_xy);
+      else
+#endif
       do_forces_eam2(cell_array + P->np, cell_array + P->nq, pbc,
         &virial, &vir_xx, &vir_yy, &vir_zz, &vir_yz, &vir_zx, &vir_xy);
     }
@@ -780,6 +780,61 @@ void copy_atoms_buf(msgbuf *to, msgbuf *from)
   }
 }
 
+#if defined(MPI3) && !defined(TWOD) && !defined(LOADBALANCE)
+
+/******************************************************************************
+*
+* alloc_shm_buffers allocates the receive buffers for the buffer cells
+* in one shared memory window per node, for comm_mode 2. Neighbors on
+* the same node then write directly into them (see exchange_start).
+* This is collective on cpugrid_node, and the layout is the same on
+* all CPUs, so that a buffer has the same offset everywhere.
+*
+******************************************************************************/
+
+static void alloc_shm_buffers(int size_east, int size_north, int size_up)
+{
+  static int have_win = 0;
+  msgbuf   *b[6];
+  int      size[6], i, k, disp;
+  MPI_Aint len = 0, seg;
+  real     *p;
+
+  b[0] = &recv_buf_east;  size[0] = size_east;
+  b[1] = &recv_buf_west;  size[1] = size_east;
+  b[2] = &recv_buf_north; size[2] = size_north;
+  b[3] = &recv_buf_south; size[3] = size_north;
+  b[4] = &recv_buf_up;    size[4] = size_up;
+  b[5] = &recv_buf_down;  size[5] = size_up;
+  for (i=0; i<6; i++) len += size[i];
+
+  if (have_win) {
+    MPI_Win_unlock_all(shm_win);
+    MPI_Win_free(&shm_win);
+  }
+  MPI_Win_allocate_shared(len * sizeof(real), sizeof(real), MPI_INFO_NULL,
+                          cpugrid_node, &shm_my_base, &shm_win);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, shm_win);
+  have_win = 1;
+
+  p = shm_my_base;
+  for (i=0; i<6; i++) {
+    b[i]->data  = p;
+    b[i]->n     = 0;
+    b[i]->n_max = size[i];
+    p += size[i];
+  }
+  for (k=0; k<3; k++)
+    for (i=0; i<2; i++) {
+      shm_nb_base[k][i] = NULL;
+      if (nb_node_rank[k][i] != MPI_UNDEFINED)
+        MPI_Win_shared_query(shm_win, nb_node_rank[k][i], &seg, &disp, 
+                             &shm_nb_base[k][i]);
+    }
+}
+
+#endif
+
 /******************************************************************************
 *
 * setup_buffers sets up the send/receive buffers
@@ -902,20 +957,47 @@ void setup_buffers(void)
 
 #ifndef LOADBALANCE
 
+#if defined(MPI3) && !defined(TWOD)
+  /* receive buffers in shared memory */
+  if (comm_mode==2) {
+    if ((size_east  > send_buf_east.n_max ) || 
+        (size_north > send_buf_north.n_max) || 
+        (size_up    > send_buf_up.n_max   )) {
+      size_east  = MAX(size_east,  send_buf_east.n_max );
+      size_north = MAX(size_north, send_buf_north.n_max);
+      size_up    = MAX(size_up,    send_buf_up.n_max   );
+      alloc_shm_buffers(size_east, size_north, size_up);
+    }
+  }
+  else
+#endif
+  {
+    if (size_east > send_buf_east.n_max) {
+      alloc_msgbuf(&recv_buf_east, size_east);
+      alloc_msgbuf(&recv_buf_west, size_east);
+    }
+    if (size_north > send_buf_north.n_max) {
+      alloc_msgbuf(&recv_buf_north, size_north);
+      alloc_msgbuf(&recv_buf_south, size_north);
+    }
+#ifndef TWOD
+    if (size_up > send_buf_up.n_max) {
+      alloc_msgbuf(&recv_buf_up,   size_up);
+      alloc_msgbuf(&recv_buf_down, size_up);
+    }
+#endif
+  }
+
   /* Allocate east/west buffers */
   if (size_east > send_buf_east.n_max) {
     alloc_msgbuf(&send_buf_east, size_east);
     alloc_msgbuf(&send_buf_west, size_east);
-    alloc_msgbuf(&recv_buf_east, size_east);
-    alloc_msgbuf(&recv_buf_west, size_east);
   }
 
   /* Allocate north/south buffers */
   if (size_north > send_buf_north.n_max) {
     alloc_msgbuf(&send_buf_north, size_north);
     alloc_msgbuf(&send_buf_south, size_north);
-    alloc_msgbuf(&recv_buf_north, size_north);
-    alloc_msgbuf(&recv_buf_south, size_north);
   }
 
 #ifndef TWOD
@@ -923,8 +1005,6 @@ void setup_buffers(void)
   if (size_up > send_buf_up.n_max) {
     alloc_msgbuf(&send_buf_up,   size_up);
     alloc_msgbuf(&send_buf_down, size_up);
-    alloc_msgbuf(&recv_buf_up,   size_up);
-    alloc_msgbuf(&recv_buf_down, size_up);
   }
 #endif
 #else /*LOADBALANCE*/
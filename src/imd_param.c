@@ -539,10 +539,30 @@ int getparamfile(char *paramfname, int phase)
       /* margin of neighbor list */
       getparam(token,&nbl_margin,PARAM_REAL,1,1);
     }
+    else if (strcasecmp(token,"nbl_adapt")==0) {
+      /* adapt margin of neighbor list, at most nbl_margin */
+      getparam(token,&nbl_adapt,PARAM_INT,1,1);
+    }
     else if (strcasecmp(token,"nbl_size")==0) {
       /* size of neighbor list */
       getparam(token,&nbl_size,PARAM_REAL,1,1);
     }
+    else if (strcasecmp(token,"nbl_full")==0) {
+      /* use full neighbor lists */
+      getparam(token,&nbl_full,PARAM_INT,1,1);
+    }
+    else if (strcasecmp(token,"nbl_sort")==0) {
+      /* sort atoms in cells every nbl_sort neighbor list updates */
+      getparam(token,&nbl_sort,PARAM_INT,1,1);
+    }
+    else if (strcasecmp(token,"nbl_cluster")==0) {
+      /* cluster pair lists with clusters of 4 or 8 atoms */
+      getparam(token,&nbl_cluster,PARAM_INT,1,1);
+    }
+    else if (strcasecmp(token,"nbl_comm_lists")==0) {
+      /* update buffer cells with atom lists between list rebuilds */
+      getparam(token,&nbl_comm_lists,PARAM_INT,1,1);
+    }
 #endif
 #ifdef NEB
     else if (strcasecmp(token,"neb_nrep")==0) {
@@ -1269,6 +1289,12 @@ int getparamfile(char *paramfname, int phase)
       getparam(token,&outbuf_size,PARAM_INT,1,1);
       outbuf_size *= 1048576;
     }
+#ifdef ASYNC_CKPT
+    else if (strcasecmp(token,"async_checkpoint")==0) {
+      /* write checkpoints in background */
+      getparam(token,&async_checkpoint,PARAM_INT,1,1);
+    }
+#endif
     else if (strcasecmp(token,"inbuf_size")==0) {
       /* total input buffer size in MB */
       getparam(token,&inbuf_size,PARAM_INT,1,1);
@@ -1828,6 +1854,14 @@ int getparamfile(char *paramfname, int phase)
       /* security factor of message buffer size */
       getparam(token,&msgbuf_size,PARAM_REAL,1,1);
     }
+    else if (strcasecmp(token,"comm_overlap")==0) {
+      /* compute inner forces while buffer cells are exchanged */
+      getparam(token,&comm_overlap,PARAM_INT,1,1);
+    }
+    else if (strcasecmp(token,"comm_mode")==0) {
+      /* buffer exchange by messages, neighborhood coll. or shared memory */
+      getparam(token,&comm_mode,PARAM_INT,1,1);
+    }
 #endif
     else if (strcasecmp(token,"binary_output")==0) {
       /* binary output flag */
@@ -2343,6 +2377,12 @@ else if (strcasecmp(token,"laser_rescale_mode")==0) {
 	  /* Load balancing strategy*/
 	  getparam("lb_balancingType",&lb_balancingType,PARAM_INT,1,1);
 	}
+	else if (strcasecmp(token, "lb_loadMeasure") == 0) {
+	  /* Load measure: 0 atoms, 1 measured force time, 2 cost model */
+	  getparam("lb_loadMeasure",&lb_loadMeasure,PARAM_INT,1,1);
+	  if ((lb_loadMeasure < 0) || (lb_loadMeasure > 2))
+	    error("lb_loadMeasure must be 0, 1 or 2");
+	}
 	else if (strcasecmp(token, "lb_iterationsPerReset") == 0) {
 	  /*  load balance minimum iteration between resets*/
 	  getparam("lb_iterationsPerReset",&lb_iterationsPerReset,PARAM_INT,1,1);
@@ -2612,6 +2652,12 @@ else if (strcasecmp(token,"laser_rescale_mode")==0) {
       /* EAM2:Filename for the tabulated atomic electron density(r_ij^2) */
       getparam("atomic_e-density_file",eam2_at_rho_filename,PARAM_STR,1,255);
     }
+#ifdef EAM2_CACHE
+    else if (strcasecmp(token,"eam2_cache")==0) {
+      /* EAM2: reuse rho_h derivatives of the first force loop */
+      getparam(token,&eam2_cache,PARAM_INT,1,1);
+    }
+#endif
 #ifdef EEAM
     else if (strcasecmp(token,"eeam_energy_file")==0) {
       /* EEAM:Filename for the tabulated energy modification term(p_h) */
@@ -2737,6 +2783,18 @@ else if (strcasecmp(token,"laser_rescale_mode")==0) {
       if (ntypes==0) error("specify parameter ntypes before pot_res");
       getparam(token, pot_res, PARAM_REAL, ntypepairs, ntypepairs);
     }
+    else if (strcasecmp(token,"pot_table_ferr")==0) {
+      /* maximal force error of the tables of analytic potentials */
+      getparam(token, &pot_table_ferr, PARAM_REAL, 1, 1);
+    }
+    else if (strcasecmp(token,"pot_table_emax")==0) {
+      /* force error is not checked where the potential exceeds this */
+      getparam(token, &pot_table_emax, PARAM_REAL, 1, 1);
+    }
+    else if (strcasecmp(token,"pot_table_file")==0) {
+      /* write table of analytic potentials to this file */
+      getparam(token, pot_table_file, PARAM_STR, 1, 255);
+    }
     /* Lennard-Jones */
     else if (strcasecmp(token,"lj_epsilon")==0) {
       if (ntypes==0) error("specify parameter ntypes before lj_epsilon");
@@ -3210,6 +3268,24 @@ else if (strcasecmp(token,"laser_rescale_mode")==0) {
     else if (strcasecmp(token,"ew_test")==0) {
       getparam(token,&ew_test,PARAM_INT,1,1);
     }
+    /* multiple time steps: k-space part only every respa_steps steps */
+    else if (strcasecmp(token,"respa_steps")==0) {
+      getparam(token,&respa_steps,PARAM_INT,1,1);
+    }
+#ifdef PME
+    /* particle mesh Ewald for the k-space part */
+    else if (strcasecmp(token,"ew_pme")==0) {
+      getparam(token,&ew_pme,PARAM_INT,1,1);
+    }
+    /* order of the PME B-splines */
+    else if (strcasecmp(token,"ew_pme_order")==0) {
+      getparam(token,&ew_pme_order,PARAM_INT,1,1);
+    }
+    /* PME mesh size */
+    else if (strcasecmp(token,"ew_pme_grid")==0) {
+      getparam(token,&ew_pme_grid,PARAM_INT,DIM,DIM);
+    }
+#endif
     /* potential table resolution */
     else if (strcasecmp(token,"coul_res")==0) {
       getparam(token,&coul_res,PARAM_REAL,1,1);
@@ -3590,6 +3666,50 @@ void check_parameters_complete()
     error("need a value for ep_rcut");
 #endif
 
+#ifdef NBLIST
+#if defined(COULOMB) || defined(COVALENT) || defined(KEATING) || \
+    defined(LOADBALANCE) || defined(FLAGEDATOMS) || defined(KIM)
+  if (nbl_full)
+    error("nbl_full is supported only for pair, EAM and ADP potentials");
+#endif
+  if ((nbl_cluster != 0) && (nbl_cluster != 4) && (nbl_cluster != 8))
+    error("nbl_cluster must be 0, 4 or 8");
+  if (nbl_cluster && nbl_full)
+    error("nbl_cluster and nbl_full cannot be combined");
+#ifndef COMM_LISTS
+  if (nbl_comm_lists)
+    error("nbl_comm_lists is not supported by this binary");
+#endif
+#endif
+
+#ifdef MPI
+#if defined(TWOD) || defined(NBLIST) || defined(SR) || defined(LOADBALANCE) || \
+    defined(VEC)
+  if (comm_overlap)
+    error("comm_overlap is not supported by this binary");
+#endif
+  if ((comm_mode < 0) || (comm_mode > 2))
+    error("comm_mode must be 0, 1 or 2");
+#if defined(TWOD) || defined(SR) || defined(LOADBALANCE) || !defined(MPI3)
+  if (comm_mode)
+    error("comm_mode 1 and 2 are not supported by this binary");
+#endif
+#endif
+
+#ifdef EWALD
+  if (respa_steps < 1)
+    error("respa_steps must be positive");
+  /* the slow force is an impulse, which only the plain integrators
+     can take as part of the force of a single step */
+  if ((respa_steps > 1) && (ensemble != ENS_NVE) && (ensemble != ENS_NVT))
+    error("respa_steps > 1 is supported only for ensembles nve and nvt");
+#ifdef SM
+  /* the charges may change only between two k-space evaluations */
+  if ((respa_steps > 1) && (charge_update_steps % respa_steps))
+    error("charge_update_steps must be a multiple of respa_steps");
+#endif
+#endif
+
 #if defined(FBC) || defined(RIGID) || defined(DEFORM)
   if (vtypes == 0)
     error("FBC, RIGID, and DEFORM require parameter total_types to be set");
@@ -4209,7 +4329,12 @@ void broadcast_params() {
   MPI_Bcast( gtypes, ntypes, MPI_INT,  0, MPI_COMM_WORLD);
 #ifdef NBLIST
   MPI_Bcast( &nbl_margin,    1, REAL, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &nbl_adapt,     1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &nbl_size,      1, REAL, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &nbl_full,      1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &nbl_sort,      1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &nbl_cluster,   1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &nbl_comm_lists, 1, MPI_INT, 0, MPI_COMM_WORLD);
 #endif
 #ifdef VEC
   MPI_Bcast( &atoms_per_cpu, 1, MPI_INT, 0, MPI_COMM_WORLD);
@@ -4261,6 +4386,8 @@ void broadcast_params() {
   MPI_Bcast( &outputgrpsize, 1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &parallel_input,  1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &msgbuf_size,     1, REAL,    0, MPI_COMM_WORLD);
+  MPI_Bcast( &comm_overlap,    1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &comm_mode,       1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &binary_output,   1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( outfilename,            255, MPI_CHAR, 0, MPI_COMM_WORLD);
   MPI_Bcast( infilename,             255, MPI_CHAR, 0, MPI_COMM_WORLD);
@@ -4271,6 +4398,9 @@ void broadcast_params() {
 #ifdef EAM2
   MPI_Bcast( eam2_emb_E_filename,    255, MPI_CHAR, 0, MPI_COMM_WORLD);
   MPI_Bcast( eam2_at_rho_filename,   255, MPI_CHAR, 0, MPI_COMM_WORLD);
+#ifdef EAM2_CACHE
+  MPI_Bcast( &eam2_cache,              1, MPI_INT,  0, MPI_COMM_WORLD);
+#endif
 #ifdef EEAM
   MPI_Bcast( eeam_mod_E_filename,    255, MPI_CHAR, 0, MPI_COMM_WORLD);
 #endif
@@ -4312,6 +4442,9 @@ void broadcast_params() {
   MPI_Bcast( &initsz,          1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &incrsz,          1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &outbuf_size,     1, MPI_INT, 0, MPI_COMM_WORLD);
+#ifdef ASYNC_CKPT
+  MPI_Bcast( &async_checkpoint, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
   MPI_Bcast( &inbuf_size,      1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &dist_chunk_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
@@ -4680,6 +4813,9 @@ void broadcast_params() {
   MPI_Bcast( r_cut_lin, ntypepairs, REAL, 0, MPI_COMM_WORLD);
   MPI_Bcast( r_begin,   ntypepairs, REAL, 0, MPI_COMM_WORLD);
   MPI_Bcast( pot_res,   ntypepairs, REAL, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &pot_table_ferr,   1, REAL, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &pot_table_emax,   1, REAL, 0, MPI_COMM_WORLD);
+  MPI_Bcast( pot_table_file,  255, MPI_CHAR, 0, MPI_COMM_WORLD);
   /* Lennard-Jones */
   MPI_Bcast( lj_epsilon_lin, ntypepairs, REAL, 0, MPI_COMM_WORLD);
   MPI_Bcast( lj_sigma_lin,   ntypepairs, REAL, 0, MPI_COMM_WORLD);
@@ -4795,6 +4931,7 @@ void broadcast_params() {
 #endif
 #ifdef SM
   MPI_Bcast( &sm_fixed_charges,        1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &charge_update_steps,     1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( sm_chi_0,            ntypes, REAL,    0, MPI_COMM_WORLD);
   MPI_Bcast( sm_J_0,              ntypes, REAL,    0, MPI_COMM_WORLD);
   MPI_Bcast( sm_Z,                ntypes, REAL,    0, MPI_COMM_WORLD);
@@ -4834,6 +4971,12 @@ void broadcast_params() {
   MPI_Bcast( &ew_kcut,            1,      REAL,    0, MPI_COMM_WORLD);
   MPI_Bcast( &ew_test,            1,      MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &ew_nmax,            1,      MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &respa_steps,        1,      MPI_INT, 0, MPI_COMM_WORLD);
+#ifdef PME
+  MPI_Bcast( &ew_pme,             1,      MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &ew_pme_order,       1,      MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &ew_pme_grid,        DIM,    MPI_INT, 0, MPI_COMM_WORLD);
+#endif
   MPI_Bcast( &coul_res,           1,      REAL,    0, MPI_COMM_WORLD);
   MPI_Bcast( &coul_begin,         1,      REAL,    0, MPI_COMM_WORLD);
 #endif
@@ -5102,6 +5245,7 @@ void broadcast_params() {
   MPI_Bcast( &lb_iterationsPerReset, 1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &lb_minStepsBetweenReset, 1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast( &lb_balancingType, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast( &lb_loadMeasure, 1, MPI_INT, 0, MPI_COMM_WORLD);
 #endif
 }
 
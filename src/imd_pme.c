@@ -0,0 +1,764 @@
+
+/******************************************************************************
+*
+* IMD -- The ITAP Molecular Dynamics Program
+*
+* Copyright 1996-2012 Institute for Theoretical and Applied Physics,
+* University of Stuttgart, D-70550 Stuttgart
+*
+******************************************************************************/
+
+/*****************************************************************************
+*
+* imd_pme -- smooth particle mesh Ewald (SPME) for the Fourier part
+*            of the Ewald sum
+*
+*  The charges are spread to a K1 x K2 x K3 mesh with cardinal B-splines
+*  of order ew_pme_order, the mesh is convolved with the influence function
+*  by 3D FFT, and potential and forces are interpolated back to the atoms
+*  (Essmann et al., J. Chem. Phys. 103, 8577 (1995)).
+*
+*  The mesh is distributed in slabs of z planes. Each CPU spreads its own
+*  atoms to a local patch of the mesh, which is sent to the slab owners;
+*  the FFT is done as 2D FFTs of the planes, a transpose to slabs of y
+*  planes, and 1D FFTs along z. No CPU holds the whole mesh or all atoms.
+*
+******************************************************************************/
+
+/******************************************************************************
+* $Revision$
+* $Date$
+******************************************************************************/
+
+#include "imd.h"
+
+#ifdef PME
+
+#define PME_MOD(i,K) ((((i) % (K)) + (K)) % (K))
+
+/* mesh and its distribution */
+static int    pme_K[3], pme_n;
+static int    *pme_z0, *pme_y0, *pme_zown;
+static int    pme_nz, pme_ny;
+static fftw_complex *pme_slab, *pme_pencil;
+static fftw_plan pme_plan_xy_f, pme_plan_xy_b, pme_plan_z_f, pme_plan_z_b;
+
+/* influence function, for the current box */
+static double *pme_bmod[3], *pme_G;
+static vektor pme_tbox[3];
+
+/* B-spline weights of the local atoms */
+static int    pme_nat, pme_nat_max;
+static int    *pme_base;
+static double *pme_q, *pme_th, *pme_dth;
+
+/* local patch of the mesh */
+static int    pme_lo[3], pme_np[3], pme_patch_max;
+static double *pme_patch;
+
+/* communication buffers of the patch exchange */
+static double *pme_sbuf, *pme_rbuf;
+static int    pme_sbuf_max, pme_rbuf_max;
+static int    *pme_scnt, *pme_sdsp, *pme_rcnt, *pme_rdsp;
+
+/* communication buffers of the transpose */
+static double *pme_tbuf_z, *pme_tbuf_y;
+static int    *pme_tcnt_z, *pme_tdsp_z, *pme_tcnt_y, *pme_tdsp_y;
+
+/******************************************************************************
+*
+*  pme_fft_size - smallest size >= n with only factors 2, 3, 5, 7
+*
+******************************************************************************/
+
+int pme_fft_size(int n)
+{
+  int m, k;
+  for (m=n; ; m++) {
+    k = m;
+    while (k%2==0) k /= 2;
+    while (k%3==0) k /= 3;
+    while (k%5==0) k /= 5;
+    while (k%7==0) k /= 7;
+    if (k==1) return m;
+  }
+}
+
+/******************************************************************************
+*
+*  pme_bspline - weights and derivatives of the B-spline of order n at
+*  the fractional offset w; th[j] belongs to mesh point floor(u) - n + 1 + j
+*
+******************************************************************************/
+
+static void pme_bspline(double w, int n, double *th, double *dth)
+{
+  int    k, j;
+  double div;
+
+  th[n-1] = 0.0;
+  th[1]   = w;
+  th[0]   = 1.0 - w;
+  for (k=3; k<n; k++) {
+    div = 1.0 / (k - 1.0);
+    th[k-1] = div * w * th[k-2];
+    for (j=1; j<k-1; j++)
+      th[k-j-1] = div * ((w+j) * th[k-j-2] + (k-j-w) * th[k-j-1]);
+    th[0] = div * (1.0 - w) * th[0];
+  }
+  /* derivatives from the spline of order n-1 */
+  dth[0] = -th[0];
+  for (j=1; j<n; j++) dth[j] = th[j-1] - th[j];
+  /* last recursion step */
+  div = 1.0 / (n - 1.0);
+  th[n-1] = div * w * th[n-2];
+  for (j=1; j<n-1; j++)
+    th[n-j-1] = div * ((w+j) * th[n-j-2] + (n-j-w) * th[n-j-1]);
+  th[0] = div * (1.0 - w) * th[0];
+}
+
+/******************************************************************************
+*
+*  pme_bspline_moduli - squared moduli of the Euler exponential splines
+*
+******************************************************************************/
+
+static void pme_bspline_moduli(int K, int n, double *bmod)
+{
+  double th[32], dth[32], sc, ss, arg;
+  int    m, k;
+
+  pme_bspline(0.0, n, th, dth);   /* th[n-2-k] = M_n(k+1) */
+  for (m=0; m<K; m++) {
+    sc = ss = 0.0;
+    for (k=0; k<n-1; k++) {
+      arg = 2.0 * M_PI * m * k / K;
+      sc += th[n-2-k] * cos(arg);
+      ss += th[n-2-k] * sin(arg);
+    }
+    bmod[m] = sc*sc + ss*ss;
+  }
+  /* for odd order, the modulus vanishes at m = K/2; interpolate */
+  for (m=0; m<K; m++)
+    if (bmod[m] < 1e-7)
+      bmod[m] = 0.5 * (bmod[(m-1+K)%K] + bmod[(m+1)%K]);
+  for (m=0; m<K; m++) bmod[m] = 1.0 / bmod[m];
+}
+
+/******************************************************************************
+*
+*  init_pme - mesh size, distribution, FFT plans
+*
+******************************************************************************/
+
+void init_pme(void)
+{
+  int r, a, n[2];
+
+  /* mesh size; by default, it resolves the k-vectors within ew_kcut */
+  pme_K[0] = ew_pme_grid.x;
+  pme_K[1] = ew_pme_grid.y;
+  pme_K[2] = ew_pme_grid.z;
+  if (pme_K[0] <= 0) pme_K[0] = pme_fft_size(2 * ew_nx + 1);
+  if (pme_K[1] <= 0) pme_K[1] = pme_fft_size(2 * ew_ny + 1);
+  if (pme_K[2] <= 0) pme_K[2] = pme_fft_size(2 * ew_nz + 1);
+  pme_n = ew_pme_order;
+  if ((pme_n < 3) || (pme_n > 12))
+    error("PME: ew_pme_order must be between 3 and 12");
+  for (a=0; a<3; a++)
+    if (pme_K[a] < 2 * pme_n)
+      error("PME: mesh too small for the interpolation order");
+
+  if (0==myid)
+    printf("PME: mesh %d x %d x %d, order %d\n",
+           pme_K[0], pme_K[1], pme_K[2], pme_n);
+
+  /* slabs of z planes, and of y planes after the transpose */
+  pme_z0   = (int *) malloc( (num_cpus+1) * sizeof(int) );
+  pme_y0   = (int *) malloc( (num_cpus+1) * sizeof(int) );
+  pme_zown = (int *) malloc( pme_K[2]     * sizeof(int) );
+  pme_scnt = (int *) malloc( num_cpus     * sizeof(int) );
+  pme_sdsp = (int *) malloc( num_cpus     * sizeof(int) );
+  pme_rcnt = (int *) malloc( num_cpus     * sizeof(int) );
+  pme_rdsp = (int *) malloc( num_cpus     * sizeof(int) );
+  pme_tcnt_z = (int *) malloc( num_cpus   * sizeof(int) );
+  pme_tdsp_z = (int *) malloc( num_cpus   * sizeof(int) );
+  pme_tcnt_y = (int *) malloc( num_cpus   * sizeof(int) );
+  pme_tdsp_y = (int *) malloc( num_cpus   * sizeof(int) );
+  if ((NULL==pme_z0) || (NULL==pme_y0) || (NULL==pme_zown) ||
+      (NULL==pme_scnt) || (NULL==pme_sdsp) ||
+      (NULL==pme_rcnt) || (NULL==pme_rdsp) ||
+      (NULL==pme_tcnt_z) || (NULL==pme_tdsp_z) ||
+      (NULL==pme_tcnt_y) || (NULL==pme_tdsp_y))
+    error("PME: cannot allocate mesh distribution");
+  for (r=0; r<=num_cpus; r++) {
+    pme_z0[r] = (int) (((long) r * pme_K[2]) / num_cpus);
+    pme_y0[r] = (int) (((long) r * pme_K[1]) / num_cpus);
+  }
+  for (r=0; r<num_cpus; r++) {
+    int z;
+    for (z=pme_z0[r]; z<pme_z0[r+1]; z++) pme_zown[z] = r;
+  }
+  pme_nz = pme_z0[myid+1] - pme_z0[myid];
+  pme_ny = pme_y0[myid+1] - pme_y0[myid];
+
+  /* counts of the transpose, in doubles */
+  for (r=0; r<num_cpus; r++) {
+    pme_tcnt_z[r] = 2 * pme_nz * (pme_y0[r+1] - pme_y0[r]) * pme_K[0];
+    pme_tcnt_y[r] = 2 * (pme_z0[r+1] - pme_z0[r]) * pme_ny * pme_K[0];
+    pme_tdsp_z[r] = (r==0) ? 0 : pme_tdsp_z[r-1] + pme_tcnt_z[r-1];
+    pme_tdsp_y[r] = (r==0) ? 0 : pme_tdsp_y[r-1] + pme_tcnt_y[r-1];
+  }
+  pme_tbuf_z = (double *)
+    malloc( (2 * (size_t) pme_nz * pme_K[1] * pme_K[0] + 1) * sizeof(double) );
+  pme_tbuf_y = (double *)
+    malloc( (2 * (size_t) pme_ny * pme_K[0] * pme_K[2] + 1) * sizeof(double) );
+  if ((NULL==pme_tbuf_z) || (NULL==pme_tbuf_y))
+    error("PME: cannot allocate transpose buffers");
+
+  pme_slab   = (fftw_complex *)
+    fftw_malloc( (size_t) (pme_nz * pme_K[1] + 1) * pme_K[0]
+                 * sizeof(fftw_complex) );
+  pme_pencil = (fftw_complex *)
+    fftw_malloc( (size_t) (pme_ny * pme_K[0] + 1) * pme_K[2]
+                 * sizeof(fftw_complex) );
+  pme_G      = (double *)
+    malloc( (size_t) (pme_ny * pme_K[0] + 1) * pme_K[2] * sizeof(double) );
+  for (a=0; a<3; a++)
+    pme_bmod[a] = (double *) malloc( pme_K[a] * sizeof(double) );
+  if ((NULL==pme_slab) || (NULL==pme_pencil) || (NULL==pme_G) ||
+      (NULL==pme_bmod[0]) || (NULL==pme_bmod[1]) || (NULL==pme_bmod[2]))
+    error("PME: cannot allocate mesh");
+  for (a=0; a<3; a++) pme_bspline_moduli(pme_K[a], pme_n, pme_bmod[a]);
+
+  /* 2D FFTs of the z planes, and 1D FFTs along z */
+  if (pme_nz > 0) {
+    n[0] = pme_K[1]; n[1] = pme_K[0];
+    pme_plan_xy_f = fftw_plan_many_dft(2, n, pme_nz,
+      pme_slab, NULL, 1, pme_K[0]*pme_K[1],
+      pme_slab, NULL, 1, pme_K[0]*pme_K[1], FFTW_FORWARD,  FFTW_ESTIMATE);
+    pme_plan_xy_b = fftw_plan_many_dft(2, n, pme_nz,
+      pme_slab, NULL, 1, pme_K[0]*pme_K[1],
+      pme_slab, NULL, 1, pme_K[0]*pme_K[1], FFTW_BACKWARD, FFTW_ESTIMATE);
+  }
+  if (pme_ny > 0) {
+    n[0] = pme_K[2];
+    pme_plan_z_f = fftw_plan_many_dft(1, n, pme_ny * pme_K[0],
+      pme_pencil, NULL, 1, pme_K[2],
+      pme_pencil, NULL, 1, pme_K[2], FFTW_FORWARD,  FFTW_ESTIMATE);
+    pme_plan_z_b = fftw_plan_many_dft(1, n, pme_ny * pme_K[0],
+      pme_pencil, NULL, 1, pme_K[2],
+      pme_pencil, NULL, 1, pme_K[2], FFTW_BACKWARD, FFTW_ESTIMATE);
+  }
+
+  /* force computation of the influence function */
+  memset(pme_tbox, 0, sizeof(pme_tbox));
+}
+
+/******************************************************************************
+*
+*  pme_influence - influence function of the local y slab; it depends
+*  on the box and is recomputed if the box has changed
+*
+******************************************************************************/
+
+static void pme_influence(void)
+{
+  int    x, y, z, m1, m2, m3;
+  double fac, b2 = SQR(ew_kappa), mv[3], m2sq;
+
+  if ((0==memcmp(&pme_tbox[0], &tbox_x, sizeof(vektor))) &&
+      (0==memcmp(&pme_tbox[1], &tbox_y, sizeof(vektor))) &&
+      (0==memcmp(&pme_tbox[2], &tbox_z, sizeof(vektor)))) return;
+  pme_tbox[0] = tbox_x;
+  pme_tbox[1] = tbox_y;
+  pme_tbox[2] = tbox_z;
+
+  fac = coul_eng / (M_PI * volume);
+  for (y=0; y<pme_ny; y++) {
+    m2 = pme_y0[myid] + y;
+    if (m2 > pme_K[1]/2) m2 -= pme_K[1];
+    for (x=0; x<pme_K[0]; x++) {
+      m1 = (x > pme_K[0]/2) ? x - pme_K[0] : x;
+      for (z=0; z<pme_K[2]; z++) {
+        double *G = pme_G + ((size_t) y * pme_K[0] + x) * pme_K[2] + z;
+        m3 = (z > pme_K[2]/2) ? z - pme_K[2] : z;
+        mv[0] = m1 * tbox_x.x + m2 * tbox_y.x + m3 * tbox_z.x;
+        mv[1] = m1 * tbox_x.y + m2 * tbox_y.y + m3 * tbox_z.y;
+        mv[2] = m1 * tbox_x.z + m2 * tbox_y.z + m3 * tbox_z.z;
+        m2sq  = mv[0]*mv[0] + mv[1]*mv[1] + mv[2]*mv[2];
+        if ((m1==0) && (m2==0) && (m3==0)) *G = 0.0;
+        else *G = fac * exp( -SQR(M_PI) * m2sq / b2 ) / m2sq
+                * pme_bmod[0][x] * pme_bmod[1][m2<0 ? m2+pme_K[1] : m2]
+                * pme_bmod[2][z];
+      }
+    }
+  }
+}
+
+/******************************************************************************
+*
+*  pme_exchange - all-to-all exchange of doubles
+*
+******************************************************************************/
+
+static void pme_exchange(double *sbuf, int *scnt, int *sdsp,
+                         double *rbuf, int *rcnt, int *rdsp)
+{
+#ifdef MPI
+  MPI_Alltoallv(sbuf, scnt, sdsp, MPI_DOUBLE,
+                rbuf, rcnt, rdsp, MPI_DOUBLE, cpugrid);
+#else
+  memcpy(rbuf + rdsp[0], sbuf + sdsp[0], scnt[0] * sizeof(double));
+#endif
+}
+
+/******************************************************************************
+*
+*  pme_buffers - make sure the communication buffers are large enough
+*
+******************************************************************************/
+
+static void pme_buffers(int ns, int nr)
+{
+  if ((ns > pme_sbuf_max) || (NULL==pme_sbuf)) {
+    pme_sbuf_max = (int) (1.2 * ns) + 1;
+    free(pme_sbuf);
+    pme_sbuf = (double *) malloc( pme_sbuf_max * sizeof(double) );
+  }
+  if ((nr > pme_rbuf_max) || (NULL==pme_rbuf)) {
+    pme_rbuf_max = (int) (1.2 * nr) + 1;
+    free(pme_rbuf);
+    pme_rbuf = (double *) malloc( pme_rbuf_max * sizeof(double) );
+  }
+  if ((NULL==pme_sbuf) || (NULL==pme_rbuf))
+    error("PME: cannot allocate communication buffers");
+}
+
+/******************************************************************************
+*
+*  pme_setup_atoms - B-spline weights and charges of the local atoms,
+*  and the patch of the mesh they touch
+*
+******************************************************************************/
+
+static void pme_setup_atoms(int use_qsm)
+{
+  int    k, i, a, j, cnt = 0, hi[3];
+  double u, fl;
+
+  pme_nat = 0;
+  for (k=0; k<ncells; k++) pme_nat += CELLPTR(k)->n;
+  if (pme_nat > pme_nat_max) {
+    pme_nat_max = (int) (1.2 * pme_nat) + 1;
+    free(pme_base); free(pme_q); free(pme_th); free(pme_dth);
+    pme_base = (int    *) malloc( 3 * pme_nat_max * sizeof(int) );
+    pme_q    = (double *) malloc(     pme_nat_max * sizeof(double) );
+    pme_th   = (double *) malloc( 3 * pme_n * pme_nat_max * sizeof(double) );
+    pme_dth  = (double *) malloc( 3 * pme_n * pme_nat_max * sizeof(double) );
+    if ((NULL==pme_base) || (NULL==pme_q) ||
+        (NULL==pme_th) || (NULL==pme_dth))
+      error("PME: cannot allocate atom data");
+  }
+
+  for (a=0; a<3; a++) { pme_lo[a] = 1 << 30; hi[a] = -(1 << 30); }
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      vektor *tb[3];
+      tb[0] = &tbox_x; tb[1] = &tbox_y; tb[2] = &tbox_z;
+#ifdef SM
+      pme_q[cnt] = use_qsm ? Q_SM(p,i) : CHARGE(p,i);
+#else
+      pme_q[cnt] = CHARGE(p,i);
+#endif
+      for (a=0; a<3; a++) {
+        u  = pme_K[a] * SPRODX(ORT,p,i,*tb[a]);
+        fl = floor(u);
+        pme_bspline(u - fl, pme_n, pme_th  + (3*cnt+a) * pme_n,
+                                   pme_dth + (3*cnt+a) * pme_n);
+        j  = (int) fl - pme_n + 1;
+        pme_base[3*cnt+a] = j;
+        if (j < pme_lo[a]) pme_lo[a] = j;
+        if (j + pme_n - 1 > hi[a]) hi[a] = j + pme_n - 1;
+      }
+      cnt++;
+    }
+  }
+
+  if (0==pme_nat) {
+    pme_np[0] = pme_np[1] = pme_np[2] = 0;
+    return;
+  }
+  for (a=0; a<3; a++) pme_np[a] = hi[a] - pme_lo[a] + 1;
+  k = pme_np[0] * pme_np[1] * pme_np[2];
+  if ((k > pme_patch_max) || (NULL==pme_patch)) {
+    pme_patch_max = (int) (1.2 * k) + 1;
+    free(pme_patch);
+    pme_patch = (double *) malloc( pme_patch_max * sizeof(double) );
+    if (NULL==pme_patch) error("PME: cannot allocate mesh patch");
+  }
+}
+
+/******************************************************************************
+*
+*  pme_patch_to_slabs - send the planes of the patch to the slab owners,
+*  and add them up in the slabs; the receive buffer is kept for the way back
+*
+******************************************************************************/
+
+#define PME_HEADER 5
+
+static void pme_patch_to_slabs(void)
+{
+  int    r, z, j, k, gz, len, pos;
+  int    n01 = pme_np[0] * pme_np[1];
+
+  /* size of the planes for each CPU */
+  for (r=0; r<num_cpus; r++) pme_scnt[r] = 0;
+  for (z=0; z<pme_np[2]; z++) {
+    gz = PME_MOD(pme_lo[2] + z, pme_K[2]);
+    pme_scnt[ pme_zown[gz] ] += PME_HEADER + n01;
+  }
+#ifdef MPI
+  MPI_Alltoall(pme_scnt, 1, MPI_INT, pme_rcnt, 1, MPI_INT, cpugrid);
+#else
+  pme_rcnt[0] = pme_scnt[0];
+#endif
+  pme_sdsp[0] = pme_rdsp[0] = 0;
+  for (r=1; r<num_cpus; r++) {
+    pme_sdsp[r] = pme_sdsp[r-1] + pme_scnt[r-1];
+    pme_rdsp[r] = pme_rdsp[r-1] + pme_rcnt[r-1];
+  }
+  pme_buffers(pme_sdsp[num_cpus-1] + pme_scnt[num_cpus-1],
+              pme_rdsp[num_cpus-1] + pme_rcnt[num_cpus-1]);
+
+  /* pack, grouped by destination */
+  pos = 0;
+  for (r=0; r<num_cpus; r++)
+    for (z=0; z<pme_np[2]; z++) {
+      gz = PME_MOD(pme_lo[2] + z, pme_K[2]);
+      if (pme_zown[gz] != r) continue;
+      pme_sbuf[pos++] = gz;
+      pme_sbuf[pos++] = pme_lo[0];
+      pme_sbuf[pos++] = pme_lo[1];
+      pme_sbuf[pos++] = pme_np[0];
+      pme_sbuf[pos++] = pme_np[1];
+      memcpy(pme_sbuf + pos, pme_patch + (size_t) z * n01,
+             n01 * sizeof(double));
+      pos += n01;
+    }
+
+  pme_exchange(pme_sbuf, pme_scnt, pme_sdsp, pme_rbuf, pme_rcnt, pme_rdsp);
+
+  /* add up in the slab */
+  len = pme_nz * pme_K[1] * pme_K[0];
+  for (j=0; j<len; j++) pme_slab[j][0] = pme_slab[j][1] = 0.0;
+  pos = 0;
+  len = pme_rdsp[num_cpus-1] + pme_rcnt[num_cpus-1];
+  while (pos < len) {
+    int lo0 = (int) pme_rbuf[pos+1], lo1 = (int) pme_rbuf[pos+2];
+    int n0  = (int) pme_rbuf[pos+3], n1  = (int) pme_rbuf[pos+4];
+    fftw_complex *plane = pme_slab
+      + (size_t) ((int) pme_rbuf[pos] - pme_z0[myid]) * pme_K[1] * pme_K[0];
+    double *val = pme_rbuf + pos + PME_HEADER;
+    for (k=0; k<n1; k++) {
+      fftw_complex *row = plane + PME_MOD(lo1 + k, pme_K[1]) * pme_K[0];
+      for (j=0; j<n0; j++)
+        row[ PME_MOD(lo0 + j, pme_K[0]) ][0] += val[k*n0+j];
+    }
+    pos += PME_HEADER + n0 * n1;
+  }
+}
+
+/******************************************************************************
+*
+*  pme_slabs_to_patch - the reverse of pme_patch_to_slabs, with the
+*  values of the slabs copied to the patch
+*
+******************************************************************************/
+
+static void pme_slabs_to_patch(void)
+{
+  int    r, z, j, k, gz, len, pos;
+  int    n01 = pme_np[0] * pme_np[1];
+
+  pos = 0;
+  len = pme_rdsp[num_cpus-1] + pme_rcnt[num_cpus-1];
+  while (pos < len) {
+    int lo0 = (int) pme_rbuf[pos+1], lo1 = (int) pme_rbuf[pos+2];
+    int n0  = (int) pme_rbuf[pos+3], n1  = (int) pme_rbuf[pos+4];
+    fftw_complex *plane = pme_slab
+      + (size_t) ((int) pme_rbuf[pos] - pme_z0[myid]) * pme_K[1] * pme_K[0];
+    double *val = pme_rbuf + pos + PME_HEADER;
+    for (k=0; k<n1; k++) {
+      fftw_complex *row = plane + PME_MOD(lo1 + k, pme_K[1]) * pme_K[0];
+      for (j=0; j<n0; j++)
+        val[k*n0+j] = row[ PME_MOD(lo0 + j, pme_K[0]) ][0];
+    }
+    pos += PME_HEADER + n0 * n1;
+  }
+
+  pme_exchange(pme_rbuf, pme_rcnt, pme_rdsp, pme_sbuf, pme_scnt, pme_sdsp);
+
+  pos = 0;
+  for (r=0; r<num_cpus; r++)
+    for (z=0; z<pme_np[2]; z++) {
+      gz = PME_MOD(pme_lo[2] + z, pme_K[2]);
+      if (pme_zown[gz] != r) continue;
+      pos += PME_HEADER;
+      memcpy(pme_patch + (size_t) z * n01, pme_sbuf + pos,
+             n01 * sizeof(double));
+      pos += n01;
+    }
+}
+
+/******************************************************************************
+*
+*  pme_transpose - redistribute the mesh between z slabs (x fastest)
+*  and y slabs (z fastest), in direction dir = 1 or back (dir = -1)
+*
+******************************************************************************/
+
+static void pme_transpose(int dir)
+{
+  int    r, z, y, x, pos, K0 = pme_K[0], K1 = pme_K[1], K2 = pme_K[2];
+
+  if (dir > 0) {
+    pos = 0;
+    for (r=0; r<num_cpus; r++)
+      for (z=0; z<pme_nz; z++)
+        for (y=pme_y0[r]; y<pme_y0[r+1]; y++)
+          for (x=0; x<K0; x++) {
+            fftw_complex *c = pme_slab + ((size_t) z * K1 + y) * K0 + x;
+            pme_tbuf_z[pos++] = (*c)[0];
+            pme_tbuf_z[pos++] = (*c)[1];
+          }
+    pme_exchange(pme_tbuf_z, pme_tcnt_z, pme_tdsp_z,
+                 pme_tbuf_y, pme_tcnt_y, pme_tdsp_y);
+    pos = 0;
+    for (r=0; r<num_cpus; r++)
+      for (z=pme_z0[r]; z<pme_z0[r+1]; z++)
+        for (y=0; y<pme_ny; y++)
+          for (x=0; x<K0; x++) {
+            fftw_complex *c = pme_pencil + ((size_t) y * K0 + x) * K2 + z;
+            (*c)[0] = pme_tbuf_y[pos++];
+            (*c)[1] = pme_tbuf_y[pos++];
+          }
+  }
+  else {
+    pos = 0;
+    for (r=0; r<num_cpus; r++)
+      for (z=pme_z0[r]; z<pme_z0[r+1]; z++)
+        for (y=0; y<pme_ny; y++)
+          for (x=0; x<K0; x++) {
+            fftw_complex *c = pme_pencil + ((size_t) y * K0 + x) * K2 + z;
+            pme_tbuf_y[pos++] = (*c)[0];
+            pme_tbuf_y[pos++] = (*c)[1];
+          }
+    pme_exchange(pme_tbuf_y, pme_tcnt_y, pme_tdsp_y,
+                 pme_tbuf_z, pme_tcnt_z, pme_tdsp_z);
+    pos = 0;
+    for (r=0; r<num_cpus; r++)
+      for (z=0; z<pme_nz; z++)
+        for (y=pme_y0[r]; y<pme_y0[r+1]; y++)
+          for (x=0; x<K0; x++) {
+            fftw_complex *c = pme_slab + ((size_t) z * K1 + y) * K0 + x;
+            (*c)[0] = pme_tbuf_z[pos++];
+            (*c)[1] = pme_tbuf_z[pos++];
+          }
+  }
+}
+
+/******************************************************************************
+*
+*  pme_solve - spread the charges, convolve with the influence function,
+*  and leave the mesh potential in the patch; the virial of the local
+*  part of the mesh is added if want_virial is set
+*
+******************************************************************************/
+
+static void pme_solve(int want_virial)
+{
+  int    n = pme_n, i, a, b, c, x, y, z, m[3];
+  int    n01 = pme_np[0] * pme_np[1];
+  double b2 = SQR(ew_kappa), tmp_vir = 0.0, tv[6] = {0,0,0,0,0,0};
+
+  /* spread the charges to the patch */
+  for (i=0; i<n01*pme_np[2]; i++) pme_patch[i] = 0.0;
+  for (i=0; i<pme_nat; i++) {
+    double *th0 = pme_th + (3*i  ) * n;
+    double *th1 = pme_th + (3*i+1) * n;
+    double *th2 = pme_th + (3*i+2) * n;
+    int    o0 = pme_base[3*i  ] - pme_lo[0];
+    int    o1 = pme_base[3*i+1] - pme_lo[1];
+    int    o2 = pme_base[3*i+2] - pme_lo[2];
+    for (c=0; c<n; c++) {
+      double qc = pme_q[i] * th2[c];
+      for (b=0; b<n; b++) {
+        double qbc = qc * th1[b];
+        double *row = pme_patch + ((size_t) (o2+c) * pme_np[1] + o1+b)
+                                  * pme_np[0] + o0;
+        for (a=0; a<n; a++) row[a] += qbc * th0[a];
+      }
+    }
+  }
+
+  /* forward FFT */
+  pme_patch_to_slabs();
+  if (pme_nz > 0) fftw_execute(pme_plan_xy_f);
+  pme_transpose(1);
+  if (pme_ny > 0) fftw_execute(pme_plan_z_f);
+
+  /* convolution */
+  pme_influence();
+  for (y=0; y<pme_ny; y++) {
+    m[1] = pme_y0[myid] + y;
+    if (m[1] > pme_K[1]/2) m[1] -= pme_K[1];
+    for (x=0; x<pme_K[0]; x++) {
+      m[0] = (x > pme_K[0]/2) ? x - pme_K[0] : x;
+      for (z=0; z<pme_K[2]; z++) {
+        size_t ind = ((size_t) y * pme_K[0] + x) * pme_K[2] + z;
+        fftw_complex *s = pme_pencil + ind;
+        if (want_virial) {
+          double eng = 0.5 * pme_G[ind] * (SQR((*s)[0]) + SQR((*s)[1]));
+          double mv[3], m2sq, f;
+          m[2] = (z > pme_K[2]/2) ? z - pme_K[2] : z;
+          mv[0] = m[0] * tbox_x.x + m[1] * tbox_y.x + m[2] * tbox_z.x;
+          mv[1] = m[0] * tbox_x.y + m[1] * tbox_y.y + m[2] * tbox_z.y;
+          mv[2] = m[0] * tbox_x.z + m[1] * tbox_y.z + m[2] * tbox_z.z;
+          m2sq  = mv[0]*mv[0] + mv[1]*mv[1] + mv[2]*mv[2];
+          if (m2sq > 0.0) {
+            f = 2.0 * (1.0 + SQR(M_PI) * m2sq / b2) / m2sq;
+            tmp_vir += eng * (1.0 - 2.0 * SQR(M_PI) * m2sq / b2);
+            tv[0] += eng * (1.0 - f * mv[0] * mv[0]);
+            tv[1] += eng * (1.0 - f * mv[1] * mv[1]);
+            tv[2] += eng * (1.0 - f * mv[2] * mv[2]);
+            tv[3] -= eng * f * mv[1] * mv[2];
+            tv[4] -= eng * f * mv[2] * mv[0];
+            tv[5] -= eng * f * mv[0] * mv[1];
+          }
+        }
+        (*s)[0] *= pme_G[ind];
+        (*s)[1] *= pme_G[ind];
+      }
+    }
+  }
+  if (want_virial) {
+    virial += tmp_vir;
+    vir_xx += tv[0];
+    vir_yy += tv[1];
+    vir_zz += tv[2];
+    vir_yz += tv[3];
+    vir_zx += tv[4];
+    vir_xy += tv[5];
+  }
+
+  /* backward FFT */
+  if (pme_ny > 0) fftw_execute(pme_plan_z_b);
+  pme_transpose(-1);
+  if (pme_nz > 0) fftw_execute(pme_plan_xy_b);
+  pme_slabs_to_patch();
+}
+
+/******************************************************************************
+*
+*  pme_interpolate - potential phi and its gradient at local atom i
+*
+******************************************************************************/
+
+static void pme_interpolate(int i, double *phi, double *grad)
+{
+  int    n = pme_n, a, b, c;
+  double *th0 = pme_th  + (3*i  ) * n, *dth0 = pme_dth + (3*i  ) * n;
+  double *th1 = pme_th  + (3*i+1) * n, *dth1 = pme_dth + (3*i+1) * n;
+  double *th2 = pme_th  + (3*i+2) * n, *dth2 = pme_dth + (3*i+2) * n;
+  int    o0 = pme_base[3*i  ] - pme_lo[0];
+  int    o1 = pme_base[3*i+1] - pme_lo[1];
+  int    o2 = pme_base[3*i+2] - pme_lo[2];
+  double p = 0.0, g0 = 0.0, g1 = 0.0, g2 = 0.0;
+
+  for (c=0; c<n; c++)
+    for (b=0; b<n; b++) {
+      double *row = pme_patch + ((size_t) (o2+c) * pme_np[1] + o1+b)
+                                * pme_np[0] + o0;
+      double s = 0.0, ds = 0.0;
+      for (a=0; a<n; a++) {
+        s  += th0[a]  * row[a];
+        ds += dth0[a] * row[a];
+      }
+      p  += th2[c]  * th1[b]  * s;
+      g0 += th2[c]  * th1[b]  * ds;
+      g1 += th2[c]  * dth1[b] * s;
+      g2 += dth2[c] * th1[b]  * s;
+    }
+  *phi = p;
+  if (grad) {
+    /* d/dr = sum_a K_a tbox_a d/du_a */
+    g0 *= pme_K[0]; g1 *= pme_K[1]; g2 *= pme_K[2];
+    grad[0] = g0 * tbox_x.x + g1 * tbox_y.x + g2 * tbox_z.x;
+    grad[1] = g0 * tbox_x.y + g1 * tbox_y.y + g2 * tbox_z.y;
+    grad[2] = g0 * tbox_x.z + g1 * tbox_y.z + g2 * tbox_z.z;
+  }
+}
+
+/******************************************************************************
+*
+*  do_forces_pme - Fourier part of the Ewald sum with PME; the forces
+*  are added with weight wgt
+*
+******************************************************************************/
+
+void do_forces_pme(real wgt)
+{
+  int    k, i, cnt = 0;
+  double phi, grad[3], pot, qw;
+
+  pme_setup_atoms(0);
+  pme_solve(1);
+
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      pme_interpolate(cnt, &phi, grad);
+      pot = 0.5 * pme_q[cnt] * phi;
+      tot_pot_energy += pot;
+      POTENG(p,i)    += pot;
+      qw = wgt * pme_q[cnt];
+      KRAFT(p,i,X)   -= qw * grad[0];
+      KRAFT(p,i,Y)   -= qw * grad[1];
+      KRAFT(p,i,Z)   -= qw * grad[2];
+      cnt++;
+    }
+  }
+}
+
+#ifdef SM
+
+/******************************************************************************
+*
+*  do_v_pme - Fourier part of the SM potential vector with PME
+*
+******************************************************************************/
+
+void do_v_pme(void)
+{
+  int    k, i, cnt = 0;
+  double phi;
+
+  pme_setup_atoms(1);
+  pme_solve(0);
+
+  for (k=0; k<ncells; k++) {
+    cell *p = CELLPTR(k);
+    for (i=0; i<p->n; i++) {
+      pme_interpolate(cnt, &phi, NULL);
+      V_SM(p,i) += phi;
+      cnt++;
+    }
+  }
+}
+
+#endif /* SM */
+
+#endif /* PME */
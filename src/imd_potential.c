@@ -271,6 +271,9 @@ void read_pot_table( pot_table_t *pt, char *filename, int ncols, int radial )
   init_fourpoint(pt, ncols);
 #elif defined(SPLINE)
   pt->table2 = NULL;
+#ifdef SPLINE_PACKED
+  pt->coeff  = NULL;
+#endif
   init_spline(pt, ncols, radial);
 #else
   init_threepoint(pt, ncols);
@@ -463,6 +466,275 @@ void read_pot_table2(pot_table_t *pt, int ncols, char *filename,
 
 #ifdef PAIR
 
+/*****************************************************************************
+*
+*  pre_pot_val -- value of the analytically defined pair potential
+*  between atom types i and j, as a function of r2
+*
+******************************************************************************/
+
+real pre_pot_val(int i, int j, real r2)
+{
+  real pot, grad, val;
+  int  col;
+
+  col = (i<j) ? i*ntypes - (i*(i+1))/2 + j : j*ntypes - (j*(j+1))/2 + i;
+
+    val = 0.0;
+    /* Lennard-Jones-Gauss ... */
+    if (ljg_eps[i][j]>0) {
+      if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
+        pair_int_ljg(&pot, &grad, i, j, r2);
+        val += pot - lj_shift[i][j];
+      }
+      else if (r2 <= r2_cut[i][j]) {
+        val += lj_aaa[i][j] * SQR(r2_cut[i][j] - r2);
+      }
+    } else
+    /* ... or just Lennard-Jones */
+    if (lj_epsilon[i][j]>0) {
+      if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
+        pair_int_lj(&pot, &grad, i, j, r2);
+        val += pot - lj_shift[i][j];
+      }
+      else if (r2 <= r2_cut[i][j]) {
+        val += lj_aaa[i][j] * SQR(r2_cut[i][j] - r2);
+      }
+    }
+    /* Morse */
+    if (morse_epsilon[i][j]>0) {
+      if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
+        pair_int_morse(&pot, &grad, i, j, r2);
+        val += pot - morse_shift[i][j];
+      }
+      else if (r2 <= r2_cut[i][j]) {
+        val += morse_aaa[i][j] * SQR(r2_cut[i][j] - r2);
+      }
+    }
+#ifndef BUCK
+    /* Buckingham */
+    if (buck_sigma[i][j]>0) {
+      if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
+        pair_int_buck(&pot, &grad, i, j, r2);
+        val += pot - buck_shift[i][j];
+      }
+      else if (r2 <= r2_cut[i][j]) {
+        val += buck_aaa[i][j] * SQR(r2_cut[i][j] - r2);
+      }
+    }
+#endif
+    /* harmonic potential for shell model */
+    if (spring_cst[i][j]>0) {
+      val = 0.5 * spring_cst[i][j] * r2;
+    }
+#ifdef STIWEB
+    if ((sw_a1[i][j] > 0) && (SQR(sw_a1[i][j]) > r2)) {
+      pair_int_stiweb(&pot, &grad, i, j, r2);
+      val += pot;
+    }
+#endif
+#ifdef TERSOFF
+    if ((ter_a[i][j] > 0) && (ter_r2_cut[i][j] > r2)) {
+      pair_int_tersoff(&pot, i, j, r2);
+      val += pot;
+    }
+#endif
+#ifdef BRENNER
+    if ((ter_a[i][j] > 0) && (ter_r2_cut[i][j] > r2)) {
+      pair_int_brenner(&pot, i, j, r2);
+      val += pot;
+    }
+#endif
+#ifdef EWALD
+    /* Coulomb potential for Ewald */
+    if ((ew_r2_cut > 0) && (ew_nmax<0)) {
+      if (r2 < ew_r2_cut) {
+        pair_int_ewald(&pot, &grad, i, j, r2);
+        val += pot - ew_shift[i][j];
+        val -= 0.5*ew_fshift[i][j]*(r2-ew_r2_cut);
+        /*val -= SQRT(r2)*ew_fshift[i][j]*(SQRT(r2)-SQRT(ew_r2_cut));*/
+      }
+    }
+#endif
+#if ((defined(DIPOLE) || defined(KERMODE) || defined(MORSE)) && !defined(BUCK))
+    /* Morse-Stretch potential for dipole */
+    if ((ew_r2_cut > 0)) {
+      /* harmonic spring */
+      if (r2 < ms_r2_min[col]) {
+	val += ms_harm_c[col]*SQR(SQRT(r2)-ms_harm_a[col])
+	  + ms_harm_b[col];
+	  }
+#ifndef KERMODE
+      else if (r2 < ew_r2_cut) {
+        pair_int_mstr(&pot, &grad, i, j, r2);
+        val += pot - ms_shift[col];
+        val -= SQRT(r2)*ms_fshift[col]*(SQRT(r2)-SQRT(ew_r2_cut));
+      }
+#endif
+#ifdef KERMODE
+      else if (r2 < r2_cut[i][j]) {
+        pair_int_mstr(&pot, &grad, i, j, r2);
+        val += (pot - ms_shift[col]);
+      }
+#endif
+    }
+#endif /* DIPOLE or MORSE */
+#ifdef BUCK
+ /* Buckingham potential for dipole */
+    if ((ew_r2_cut > 0)) {
+      if (r2 < ew_r2_cut) {
+        pair_int_buck(&pot, &grad, i, j, r2);
+        val += pot - bk_shift[col];
+        val -= SQRT(r2)*bk_fshift[col]*(SQRT(r2)-SQRT(ew_r2_cut));
+      }
+    }
+#endif /* BUCK */
+  return val;
+}
+
+/*****************************************************************************
+*
+*  pot_table_error -- maximal error of the force interpolated from a
+*  table with n points, for the pair potential between types i and j.
+*  The force is compared at three points in each table interval with
+*  a central difference of pre_pot_val. Regions where the potential
+*  exceeds pot_table_emax (if > 0) are not checked.
+*
+******************************************************************************/
+
+real pot_table_error(int i, int j, real r2_begin, real r2_end, int n)
+{
+  pot_table_t pt;
+  real r2, delta, val, grad, exact, err = 0.0;
+  int  k, m, is_short = 0;
+
+  /* table with a single column */
+  pt.ncols    = 1;
+  pt.maxsteps = n;
+  pt.begin    = (real *) malloc(sizeof(real));
+  pt.end      = (real *) malloc(sizeof(real));
+  pt.step     = (real *) malloc(sizeof(real));
+  pt.invstep  = (real *) malloc(sizeof(real));
+  pt.len      = (int  *) malloc(sizeof(int ));
+  pt.table    = (real *) malloc((n + 2) * sizeof(real));
+  if ((NULL==pt.begin) || (NULL==pt.end) || (NULL==pt.step) ||
+      (NULL==pt.invstep) || (NULL==pt.len) || (NULL==pt.table))
+    error("Cannot allocate memory for potential table test");
+  pt.begin  [0] = r2_begin;
+  pt.end    [0] = r2_end;
+  pt.step   [0] = (r2_end - r2_begin) / (n - 1);
+  pt.invstep[0] = 1.0 / pt.step[0];
+  pt.len    [0] = n;
+  for (k=0; k<n; k++)
+    pt.table[k] = pre_pot_val(i, j, r2_begin + k * pt.step[0]);
+#if   defined(FOURPOINT)
+  init_fourpoint(&pt, 1);
+#elif defined(SPLINE)
+  pt.table2 = NULL;
+#ifdef SPLINE_PACKED
+  pt.coeff  = NULL;
+#endif
+  init_spline(&pt, 1, 1);
+#else
+  init_threepoint(&pt, 1);
+#endif
+
+  /* compare twice the derivative with a central difference */
+  delta = 1e-3 * pt.step[0];
+  for (k=0; k<n-1; k++)
+    for (m=1; m<4; m++) {
+      r2 = r2_begin + (k + 0.25 * m) * pt.step[0];
+      if (pot_table_emax > 0) {
+        VAL_FUNC(val, pt, 0, 1, r2, is_short);
+        if (val > pot_table_emax) continue;
+      }
+      DERIV_FUNC(grad, pt, 0, 1, r2, is_short);
+      exact = (pre_pot_val(i, j, r2 + delta) - pre_pot_val(i, j, r2 - delta))
+              / delta;
+      err = MAX(err, SQRT(r2) * FABS(grad - exact));
+    }
+
+  free_pot_table(&pt);
+  return err;
+}
+
+/*****************************************************************************
+*
+*  pot_table_size -- smallest table length for the pair potential between
+*  types i and j, for which the error of the interpolated force is below
+*  pot_table_ferr. The table remains equidistant in r2.
+*
+******************************************************************************/
+
+int pot_table_size(int i, int j, real r2_begin, real r2_end)
+{
+  int  lo, hi, mid;
+  real err;
+
+  /* double the length until the error is small enough */
+  hi = 64;
+  while ((err = pot_table_error(i, j, r2_begin, r2_end, hi)) > pot_table_ferr) {
+    if (hi >= POT_TABLE_MAXLEN) {
+      char msg[255];
+      sprintf(msg, "Force error %e for types %d and %d above pot_table_ferr",
+              err, i, j);
+      warning(msg);
+      break;
+    }
+    hi *= 2;
+  }
+
+  /* bisection, up to 2 percent */
+  lo = hi / 2;
+  while ((hi > 64) && (err <= pot_table_ferr) &&
+         (hi - lo > MAX(1, lo / 50))) {
+    mid = (lo + hi) / 2;
+    if (pot_table_error(i, j, r2_begin, r2_end, mid) > pot_table_ferr)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  err = pot_table_error(i, j, r2_begin, r2_end, hi);
+  printf("Potential table for types %d and %d: %d points, force error %e\n",
+         i, j, hi, err);
+  return hi;
+}
+
+/*****************************************************************************
+*
+*  write_pot_table -- write a potential table in format 2,
+*  so that it can be read again as potfile
+*
+******************************************************************************/
+
+void write_pot_table(pot_table_t *pt, char *filename)
+{
+  FILE *out;
+  int  i, k;
+
+  out = fopen(filename, "w");
+  if (NULL == out) error_str("Cannot open potential table file %s", filename);
+  fprintf(out, "#F 2 %d\n", pt->ncols);
+  fprintf(out, "#C created by IMD from analytic pair potentials\n");
+  fprintf(out, "#E\n");
+  for (i=0; i<pt->ncols; i++) {
+    if (pt->len[i] > 0)
+      fprintf(out, "%.16e %.16e %.16e\n",
+              pt->begin[i], pt->end[i], pt->step[i]);
+    else  /* no potential, a single zero */
+      fprintf(out, "%.16e %.16e %.16e\n", 0.0, 0.0, 1.0);
+  }
+  for (i=0; i<pt->ncols; i++) {
+    for (k=0; k<pt->len[i]; k++)
+      fprintf(out, "%.16e\n",
+              *PTR_2D(pt->table, k, i, pt->maxsteps, pt->ncols));
+    if (pt->len[i]==0) fprintf(out, "%.16e\n", 0.0);
+  }
+  fclose(out);
+  printf("Potential table written to file %s\n", filename);
+}
+
 /*****************************************************************************
 *
 *  Create or modify potential tables for predefined potentials
@@ -473,10 +745,49 @@ void create_pot_table(pot_table_t *pt)
 {
     int maxres = 0, tablesize;
     int ncols = ntypes * ntypes;
-    int i, j, n, column,col;
+    int i, j, n, column;
     real r2_begin[10][10], r2_end[10][10], r2_step[10][10], r2_invstep[10][10];
     int len[10][10];
-    real pot, grad, r2, val;
+    real r2;
+
+    /* Determine range of potential table */
+    column = 0;
+    for (i=0; i<ntypes; i++)
+      for (j=i; j<ntypes; j++) {
+        if ((r_cut_lin[column]>0)
+#ifdef EWALD
+	    || ((ew_r2_cut>0) && (SQR(charge[i]*charge[j])>0))
+#endif
+          ) {
+          r2_begin[i][j]   = r2_begin[j][i]   = SQR(r_begin[column]);
+#ifndef KERMODE
+          r2_end[i][j]     = r2_end[j][i]
+                           = MAX( SQR(r_cut_lin[column]), ew_r2_cut);
+#endif
+#ifdef KERMODE
+          r2_end[i][j]     = r2_end[j][i]    = SQR(r_cut_lin[column]);
+#endif
+	}
+        else r2_end[i][j]  = r2_end[j][i] = 0.0;
+        ++column;
+      }
+
+    /* choose resolution according to the required force accuracy */
+    if (pot_table_ferr > 0) {
+      if (0==myid) {
+        column = 0;
+        for (i=0; i<ntypes; i++)
+          for (j=i; j<ntypes; j++) {
+            if (r2_end[i][j]>0)
+              pot_res[column] = pot_table_size(i, j, r2_begin[i][j],
+                                               r2_end[i][j]);
+            ++column;
+          }
+      }
+#ifdef MPI
+      MPI_Bcast( pot_res, ntypepairs, REAL, 0, MPI_COMM_WORLD);
+#endif
+    }
 
     /* Determine size of potential table */
     for (i=0; i<ntypes*(ntypes+1)/2; ++i)
@@ -512,25 +823,12 @@ void create_pot_table(pot_table_t *pt)
     column = 0;
     for (i=0; i<ntypes; i++)
       for (j=i; j<ntypes; j++) {
-        if ((r_cut_lin[column]>0)
-#ifdef EWALD
-	    || ((ew_r2_cut>0) && (SQR(charge[i]*charge[j])>0))
-#endif
-          ) {
-          r2_begin[i][j]   = r2_begin[j][i]   = SQR(r_begin[column]);
-#ifndef KERMODE
-          r2_end[i][j]     = r2_end[j][i]
-                           = MAX( SQR(r_cut_lin[column]), ew_r2_cut);
-#endif
-#ifdef KERMODE
-          r2_end[i][j]     = r2_end[j][i]    = SQR(r_cut_lin[column]);
-#endif
+        if (r2_end[i][j]>0) {
           r2_step[i][j]    = r2_step[j][i]
                            = (r2_end[i][j]-r2_begin[i][j])/(pot_res[column]-1);
           r2_invstep[i][j] = r2_invstep[j][i] = 1.0 / r2_step[i][j];
           len[i][j]        = len[j][i]        = pot_res[column];
 	}
-        else r2_end[i][j]  = r2_end[j][i] = 0.0;
         ++column;
       }
 
@@ -561,138 +859,47 @@ void create_pot_table(pot_table_t *pt)
     column = 0;
     for (i=0; i<ntypes; i++)
       for (j=0; j<ntypes; j++) {
-
         if (r2_end[i][j]>0) {
-	  col= (i<j) ?
-	    i*ntypes - (i*(i+1))/2 + j :
-	    j*ntypes - (j*(j+1))/2 + i;
           for (n=0; n<len[i][j]; n++) {
-            val = 0.0;
             r2 = r2_begin[i][j] + n * r2_step[i][j];
-            /* Lennard-Jones-Gauss ... */
-            if (ljg_eps[i][j]>0) {
-              if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
-                pair_int_ljg(&pot, &grad, i, j, r2);
-                val += pot - lj_shift[i][j];
-              }
-              else if (r2 <= r2_cut[i][j]) {
-                val += lj_aaa[i][j] * SQR(r2_cut[i][j] - r2);
-              }
-            } else
-            /* ... or just Lennard-Jones */
-            if (lj_epsilon[i][j]>0) {
-              if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
-                pair_int_lj(&pot, &grad, i, j, r2);
-                val += pot - lj_shift[i][j];
-              }
-              else if (r2 <= r2_cut[i][j]) {
-                val += lj_aaa[i][j] * SQR(r2_cut[i][j] - r2);
-              }
-            }
-            /* Morse */
-            if (morse_epsilon[i][j]>0) {
-              if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
-                pair_int_morse(&pot, &grad, i, j, r2);
-                val += pot - morse_shift[i][j];
-              }
-              else if (r2 <= r2_cut[i][j]) {
-                val += morse_aaa[i][j] * SQR(r2_cut[i][j] - r2);
-              }
-            }
-#ifndef BUCK
-            /* Buckingham */
-            if (buck_sigma[i][j]>0) {
-              if (r2 < (1.0 - POT_TAIL) * r2_cut[i][j]) {
-                pair_int_buck(&pot, &grad, i, j, r2);
-                val += pot - buck_shift[i][j];
-              }
-              else if (r2 <= r2_cut[i][j]) {
-                val += buck_aaa[i][j] * SQR(r2_cut[i][j] - r2);
-              }
-            }
-#endif
-            /* harmonic potential for shell model */
-            if (spring_cst[i][j]>0) {
-	      val = 0.5 * spring_cst[i][j] * r2;
-            }
-#ifdef STIWEB
-            if ((sw_a1[i][j] > 0) && (SQR(sw_a1[i][j]) > r2)) {
-              pair_int_stiweb(&pot, &grad, i, j, r2);
-              val += pot;
-            }
-#endif
-#ifdef TERSOFF
-            if ((ter_a[i][j] > 0) && (ter_r2_cut[i][j] > r2)) {
-              pair_int_tersoff(&pot, i, j, r2);
-              val += pot;
-            }
-#endif
-#ifdef BRENNER
-            if ((ter_a[i][j] > 0) && (ter_r2_cut[i][j] > r2)) {
-              pair_int_brenner(&pot, i, j, r2);
-              val += pot;
-            }
-#endif
-#ifdef EWALD
-            /* Coulomb potential for Ewald */
-            if ((ew_r2_cut > 0) && (ew_nmax<0)) {
-              if (r2 < ew_r2_cut) {
-                pair_int_ewald(&pot, &grad, i, j, r2);
-                val += pot - ew_shift[i][j];
-                val -= 0.5*ew_fshift[i][j]*(r2-ew_r2_cut);
-                /*val -= SQRT(r2)*ew_fshift[i][j]*(SQRT(r2)-SQRT(ew_r2_cut));*/
-              }
-	    }
-#endif
-#if ((defined(DIPOLE) || defined(KERMODE) || defined(MORSE)) && !defined(BUCK))
-            /* Morse-Stretch potential for dipole */
-            if ((ew_r2_cut > 0)) {
-	      /* harmonic spring */
-	      if (r2 < ms_r2_min[col]) {
-		val += ms_harm_c[col]*SQR(SQRT(r2)-ms_harm_a[col])
-		  + ms_harm_b[col];
-		  }
-#ifndef KERMODE
-              else if (r2 < ew_r2_cut) {
-                pair_int_mstr(&pot, &grad, i, j, r2);
-                val += pot - ms_shift[col];
-                val -= SQRT(r2)*ms_fshift[col]*(SQRT(r2)-SQRT(ew_r2_cut));
-              }
-#endif
-#ifdef KERMODE
-              else if (r2 < r2_cut[i][j]) {
-                pair_int_mstr(&pot, &grad, i, j, r2);
-                val += (pot - ms_shift[col]);
-              }
-#endif
-	    }
-#endif /* DIPOLE or MORSE */
-#ifdef BUCK
- /* Buckingham potential for dipole */
-            if ((ew_r2_cut > 0)) {
-	      if (r2 < ew_r2_cut) {
-                pair_int_buck(&pot, &grad, i, j, r2);
-                val += pot - bk_shift[col];
-                val -= SQRT(r2)*bk_fshift[col]*(SQRT(r2)-SQRT(ew_r2_cut));
-              }
-	    }
-#endif /* BUCK */
-            *PTR_2D(pt->table, n, column, pt->maxsteps, ncols) = val;
+            *PTR_2D(pt->table, n, column, pt->maxsteps, ncols)
+              = pre_pot_val(i, j, r2);
           }
 	}
         ++column;
       }
 
+    /* report size of table, and write it for later use as potfile */
+    if ((0==myid) && (pot_table_ferr > 0)) {
+      long bytes = (long) ncols * (pt->maxsteps + 2) * sizeof(real);
+#ifdef SPLINE
+      bytes *= 2;
+#ifdef SPLINE_PACKED
+      bytes += (long) ncols * 4 * (pt->maxsteps + 2) * sizeof(real);
+#endif
+#endif
+      printf("Potential table has %d points, needs %ld bytes of memory\n",
+             pt->maxsteps, bytes);
+    }
+    if ((0==myid) && (pot_table_file[0]!='\0'))
+      write_pot_table(pt, pot_table_file);
+
 #if   defined(FOURPOINT)
   init_fourpoint(pt, ncols);
 #elif defined(SPLINE)
   if (have_potfile==0) pt->table2 = NULL;
+#ifdef SPLINE_PACKED
+  if (have_potfile==0) pt->coeff  = NULL;
+#endif
   init_spline(pt, ncols, 1);
 #else
   init_threepoint(pt, ncols);
 #endif
 
   if (fix_bks) fix_pottab_bks();
+#ifdef SPLINE_PACKED
+  if (fix_bks) init_spline_coeff(pt, ncols);
+#endif
 
   /* test interpolation of potential */
   if ((0==myid) && (debug_potential)) test_potential(*pt, "pair_pot", ncols);
@@ -1125,6 +1332,9 @@ void create_coulomb_tables()
   init_fourpoint(pt, ncols);
 #elif defined(SPLINE)
   if (have_potfile==0) pt->table2 = NULL;
+#ifdef SPLINE_PACKED
+  if (have_potfile==0) pt->coeff  = NULL;
+#endif
   init_spline(pt, ncols, 1);
 #else
   init_threepoint(pt, ncols);
@@ -1243,8 +1453,61 @@ void init_spline( pot_table_t *pt, int ncols, int radial )
     y2[n*ncols] = 2*y2[(n-1)*ncols]-y2[(n-2)*ncols];
 
   }
+#ifdef SPLINE_PACKED
+  init_spline_coeff(pt, ncols);
+#endif
 }
 
+#ifdef SPLINE_PACKED
+
+/******************************************************************************
+*
+*  init_spline_coeff -- pack the spline polynomials of the table intervals
+*
+*  For interval k, with b = (r2 - r2_k) / step, the spline is
+*  c0 + b * (c1 + b * (c2 + b * c3)), with the four coefficients stored
+*  consecutively in pt->coeff. Columns are contiguous, and the table is
+*  aligned to cache lines, so that the coefficients of an interval never
+*  straddle a cache line. Must be called whenever table or table2 change.
+*
+******************************************************************************/
+
+void init_spline_coeff( pot_table_t *pt, int ncols )
+{
+  int  size, col, n, k;
+  real h, p1, p2, d21, d22, *c;
+
+  /* (re)allocate data */
+  size = 4 * (pt->maxsteps + 2);
+  free(pt->coeff);
+  if (posix_memalign((void **) &pt->coeff, 64, ncols * size * sizeof(real)))
+    error("Cannot allocate memory for spline coefficients");
+  memset(pt->coeff, 0, ncols * size * sizeof(real));
+  pt->cstride = size;
+
+  /* loop over columns */
+  for (col=0; col<ncols; col++) {
+
+    n = pt->len[col];
+    h = SQR(pt->step[col]) / 6;
+
+    /* the interval beyond the end is used for r2 == end */
+    for (k=0; k<n; k++) {
+      p1  = *PTR_2D(pt->table,  k,   col, pt->maxsteps, ncols);
+      p2  = *PTR_2D(pt->table,  k+1, col, pt->maxsteps, ncols);
+      d21 = *PTR_2D(pt->table2, k,   col, pt->maxsteps, ncols);
+      d22 = *PTR_2D(pt->table2, k+1, col, pt->maxsteps, ncols);
+      c   = pt->coeff + col * size + 4 * k;
+      c[0] = p1;
+      c[1] = (p2 - p1) - h * (2 * d21 + d22);
+      c[2] = 3 * h * d21;
+      c[3] = h * (d22 - d21);
+    }
+  }
+}
+
+#endif
+
 #else
 
 /******************************************************************************
@@ -1370,6 +1633,9 @@ void free_pot_table(pot_table_t *pt)
   free(pt->table);
 #ifdef SPLINE
   free(pt->table2);
+#ifdef SPLINE_PACKED
+  free(pt->coeff);
+#endif
 #endif
 }
 
@@ -1405,6 +1671,20 @@ void copy_pot_table( pot_table_t pt, pot_table_t *npt )
   memcpy( npt->invstep, pt.invstep, pt.ncols * sizeof(real) );
   memcpy( npt->table,   pt.table,   size     * sizeof(real) );
 
+#ifdef SPLINE
+  npt->table2   = (real *) malloc( size     * sizeof(real) );
+  if (NULL==npt->table2)
+    error("Cannot allocate potential table");
+  memcpy( npt->table2,  pt.table2,  size     * sizeof(real) );
+#ifdef SPLINE_PACKED
+  size = pt.cstride * pt.ncols;
+  npt->cstride  = pt.cstride;
+  if (posix_memalign((void **) &npt->coeff, 64, size * sizeof(real)))
+    error("Cannot allocate potential table");
+  memcpy( npt->coeff,   pt.coeff,   size     * sizeof(real) );
+#endif
+#endif
+
 }
 
 #endif
@@ -57,6 +57,25 @@ void init_sm(void)
 }
 
 
+/*****************************************************************************
+*
+* Is a charge update due after this step? With r-RESPA (respa_steps > 1),
+* the charges are updated only just before an outer step, so that they
+* stay fixed between two evaluations of the k-space part.
+*
+******************************************************************************/
+
+int charge_update_due(int steps)
+{
+  if ((sm_fixed_charges) || (charge_update_steps <= 0)) return 0;
+#ifdef EWALD
+  if (respa_steps > 1)
+    return ((steps + 1 - steps_min) % charge_update_steps == 0);
+#endif
+  return (steps % charge_update_steps == 0);
+}
+
+
 /*****************************************************************************
 *
 * Compute the electronegativity
@@ -337,113 +356,49 @@ void do_v_kspace(void)
 #ifdef DEBUG
   printf("do_v_kspace\n");
 #endif
-  int    i, j, k, l, m, n, c;
-  int    cnt, typ, offx, offy, offz;
-  int    px, py, pz, mx, my, mz;
-  real   tmp, tmp_virial=0.0, sum_cos, sum_sin;
-  real   kforce, kpot;
+  int    i, k, c, cnt;
+  real   sum_cos, sum_sin;
   real v_k;
 
-  /* Compute exp(ikr) recursively */
-  px = (ew_nx+1) * natoms;  mx = (ew_nx-1) * natoms;
-  py = (ew_ny+1) * natoms;  my = (ew_ny-1) * natoms;
-  pz = (ew_nz+1) * natoms;  mz = (ew_nz-1) * natoms;
-
-  cnt = 0;
-  for (c=0; c<ncells; c++) {
-    cell *p = CELLPTR(c);
-    for (i=0; i<p->n; i++) {
-      tmp = twopi * SPRODX(ORT,p,i,tbox_x);
-      coskx[px+cnt] =  cos(tmp);
-      coskx[mx+cnt] =  coskx[px+cnt];
-      sinkx[px+cnt] =  sin(tmp);
-      sinkx[mx+cnt] = -sinkx[px+cnt]; 
-      tmp = twopi * SPRODX(ORT,p,i,tbox_y);
-      cosky[py+cnt] =  cos(tmp);
-      cosky[my+cnt] =  cosky[py+cnt];
-      sinky[py+cnt] =  sin(tmp);
-      sinky[my+cnt] = -sinky[py+cnt];
-      tmp = twopi * SPRODX(ORT,p,i,tbox_z);
-      coskz[pz+cnt] = cos(tmp);
-      sinkz[pz+cnt] = sin(tmp);
-      cnt++;
-    }
-  }
-
-  for (j=2; j<=ew_nx; j++) {
-    int pp, qq, mm, ee, i;
-    pp  = (ew_nx+j  ) * natoms;
-    qq  = (ew_nx+j-1) * natoms;
-    mm  = (ew_nx-j  ) * natoms;
-    ee  = (ew_nx  +1) * natoms;
-    for (i=0; i<natoms; i++) {
-      coskx[pp+i] =   coskx[qq+i] * coskx[ee+i] - sinkx[qq+i] * sinkx[ee+i];
-      coskx[mm+i] =   coskx[pp+i];
-      sinkx[pp+i] =   coskx[qq+i] * sinkx[ee+i] - sinkx[qq+i] * coskx[ee+i];
-      sinkx[mm+i] = - sinkx[pp+i];
-    }
-  }
-
-  for (j=2; j<=ew_ny; j++) {
-    int pp, qq, mm, ee, i;
-    pp  = (ew_ny+j  ) * natoms;
-    qq  = (ew_ny+j-1) * natoms;
-    mm  = (ew_ny-j  ) * natoms;
-    ee  = (ew_ny  +1) * natoms;
-    for (i=0; i<natoms; i++) {
-      cosky[pp+i] =   cosky[qq+i] * cosky[ee+i] - sinky[qq+i] * sinky[ee+i];
-      cosky[mm+i] =   cosky[pp+i];
-      sinky[pp+i] =   cosky[qq+i] * sinky[ee+i] - sinky[qq+i] * cosky[ee+i];
-      sinky[mm+i] = - sinky[pp+i];
-    }
+#ifdef PME
+  if (ew_pme) {
+    do_v_pme();
+    return;
   }
+#endif
 
-  for (j=2; j<=ew_nz; j++) {
-    int pp, qq, ee, i;
-    pp  = (ew_nz+j  ) * natoms;
-    qq  = (ew_nz+j-1) * natoms;
-    ee  = (ew_nz  +1) * natoms;
-    for (i=0; i<natoms; i++) {
-      coskz[pp+i] =   coskz[qq+i] * coskz[ee+i] - sinkz[qq+i] * sinkz[ee+i];
-      sinkz[pp+i] =   coskz[qq+i] * sinkz[ee+i] - sinkz[qq+i] * coskz[ee+i];
-    }
-  }
+  /* exp(ikr) of the local atoms */
+  ewald_kr_tables();
 
-  /* Loop over all reciprocal vectors */
+  /* partial structure factors of the local atoms */
   for (k=0; k<ew_totk; k++) {
-
-    cnt     = 0; 
-    offx    = ew_ivek[k].x * natoms;
-    offy    = ew_ivek[k].y * natoms;
-    offz    = ew_ivek[k].z * natoms;
+    ewald_kr(k);
     sum_cos = 0.0;
     sum_sin = 0.0;
-    v_k     = 0.0;
-
-    /* Compute exp(ikr) and sums thereof */
+    cnt     = 0;
     for (c=0; c<ncells; c++) {
-
       cell *p = CELLPTR(c);
-
       for (i=0; i<p->n; i++) {
-
-        coskr[cnt] =   coskx[offx+cnt] * cosky[offy+cnt] * coskz[offz+cnt]
-                     - sinkx[offx+cnt] * sinky[offy+cnt] * coskz[offz+cnt]
-                     - sinkx[offx+cnt] * cosky[offy+cnt] * sinkz[offz+cnt] 
-                     - coskx[offx+cnt] * sinky[offy+cnt] * sinkz[offz+cnt];
-
-        sinkr[cnt] = - sinkx[offx+cnt] * sinky[offy+cnt] * sinkz[offz+cnt]
-                     + sinkx[offx+cnt] * cosky[offy+cnt] * coskz[offz+cnt]
-                     + coskx[offx+cnt] * sinky[offy+cnt] * coskz[offz+cnt]
-                     + coskx[offx+cnt] * cosky[offy+cnt] * sinkz[offz+cnt];
-
         sum_cos += Q_SM(p,i) * coskr[cnt];
         sum_sin += Q_SM(p,i) * sinkr[cnt];
         cnt++;
       }
     }
+    ew_sum_cos[k] = sum_cos;
+    ew_sum_sin[k] = sum_sin;
+  }
+
+  /* total structure factors */
+  ewald_sum_kspace();
+
+  /* Loop over all reciprocal vectors */
+  for (k=0; k<ew_totk; k++) {
+
+    sum_cos = ew_sum_cos[k];
+    sum_sin = ew_sum_sin[k];
 
     /* updates */
+    ewald_kr(k);
     cnt = 0;
     for (c=0; c<ncells; c++) {
 
@@ -451,8 +406,8 @@ void do_v_kspace(void)
 
       for (i=0; i<p->n; i++) {
 
-	/* update fourier part of v_i */
-        v_k   = ew_expk[k] * (sinkr[cnt] * sum_sin + coskr[cnt] * sum_cos);
+	/* update fourier part of v_i, the derivative of the energy */
+        v_k   = 2.0 * ew_expk[k] * (sinkr[cnt] * sum_sin + coskr[cnt] * sum_cos);
 	/* the total vector v_i */
 	V_SM(p,i) += v_k;
         cnt++;
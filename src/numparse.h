@@ -0,0 +1,161 @@
+
+/******************************************************************************
+*
+* IMD -- The ITAP Molecular Dynamics Program
+*
+* Copyright 1996-2012 Institute for Theoretical and Applied Physics,
+* University of Stuttgart, D-70550 Stuttgart
+*
+******************************************************************************/
+
+/*****************************************************************************
+*
+*  Fast conversion of the numbers in ASCII configuration files, as a
+*  replacement for sscanf. Floating point numbers are converted directly
+*  to real. If the decimal mantissa and the power of ten are both exact
+*  in real (mantissa up to 2^53 and exponent up to 22 for DOUBLE, 2^24
+*  and 10 for float), a single multiplication or division gives the
+*  correctly rounded result. Anything else is passed on to strtod or
+*  strtof, so that the result is the same as with sscanf in both
+*  precisions, unless the compiler relaxes IEEE arithmetic (-ffast-math).
+*
+*  $Revision$
+*  $Date$
+*
+******************************************************************************/
+
+#define NUMPARSE_BLANK(c) (((c)==' ') || ((c)=='\t') || ((c)=='\n') || \
+                           ((c)=='\r') || ((c)=='\v') || ((c)=='\f'))
+#define NUMPARSE_DIGIT(c) (((c)>='0') && ((c)<='9'))
+
+#ifdef DOUBLE
+#define NUMPARSE_MANT_MAX (1ULL << 53)
+#define NUMPARSE_EXP_MAX  22
+#define NUMPARSE_STRTOR   strtod
+#else
+#define NUMPARSE_MANT_MAX (1ULL << 24)
+#define NUMPARSE_EXP_MAX  10
+#define NUMPARSE_STRTOR   strtof
+#endif
+
+static const double numparse_pow10[23] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/******************************************************************************
+*
+*  parse_int converts the next integer in *str, and advances *str;
+*  returns 1 on success, 0 if there is no integer
+*
+******************************************************************************/
+
+static inline int parse_int(char **str, int *val)
+{
+  char *s = *str;
+  long v = 0;
+  int  neg = 0, nd = 0;
+
+  while (NUMPARSE_BLANK(*s)) s++;
+  if      (*s=='-') { neg = 1; s++; }
+  else if (*s=='+') s++;
+  while (NUMPARSE_DIGIT(*s) && (nd < 18)) { v = 10 * v + (*s++ - '0'); nd++; }
+  if (0==nd) return 0;
+  if (NUMPARSE_DIGIT(*s)) {
+    /* too many digits; let strtol handle the overflow */
+    v = strtol(*str, &s, 10);
+    *val = (int) v;
+  }
+  else *val = (int) (neg ? -v : v);
+  *str = s;
+  return 1;
+}
+
+/******************************************************************************
+*
+*  parse_real converts the next floating point number in *str,
+*  and advances *str; returns 1 on success, 0 if there is no number
+*
+******************************************************************************/
+
+static inline int parse_real(char **str, real *val)
+{
+  char *s = *str, *start, *end;
+  unsigned long long m = 0;
+  int  neg = 0, nd = 0, ndig = 0, e = 0, ex = 0, eneg = 0;
+
+  while (NUMPARSE_BLANK(*s)) s++;
+  start = s;
+  if      (*s=='-') { neg = 1; s++; }
+  else if (*s=='+') s++;
+
+  /* mantissa; leading zeros are not significant */
+  while (NUMPARSE_DIGIT(*s)) {
+    if ((m > 0) || (*s != '0')) { m = 10 * m + (*s - '0'); nd++; }
+    ndig++; s++;
+    if (nd > 19) goto slow;
+  }
+  if (*s=='.') {
+    s++;
+    while (NUMPARSE_DIGIT(*s)) {
+      if ((m > 0) || (*s != '0')) { m = 10 * m + (*s - '0'); nd++; }
+      ndig++; e--; s++;
+      if (nd > 19) goto slow;
+    }
+  }
+  if (0==ndig) goto slow;   /* no digits, or something like nan or inf */
+
+  /* exponent */
+  if ((*s=='e') || (*s=='E')) {
+    char *t = s + 1;
+    if      (*t=='-') { eneg = 1; t++; }
+    else if (*t=='+') t++;
+    if (!NUMPARSE_DIGIT(*t)) goto slow;
+    while (NUMPARSE_DIGIT(*t) && (ex < 10000)) ex = 10 * ex + (*t++ - '0');
+    s = t;
+    e += eneg ? -ex : ex;
+  }
+
+  /* number must end here, otherwise strtod decides */
+  if ((*s != '\0') && !NUMPARSE_BLANK(*s)) goto slow;
+  if ((m > NUMPARSE_MANT_MAX) || (e < -NUMPARSE_EXP_MAX) || 
+      (e > NUMPARSE_EXP_MAX)) goto slow;
+
+  if (e < 0) *val = (real) m / (real) numparse_pow10[-e];
+  else       *val = (real) m * (real) numparse_pow10[ e];
+  if (neg) *val = -*val;
+  *str = s;
+  return 1;
+
+ slow:
+  *val = NUMPARSE_STRTOR(start, &end);
+  if (end==start) return 0;
+  *str = end;
+  return 1;
+}
+
+/******************************************************************************
+*
+*  parse_config_line converts a line of an ASCII configuration file:
+*  number and type, followed by at most nmax floating point values.
+*  Like sscanf, returns the number of items converted; a line with a
+*  number but no type returns 1 with type 0, which the caller rejects
+*  as a malformed line.
+*
+******************************************************************************/
+
+static inline int parse_config_line(char *buf, int *n, int *s,
+                                    real *d, int nmax)
+{
+  real   v;
+  int    k;
+
+  *s = 0;
+  if (!parse_int(&buf, n)) return 0;
+  if (!parse_int(&buf, s)) return 1;
+  for (k=0; k<nmax; k++) {
+    if (!parse_real(&buf, &v)) break;
+    d[k] = v;
+  }
+  return k+2;
+}
@@ -25,6 +25,10 @@
 #define   PAIR_INT   PAIR_INT3
 #define   VAL_FUNC   VAL_FUNC3
 #define DERIV_FUNC DERIV_FUNC3
+#elif defined(SPLINE) && defined(SPLINE_PACKED)
+#define   PAIR_INT   PAIR_INT_SPC
+#define   VAL_FUNC   VAL_FUNC_SPC
+#define DERIV_FUNC DERIV_FUNC_SPC
 #elif defined(SPLINE)
 #define   PAIR_INT   PAIR_INT_SP
 #define   VAL_FUNC   VAL_FUNC_SP
@@ -295,10 +299,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   r2a   = r2a *  (pt).invstep[col];                                          \
@@ -328,10 +330,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -371,10 +371,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -426,10 +424,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -470,10 +466,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -509,10 +503,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -552,10 +544,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -596,10 +586,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a   = 0;                                                               \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -636,10 +624,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -680,10 +666,8 @@
   /* check for distances shorter than minimal distance in table */           \
   r2a = MIN((r2),(pt).end[col]);                                             \
   r2a = r2a - (pt).begin[col];                                               \
-  if (r2a < 0) {                                                             \
-    r2a = 0;                                                                 \
-    is_short = 1;                                                            \
-  }                                                                          \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
                                                                              \
   /* indices into potential table */                                         \
   istep = (pt).invstep[col];                                                 \
@@ -709,3 +693,124 @@
   grad = 2*((p2 - p1) * istep + ((3*b2 + 2) * d22 - (3*a2 + 2) * d21) * st6);\
 }
 
+/*****************************************************************************
+*
+*  Spline interpolation with packed coefficients (SPLINE_PACKED). The
+*  spline polynomial of each table interval is stored as four consecutive
+*  coefficients in (pt).coeff, column by column, so that an evaluation
+*  touches a single cache line (see init_spline_coeff). The results
+*  agree with PAIR_INT_SP, VAL_FUNC_SP and DERIV_FUNC_SP up to rounding.
+*  inc is not needed; it is kept for compatibility with the other macros,
+*  and cast to void, so that the force loops do not warn about it.
+*
+******************************************************************************/
+
+#define PAIR_INT_SPC(pot, grad, pt, col, inc, r2, is_short)                  \
+{                                                                            \
+  real r2a, b, istep, *cf;                                                   \
+  int k;                                                                     \
+  (void) (inc);                                                              \
+                                                                             \
+  /* check for distances shorter than minimal distance in table */           \
+  r2a = MIN((r2),(pt).end[col]);                                             \
+  r2a = r2a - (pt).begin[col];                                               \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
+                                                                             \
+  /* index into coefficient table */                                         \
+  istep = (pt).invstep[col];                                                 \
+  r2a   = r2a * istep;                                                       \
+  k     = POS_TRUNC(r2a);                                                    \
+  b     = r2a - k;                                                           \
+  cf    = (pt).coeff + (col) * (pt).cstride + 4 * k;                         \
+                                                                             \
+  /* potential and twice the derivative */                                   \
+  pot  = cf[0] + b * (cf[1] + b * (cf[2] + b * cf[3]));                      \
+  grad = 2 * istep * (cf[1] + b * (2 * cf[2] + 3 * b * cf[3]));              \
+}
+
+#define VAL_FUNC_SPC(val, pt, col, inc, r2, is_short)                        \
+{                                                                            \
+  real r2a, b, *cf;                                                          \
+  int k;                                                                     \
+  (void) (inc);                                                              \
+                                                                             \
+  /* check for distances shorter than minimal distance in table */           \
+  r2a = MIN((r2),(pt).end[col]);                                             \
+  r2a = r2a - (pt).begin[col];                                               \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
+                                                                             \
+  /* index into coefficient table */                                         \
+  r2a   = r2a * (pt).invstep[col];                                           \
+  k     = POS_TRUNC(r2a);                                                    \
+  b     = r2a - k;                                                           \
+  cf    = (pt).coeff + (col) * (pt).cstride + 4 * k;                         \
+                                                                             \
+  /* the function value */                                                   \
+  val  = cf[0] + b * (cf[1] + b * (cf[2] + b * cf[3]));                      \
+}
+
+#define DERIV_FUNC_SPC(grad, pt, col, inc, r2, is_short)                     \
+{                                                                            \
+  real r2a, b, istep, *cf;                                                   \
+  int k;                                                                     \
+  (void) (inc);                                                              \
+                                                                             \
+  /* check for distances shorter than minimal distance in table */           \
+  r2a = MIN((r2),(pt).end[col]);                                             \
+  r2a = r2a - (pt).begin[col];                                               \
+  is_short |= (r2a < 0);                                                     \
+  r2a = MAX(r2a, 0);                                                         \
+                                                                             \
+  /* index into coefficient table */                                         \
+  istep = (pt).invstep[col];                                                 \
+  r2a   = r2a * istep;                                                       \
+  k     = POS_TRUNC(r2a);                                                    \
+  b     = r2a - k;                                                           \
+  cf    = (pt).coeff + (col) * (pt).cstride + 4 * k;                         \
+                                                                             \
+  /* twice the derivative */                                                 \
+  grad = 2 * istep * (cf[1] + b * (2 * cf[2] + 3 * b * cf[3]));              \
+}
+
+/*****************************************************************************
+*
+*  Block versions of the table access macros: evaluate n table entries
+*  at once, for r2[l] in column col[l], l = 0..n-1, with results in
+*  pot[l] and grad[l] (or val[l]). Since the single entry macros have
+*  no branches, the compiler can vectorize these loops, using gathers
+*  for the table values. The result arrays should be local arrays, or
+*  else the compiler may fail to prove that they do not overlap with
+*  the potential table.
+*
+******************************************************************************/
+
+#define PAIR_INT_BLOCK(pot, grad, pt, col, inc, r2, n, is_short)             \
+{                                                                            \
+  int l_blk, sh_blk = 0;                                                     \
+  for (l_blk=0; l_blk<(n); l_blk++) {                                        \
+    PAIR_INT((pot)[l_blk], (grad)[l_blk], pt, (col)[l_blk], inc,             \
+             (r2)[l_blk], sh_blk);                                           \
+  }                                                                          \
+  is_short |= sh_blk;                                                        \
+}
+
+#define VAL_FUNC_BLOCK(val, pt, col, inc, r2, n, is_short)                   \
+{                                                                            \
+  int l_blk, sh_blk = 0;                                                     \
+  for (l_blk=0; l_blk<(n); l_blk++) {                                        \
+    VAL_FUNC((val)[l_blk], pt, (col)[l_blk], inc, (r2)[l_blk], sh_blk);      \
+  }                                                                          \
+  is_short |= sh_blk;                                                        \
+}
+
+#define DERIV_FUNC_BLOCK(grad, pt, col, inc, r2, n, is_short)                \
+{                                                                            \
+  int l_blk, sh_blk = 0;                                                     \
+  for (l_blk=0; l_blk<(n); l_blk++) {                                        \
+    DERIV_FUNC((grad)[l_blk], pt, (col)[l_blk], inc, (r2)[l_blk], sh_blk);   \
+  }                                                                          \
+  is_short |= sh_blk;                                                        \
+}
+
@@ -68,11 +68,18 @@ void deriv_func2(       real*, int*, pot_table_t*, int, int, real);
 void deriv_func3(       real*, int*, pot_table_t*, int, int, real);
 void init_pre_pot(void);
 void create_pot_table(pot_table_t *pt);
+real pre_pot_val(int, int, real);
+real pot_table_error(int, int, real, real, int);
+int  pot_table_size(int, int, real, real);
+void write_pot_table(pot_table_t*, char*);
 void test_potential(pot_table_t, char*, int);
 #if   defined(FOURPOINT)
 void init_fourpoint(pot_table_t*, int);
 #elif defined(SPLINE)
 void init_spline(pot_table_t*, int, int);
+#ifdef SPLINE_PACKED
+void init_spline_coeff(pot_table_t*, int);
+#endif
 #else
 void init_threepoint(pot_table_t*, int);
 #endif
@@ -82,6 +89,11 @@ void read_atoms(str255 infilename);
 void read_atoms_cleanup(void);  
 #ifdef MPI
 void recv_atoms(void);
+int  read_atoms_mpiio(str255 infilename, header_info_t *info, 
+                      int **num, int **typ, double **dat);
+int  read_atoms_ascii(str255 infilename, header_info_t *info, 
+                      int **num, int **typ, double **dat, int **cnt);
+void send_input_atoms(msgbuf *input_buf);
 #endif
 
 /* generate configuration - file imd_generate.c */
@@ -189,13 +201,32 @@ void do_forces2(cell*, real*, real*, real*, real*, real*, real*, real*, real*);
 #endif
 #ifdef EAM2
 void do_forces_eam2(cell*, cell*, vektor, real*, real*, real*, real*, real*, real*, real*);
+#ifdef EAM2_CACHE
+void do_forces_cache(cell*, cell*, vektor, eam2_cache_t*, real*, real*, real*, real*, real*, real*, real*, real*);
+void do_forces_eam2_cache(cell*, cell*, vektor, eam2_cache_t*, real*, real*, real*, real*, real*, real*, real*);
+void increase_eam2_cache(eam2_cache_t *ec, int count);
+void alloc_eam2_cache(void);
+#endif
 void do_embedding_energy(void);
 #endif
 #ifdef NBLIST
-int  estimate_nblist_size(void);
 void make_nblist(void);
 void check_nblist(void);
+void adapt_nbl_margin(real);
 void deallocate_nblist(void);
+void make_nbl_colors(void);
+void make_nbl_clusters(void);
+void calc_pair_clusters(int);
+void calc_pair_blocks(int);
+void sort_nbl_cells(void);
+void calc_forces_full(int);
+int  nbl_cell_nbrs(int, int*);
+void nbl_pack_atoms(void);
+void nbl_add_packed(int);
+#ifdef EAM2
+void do_embedding_energy_nbl(void);
+void nbl_pack_dF(void);
+#endif
 #endif
 #ifdef MEAM
 void init_meam(void);
@@ -256,6 +287,16 @@ void unpack_forces( msgbuf *b, int j, int k );
 void send_cells (void (*copy_func)  (int, int, int, int, int, int, vektor),
                  void (*pack_func)  (msgbuf*, int, int, int, vektor),
                  void (*unpack_func)(msgbuf*, int, int, int));
+void send_cells_begin(void (*copy_func)  (int, int, int, int, int, int, vektor),
+                      void (*pack_func)  (msgbuf*, int, int, int, vektor),
+                      void (*unpack_func)(msgbuf*, int, int, int));
+int  send_cells_test(void);
+void send_cells_end(void);
+#ifdef COMM_LISTS
+void make_comm_lists(void);
+void send_cells_lists(void);
+void send_forces_lists(void);
+#endif
 void sync_cells (void (*copy_func)  (int, int, int, int, int, int, vektor),
                  void (*pack_func)  (msgbuf*, int, int, int, vektor),
                  void (*unpack_func)(msgbuf*, int, int, int));
@@ -355,9 +396,25 @@ void write_config(int fzhlr, int steps);
 #ifdef RELAX
 void write_ssconfig(int steps);
 #endif
+void config_file_name(str255 fname, int fzhlr, char *suffix, char *tail);
+FILE *open_config_file(int fzhlr, char *suffix,
+  void (*write_header_fun)(FILE *out));
 void write_config_select(int fzhlr, char *suffix,
   void (*write_atoms_fun)(FILE *out), void (*write_header_fun)(FILE *out));
 void write_atoms_config(FILE *out);
+int  format_atom_config(char *buf, cell *p, int i);
+int  pack_atom_config(i_or_r *data, cell *p, int i);
+#ifdef CNA
+int  config_crist(cell *p, int i);
+#endif
+#ifdef MPI
+void write_config_mpiio(int fzhlr, char *suffix);
+#endif
+#ifdef ASYNC_CKPT
+void write_config_async(int fzhlr, char *suffix);
+void *write_config_thread(void *arg);
+void wait_config_async(void);
+#endif
 void write_header_config(FILE *out);
 void write_atoms_pic(FILE *out); 
 void write_header_pic(FILE *out); 
@@ -603,8 +660,13 @@ void write_lb_status(int);
 void write_config_lb(FILE*);
 void write_header_lb(FILE*);
 void write_lb_file(int, int);
+void write_lbcost_file(int);
 
 int lb_countAtoms(void);
+real lb_getCellCost(int, int, int);
+real lb_getCellLoad(int, int, int);
+real lb_getCost(void);
+void lb_measureLoad(void);
 void lb_computeVariance(void);
 
 void lb_processCellDataBuffer(msgbuf*,
@@ -615,9 +677,15 @@ void lb_processForceDataBuffer(msgbuf*,
 
 void lb_moveCornersReset(real*, int iteration);
 
-void lb_balanceOneAxisOrthogonal(int, int, int*, int*);
+void lb_balanceOneAxisOrthogonal(int, int, long*, int*);
 void balanceOrtho(void);
 
+int balanceBisection(void);
+void lb_bisectLoad(real*, int, int, int, int*);
+int lb_findInterval(int*, int, int);
+int lb_bisectionOwner(int, int, int);
+void lb_migrateParticles(ivektor, ivektor, cell*);
+
 #endif
 
 #ifdef BBOOST
@@ -629,9 +697,21 @@ bb_neightab *alloc_bb_neightab(bb_neightab *bb_neigh, int count);
 /* support for computation of Coulomb forces */
 void do_forces_ewald(int);
 void do_forces_ewald_real(void);
-void do_forces_ewald_fourier(void);
+void do_forces_ewald_fourier(real);
+void do_forces_ewald_respa(int);
+void ewald_kr_tables(void);
+void ewald_kr(int k);
+void ewald_sum_kspace(void);
 void init_ewald(void);
 #endif
+#ifdef PME
+void init_pme(void);
+int  pme_fft_size(int n);
+void do_forces_pme(real);
+#ifdef SM
+void do_v_pme(void);
+#endif
+#endif
 #if defined(EWALD) || defined(COULOMB)
 real erfc1(real x);
 #endif
@@ -797,6 +877,7 @@ void ttm_overwrite(void);
 #ifdef SM
 /* Streitz and Mintmire model SM - file imd_sm.c */
 void init_sm(void);
+int  charge_update_due(int);
 void do_electronegativity(void);
 void do_v_real(void);
 void do_cg(void);
@@ -375,12 +375,31 @@ typedef struct {
 #endif
 } pair;
 
+#ifdef EAM2_CACHE
+/* atom pairs of a cell pair within the rho_h cutoff, with the rho_h 
+   derivatives, cached by the first EAM2 force loop for the second one */
+typedef struct {
+  int     n, n_max;
+  integer *ij;     /* atom i in first cell, atom j in second cell */
+  real    *drho;   /* rho_i'(r_ij), rho_j'(r_ij) [, rho_i, rho_j (EEAM)] */
+} eam2_cache_t;
+#endif
+
 #ifdef NBLIST
 typedef struct {
   integer np, nq[NNBCELL];
 } cell_nbrs_t;
 #endif
 
+#ifdef COMM_LISTS
+/* atoms sent to or received into buffer cells in one direction */
+typedef struct {
+  int      n, n_max;
+  minicell **cell;  /* cell of the atom */
+  int      *ind;    /* number of the atom in the cell */
+} comm_list_t;
+#endif
+
 /* Buffer for messages */
 typedef struct {
   real *data;
@@ -424,6 +443,10 @@ typedef struct {
   real *table;      /* the actual data */
 #ifdef SPLINE
   real *table2;     /* second derivatives for spine interpolation */
+#ifdef SPLINE_PACKED
+  real *coeff;      /* packed spline coefficients, column by column */
+  int  cstride;     /* distance of the columns in coeff */
+#endif
 #endif
 } pot_table_t;
 
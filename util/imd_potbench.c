@@ -0,0 +1,336 @@
+/******************************************************************************
+*
+*  IMD -- The ITAP Molecular Dynamics Program
+*
+*  Copyright 1996-2011 Institute for Theoretical and Applied Physics,
+*  University of Stuttgart, D-70550 Stuttgart
+*
+*  $Revision$
+*  $Date$
+*
+******************************************************************************/
+
+/******************************************************************************
+*
+*  imd_potbench measures the cost of the potential table access macros
+*  of IMD (src/potaccess.h), for quadratic, cubic (4-point) and spline
+*  interpolation, and for spline interpolation with packed coefficients
+*  (SPLINE_PACKED). For each interpolation order, PAIR_INT, VAL_FUNC and
+*  DERIV_FUNC are evaluated for a large set of random squared distances,
+*  once pair by pair, as in the scalar force loops, and once in blocks
+*  with the PAIR_INT_BLOCK, VAL_FUNC_BLOCK and DERIV_FUNC_BLOCK macros.
+*  The time per pair is reported in nanoseconds.
+*
+*  The table is a Lennard-Jones potential for two atom types, with the
+*  usual IMD layout, and with the default table resolution of IMD. Use
+*  the same compiler flags as for IMD, for the numbers to be meaningful.
+*  The number of atom types can be changed with -DNTYPES=n; with many
+*  types, the columns of the interleaved table are far apart.
+*
+*  Compilation:  gcc -o imd_potbench -O3 imd_potbench.c -lm
+*
+*  Usage:        imd_potbench [npairs [nrep]]
+*
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+typedef double real;
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+#define SQR(a)   ((a) * (a))
+
+#define PTR_2D(var,i,j,dim_i,dim_j) (((var) + ((i)*(dim_j)) + (j)))
+
+/* same as in src/types.h, with SPLINE and SPLINE_PACKED */
+typedef struct {
+  real *begin;      /* first value in the table */
+  real *end;        /* last value in the table (followed by extra zeros) */
+  real *step;       /* table increment */
+  real *invstep;    /* inverse of increment */
+  int  *len;        /* length of the individual columns */
+  int  ncols;       /* number of columns in the table */
+  int  maxsteps;    /* physical length of the table */
+  real *table;      /* the actual data */
+  real *table2;     /* second derivatives for spine interpolation */
+  real *coeff;      /* packed spline coefficients, column by column */
+  int  cstride;     /* distance of the columns in coeff */
+} pot_table_t;
+
+#include "../src/potaccess.h"
+
+#ifndef NTYPES
+#define NTYPES  2       /* number of atom types */
+#endif
+#define NCOLS   (NTYPES * NTYPES)   /* columns of the table */
+#define NSTEPS  10000   /* table length */
+#define BLOCK   64      /* block size for the block macros */
+
+pot_table_t pt;
+real *r2, sum;
+int  *col, npairs, nrep, is_short;
+
+/******************************************************************************
+*
+*  make_table - tabulate a Lennard-Jones potential in r^2, with a few
+*  extra entries at the end, as read_pot_table does, and pack the spline
+*  coefficients as init_spline_coeff does
+*
+******************************************************************************/
+
+void make_table(void)
+{
+  int  i, k, inc = NTYPES * NTYPES;
+  real sig[NTYPES];
+
+  for (i=0; i<NTYPES; i++) sig[i] = 1.0 + 0.1 * i;
+
+  pt.ncols    = inc;
+  pt.maxsteps = NSTEPS + 4;
+  pt.begin    = (real *) malloc( inc * sizeof(real) );
+  pt.end      = (real *) malloc( inc * sizeof(real) );
+  pt.step     = (real *) malloc( inc * sizeof(real) );
+  pt.invstep  = (real *) malloc( inc * sizeof(real) );
+  pt.len      = (int  *) malloc( inc * sizeof(int ) );
+  pt.table    = (real *) calloc( pt.maxsteps * inc, sizeof(real) );
+  pt.table2   = (real *) calloc( pt.maxsteps * inc, sizeof(real) );
+  pt.cstride  = 4 * (pt.maxsteps + 2);
+  if (posix_memalign((void **) &pt.coeff, 64,
+                     pt.cstride * inc * sizeof(real))) pt.coeff = NULL;
+  if ((NULL==pt.table) || (NULL==pt.table2) || (NULL==pt.coeff)) {
+    fprintf(stderr, "cannot allocate potential table\n");
+    exit(1);
+  }
+
+  for (i=0; i<inc; i++) {
+    real s = 0.5 * (sig[i / NTYPES] + sig[i % NTYPES]);
+    pt.begin  [i] = SQR(0.8 * s);
+    pt.end    [i] = SQR(2.5 * s);
+    pt.step   [i] = (pt.end[i] - pt.begin[i]) / (NSTEPS - 1);
+    pt.invstep[i] = 1.0 / pt.step[i];
+    pt.len    [i] = NSTEPS;
+    for (k=0; k<NSTEPS; k++) {
+      real x = pt.begin[i] + k * pt.step[i], s6 = s * s * s / (x * x * x);
+      pt.table[k * inc + i] = 4.0 * (s6 * s6 - s6);
+    }
+    /* second derivatives, as finite differences */
+    for (k=1; k<NSTEPS-1; k++)
+      pt.table2[k * inc + i] = (pt.table[(k+1) * inc + i]
+        - 2 * pt.table[k * inc + i] + pt.table[(k-1) * inc + i])
+        * SQR(pt.invstep[i]);
+    /* packed coefficients of the spline polynomials */
+    memset(pt.coeff + i * pt.cstride, 0, pt.cstride * sizeof(real));
+    for (k=0; k<NSTEPS-1; k++) {
+      real h  = SQR(pt.step[i]) / 6, *c = pt.coeff + i * pt.cstride + 4 * k;
+      real p1 = pt.table [k * inc + i], p2  = pt.table [(k+1) * inc + i];
+      real d1 = pt.table2[k * inc + i], d2  = pt.table2[(k+1) * inc + i];
+      c[0] = p1;
+      c[1] = (p2 - p1) - h * (2 * d1 + d2);
+      c[2] = 3 * h * d1;
+      c[3] = h * (d2 - d1);
+    }
+  }
+}
+
+/******************************************************************************
+*
+*  make_pairs - random squared distances and table columns, all
+*  within the range of the table
+*
+******************************************************************************/
+
+void make_pairs(void)
+{
+  int l;
+
+  r2  = (real *) malloc( npairs * sizeof(real) );
+  col = (int  *) malloc( npairs * sizeof(int ) );
+  if ((NULL==r2) || (NULL==col)) {
+    fprintf(stderr, "cannot allocate pairs\n");
+    exit(1);
+  }
+  srand(4711);
+  for (l=0; l<npairs; l++) {
+    real x = rand() / (RAND_MAX + 1.0);
+    col[l] = rand() % (NTYPES * NTYPES);
+    r2 [l] = pt.begin[col[l]] + x * (pt.end[col[l]] - pt.begin[col[l]]);
+  }
+}
+
+/******************************************************************************
+*
+*  Benchmark loops, for the interpolation order selected by PAIR_INT,
+*  VAL_FUNC and DERIV_FUNC. They are redefined for each order below.
+*
+******************************************************************************/
+
+#define BENCH_LOOPS(suffix)                                                  \
+                                                                             \
+void pair_scalar##suffix(void)                                               \
+{                                                                            \
+  int  l;                                                                    \
+  real pot, grad;                                                            \
+  for (l=0; l<npairs; l++) {                                                 \
+    PAIR_INT(pot, grad, pt, col[l], NCOLS, r2[l], is_short);                 \
+    sum += pot + grad;                                                       \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+void pair_block##suffix(void)                                                \
+{                                                                            \
+  int  l, m;                                                                 \
+  real pot[BLOCK], grad[BLOCK];                                              \
+  for (m=0; m<npairs; m+=BLOCK) {                                            \
+    int n = MIN(BLOCK, npairs - m);                                          \
+    PAIR_INT_BLOCK(pot, grad, pt, col + m, NCOLS, r2 + m, n, is_short);      \
+    for (l=0; l<n; l++) sum += pot[l] + grad[l];                             \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+void val_scalar##suffix(void)                                                \
+{                                                                            \
+  int  l;                                                                    \
+  real val;                                                                  \
+  for (l=0; l<npairs; l++) {                                                 \
+    VAL_FUNC(val, pt, col[l], NCOLS, r2[l], is_short);                       \
+    sum += val;                                                              \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+void val_block##suffix(void)                                                 \
+{                                                                            \
+  int  l, m;                                                                 \
+  real val[BLOCK];                                                           \
+  for (m=0; m<npairs; m+=BLOCK) {                                            \
+    int n = MIN(BLOCK, npairs - m);                                          \
+    VAL_FUNC_BLOCK(val, pt, col + m, NCOLS, r2 + m, n, is_short);            \
+    for (l=0; l<n; l++) sum += val[l];                                       \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+void deriv_scalar##suffix(void)                                              \
+{                                                                            \
+  int  l;                                                                    \
+  real grad;                                                                 \
+  for (l=0; l<npairs; l++) {                                                 \
+    DERIV_FUNC(grad, pt, col[l], NCOLS, r2[l], is_short);                    \
+    sum += grad;                                                             \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+void deriv_block##suffix(void)                                               \
+{                                                                            \
+  int  l, m;                                                                 \
+  real grad[BLOCK];                                                          \
+  for (m=0; m<npairs; m+=BLOCK) {                                            \
+    int n = MIN(BLOCK, npairs - m);                                          \
+    DERIV_FUNC_BLOCK(grad, pt, col + m, NCOLS, r2 + m, n, is_short);         \
+    for (l=0; l<n; l++) sum += grad[l];                                      \
+  }                                                                          \
+}
+
+#undef  PAIR_INT
+#undef  VAL_FUNC
+#undef  DERIV_FUNC
+#define   PAIR_INT   PAIR_INT2
+#define   VAL_FUNC   VAL_FUNC2
+#define DERIV_FUNC DERIV_FUNC2
+BENCH_LOOPS(2)
+
+#undef  PAIR_INT
+#undef  VAL_FUNC
+#undef  DERIV_FUNC
+#define   PAIR_INT   PAIR_INT3
+#define   VAL_FUNC   VAL_FUNC3
+#define DERIV_FUNC DERIV_FUNC3
+BENCH_LOOPS(3)
+
+#undef  PAIR_INT
+#undef  VAL_FUNC
+#undef  DERIV_FUNC
+#define   PAIR_INT   PAIR_INT_SP
+#define   VAL_FUNC   VAL_FUNC_SP
+#define DERIV_FUNC DERIV_FUNC_SP
+BENCH_LOOPS(_sp)
+
+#undef  PAIR_INT
+#undef  VAL_FUNC
+#undef  DERIV_FUNC
+#define   PAIR_INT   PAIR_INT_SPC
+#define   VAL_FUNC   VAL_FUNC_SPC
+#define DERIV_FUNC DERIV_FUNC_SPC
+BENCH_LOOPS(_spc)
+
+/******************************************************************************
+*
+*  ns_per_pair - time a benchmark loop
+*
+******************************************************************************/
+
+real ns_per_pair(void (*loop)(void))
+{
+  clock_t t;
+  int     i;
+
+  loop();   /* warm up */
+  t = clock();
+  for (i=0; i<nrep; i++) loop();
+  t = clock() - t;
+  return 1e9 * t / CLOCKS_PER_SEC / ((real) nrep * npairs);
+}
+
+/******************************************************************************
+*
+*  main
+*
+******************************************************************************/
+
+int main(int argc, char **argv)
+{
+  npairs = (argc > 1) ? atoi(argv[1]) : 1000000;
+  nrep   = (argc > 2) ? atoi(argv[2]) : 20;
+  if ((npairs < 1) || (nrep < 1)) {
+    fprintf(stderr, "Usage: %s [npairs [nrep]]\n", argv[0]);
+    exit(1);
+  }
+  make_table();
+  make_pairs();
+
+  printf("# %d pairs, %d types, %d repetitions, ns per pair\n",
+         npairs, NTYPES, nrep);
+  printf("# interpolation    function    scalar     block\n");
+  printf("  quadratic        PAIR_INT   %7.3f   %7.3f\n",
+         ns_per_pair(pair_scalar2),  ns_per_pair(pair_block2));
+  printf("  quadratic        VAL_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(val_scalar2),   ns_per_pair(val_block2));
+  printf("  quadratic      DERIV_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(deriv_scalar2), ns_per_pair(deriv_block2));
+  printf("  cubic            PAIR_INT   %7.3f   %7.3f\n",
+         ns_per_pair(pair_scalar3),  ns_per_pair(pair_block3));
+  printf("  cubic            VAL_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(val_scalar3),   ns_per_pair(val_block3));
+  printf("  cubic          DERIV_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(deriv_scalar3), ns_per_pair(deriv_block3));
+  printf("  spline           PAIR_INT   %7.3f   %7.3f\n",
+         ns_per_pair(pair_scalar_sp),  ns_per_pair(pair_block_sp));
+  printf("  spline           VAL_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(val_scalar_sp),   ns_per_pair(val_block_sp));
+  printf("  spline         DERIV_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(deriv_scalar_sp), ns_per_pair(deriv_block_sp));
+  printf("  spline packed    PAIR_INT   %7.3f   %7.3f\n",
+         ns_per_pair(pair_scalar_spc),  ns_per_pair(pair_block_spc));
+  printf("  spline packed    VAL_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(val_scalar_spc),   ns_per_pair(val_block_spc));
+  printf("  spline packed  DERIV_FUNC   %7.3f   %7.3f\n",
+         ns_per_pair(deriv_scalar_spc), ns_per_pair(deriv_block_spc));
+
+  /* keep the results alive */
+  if (is_short) printf("# short distances\n");
+  printf("# checksum %e\n", sum);
+  return 0;
+}
@@ -0,0 +1,197 @@
+/******************************************************************************
+*
+*  IMD -- The ITAP Molecular Dynamics Program
+*
+*  Copyright 1996-2012 Institute for Theoretical and Applied Physics,
+*  University of Stuttgart, D-70550 Stuttgart
+*
+*  $Revision$
+*  $Date$
+*
+******************************************************************************/
+
+/******************************************************************************
+*
+*  imd_readbench measures the cost of converting the lines of an ASCII
+*  configuration file, with sscanf as in the old reader of IMD, and with
+*  parse_config_line from src/numparse.h, as used by the current readers.
+*  A set of lines in the format of a checkpoint (number, type, mass,
+*  position, velocity, potential energy) is generated in memory, and
+*  converted repeatedly by both methods. The results must agree bit by bit.
+*  The time per line is reported in nanoseconds.
+*
+*  Compilation:  gcc -o imd_readbench -O3 imd_readbench.c -lm
+*
+*  Usage:        imd_readbench [nlines [nrep]]
+*
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef double real;
+
+#include "../src/numparse.h"
+
+#define NDATA   8       /* mass, position, velocity, potential energy */
+#define LINELEN 256     /* maximal length of a line */
+
+char *lines;
+int  nlines, nrep, nerr;
+int  *num, *typ;
+real *dat, sum;
+
+/******************************************************************************
+*
+*  make_lines - random atoms, formatted as write_atoms_config does
+*
+******************************************************************************/
+
+void make_lines(void)
+{
+  int l;
+
+  lines = (char *) malloc( (size_t) nlines * LINELEN );
+  num   = (int  *) malloc( nlines * sizeof(int) );
+  typ   = (int  *) malloc( nlines * sizeof(int) );
+  dat   = (real *) malloc( (size_t) nlines * NDATA * sizeof(real) );
+  if ((NULL==lines) || (NULL==num) || (NULL==typ) || (NULL==dat)) {
+    fprintf(stderr, "cannot allocate lines\n");
+    exit(1);
+  }
+  srand(4711);
+  for (l=0; l<nlines; l++) {
+    real x[NDATA];
+    int  k;
+    x[0] = 26.98;
+    for (k=1; k<4; k++) x[k] = 100.0 * rand() / (RAND_MAX + 1.0);
+    for (k=4; k<7; k++) x[k] = 0.1 * rand() / (RAND_MAX + 1.0) - 0.05;
+    x[7] = -3.36 + 0.1 * rand() / (RAND_MAX + 1.0);
+    sprintf(lines + (size_t) l * LINELEN,
+            "%d %d %12.16g %12.16g %12.16g %12.16g %12.16g %12.16g %12.16g "
+            "%12.16g\n", l, rand() % 2, x[0], x[1], x[2], x[3], x[4], x[5],
+            x[6], x[7]);
+  }
+}
+
+/******************************************************************************
+*
+*  read_sscanf - convert the lines with sscanf
+*
+******************************************************************************/
+
+void read_sscanf(void)
+{
+  int l;
+
+  for (l=0; l<nlines; l++) {
+    real *d = dat + (size_t) l * NDATA;
+    int  p  = sscanf(lines + (size_t) l * LINELEN,
+                     "%d %d %lf %lf %lf %lf %lf %lf %lf %lf", num + l, typ + l,
+                     d, d+1, d+2, d+3, d+4, d+5, d+6, d+7);
+    if (p != NDATA + 2) nerr++;
+    sum += d[1];
+  }
+}
+
+/******************************************************************************
+*
+*  read_numparse - convert the lines with parse_config_line
+*
+******************************************************************************/
+
+void read_numparse(void)
+{
+  int l;
+
+  for (l=0; l<nlines; l++) {
+    real *d = dat + (size_t) l * NDATA;
+    int  p  = parse_config_line(lines + (size_t) l * LINELEN, num + l,
+                                typ + l, d, NDATA);
+    if (p != NDATA + 2) nerr++;
+    sum += d[1];
+  }
+}
+
+/******************************************************************************
+*
+*  compare - check that both methods give identical results
+*
+******************************************************************************/
+
+void compare(void)
+{
+  int  *num2, *typ2;
+  real *dat2;
+
+  read_sscanf();
+  num2 = num; typ2 = typ; dat2 = dat;
+  num  = (int  *) malloc( nlines * sizeof(int) );
+  typ  = (int  *) malloc( nlines * sizeof(int) );
+  dat  = (real *) malloc( (size_t) nlines * NDATA * sizeof(real) );
+  if ((NULL==num) || (NULL==typ) || (NULL==dat)) {
+    fprintf(stderr, "cannot allocate lines\n");
+    exit(1);
+  }
+  read_numparse();
+  if (memcmp(num, num2, nlines * sizeof(int)) ||
+      memcmp(typ, typ2, nlines * sizeof(int)) ||
+      memcmp(dat, dat2, (size_t) nlines * NDATA * sizeof(real))) {
+    fprintf(stderr, "sscanf and parse_config_line disagree\n");
+    exit(1);
+  }
+  free(num2); free(typ2); free(dat2);
+}
+
+/******************************************************************************
+*
+*  ns_per_line - time a conversion loop
+*
+******************************************************************************/
+
+real ns_per_line(void (*loop)(void))
+{
+  clock_t t;
+  int     i;
+
+  loop();   /* warm up */
+  t = clock();
+  for (i=0; i<nrep; i++) loop();
+  t = clock() - t;
+  return 1e9 * t / CLOCKS_PER_SEC / ((real) nrep * nlines);
+}
+
+/******************************************************************************
+*
+*  main
+*
+******************************************************************************/
+
+int main(int argc, char **argv)
+{
+  real t1, t2;
+
+  nlines = (argc > 1) ? atoi(argv[1]) : 200000;
+  nrep   = (argc > 2) ? atoi(argv[2]) : 10;
+  if ((nlines < 1) || (nrep < 1)) {
+    fprintf(stderr, "Usage: %s [nlines [nrep]]\n", argv[0]);
+    exit(1);
+  }
+  make_lines();
+  compare();
+
+  t1 = ns_per_line(read_sscanf);
+  t2 = ns_per_line(read_numparse);
+  printf("# %d lines, %d repetitions\n", nlines, nrep);
+  printf("# method                ns/line    Mlines/s\n");
+  printf("  sscanf             %10.1f  %10.3f\n", t1, 1e3 / t1);
+  printf("  parse_config_line  %10.1f  %10.3f\n", t2, 1e3 / t2);
+  printf("# speedup %.2f\n", t1 / t2);
+
+  /* keep the results alive */
+  if (nerr) printf("# %d lines not converted completely\n", nerr);
+  printf("# checksum %e\n", sum);
+  return 0;
+}